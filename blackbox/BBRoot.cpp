@@ -84,6 +84,49 @@ HBITMAP make_root_bmp(const char *command)
     return bmp;
 }
 
+// bsetroot writes the bitmap at the screen size. With a 32 bit display
+// its rows are read straight into a dib section then, which paints as
+// fast as a compatible bitmap, without the buffer for the whole file,
+// CreateDIBitmap and the StretchBlt copy.
+static HBITMAP read_bitmap_direct(FILE *fp, BITMAPFILEHEADER *hdr, BITMAPINFOHEADER *bih, HDC hdc_desk)
+{
+    BITMAPINFOHEADER bmi;
+    HBITMAP bmp;
+    BYTE *bits, *row, *s, *d;
+    int w, h, x, y, stride;
+
+    w = bih->biWidth, h = bih->biHeight;
+    if (w != VScreenWidth || h != VScreenHeight
+     || BI_RGB != bih->biCompression
+     || (24 != bih->biBitCount && 32 != bih->biBitCount)
+     || 32 != GetDeviceCaps(hdc_desk, BITSPIXEL))
+        return NULL;
+
+    memset(&bmi, 0, sizeof bmi);
+    bmi.biSize = sizeof bmi;
+    bmi.biWidth = w;
+    bmi.biHeight = h;
+    bmi.biPlanes = 1;
+    bmi.biBitCount = 32;
+    bmi.biCompression = BI_RGB;
+    bmp = CreateDIBSection(hdc_desk, (BITMAPINFO*)&bmi, DIB_RGB_COLORS, (void**)&bits, NULL, 0);
+    if (NULL == bmp)
+        return NULL;
+
+    fseek(fp, hdr->bfOffBits, SEEK_SET);
+    if (32 == bih->biBitCount) {
+        fread(bits, 4, w * h, fp);
+    } else {
+        stride = (w * 3 + 3) & ~3;
+        row = (BYTE*)m_alloc(stride);
+        for (y = 0; y < h && 1 == fread(row, stride, 1, fp); ++y)
+            for (s = row, d = bits + y * w * 4, x = 0; x < w; ++x, s += 3, d += 4)
+                d[0] = s[0], d[1] = s[1], d[2] = s[2], d[3] = 0;
+        m_free(row);
+    }
+    return bmp;
+}
+
 static HBITMAP read_bitmap(const char* path, bool delete_after)
 {
     HWND hwnd_desk = GetDesktopWindow();
@@ -93,6 +136,7 @@ static HBITMAP read_bitmap(const char* path, bool delete_after)
     HBITMAP bmp = (HBITMAP)LoadImage(NULL, path, IMAGE_BITMAP, 0,0, LR_LOADFROMFILE);
 #else
     HBITMAP bmp = NULL;
+    bool direct = false;
     FILE *fp=fopen(path, "rb");
     if (fp)
     {
@@ -102,22 +146,26 @@ static HBITMAP read_bitmap(const char* path, bool delete_after)
         {
             BITMAPINFOHEADER bih, *pbih; int CU, s; void *lpBits;
             fread(&bih, 1, sizeof(bih), fp);
-            CU = bih.biClrUsed * sizeof(RGBQUAD);
-            pbih = (PBITMAPINFOHEADER)m_alloc(bih.biSize + CU);
-            memmove(pbih, &bih, bih.biSize);
-            fread(&((BITMAPINFO*)pbih)->bmiColors, 1, CU, fp);
-            s = hdr.bfSize - hdr.bfOffBits;
-            lpBits = m_alloc(s);
-            fseek(fp, hdr.bfOffBits, SEEK_SET);
-            fread(lpBits, 1, s, fp);
-            bmp = CreateDIBitmap(hdc_desk, pbih, CBM_INIT, lpBits, (LPBITMAPINFO)pbih, DIB_RGB_COLORS);
-            m_free(lpBits);
-            m_free(pbih);
+            bmp = read_bitmap_direct(fp, &hdr, &bih, hdc_desk);
+            direct = NULL != bmp;
+            if (false == direct) {
+                CU = bih.biClrUsed * sizeof(RGBQUAD);
+                pbih = (PBITMAPINFOHEADER)m_alloc(bih.biSize + CU);
+                memmove(pbih, &bih, bih.biSize);
+                fread(&((BITMAPINFO*)pbih)->bmiColors, 1, CU, fp);
+                s = hdr.bfSize - hdr.bfOffBits;
+                lpBits = m_alloc(s);
+                fseek(fp, hdr.bfOffBits, SEEK_SET);
+                fread(lpBits, 1, s, fp);
+                bmp = CreateDIBitmap(hdc_desk, pbih, CBM_INIT, lpBits, (LPBITMAPINFO)pbih, DIB_RGB_COLORS);
+                m_free(lpBits);
+                m_free(pbih);
+            }
         }
         fclose(fp);
     }
 #endif
-    if (bmp && GetObject(bmp, sizeof bm, &bm))
+    if (bmp && false == direct && GetObject(bmp, sizeof bm, &bm))
     {
         // convert in any case (20ms), bc if it's compatible, it's faster to paint.
         HDC hdc_old = CreateCompatibleDC(hdc_desk);
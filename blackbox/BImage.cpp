@@ -62,6 +62,17 @@ struct bimage
     unsigned char lite_table[256];
     unsigned char *xtab;
     unsigned char *ytab;
+
+    // for bimage_create_strip
+    int rows;
+    int type;
+    bool interlaced;
+    bool sunken;
+    int bevelposition;
+    DWORD solid[2];
+    unsigned char bevel_dark[256];
+    unsigned char bevel_lite[256];
+
     unsigned char pixels[1];
 };
 
@@ -179,15 +190,20 @@ inline static unsigned char trans_late(int i, int d)
     return r > 255 ? 255 : r;
 }
 
-static void make_delta_table(struct bimage *bi, int *m, bool inv)
+static void make_tables(unsigned char *dark, unsigned char *lite, int *m, bool inv)
 {
     int i = 0;
     do {
-        bi->dark_table[i] = trans_late(i, m[inv]);
-        bi->lite_table[i] = trans_late(i, m[!inv]);
+        dark[i] = trans_late(i, m[inv]);
+        lite[i] = trans_late(i, m[!inv]);
     } while (++i < 256);
 }
 
+static void make_delta_table(struct bimage *bi, int *m, bool inv)
+{
+    make_tables(bi->dark_table, bi->lite_table, m, inv);
+}
+
 /* make a single pixel darker or lighter */
 static void modify_pixel(unsigned char *pixel, int *m, bool inv)
 {
@@ -274,9 +290,9 @@ inline static void diag_fn(struct bimage *bi, unsigned char *c, int x, int y)
 inline static void rect_fn(struct bimage *bi, unsigned char *c, int x, int y)
 {
     if (bi->alternativ ^ (x*bi->height <= y*bi->width))
-        *(unsigned long*)c = ((unsigned long*)bi->xtab)[x];
+        *(DWORD*)c = ((DWORD*)bi->xtab)[x];
     else
-        *(unsigned long*)c = ((unsigned long*)bi->ytab)[y];
+        *(DWORD*)c = ((DWORD*)bi->ytab)[y];
 }
 
 inline static void elli_fn(struct bimage *bi, unsigned char *c, int x, int y)
@@ -284,32 +300,17 @@ inline static void elli_fn(struct bimage *bi, unsigned char *c, int x, int y)
     int dx = SQF - 1 - SQF * x / bi->width;
     int dy = SQF - 1 - SQF * y / bi->height;
     int f = _sqrt_table[(dx*dx + dy*dy) / SQD];
-    *(unsigned long *)c = ((unsigned long*)bi->xtab)[f];
+    *(DWORD *)c = ((DWORD*)bi->xtab)[f];
 }
 
 // -------------------------------------
-struct bimage *bimage_create(int width, int height,  StyleItem *si)
+static struct bimage *alloc_bimage(int width, int height, int rows)
 {
     int byte_size;
     int table_size;
-    bool sunken, interlaced;
-
-    unsigned long *s, *d, c, *e, *f;
-    int x, y, z, i;
-    unsigned char r2, g2, b2;
-    unsigned char *p;
-
-    COLORREF color_from, color_to, cr_tmp;
-    int type;
-
-    struct bimage *bi = NULL;
-
-    if (width < 2 && ++width < 2)
-        return bi;
-    if (height < 2 && ++height < 2)
-        return bi;
+    struct bimage *bi;
 
-    byte_size = (width * height) * BBP;
+    byte_size = (width * rows) * BBP;
     table_size = width + height;
     if (table_size < SQR)
         table_size = SQR;
@@ -323,8 +324,23 @@ struct bimage *bimage_create(int width, int height,  StyleItem *si)
 
     bi->width = width;
     bi->height = height;
+    bi->rows = rows;
     bi->xtab = bi->pixels + byte_size;
     bi->ytab = bi->xtab + width * BBP;
+    return bi;
+}
+
+// colors and delta tables, common to bimage_create/_strip
+static void setup_colors(struct bimage *bi, StyleItem *si)
+{
+    bool sunken, interlaced;
+    unsigned char r2, g2, b2;
+    COLORREF color_from, color_to, cr_tmp;
+    int type, i;
+    union {
+        unsigned char b[4];
+        DWORD c;
+    } v;
 
     color_from = si->Color;
     color_to = si->ColorTo;
@@ -351,10 +367,50 @@ struct bimage *bimage_create(int width, int height,  StyleItem *si)
     bi->diff_red = i + isgn(i);
 
     if (interlaced && B_SOLID != type)
-        make_delta_table(bi, delta_interlace, sunken != (0 == (height & 1)));
+        make_delta_table(bi, delta_interlace, sunken != (0 == (bi->height & 1)));
+
+    v.b[0] = (unsigned char)bi->from_blue ,
+    v.b[1] = (unsigned char)bi->from_green,
+    v.b[2] = (unsigned char)bi->from_red  ,
+    v.b[3] = (unsigned char)BI_HIBITS;
+    bi->solid[0] = bi->solid[1] = v.c;
+    if (interlaced) {
+        v.b[0] = b2, v.b[1] = g2, v.b[2] = r2;
+        bi->solid[1] = v.c;
+    }
 
-    p = bi->pixels;
+    bi->type = type;
+    bi->interlaced = interlaced;
+    bi->sunken = sunken;
+    bi->bevelposition = si->bevelstyle != BEVEL_FLAT ? si->bevelposition : 0;
     bi->alternativ = false;
+}
+
+struct bimage *bimage_create(int width, int height,  StyleItem *si)
+{
+    bool sunken, interlaced;
+
+    DWORD *s, *d, c, *e, *f;
+    int x, y, z;
+    unsigned char *p;
+    int type;
+
+    struct bimage *bi = NULL;
+
+    if (width < 2 && ++width < 2)
+        return bi;
+    if (height < 2 && ++height < 2)
+        return bi;
+
+    bi = alloc_bimage(width, height, height);
+    if (NULL == bi)
+        return bi;
+
+    setup_colors(bi, si);
+    type = bi->type;
+    sunken = bi->sunken;
+    interlaced = bi->interlaced;
+    p = bi->pixels;
 
     switch (type)
     {
@@ -362,26 +418,13 @@ struct bimage *bimage_create(int width, int height,  StyleItem *si)
         default:
         case B_SOLID:
         {
-            union {
-                unsigned char b[4];
-                unsigned long c;
-            } v;
-            unsigned long c1, c2;
-            v.b[0] = (unsigned char)bi->from_blue ,
-            v.b[1] = (unsigned char)bi->from_green,
-            v.b[2] = (unsigned char)bi->from_red  ,
-            v.b[3] = (unsigned char)BI_HIBITS;
-            c1 = c2 = v.c;
-            if (interlaced) {
-                v.b[0] = b2, v.b[1] = g2, v.b[2] = r2;
-                c2 = v.c;;
-            }
+            DWORD c1 = bi->solid[0], c2 = bi->solid[1];
 
             // draw 2 lines, to cover the 'interlaced' case
             y = 0; do {
                 c = (height & 1) == y ? c2 : c1;
                 x = 0; do {
-                    *(unsigned long*)p = c;
+                    *(DWORD*)p = c;
                     p+=BBP;
                 } while (++x < width);
             } while (++y < 2);
@@ -392,8 +435,8 @@ struct bimage *bimage_create(int width, int height,  StyleItem *si)
             table_fn(bi, bi->xtab, width, false);
             // draw 2 lines, to cover the 'interlaced' case
             y = 0; do {
-                x = 0; s = (unsigned long *)bi->xtab; do {
-                    *(unsigned long*)p = *s++;
+                x = 0; s = (DWORD *)bi->xtab; do {
+                    *(DWORD*)p = *s++;
                     if (interlaced) {
                         if (1 & y) darker(bi, p);
                         else lighter(bi, p);
@@ -404,9 +447,9 @@ struct bimage *bimage_create(int width, int height,  StyleItem *si)
 
             // copy down the lines
         copy_lines:
-            d = (unsigned long*)p;
+            d = (DWORD*)p;
             while (y < height) {
-                s = (unsigned long*)bi->pixels + (y&1)*width;
+                s = (DWORD*)bi->pixels + (y&1)*width;
                 memcpy(d, s, width*BBP);
                 d += width; y++;
             }
@@ -417,9 +460,9 @@ struct bimage *bimage_create(int width, int height,  StyleItem *si)
             table_fn(bi, bi->ytab, height, true);
 
             // draw 1 column
-            y = 0; s = (unsigned long *)bi->ytab; z = width*BBP;
+            y = 0; s = (DWORD *)bi->ytab; z = width*BBP;
             do {
-                *(unsigned long*)p = *s++;
+                *(DWORD*)p = *s++;
                 if (interlaced) {
                     if (1 & y) darker(bi, p);
                     else lighter(bi, p);
@@ -428,7 +471,7 @@ struct bimage *bimage_create(int width, int height,  StyleItem *si)
             } while (++y < height);
 
             // copy colums
-            s = (unsigned long*)bi->pixels;
+            s = (DWORD*)bi->pixels;
             y = 0; do {
                 d = s, s += width; c = *d++;
                 do *d = c; while (++d<s);
@@ -473,11 +516,11 @@ struct bimage *bimage_create(int width, int height,  StyleItem *si)
         draw_quadrant:
             // one quadrant is drawn, and mirrored horizontally and vertically
             y = 0;
-            s = (unsigned long*)p + height*width;
+            s = (DWORD*)p + height*width;
             z = height;
             do {
                 x = 0;
-                d = (unsigned long*)p + width;
+                d = (DWORD*)p + width;
                 f = s; s -= width; e = s; z--;
                 do {
                     if (B_ELLIPTIC == type)
@@ -488,14 +531,14 @@ struct bimage *bimage_create(int width, int height,  StyleItem *si)
                     else
                         rect_fn(bi, p, x, y);
 
-                    c = *(unsigned long *)p;
+                    c = *(DWORD *)p;
                     if (interlaced) {
                         if (2 & y) darker(bi, p);
                         else lighter(bi, p);
                     }
-                    *--d = *(unsigned long *)p;
+                    *--d = *(DWORD *)p;
 
-                    if (e != (unsigned long *)p) {
+                    if (e != (DWORD *)p) {
                         *e = c;
                         if (interlaced) {
                             if (1 & z) darker(bi, (unsigned char*)e);
@@ -517,6 +560,187 @@ struct bimage *bimage_create(int width, int height,  StyleItem *si)
     return bi;
 }
 
+//===========================================================================
+// The same gradients, but made row by row into a strip of a few rows,
+// such that large images can be written out without ever having them
+// in memory as a whole. The result is the same as with bimage_create.
+
+inline static void table_pixel(const unsigned char *t, unsigned char *pixel)
+{
+    pixel[0] = t[pixel[0]];
+    pixel[1] = t[pixel[1]];
+    pixel[2] = t[pixel[2]];
+}
+
+static void draw_row(struct bimage *bi, unsigned char *p, int y)
+{
+    int width = bi->width, height = bi->height;
+    int x, y2, pos, nx, ny;
+    DWORD c, *d = (DWORD*)p;
+
+    switch (bi->type)
+    {
+        default:
+        case B_SOLID:
+            c = bi->solid[(height & 1) == (y & 1)];
+            x = 0; do d[x] = c; while (++x < width);
+            break;
+
+        case B_HORIZONTAL:
+            memcpy(d, bi->xtab, width*BBP);
+            break;
+
+        case B_VERTICAL:
+            c = ((DWORD*)bi->ytab)[y];
+            x = 0; do d[x] = c; while (++x < width);
+            break;
+
+        case B_CROSSDIAGONAL:
+        case B_DIAGONAL:
+            x = 0; do diag_fn(bi, p + x*BBP, x, y); while (++x < width);
+            break;
+
+        case B_PIPECROSS:
+        case B_RECTANGLE:
+        case B_PYRAMID:
+        case B_ELLIPTIC:
+            // the quadrant mirrored, in the doubled coordinates
+            // that bimage_create uses
+            y2 = 2 * _imin(y, height - 1 - y);
+            x = 0; do {
+                int x2 = 2 * _imin(x, width - 1 - x);
+                if (B_ELLIPTIC == bi->type)
+                    elli_fn(bi, p + x*BBP, x2, y2);
+                else
+                if (B_PYRAMID == bi->type)
+                    diag_fn(bi, p + x*BBP, x2, y2);
+                else
+                    rect_fn(bi, p + x*BBP, x2, y2);
+            } while (++x < width);
+            break;
+    }
+
+    if (bi->interlaced && B_SOLID != bi->type) {
+        const unsigned char *t = (y & 1) ? bi->dark_table : bi->lite_table;
+        x = 0; do table_pixel(t, p + x*BBP); while (++x < width);
+    }
+
+    // see bevel() above
+    pos = bi->bevelposition - 1;
+    nx = width - 2*pos - 1;
+    ny = height - 2*pos - 1;
+    if (pos >= 0 && nx > 0 && ny > 0) {
+        if (y == pos) {
+            for (x = pos+1; x < pos+nx; ++x)
+                table_pixel(bi->bevel_dark, p + x*BBP);
+            modify_pixel(p + (pos+nx)*BBP, delta_bevel_corner, !bi->sunken);
+        } else if (y == pos+ny) {
+            for (x = pos+1; x < pos+nx; ++x)
+                table_pixel(bi->bevel_lite, p + x*BBP);
+            modify_pixel(p + pos*BBP, delta_bevel_corner, bi->sunken);
+        } else if (y > pos && y < pos+ny) {
+            table_pixel(bi->bevel_dark, p + (pos+nx)*BBP);
+            table_pixel(bi->bevel_lite, p + pos*BBP);
+        }
+    }
+
+    if (option_dither) {
+        int oy = 4 * (y & 3);
+        for (x = 0; x < width; x++, p+=BBP) {
+            int ox = oy + (x & 3);
+            p[0] = _dith_b_table[p[0] + add_b[ox]];
+            p[1] = _dith_g_table[p[1] + add_g[ox]];
+            p[2] = _dith_r_table[p[2] + add_r[ox]];
+        }
+    }
+}
+
+struct bimage *bimage_create_strip(int width, int height, int rows, StyleItem *si)
+{
+    struct bimage *bi = NULL;
+
+    if (width < 2 && ++width < 2)
+        return bi;
+    if (height < 2 && ++height < 2)
+        return bi;
+    if (rows < 1 || rows > height)
+        rows = height;
+
+    bi = alloc_bimage(width, height, rows);
+    if (NULL == bi)
+        return bi;
+
+    setup_colors(bi, si);
+    switch (bi->type)
+    {
+        case B_HORIZONTAL:
+            table_fn(bi, bi->xtab, width, false);
+            break;
+        case B_VERTICAL:
+            table_fn(bi, bi->ytab, height, true);
+            break;
+        case B_CROSSDIAGONAL:
+            table_fn(bi, bi->xtab, width, true);
+            table_fn(bi, bi->ytab, height, true);
+            break;
+        case B_DIAGONAL:
+            table_fn(bi, bi->xtab, width, false);
+            table_fn(bi, bi->ytab, height, true);
+            break;
+        case B_PIPECROSS:
+            bi->alternativ = true;
+        case B_RECTANGLE:
+        case B_PYRAMID:
+            table_fn(bi, bi->xtab, width, false);
+            table_fn(bi, bi->ytab, height, false);
+            break;
+        case B_ELLIPTIC:
+            if (0 == _sqrt_table[0])
+                init_sqrt();
+            table_fn(bi, bi->xtab, SQR, false);
+            break;
+    }
+    make_tables(bi->bevel_dark, bi->bevel_lite, delta_bevel, bi->sunken);
+    return bi;
+}
+
+BYTE *bimage_getstrip(struct bimage *bi, int y, int n)
+{
+    int i;
+    if (NULL == bi || n > bi->rows || y < 0 || y + n > bi->height)
+        return NULL;
+    for (i = 0; i < n; ++i)
+        draw_row(bi, bi->pixels + i * bi->width * BBP, y + i);
+    return bi->pixels;
+}
+
+BYTE *bimage_getpixels(struct bimage *bi)
+{
+    return bi ? bi->pixels : NULL;
+}
+
+void bimage_destroy(struct bimage *bi)
+{
+    free(bi);
+}
+
+void bimage_init(bool dither, bool is_070)
+{
+    option_dither = dither;
+    option_070 = is_070;
+    init_dither_tables();
+    // also here, rather than only on demand, for the sake of
+    // callers that render from several threads
+    if (0 == _sqrt_table[0])
+        init_sqrt();
+}
+
+//===========================================================================
+// The functions below paint on a HDC and are not available in the
+// headless (posix) build of the gradient code.
+
+#ifdef _WIN32
+
 static void setup_bmiHeader(struct bimage *bi, BITMAPINFOHEADER *bmiHeader)
 {
     memset(bmiHeader, 0, sizeof(*bmiHeader));
@@ -551,23 +775,6 @@ static void copy_to_hdc(struct bimage *bi, HDC hdc, int px, int py, int w, int h
     SetDIBitsToDevice(hdc, px, py, w, h, 0, 0, 0, h, bi->pixels, (BITMAPINFO*)&bmiHeader, DIB_RGB_COLORS);
 }
 
-BYTE *bimage_getpixels(struct bimage *bi)
-{
-    return bi ? bi->pixels : NULL;
-}
-
-void bimage_destroy(struct bimage *bi)
-{
-    free(bi);
-}
-
-void bimage_init(bool dither, bool is_070)
-{
-    option_dither = dither;
-    option_070 = is_070;
-    init_dither_tables();
-}
-
 //===========================================================================
 // API: CreateBorder
 //===========================================================================
@@ -682,4 +889,6 @@ HBITMAP MakeGradientBitmap(int width, int height, StyleItem *pSI)
     return bmp;
 }
 
+#endif /* _WIN32 */
+
 //===========================================================================
@@ -77,6 +77,13 @@ void bimage_destroy(struct bimage *bi);
 /* get a pointer to the pixel memory */
 BYTE *bimage_getpixels(struct bimage *bi);
 
+/* the same gradient, made on demand in strips of 'rows' rows, for
+   large images. Rows count from the bottom as with bimage_getpixels */
+struct bimage *bimage_create_strip(int width, int height, int rows, struct StyleItem *si);
+
+/* make rows y .. y+n-1 (n <= rows) and get a pointer to them */
+BYTE *bimage_getstrip(struct bimage *bi, int y, int n);
+
 
 /* High level functions */
 /* ------------------- */
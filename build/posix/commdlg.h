@@ -0,0 +1,66 @@
+/* ------------------------------------------------------------------------- */
+/*
+  This file is part of the bbLean source code
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+*/
+/* ------------------------------------------------------------------------- */
+/* commdlg.h - the file dialogs for headless builds on posix systems
+
+   There is nobody to ask, the dialogs are always cancelled.
+*/
+
+#ifndef _POSIX_COMMDLG_H_
+#define _POSIX_COMMDLG_H_
+
+#include <windows.h>
+
+#define OFN_OVERWRITEPROMPT     0x00000002
+#define OFN_HIDEREADONLY        0x00000004
+#define OFN_ENABLEHOOK          0x00000020
+#define OFN_ALLOWMULTISELECT    0x00000200
+#define OFN_PATHMUSTEXIST       0x00000800
+#define OFN_FILEMUSTEXIST       0x00001000
+#define OFN_EXPLORER            0x00080000
+
+typedef struct tagOFNA {
+    DWORD lStructSize;
+    HWND hwndOwner;
+    HINSTANCE hInstance;
+    LPCSTR lpstrFilter;
+    LPSTR lpstrCustomFilter;
+    DWORD nMaxCustFilter;
+    DWORD nFilterIndex;
+    LPSTR lpstrFile;
+    DWORD nMaxFile;
+    LPSTR lpstrFileTitle;
+    DWORD nMaxFileTitle;
+    LPCSTR lpstrInitialDir;
+    LPCSTR lpstrTitle;
+    DWORD Flags;
+    WORD nFileOffset;
+    WORD nFileExtension;
+    LPCSTR lpstrDefExt;
+    LPARAM lCustData;
+    void *lpfnHook;
+    LPCSTR lpTemplateName;
+} OPENFILENAMEA, OPENFILENAME;
+
+#define OPENFILENAME_SIZE_VERSION_400 sizeof(OPENFILENAMEA)
+
+static inline BOOL GetOpenFileName(OPENFILENAME *ofn) { (void)ofn; return FALSE; }
+static inline BOOL GetSaveFileName(OPENFILENAME *ofn) { (void)ofn; return FALSE; }
+
+#endif /* _POSIX_COMMDLG_H_ */
@@ -0,0 +1,258 @@
+/* ------------------------------------------------------------------------- */
+/*
+  This file is part of the bbLean source code
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+*/
+/* ------------------------------------------------------------------------- */
+/* windows.h - minimal stand-in for headless builds on posix systems
+
+   Only the types and the few functions that the portable parts of
+   bbLean (bblib string/path/color utils, bbroot parsing, BImage
+   gradients, the bbnote editor engine) need are provided here.
+   Anything that would need a display is stubbed out to a harmless
+   default.
+*/
+
+#ifndef _POSIX_WINDOWS_H_
+#define _POSIX_WINDOWS_H_
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <stdarg.h>
+#include <ctype.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#define VOID void
+#define WINAPI
+#define CALLBACK
+#define APIENTRY
+#define __declspec(x)
+#define __stdcall
+
+#define MAX_PATH 260
+
+typedef uint8_t BYTE;
+typedef uint16_t WORD;
+typedef uint32_t DWORD;
+typedef long LONG;
+typedef int BOOL;
+typedef unsigned int UINT;
+typedef char CHAR;
+typedef uint16_t WCHAR;
+typedef char *LPSTR, *LPTSTR;
+typedef const char *LPCSTR, *LPCTSTR;
+typedef void *LPVOID;
+typedef uintptr_t WPARAM, DWORD_PTR, UINT_PTR;
+typedef intptr_t LPARAM, LRESULT, LONG_PTR, INT_PTR;
+typedef DWORD COLORREF;
+typedef uint64_t ULONGLONG;
+
+typedef void *HANDLE;
+typedef struct HWND__ *HWND;
+typedef struct HINSTANCE__ *HINSTANCE, *HMODULE;
+typedef struct HDC__ *HDC;
+typedef struct HGDIOBJ__ *HGDIOBJ;
+typedef struct HBITMAP__ *HBITMAP;
+typedef struct HFONT__ *HFONT;
+typedef struct HICON__ *HICON;
+typedef struct HMENU__ *HMENU;
+typedef struct HMONITOR__ *HMONITOR;
+#define HMONITOR_DECLARED
+typedef struct HKEY__ *HKEY;
+
+typedef struct tagRECT { LONG left, top, right, bottom; } RECT, *LPRECT;
+typedef struct tagPOINT { LONG x, y; } POINT, *LPPOINT;
+typedef struct tagSIZE { LONG cx, cy; } SIZE;
+typedef struct _FILETIME { DWORD dwLowDateTime, dwHighDateTime; } FILETIME;
+typedef struct tagWINDOWPOS {
+    HWND hwnd, hwndInsertAfter; int x, y, cx, cy; UINT flags;
+} WINDOWPOS;
+typedef struct tagMSG {
+    HWND hwnd; UINT message; WPARAM wParam; LPARAM lParam; DWORD time; POINT pt;
+} MSG;
+
+typedef struct tagRGBQUAD {
+    BYTE rgbBlue, rgbGreen, rgbRed, rgbReserved;
+} RGBQUAD;
+
+typedef LRESULT (CALLBACK *WNDPROC)(HWND, UINT, WPARAM, LPARAM);
+typedef int (CALLBACK *FARPROC)(void);
+
+#ifndef TRUE
+#define TRUE 1
+#define FALSE 0
+#endif
+
+#define RGB(r,g,b) ((COLORREF)(((BYTE)(r)|((WORD)((BYTE)(g))<<8))|(((DWORD)(BYTE)(b))<<16)))
+#define GetRValue(rgb) ((BYTE)(rgb))
+#define GetGValue(rgb) ((BYTE)(((WORD)(rgb)) >> 8))
+#define GetBValue(rgb) ((BYTE)((rgb)>>16))
+
+#define BITSPIXEL 12
+#define CLR_INVALID 0xFFFFFFFF
+#define BI_RGB 0
+#define INVALID_FILE_ATTRIBUTES ((DWORD)-1)
+#define FILE_ATTRIBUTE_DIRECTORY 0x10
+#define FILE_ATTRIBUTE_NORMAL 0x80
+
+#define IDOK 1
+#define IDCANCEL 2
+#define IDYES 6
+#define IDNO 7
+
+#define WM_COMMAND 0x0111
+
+#define CF_TEXT 1
+#define GMEM_MOVEABLE 0x0002
+#define GMEM_DDESHARE 0x2000
+
+#define LOBYTE(w) ((BYTE)((DWORD_PTR)(w) & 0xff))
+
+#define _stricmp strcasecmp
+#define _strnicmp strncasecmp
+#define _memicmp posix_memicmp
+#define _strlwr strlwr
+#define _strupr strupr
+#define stricmp _stricmp
+#define strnicmp _strnicmp
+#define memicmp _memicmp
+#define lstrcpy strcpy
+#define lstrlen strlen
+#define lstrcmpi strcasecmp
+#define _snprintf snprintf
+#define _vsnprintf vsnprintf
+
+static inline int posix_memicmp(const void *a, const void *b, size_t n)
+{
+    const unsigned char *p = (const unsigned char *)a;
+    const unsigned char *q = (const unsigned char *)b;
+    int d;
+    for (; n; --n, ++p, ++q)
+        if (0 != (d = tolower(*p) - tolower(*q)))
+            return d;
+    return 0;
+}
+
+static inline char *strlwr(char *s)
+{
+    char *p;
+    for (p = s; *p; ++p)
+        *p = (char)tolower((unsigned char)*p);
+    return s;
+}
+
+static inline char *strupr(char *s)
+{
+    char *p;
+    for (p = s; *p; ++p)
+        *p = (char)toupper((unsigned char)*p);
+    return s;
+}
+
+/* there is no display, report a truecolor one so nothing gets dithered */
+static inline HDC GetDC(HWND hwnd) { (void)hwnd; return NULL; }
+static inline int ReleaseDC(HWND hwnd, HDC hdc) { (void)hwnd; (void)hdc; return 1; }
+static inline int GetDeviceCaps(HDC hdc, int index) { (void)hdc; (void)index; return 32; }
+
+/* no message loop either, timers never fire */
+static inline UINT_PTR SetTimer(HWND hwnd, UINT_PTR id, UINT ms, void *fn)
+{
+    (void)hwnd; (void)ms; (void)fn; return id;
+}
+static inline BOOL KillTimer(HWND hwnd, UINT_PTR id) { (void)hwnd; (void)id; return TRUE; }
+static inline BOOL PostMessage(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
+{
+    (void)hwnd; (void)msg; (void)wp; (void)lp; return FALSE;
+}
+static inline LRESULT SendMessage(HWND hwnd, UINT msg, WPARAM wp, LPARAM lp)
+{
+    (void)hwnd; (void)msg; (void)wp; (void)lp; return 0;
+}
+
+/* nor a clipboard, OpenClipboard fails and nothing else gets called */
+static inline BOOL OpenClipboard(HWND hwnd) { (void)hwnd; return FALSE; }
+static inline BOOL EmptyClipboard(void) { return FALSE; }
+static inline BOOL CloseClipboard(void) { return TRUE; }
+static inline HANDLE GetClipboardData(UINT fmt) { (void)fmt; return NULL; }
+static inline HANDLE SetClipboardData(UINT fmt, HANDLE h) { (void)fmt; (void)h; return NULL; }
+static inline HANDLE GlobalAlloc(UINT flags, size_t n) { (void)flags; return malloc(n); }
+static inline HANDLE GlobalFree(HANDLE h) { free(h); return NULL; }
+static inline void *GlobalLock(HANDLE h) { return h; }
+static inline BOOL GlobalUnlock(HANDLE h) { (void)h; return TRUE; }
+
+/* an NT, so the newer structure sizes are used */
+static inline DWORD GetVersion(void) { return 6; }
+
+static inline LONG CompareFileTime(const FILETIME *a, const FILETIME *b)
+{
+    if (a->dwHighDateTime != b->dwHighDateTime)
+        return a->dwHighDateTime < b->dwHighDateTime ? -1 : 1;
+    if (a->dwLowDateTime != b->dwLowDateTime)
+        return a->dwLowDateTime < b->dwLowDateTime ? -1 : 1;
+    return 0;
+}
+
+static inline DWORD GetFileAttributes(LPCSTR path)
+{
+    struct stat st;
+    if (0 != stat(path, &st))
+        return INVALID_FILE_ATTRIBUTES;
+    return S_ISDIR(st.st_mode) ? FILE_ATTRIBUTE_DIRECTORY : FILE_ATTRIBUTE_NORMAL;
+}
+
+static inline BOOL CreateDirectory(LPCSTR path, void *sa)
+{
+    (void)sa; return 0 == mkdir(path, 0777);
+}
+
+static inline DWORD GetCurrentDirectory(DWORD size, LPSTR path)
+{
+    if (NULL == getcwd(path, size))
+        return 0;
+    return (DWORD)strlen(path);
+}
+
+/* relative to the current directory, without looking at the disk */
+static inline DWORD GetFullPathName(LPCSTR name, DWORD size, LPSTR path, LPSTR *pname)
+{
+    char buf[MAX_PATH];
+    if (name[0] == '/' || NULL == getcwd(buf, sizeof buf))
+        buf[0] = 0;
+    else
+        strcat(buf, "/");
+    snprintf(path, size, "%s%s", buf, name);
+    if (pname)
+        *pname = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+    return (DWORD)strlen(path);
+}
+
+static inline DWORD GetModuleFileName(HMODULE h, LPSTR path, DWORD size)
+{
+    ssize_t n;
+    (void)h;
+    n = readlink("/proc/self/exe", path, size - 1);
+    if (n < 0)
+        n = 0;
+    path[n] = 0;
+    return (DWORD)n;
+}
+
+#endif /* _POSIX_WINDOWS_H_ */
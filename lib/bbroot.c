@@ -34,6 +34,7 @@ void init_root(struct rootinfo *r)
     r->sat = 255;
     r->hue = 0;
     r->scale = 100;
+    r->pnglevel = -1;
 }
 
 void delete_root(struct rootinfo *r)
@@ -49,7 +50,7 @@ const char *get_root_switch(int n)
 ST int next_token(struct rootinfo *r)
 {
     int s = E_eos;
-    strlwr(NextToken(r->token, &r->cptr, " "));
+    strlwr(strcpy(r->token, NextToken(r->ftoken, &r->cptr, " ")));
     r->flag = 1;
     if (r->token[0]) {
         const char * p = r->token;
@@ -132,7 +133,7 @@ cont_1:
         get_img_1:
             if (E_eos == s) return false;
             if (r->bmp) return false;
-            unquote(strcpy(r->wpfile, r->token));
+            unquote(strcpy(r->wpfile, r->ftoken));
             r->bmp = 1;
             continue;
 
@@ -245,18 +246,35 @@ cont_1:
             if (r->save)
             {
                 if (E_eos==next_token(r)) return false;
-                unquote(strcpy(r->bsetroot_bmp, r->token));
+                unquote(strcpy(r->bsetroot_bmp, r->ftoken));
             }
             continue;
 
         case E_prefix:
             if (E_eos==next_token(r)) return false;
-            unquote(strcpy(r->search_base, r->token));
+            unquote(strcpy(r->search_base, r->ftoken));
             continue;
 
         case E_path:
             if (E_eos==next_token(r)) return false;
-            append_string_node(&r->paths, unquote(r->token));
+            append_string_node(&r->paths, unquote(r->ftoken));
+            continue;
+
+        case E_layout:
+            if (E_eos==next_token(r)) return false;
+            unquote(strcpy(r->layout, r->ftoken));
+            continue;
+
+        case E_pnglevel:
+            next_token(r);
+            if (!read_int(r->token, &r->pnglevel)
+                || r->pnglevel < 0 || r->pnglevel > 9) return false;
+            continue;
+
+        case E_maxmem:
+            next_token(r);
+            if (!read_int(r->token, &r->maxmem) || r->maxmem < 0)
+                return false;
             continue;
         }
     }
@@ -51,7 +51,7 @@ enum
     Etile       , Ecenter     , Estretch    ,
 
     E_scale, E_save, E_convert, E_vdesk, E_help, E_quiet,
-    E_prefix, E_path,
+    E_prefix, E_path, E_layout, E_pnglevel, E_maxmem,
     E_last
 };
 
@@ -71,7 +71,7 @@ static const char *switches[] =
     "tile",         "center",       "stretch",
 
     "-scale", "-save", "-convert", "-vdesk", "-help", "-quiet",
-    "-prefix", "-path",
+    "-prefix", "-path", "-layout", "-pnglevel", "-maxmem",
     NULL
 };
 #endif
@@ -105,15 +105,19 @@ struct rootinfo
     char convert; // -convert
     char help;  // -help
     char quiet; // -quiet
+    int pnglevel; // -pnglevel, -1 = default
+    int maxmem; // -maxmem, MB for decoding an image, 0 = no limit
 
     string_node *paths; //-path <...>
     char search_base[MAX_PATH]; // -prefix <...>
     char bsetroot_bmp[MAX_PATH]; // file to save to
+    char layout[MAX_PATH]; // -layout <file>, per monitor settings
 
     // internal
     char flag;
     const char *cptr;
-    char token[MAX_PATH];
+    char token[MAX_PATH]; // lowercased
+    char ftoken[MAX_PATH]; // as is, for filenames
 };
 
 BBLIB_EXPORT void init_root(struct rootinfo *r);
@@ -22,6 +22,12 @@
 #include "bblib.h"
 #include "win0x500.h"
 
+#ifdef _WIN32
+# define PATH_SLASH '\\'
+#else
+# define PATH_SLASH '/'
+#endif
+
 char* unquote(char *src)
 {
     int l = strlen(src);
@@ -110,7 +116,7 @@ char *join_path(char *buffer, const char *dir, const char *filename)
     if (l) {
         memcpy(buffer, dir, l);
         if (!IS_SLASH(buffer[l-1]))
-            buffer[l++] = '\\';
+            buffer[l++] = PATH_SLASH;
     }
     if (filename) {
         while (IS_SLASH(filename[0]))
@@ -137,16 +143,20 @@ char *replace_slashes(char *buffer, const char *path)
 
 /* ------------------------------------------------------------------------- */
 
+#ifdef _WIN32
 static DWORD (WINAPI *pGetLongPathName)(
     LPCTSTR lpszShortPath,
     LPTSTR lpszLongPath,
     DWORD cchBuffer);
+#endif
 
 char* get_exe_path(HINSTANCE h, char* pszPath, int nMaxLen)
 {
     GetModuleFileName(h, pszPath, nMaxLen);
+#ifdef _WIN32
     if (load_imp(&pGetLongPathName, "KERNEL32.DLL", "GetLongPathNameA"))
         pGetLongPathName(pszPath, pszPath, nMaxLen);
+#endif
     *(char*)file_basename(pszPath) = 0;
     return pszPath;
 }
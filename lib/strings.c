@@ -144,11 +144,17 @@ char *m_formatv(const char *fmt, va_list arg_list)
     out = NULL;
 
 _restart:
-    arg = arg_list, ptr = out, len = 0;
+#ifdef va_copy
+    va_copy(arg, arg_list);
+#else
+    arg = arg_list;
+#endif
+    ptr = out, len = 0;
     for (f = fmt;;++f) {
         switch (c = *f) {
         case '\0':
 _quit:
+            va_end(arg);
             if (ptr) {
                 *ptr = 0;
                 /*dbg_printf("%s (%d): <%s>", fmt, strlen(out), out); */
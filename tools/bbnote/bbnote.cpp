@@ -68,6 +68,7 @@ extern char  My_Font[];
 
 extern char smart, tuse, ltup, syncolors, unix_eol;
 extern int tabs;
+extern int undo_mb;
 
 void makefonts(void);
 void deletefonts(void);
@@ -98,6 +99,7 @@ struct ini {
     { "colorized",      1, &syncolors },
     { "unix_eol",       1, &unix_eol },
     { "mousewheel",     4, &mousewheelfac },
+    { "undomemory",     4, &undo_mb },
 
     { "wx0", 2, &ewx0 },
     { "wy0", 2, &ewy0 },
@@ -782,6 +784,7 @@ HWND editline (RECT *r, HWND hwnd, const char *txt)
 #define IDALLF      408
 #define IDGREP      409
 #define SEA_INIT    410
+#define IDRPLALL    411
 
 struct button bts[] = {
     { "&up",      0,   6, 18,  20, 10,  0, BN_BTN, IDUP},
@@ -792,8 +795,9 @@ struct button bts[] = {
     { "reg&x",    0, 154, 18,  24, 10,  0, BN_CHK, 0},
     { "&files",   0, 182, 18,  24, 10,  0, BN_CHK, 0},
     { "&replace", 0, 210, 18,  40, 10,  0, BN_BTN, IDRPL},
-    { seabuf,     0,   6,  5, 119, 10,  0, BN_EDT, 0},
-    { rplbuf,     0, 131,  5, 119, 10,  0, BN_EDT, 0},
+    { seabuf,     0,   6,  5, 135, 10,  0, BN_EDT, 0},
+    { rplbuf,     0, 147,  5, 135, 10,  0, BN_EDT, 0},
+    { "&all",     0, 254, 18,  28, 10,  0, BN_BTN, IDRPLALL},
     {NULL}
 };
 
@@ -980,7 +984,7 @@ int bb_search_dialog(HWND hwnd)
         return 0;
     }
 
-    dlg = fix_dlg (bts, 256, 32);
+    dlg = fix_dlg (bts, 288, 32);
 
     //place dialog to upper right corner
     GetWindowRect (ewnd, &r);
@@ -0,0 +1,683 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDBENCH.C - replays edit traces against the text store (posix, headless)
+
+/*
+    usage: edbench [options] [file]
+
+    -s <size>       generate a log-like text of that size, default 16M
+                    (k/M/G suffixes work)
+    -t <trace>      replay this trace
+    -n <count>      otherwise generate a trace of so many edits, default 20000
+    -r <seed>       random seed for the generated text and trace
+    -w <trace>      write the generated trace to a file
+    -m              map the file and use load_text(), as loadfile() does
+                    for big files
+    -b <count>      open so many buffers, each with a text as above; the
+                    trace works in the first, except for f and r
+    -j <threads>    threads for f and r, default one for each cpu
+    -k              generate a typing trace instead: chars, backspaces,
+                    newlines, some moves and undo/redo
+    -u <MB>         the undo memory for each buffer (undo_mb), 0 for
+                    no limit
+    -o <file>       where w saves to, with -k a w also comes every
+                    5000 keys or so
+    -x <count>      crash test: a child process saves the text over and
+                    over to the -o file, with an edit between, and gets
+                    killed at some point, so many times. The file must
+                    then be one of the two texts, whole.
+
+    Otherwise a file is loaded like loadfile() does it for small ones:
+    TABs expanded to TABC runs, CRs dropped, in BLS sized chunks through
+    insdelmem() and copyto().
+
+    A trace has one command per line, acting at a cursor:
+
+    g <pos>         go to an offset, also N% or $ for the end
+    l <line>        go to a line, also N% of the lines at load time
+    n <n>           go down n lines
+    p <n>           go up n lines
+    y               count the lines up to the cursor, as the status line
+    v <n>           read n bytes with getchr, as when painting the screen
+    c <n>           read n bytes with copyfrom
+    i <text>        insert text, with \n \t \\ escapes, cursor after it
+    b <n>           delete n bytes before the cursor (backspace)
+    d <n>           delete n bytes at the cursor
+    z               undo, like unredo() (each i, b, d is one edit)
+    Z               redo
+    s <regex>       go to the next match after the cursor, as the search
+                    does forward (the cursor stays when there is none)
+    f <regex>       find all matches in all buffers, with find_all()
+    r <text> <regex> replace all in all buffers, like ed_rplall()
+    w               save to the -o file in the background, like
+                    savefile(), the trace goes on meanwhile
+*/
+
+#include "edstruct.h"
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <signal.h>
+#include <sys/wait.h>
+
+ST const char *out;
+
+#define BLS     4096
+
+ST double usec_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// VmHWM is the peak of all, RssAnon what is not the mapped file
+ST long status_kb(const char *key) {
+    char line[200];
+    long kb = 0;
+    int n = strlen(key);
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp) {
+        while (fgets(line, sizeof line, fp))
+            if (0 == strncmp(line, key, n) && line[n] == ':')
+                kb = atol(line + n + 1);
+        fclose(fp);
+    }
+    return kb;
+}
+
+ST long peak_kb(void) {
+    struct rusage ru;
+    long kb = status_kb("VmHWM");
+    if (0 == kb && 0 == getrusage(RUSAGE_SELF, &ru))
+        kb = ru.ru_maxrss;
+    return kb;
+}
+
+ST unsigned rnd_s = 1;
+
+ST unsigned rnd(unsigned n) {
+    rnd_s = rnd_s * 1103515245 + 12345;
+    return (rnd_s >> 8) % n;
+}
+
+/*----------------------------------------------------------------------------*/
+// loading
+
+ST void append(const char *p, int n) {
+    int o;
+    insdelmem(o=flen, n);
+    copyto(o, p, n);
+}
+
+ST int load_file(const char *fn) {
+    FILE *fp;
+    char buf_i[BLS], buf_o[BLS], d, *r=NULL;
+    int a,b,n;
+
+    if (NULL==(fp=fopen(fn, "rb"))) return 0;
+    a=b=n=0;
+    for (;;) {
+        if (0==a && 0==(a=fread(r=buf_i, 1, BLS, fp)))
+            break;
+        d=*r++, a--, b++;
+        switch (d) {
+        case 10: b=0; tlin++; break;
+        case  9: d=(char)TABC; if (b%tabs) r--,a++; break;
+        case 13: b--; continue;
+        }
+        buf_o[n++]=d;
+        if (n>=BLS) append(buf_o, n), n=0;
+    }
+    if (n) append(buf_o, n);
+    fclose(fp);
+    return 1;
+}
+
+ST int map_file(const char *fn) {
+    struct stat st;
+    void *p;
+    int fd = open(fn, O_RDONLY);
+    if (fd < 0) return 0;
+    if (fstat(fd, &st) || st.st_size > 0x7fffffff) {
+        close(fd);
+        return 0;
+    }
+    p = st.st_size ? mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0) : NULL;
+    close(fd);
+    if (p == MAP_FAILED) return 0;
+    if (p) tlin = load_text((const char *)p, st.st_size);
+    return 1;
+}
+
+// something that looks like a log file or source, in BLS chunks
+ST void make_text(double size) {
+    static const char *w[] = {
+        "INFO", "WARN", "request", "served", "from", "cache", "user",
+        "session", "opened", "closed", "GET", "/index.html", "200", "404",
+        "int", "return", "if", "(x)", "{", "}", "=", "0;", "while",
+    };
+    char buf[BLS+200];
+    int n=0, k, i;
+    double l=0;
+    while (l < size) {
+        n += sprintf(buf+n, "%08u ", rnd(100000000));
+        for (k = rnd(4); k--;)
+            memset(buf+n, TABC, tabs), n+=tabs;
+        for (k = 2 + rnd(12); k--;)
+            n += sprintf(buf+n, "%s ", w[rnd(sizeof w / sizeof *w)]);
+        buf[n-1] = 10, tlin++;
+        if (n >= BLS || l + n >= size) {
+            i = imin(n, BLS);
+            if (l + i > size) i = (int)(size - l);
+            append(buf, i), l += i;
+            memmove(buf, buf+i, n-=i);
+        }
+    }
+}
+
+/*----------------------------------------------------------------------------*/
+// traces
+
+// a session: jump somewhere, then type and paint, delete some, read some
+ST void make_trace(FILE *fp, int count) {
+    static const char *s[] = {
+        "x", "y", "z", " ", "=", "1", "2", ";", "\\n", "\\t", "foo", "bar();"
+    };
+    int i, k;
+    for (i = 0; i < count; ) {
+        if (rnd(2))
+            fprintf(fp, "g %d%%\n", rnd(100));
+        else
+            fprintf(fp, "l %d%%\n", rnd(100));
+        fprintf(fp, "v 4000\ny\n");
+        for (k = 1 + rnd(30); k-- && i < count; i++) {
+            switch (rnd(14)) {
+            case 0: fprintf(fp, "b %d\n", 1 + rnd(3)); break;
+            case 1: fprintf(fp, "d %d\n", 1 + rnd(80)); break;
+            case 2: fprintf(fp, "c %d\n", 1 + rnd(8000)); break;
+            case 3: fprintf(fp, "n %d\n", rnd(2) ? 1 : 50); break;
+            case 4: fprintf(fp, "p %d\n", rnd(2) ? 1 : 50); break;
+            case 5: fprintf(fp, "n %d\n", 1000 + rnd(100000)); break;
+            default: fprintf(fp, "i %s\n", s[rnd(sizeof s / sizeof *s)]);
+            }
+            fprintf(fp, "v 4000\ny\n");
+        }
+    }
+}
+
+// someone typing, a million keys is an hour or two of it
+ST void make_keys(FILE *fp, int count) {
+    static const char *w[] = {
+        "int", "return", "foo", "bar", "x", "if", "while", "0;", "=",
+        "(x)", "{", "}", "request", "session",
+    };
+    const char *p;
+    int i, k, s;
+    for (i = s = 0; i < count; ) {
+        if (out && i >= s)
+            fprintf(fp, "w\n"), s += 5000;
+        switch (rnd(40)) {
+        case 0: fprintf(fp, "g %d%%\n", rnd(100)), i++; break;
+        case 1: fprintf(fp, "%c 1\n", "np"[rnd(2)]), i++; break;
+        case 2:
+            for (k = 1 + rnd(4); k-- && i < count; i++)
+                fprintf(fp, "z\n");
+            if (rnd(2))
+                fprintf(fp, "Z\n"), i++;
+            break;
+        case 3:
+            for (k = 1 + rnd(8); k-- && i < count; i++)
+                fprintf(fp, "b 1\n");
+            break;
+        case 4: fprintf(fp, "d 1\n"), i++; break;
+        case 5: fprintf(fp, "i \\n\n"), i++; break;
+        default:
+            for (p = w[rnd(sizeof w / sizeof *w)]; *p && i < count; p++, i++)
+                fprintf(fp, "i %c\n", *p);
+            fprintf(fp, "i  \n"), i++;
+        }
+    }
+}
+
+ST int unescape(char *d, const char *s) {
+    char *p = d;
+    for (; *s && *s != 10; s++) {
+        if (*s == '\\' && s[1]) {
+            s++;
+            if (*s == 'n') *p++ = 10;
+            else if (*s == 't') *p++ = TABC;
+            else *p++ = *s;
+        } else
+            *p++ = *s;
+    }
+    return p - d;
+}
+
+// the regex search from ed_search(), without the dialog
+ST int search(int o, char *pat) {
+    static unsigned char code[1000];
+    static struct rdfa *d;
+    static char last[1000];
+    int m, n;
+    if (NULL == d || strcmp(pat, last)) {
+        if (d) rdfa_free(d), d = NULL;
+        if (0 == rcomp((unsigned char*)pat, code, sizeof code, 0))
+            return o;
+        d = rdfa_new(code, TABC);
+        if (NULL == d)
+            return o;
+        strcpy(last, pat);
+    }
+    n = rdfa_find(d, imin(o+1, flen), flen, &m, getchunk, NULL);
+    return n ? m : o;
+}
+
+// find all in all buffers, and replace them like ed_rplall() does,
+// without the undo
+ST int replace_all(char *pat, const char *r) {
+    struct edvars *ev0 = edp;
+    struct hits *h0, *h;
+    int i, a, e, n, k;
+    char *b;
+    k = find_all(pat, 64|128, 0, &h0);
+    for (h = h0; r && h; h = h->next) {
+        edp = h->ev;
+        for (i = h->n; i; ) {
+            b = rpl_run(h, &i, &a, &e, &n, NULL, r);
+            insdelmem(a, a - e);
+            insdelmem(a, n);
+            copyto(a, b, n);
+            m_free(b);
+        }
+    }
+    edp = ev0;
+    free_hits(h0);
+    return k;
+}
+
+// undo or redo one edit like unredo() in edfunc.cpp, returns where
+// the cursor goes
+ST int unredo(struct ulog *u1, struct ulog *u2, int o) {
+    sud *up;
+    int a, e, c;
+    if (NULL == (up = u_top(u1)))
+        return o;
+    a = up->p, e = up->l, c = up->cmd - UD_POS;
+    u_pp = u2;
+    for (;;) {
+        u_pop(u1);
+        if (NULL == (up = u_top(u1)) || UD_POS <= up->cmd)
+            break;
+        if (up->cmd == UD_INS) {
+            u_del(up->p, up->l);
+            insdelmem(up->p, -up->l);
+        } else {
+            u_ins(up->p, up->l);
+            insdelmem(up->p, up->l);
+            copyto(up->p, up->buf, up->l);
+        }
+    }
+    u_check(e, a);
+    chg = c;
+    return a;
+}
+
+ST unsigned sink;
+ST int lines;
+ST int saves;
+ST double save_us, save_max, wait_us;
+
+ST int run_trace(FILE *fp, int *ops) {
+    char line[1000], txt[1000];
+    static char tmp[65536];
+    int o = 0, n, i, a, u;
+    unsigned s = 0;
+    double t;
+
+    while (fgets(line, sizeof line, fp)) {
+        n = atoi(line+2);
+        // as ed_cmd() does
+        a = o, u = undo_l.n;
+        u_pp = &undo_l;
+        switch (line[0]) {
+        case 'g':
+            if (line[2] == '$') o = flen;
+            else if (strchr(line, '%')) o = (int)((double)flen * n / 100);
+            else o = n;
+            o = imax(0, imin(o, flen));
+            break;
+        case 'l':
+            if (strchr(line, '%')) n = (int)((double)lines * n / 100);
+            s += o = nextline_v(0, n, NULL);
+            break;
+        case 'n':
+            s += o = nextline_v(o, n, &i);
+            s += i;
+            break;
+        case 'p':
+            s += o = prevline_v(o, n, &i);
+            s += i;
+            break;
+        case 'y':
+            s += cntlf(0, o);
+            break;
+        case 'v':
+            for (i = 0; i < n; i++)
+                s += getchr(o + i);
+            break;
+        case 'c':
+            n = imin(imin(n, flen - o), sizeof tmp);
+            copyfrom(tmp, o, n);
+            s += tmp[0];
+            break;
+        case 'i':
+            n = unescape(txt, line+2);
+            if (n > 0) u_ins(o, n);
+            insdelmem(o, n);
+            copyto(o, txt, n);
+            o += n;
+            break;
+        case 'b':
+            n = imin(n, o);
+            if (n > 0) u_del(o - n, n);
+            insdelmem(o -= n, -n);
+            break;
+        case 'd':
+            n = imin(n, flen - o);
+            if (n > 0) u_del(o, n);
+            insdelmem(o, -n);
+            break;
+        case 'z':
+            o = unredo(&undo_l, &redo_l, o);
+            u = undo_l.n;
+            break;
+        case 'Z':
+            o = unredo(&redo_l, &undo_l, o);
+            u = undo_l.n;
+            break;
+        case 's':
+            line[strcspn(line, "\r\n")] = 0;
+            s += o = search(o, line+2);
+            break;
+        case 'f':
+            line[strcspn(line, "\r\n")] = 0;
+            s += replace_all(line+2, NULL);
+            break;
+        case 'r':
+            line[strcspn(line, "\r\n")] = 0;
+            if (0 == line[i = 2 + strcspn(line+2, " ")]) continue;
+            line[i] = 0;
+            txt[unescape(txt, line+2)] = 0;
+            s += replace_all(line+i+1, txt);
+            o = imin(o, flen);
+            break;
+        case 'w':
+            if (NULL == out) continue;
+            // the one before is waited for, as savefile() does
+            t = usec_now();
+            if (save_j) save_end(save_j);
+            wait_us += usec_now() - t;
+            t = usec_now();
+            save_j = save_start(out, "", 0, 1, NULL);
+            t = usec_now() - t;
+            save_us += t, saves++;
+            if (t > save_max) save_max = t;
+            break;
+        default:
+            continue;
+        }
+        if (u != undo_l.n)
+            u_close(a, o, u), u_free(&redo_l), chg = 1;
+        ++*ops;
+    }
+    if (save_j)
+        save_end(save_j), save_j = NULL;
+    sink = s;
+    return 1;
+}
+
+// all the linefeeds again, a piece at a time
+ST int count_lines(void) {
+    const char *p;
+    int o, n, r = 0;
+    for (edp = ed0; edp; edp = edp->next)
+        for (o = 0; o < flen; o += n) {
+            p = (const char *)getchunk(NULL, o, &n);
+            r += ch_count(p, n, 10);
+        }
+    edp = ed0;
+    return r;
+}
+
+ST unsigned checksum(void) {
+    char buf[BLS];
+    unsigned h = 2166136261u;
+    int o, n, i;
+    for (edp = ed0; edp; edp = edp->next)
+        for (o = 0; o < flen; o += n) {
+            n = imin(BLS, flen - o);
+            copyfrom(buf, o, n);
+            for (i = 0; i < n; i++)
+                h = (h ^ (unsigned char)buf[i]) * 16777619;
+        }
+    edp = ed0;
+    return h;
+}
+
+/*----------------------------------------------------------------------------*/
+// the crash test
+
+ST unsigned file_hash(const char *fn) {
+    char buf[BLS];
+    unsigned h = 2166136261u;
+    int n, i;
+    FILE *fp = fopen(fn, "rb");
+    if (NULL == fp) return 0;
+    while (0 < (n = fread(buf, 1, BLS, fp)))
+        for (i = 0; i < n; i++)
+            h = (h ^ (unsigned char)buf[i]) * 16777619;
+    fclose(fp);
+    return h;
+}
+
+// the edit between the saves, once it is in, once not
+ST void crash_edit(int f) {
+    static const char txt[] = "crash test\n";
+    int n = sizeof txt - 1, o = (flen - (f ? 0 : n)) / 2;
+    if (f) insdelmem(o, n), copyto(o, txt, n);
+    else insdelmem(o, -n);
+}
+
+ST int crash_save(const char *bak) {
+    return 0 == save_end(save_start(out, bak, 4, 0, NULL));
+}
+
+ST int crash_test(int count) {
+    char bak[MAX_PATH], tmp[MAX_PATH];
+    unsigned h[2], r, b;
+    double t;
+    int i, f, st, bad = 0, tmps = 0;
+    pid_t pid;
+
+    sprintf(bak, "%s~", out);
+    sprintf(tmp, "%s.save~", out);
+    crash_edit(1);
+    crash_save("");
+    h[1] = file_hash(out);
+    crash_edit(0);
+    t = usec_now();
+    crash_save("");
+    t = usec_now() - t;
+    h[0] = file_hash(out);
+
+    for (i = 0; i < count; i++) {
+        fflush(stdout);
+        if (0 == (pid = fork())) {
+            for (f = 1;; f ^= 1)
+                crash_edit(f), crash_save(i & 1 ? bak : "");
+        }
+        if (pid < 0)
+            return 0;
+        // somewhere in the first few saves
+        usleep(rnd((unsigned)(4 * t) + 1));
+        kill(pid, SIGKILL);
+        waitpid(pid, &st, 0);
+
+        r = file_hash(out), b = file_hash(bak);
+        if ((r != h[0] && r != h[1]) || (b && b != h[0] && b != h[1]))
+            bad++;
+        if (0 == unlink(tmp))
+            tmps++;
+    }
+    printf("crash    %d kills, %d bad, %d with the new one left next to it,"
+        " %.1f ms a save\n", count, bad, tmps, t / 1e3);
+    unlink(bak);
+    return 0 == bad;
+}
+
+ST double get_size(const char *s) {
+    char *e;
+    double d = strtod(s, &e);
+    switch (*e) {
+    case 'g': case 'G': d *= 1024;
+    case 'm': case 'M': d *= 1024;
+    case 'k': case 'K': d *= 1024;
+    }
+    return d;
+}
+
+/*----------------------------------------------------------------------------*/
+int main(int argc, char **argv) {
+    const char *file = NULL, *trace = NULL, *wtrace = NULL;
+    double size = 16*1024*1024, t0, t1, t2, tc;
+    int count = 20000, ops = 0, i, m = 0, nb = 1, len, lns, k = 0, x = 0, lc;
+    struct edvars **pe;
+    char *mp;
+    FILE *fp;
+
+    for (i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (0 == strcmp(a, "-s") && i+1 < argc) size = get_size(argv[++i]);
+        else if (0 == strcmp(a, "-t") && i+1 < argc) trace = argv[++i];
+        else if (0 == strcmp(a, "-n") && i+1 < argc) count = atoi(argv[++i]);
+        else if (0 == strcmp(a, "-r") && i+1 < argc) rnd_s = atoi(argv[++i]);
+        else if (0 == strcmp(a, "-w") && i+1 < argc) wtrace = argv[++i];
+        else if (0 == strcmp(a, "-m")) m = 1;
+        else if (0 == strcmp(a, "-b") && i+1 < argc) nb = imax(1, atoi(argv[++i]));
+        else if (0 == strcmp(a, "-j") && i+1 < argc) find_threads = atoi(argv[++i]);
+        else if (0 == strcmp(a, "-k")) k = 1;
+        else if (0 == strcmp(a, "-u") && i+1 < argc) undo_mb = atoi(argv[++i]);
+        else if (0 == strcmp(a, "-o") && i+1 < argc) out = argv[++i];
+        else if (0 == strcmp(a, "-x") && i+1 < argc) x = atoi(argv[++i]);
+        else if (a[0] != '-') file = a;
+        else {
+            fprintf(stderr, "usage: edbench [-s size] [-t trace | -n count]"
+                " [-r seed] [-w trace] [-m] [-b count] [-j threads] [-k]"
+                " [-u MB] [-o file] [-x count] [file]\n");
+            return 1;
+        }
+    }
+    if (size > 0x7fffffff - 0x100000) {
+        fprintf(stderr, "edbench: the editor is limited to 2G\n");
+        return 1;
+    }
+
+    t0 = usec_now();
+    for (pe = &ed0, len = lns = i = 0; i < nb; i++, pe = &edp->next) {
+        *pe = edp = c_new(struct edvars);
+        if (file) {
+            if (0 == (m ? map_file(file) : load_file(file))) {
+                fprintf(stderr, "edbench: cannot read %s\n", file);
+                return 1;
+            }
+        } else
+            make_text(size);
+        len += flen, lns += tlin;
+    }
+    t1 = usec_now();
+    edp = ed0;
+    lines = tlin;
+
+    if (x) {
+        if (NULL == out) {
+            fprintf(stderr, "edbench: -x needs -o\n");
+            return 1;
+        }
+        return crash_test(x) ? 0 : 1;
+    }
+
+    if (trace)
+        fp = fopen(trace, "rb");
+    else if (wtrace)
+        fp = fopen(wtrace, "w+b");
+    else
+        fp = tmpfile();
+    if (NULL == fp) {
+        fprintf(stderr, "edbench: cannot open trace\n");
+        return 1;
+    }
+    if (NULL == trace) {
+        if (k) make_keys(fp, count);
+        else make_trace(fp, count);
+        rewind(fp);
+    }
+
+    tc = usec_now();
+    lc = count_lines();
+    tc = usec_now() - tc;
+
+    t2 = usec_now();
+    run_trace(fp, &ops);
+    t2 = usec_now() - t2;
+    fclose(fp);
+
+    if (nb > 1)
+        printf("size     %d bytes, %d lines in %d buffers\n", len, lns, nb);
+    else
+        printf("size     %d bytes, %d lines\n", flen, tlin);
+    printf("load     %.1f ms, %.0f MB/s\n",
+        (t1 - t0) / 1e3, len / (t1 - t0));
+    printf("count    %d lines again in %.1f ms, %.0f MB/s\n",
+        lc, tc / 1e3, len / tc);
+    printf("trace    %d ops in %.1f ms, %.0f ops/s, %.2f us/op\n",
+        ops, t2 / 1e3, ops / (t2 / 1e6), t2 / imax(ops, 1));
+    printf("peak     %ld kB, heap %ld kB\n", peak_kb(), status_kb("RssAnon"));
+    printf("undo     %d edits in %d kB, redo %d in %d kB\n",
+        undo_l.g, undo_l.size >> 10, redo_l.g, redo_l.size >> 10);
+    if (saves)
+        printf("save     %d in the background, %.2f ms to start each, %.2f ms"
+            " at most, %.1f ms waiting for the one before\n", saves,
+            save_us / saves / 1e3, save_max / 1e3, wait_us / 1e3);
+    printf("reads    %08x\n", sink);
+    printf("checksum %08x\n", checksum());
+
+    while (NULL != (edp = ed0)) {
+        ed0 = edp->next;
+        mp = map_p, i = map_n;
+        u_reset();
+        clear_text();
+        if (mp) munmap(mp, i);
+        m_free(edp);
+    }
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -41,6 +41,7 @@
 #define IDALLF      408
 #define IDGREP      409
 #define SEA_INIT    410
+#define IDRPLALL    411
 
 #define DLG_TOOL    700
 #define WTOOL       701
@@ -146,12 +147,14 @@
 #define CMD_CLOSE   1034
 #define CMD_PRJMGR  1035
 #define CMD_FILECHG 1036
+#define CMD_SAVED   1037
 
 #define CMD_NONE    1099
 
 #define CMD_NSEARCH  1101
 #define CMD_LOADFILE 1102
 #define CMD_GOTOLINE 1103
+#define CMD_RPLALL   1104
 
 #define CMD_PRJLIST    4000
 #define CMD_PRJLIST_M  4199
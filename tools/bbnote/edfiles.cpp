@@ -21,239 +21,39 @@
 #include <malloc.h>
 #include <commdlg.h>
 
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <fcntl.h>
+#endif
+
 char backup=0;
 char bakdir=0;
 char unix_eol=0;
 
 #define BLS     4096
-#define EDSZ    (BLS*3)
-#define QFLSH   (BLS*2)
-#define BLN     2
-
-struct bufpage {
-    struct bufpage *next;
-    struct bufpage *prev;
-    int size;
-    char cont[BLS];
-};
-
-#define inbuff (buf_e-buf_a)
-
-/*----------------------------------------------------------------------------*/
-ST void ins_pg(void) {
-    struct bufpage *p;
-    p=(struct bufpage *)c_alloc(sizeof(struct bufpage));
-    p->next=next_pg;
-    p->prev=prev_pg;
-    if (NULL!=prev_pg) prev_pg->next=p;
-    if (NULL!=next_pg) next_pg->prev=p;
-    next_pg=p;
-}
-
-ST void del_pg(void) {
-    struct bufpage *p;
-    p=next_pg;
-    next_pg=p->next;
-    prev_pg=p->prev;
-    if (NULL!=prev_pg) prev_pg->next=next_pg;
-    if (NULL!=next_pg) next_pg->prev=prev_pg;
-    m_free(p);
-}
-
-ST int flush_out(int m) {
-    int l;
-    l=imin(inbuff,BLS);
-    ins_pg();
-    memmove(next_pg->cont,buffer+m,l);
-    next_pg->size=l;
-    return l;
-}
-
-ST void flush_last(void){
-    buf_e-=flush_out(inbuff-BLS);
-}
-
-ST void flush_first(void){
-    int o;
-    buf_a+=o=flush_out(0);
-    memmove(buffer,buffer+o,inbuff);
-    prev_pg=next_pg;
-    next_pg=next_pg->next;
-}
-
-ST void insert_first(void){
-    int s;
-    next_pg=prev_pg;
-    prev_pg=next_pg->prev;
-    s=next_pg->size;
-    memmove(buffer+s,buffer,inbuff);
-    memmove(buffer,next_pg->cont,s);
-    buf_a-=s;
-    del_pg();
-}
-
-ST void insert_last(void){
-    int s;
-    if (next_pg==NULL) return;
-    s=next_pg->size;
-    memmove(buffer+inbuff,next_pg->cont,s);
-    buf_e+=s;
-    del_pg();
-}
-
-ST void flush_all(void) {
-    for (;inbuff;) {
-        if (inbuff<BLS) insert_last();
-        flush_first();
-    }
-}
-
-ST struct bufpage *getstart(void) {
-    struct bufpage *p,*n;
-    n=next_pg; p=prev_pg;
-    for (;NULL!=p;p=(n=p)->prev);
-    return n;
-}
-
-ST void fill_buffer(int o){
-    struct bufpage *p,*n;
-    int i;
-    i=o/BLS; buf_a=buf_e=i*BLS;
-    p=NULL; n=getstart();
-    for (;i--;) n=(p=n)->next;
-    prev_pg=p; next_pg=n; i=BLN;
-    for (;i--;) insert_last();
-}
-
-ST void shift_dn(void) {
-    if (inbuff > EDSZ-BLS) flush_last();
-    insert_first();
-}
-
-ST void shift_up(void) {
-    if (inbuff > EDSZ-BLS) flush_first();
-    insert_last();
-}
-
-/*----------------------------------------------------------------------------*/
-ST char *getmem(int o) {
-
-    for (;o<buf_a;) {
-        if (buf_a-o>QFLSH) goto p2;
-        shift_dn();
-    }
-
-    for (;o+BLS>buf_e && flen>buf_e;) {
-        if (o+BLS-buf_e>QFLSH) goto p2;
-        shift_up();
-    }
-
-    goto p1;
-p2:
-    flush_all();
-    fill_buffer(o);
-p1:
-    return buffer+(o-buf_a);
-}
-
-/*----------------------------------------------------------------------------*/
-void insdelmem (int o, int len) {
-    int a,b,d,f; char *at,*to,*p;
-
-    f = len>0; if (!f) len=-len;
 
-    p=getmem(o);
-
-    for (;len;)
-    {
-        b=imin(BLS,len);
-        if (f)
-        {
-            if (inbuff+b>EDSZ)
-            {
-                if (o>=buf_a+BLS) flush_first(), p-=BLS;
-                else flush_last();
-            }
-            to=(at=p)+b,a=o,d=b;
-        }
-        else
-        {
-            at=(to=p)+b,a=o+b,d=-b;
-            if (a>buf_e) insert_last();
-        }
-
-        memmove(to,at,buf_e-a);
-
-        buf_e+=d, flen+=d, len-=b;
-    }
+ST void unmap(char *p, int n) {
+#ifdef _WIN32
+    UnmapViewOfFile(p);
+#else
+    munmap(p, n);
+#endif
 }
 
 /*----------------------------------------------------------------------------*/
 void clear_buffer(void) {
-    struct bufpage *n=getstart();
-    freelist(&n);
-    next_pg = prev_pg = n;
-    buf_a   = buf_e   = 0;
+    char *p; int n;
+    if (save_j) save_over();
+    p = map_p, n = map_n;
+    clear_text();
+    if (p) unmap(p, n);
     u_reset();
 }
 
 struct edvars *new_buffer(void) {
-    return (struct edvars *)c_alloc(sizeof(struct edvars)-1+EDSZ);
-}
-
-/*----------------------------------------------------------------------------*/
-// buffer access
-
-unsigned char getchr(int o) {
-    if (o<buf_a || o>=buf_e) {
-        if (o<0 || o>=flen) return 0; 
-        return *getmem(o);
-    }
-    return *(buffer+(o-buf_a));
-}
-
-#if 0
-void setchr(int o, char c) {
-    if (o<0 || o>=flen) return;
-    *getmem(o)=c;
-    upd=1;
-}
-#endif
-
-void copyto(int dst, const char *src, int l) {
-    int b; char *p;
-    for (;l;) {
-        b=imin(l,BLS);
-        p=getmem(dst);
-        memmove(p,src,b);
-        l-=b; src+=b; dst+=b;
-    }
-    upd=1;
-}
-
-void copyfrom(char *dst, int src, int l) {
-    int b; char *p;
-    for (;l;) {
-        b=imin(l,BLS);
-        p=getmem(src);
-        memmove(dst,p,b);
-        l-=b; src+=b; dst+=b;
-    }
-}
-
-void clearchr(int dst, char c, int l) {
-    int b; char *p;
-    for (;l;) {
-        b=imin(l,BLS);
-        p=getmem(dst);
-        memset(p,c,b);
-        l-=b; dst+=b;
-    }
-    upd=1;
+    return (struct edvars *)c_alloc(sizeof(struct edvars));
 }
 
-/*----------------------------------------------------------------------------*/
-
 /*----------------------------------------------------------------------------*/
 void revlist (void *d) {
     void **a,**b,**c;
@@ -314,6 +114,7 @@ int fileexist(char *name) {
     return (a==(DWORD)-1) ? 0 : a;
 }
 
+#ifdef _WIN32
 HANDLE hopenfile(char *name, DWORD access, DWORD creation) {
     HANDLE hf;
     hf=CreateFile(name,access,
@@ -333,11 +134,6 @@ int getftime_0(char *fn, FILETIME *ft) {
     return r!=0;
 }
 
-int getftime(void) {
-    fileflg&=~4;
-    return getftime_0(filename, &filetime);
-}
-
 int setftime(void) {
     HANDLE hf;
     hf=hopenfile(filename,GENERIC_WRITE,OPEN_EXISTING);
@@ -347,6 +143,40 @@ int setftime(void) {
     return 1;
 }
 
+#else
+// the handle is the fd + 1, the time in 100ns since 1601 as on win32
+#define FT_1970 116444736000000000ULL
+
+HANDLE hopenfile(char *name, int flags) {
+    int fd=open(name, flags, 0666);
+    return fd<0 ? NULL : (HANDLE)(intptr_t)(fd+1);
+}
+
+#define hfd(hf) ((int)(intptr_t)(hf)-1)
+
+int getftime_0(char *fn, FILETIME *ft) {
+    struct stat st; ULONGLONG t;
+    if (stat(fn, &st)) return 0;
+    t=FT_1970 + st.st_mtim.tv_sec*10000000ULL + st.st_mtim.tv_nsec/100;
+    ft->dwLowDateTime=(DWORD)t, ft->dwHighDateTime=(DWORD)(t>>32);
+    return 1;
+}
+
+int setftime(void) {
+    struct timespec ts[2];
+    ULONGLONG t=filetime.dwLowDateTime|(ULONGLONG)filetime.dwHighDateTime<<32;
+    t-=FT_1970;
+    ts[0].tv_sec=t/10000000, ts[0].tv_nsec=t%10000000*100;
+    ts[1]=ts[0];
+    return 0==utimensat(AT_FDCWD, filename, ts, 0);
+}
+#endif
+
+int getftime(void) {
+    fileflg&=~4;
+    return getftime_0(filename, &filetime);
+}
+
 
 void f_reload(int f) {
     const char *p; int i;
@@ -402,12 +232,22 @@ r3:
 }
 
 
+#ifndef _WIN32
+ST int map_check(struct edvars *v);
+#endif
+
 void checkftime(HWND hwnd)  {
     FILETIME t1; struct edvars *v;
     for (v=ed0; NULL!=v; v=v->next)
-        if (getftime_0(v->sfilename, &t1)
-        && CompareFileTime(&v->sfiletime, &t1) != 0)
+        if (NULL==v->ssave_j
+        && getftime_0(v->sfilename, &t1)
+        && CompareFileTime(&v->sfiletime, &t1) != 0) {
+#ifndef _WIN32
+            if (map_check(v))
+                continue;
+#endif
             PostMessage((HWND)hwnd, WM_COMMAND, CMD_FILECHG, (LPARAM)v);
+        }
 }
 
 /*
@@ -423,6 +263,7 @@ callback.
 Something like that.
 */
 
+#ifdef _WIN32
 HANDLE openf(char *name) {
     return hopenfile(name,GENERIC_READ,OPEN_EXISTING);
 }
@@ -447,10 +288,36 @@ int closef(HANDLE hf) {
     return CloseHandle(hf);
 }
 
+#else
+HANDLE openf(char *name) {
+    return hopenfile(name,O_RDONLY);
+}
+
+HANDLE creatf(char *name) {
+    return hopenfile(name,O_WRONLY|O_CREAT|O_TRUNC);
+}
+
+DWORD readf(HANDLE hf, void *buf, DWORD l) {
+    ssize_t r=read(hfd(hf), buf, l);
+    return r<0 ? 0 : r;
+}
+
+DWORD writf(HANDLE hf, void *buf, DWORD l) {
+    ssize_t r=write(hfd(hf), buf, l);
+    return r<0 ? 0 : r;
+}
+
+int closef(HANDLE hf) {
+    return 0==close(hfd(hf));
+}
+#endif
+
 /*----------------------------------------------------------------------------*/
-int backupfile (char *org) {
-    char bak[128], *q, d, e;
+// the name of the backup, the file is renamed to it by the save
+int backupname (char *org, char *bak) {
+    char *q, d, e;
 
+    bak[0]=0;
     if (0==backup || 0==fileexist(org)) return 1;
 
     if (bakdir) {
@@ -462,14 +329,124 @@ int backupfile (char *org) {
         q=fname(strcpy(bak,org));
         for (d='~';e=*q,0 != (*q=d);d=e,q++);
     }
-
-    if (0!=fileexist(bak)) DeleteFile(bak);
-    if (0!=MoveFile(org,bak)) return 1;
-    oyncan_msgbox("Rename failed:\n%s",bak,1);
-    return 0;
+    return 1;
 }
 
 /*----------------------------------------------------------------------------*/
+#define MAPSIZE (4*1024*1024)   // map files from that size on
+
+// map a big file and keep the text there, see load_text()
+ST int mapfile(HANDLE fp, int *tl) {
+#ifdef _WIN32
+    DWORD n, hi=0;
+    HANDLE hm;
+    char *p;
+
+    n=GetFileSize(fp, &hi);
+    if (hi || n<MAPSIZE || n>0x7FFFFFFF) return 0;
+    hm=CreateFileMapping(fp, NULL, PAGE_READONLY, 0, 0, NULL);
+    if (NULL==hm) return 0;
+    p=(char*)MapViewOfFile(hm, FILE_MAP_READ, 0, 0, 0);
+    CloseHandle(hm);
+    if (NULL==p) return 0;
+#else
+    struct stat st, s2;
+    DWORD n;
+    char *p;
+
+    // a pipe or a device is read as it comes
+    if (fstat(hfd(fp), &st) || !S_ISREG(st.st_mode)
+     || st.st_size<MAPSIZE || st.st_size>0x7FFFFFFF)
+        return 0;
+    n=st.st_size;
+    p=(char*)mmap(NULL, n, PROT_READ, MAP_SHARED, hfd(fp), 0);
+    if (MAP_FAILED==p) return 0;
+    // the file is written to just now, read it instead
+    if (fstat(hfd(fp), &s2) || s2.st_size!=st.st_size
+     || s2.st_mtim.tv_sec!=st.st_mtim.tv_sec
+     || s2.st_mtim.tv_nsec!=st.st_mtim.tv_nsec) {
+        munmap(p, n);
+        return 0;
+    }
+#endif
+    *tl=load_text(p, n);
+    return 1;
+}
+
+// file names are the same, as the file system sees it
+ST int samefile(const char *a, const char *b) {
+#ifdef _WIN32
+    return 0==stricmp(a, b);
+#else
+    return 0==strcmp(a, b);
+#endif
+}
+
+// let go of the mappings of a file that is about to be written, after
+// the saves that still read from them
+ST void unmapfile(const char *name) {
+    struct edvars *v, *e=edp;
+    int n;
+    for (v=ed0; NULL!=v; v=v->next)
+        if (v->smap_p && samefile(name, v->sfilename)) {
+            edp=v;
+            if (save_j) save_over();
+            n=map_n;
+            unmap(unmap_text(), n);
+        }
+    edp=e;
+}
+
+#ifndef _WIN32
+// Another program that writes to a mapped file changes the text under
+// the buffer, or takes it away when it cuts the file, and reading it
+// then is SIGBUS. It is looked at on focus and on save: when the file
+// changed, the text is copied out of the mapping as it is now, or when
+// it is shorter, the buffer is read again. Returns 1 for that.
+ST int map_check(struct edvars *v) {
+    struct edvars *e=edp;
+    struct stat st;
+    FILETIME t;
+    int n, r=0;
+
+    if (NULL==v->smap_p || stat(v->sfilename, &st)
+     || 0==getftime_0(v->sfilename, &t)
+     || (st.st_size==v->smap_n && 0==CompareFileTime(&t, &v->sfiletime)))
+        return 0;
+    edp=v;
+    if (st.st_size>=map_n) {
+        n=map_n;
+        unmap(unmap_text(), n);
+    } else {
+        clear_buffer();
+        chg=0;
+        if (loadfile())
+            ed_cmd(EK_INIT,plin,cury,curx);
+        InfoMsg("File cut on disk, reloaded");
+        r=1;
+    }
+    edp=e;
+    return r;
+}
+
+// On posix the mapping of the file as it was stays good after the new
+// one is renamed over it. When the buffer is as it was saved, and the
+// save says the new file loads to that same text (save_exact()), the
+// buffer moves to a mapping of that, and keeps its undo log.
+ST void remap(void) {
+    struct edvars *v=edp, *t=new_buffer();
+    int e;
+
+    strcpy(t->sfilename, filename);
+    edp=t;
+    e=loadfile() && map_p && flen==v->sflen;
+    if (e) swap_text(v);
+    clear_buffer();
+    m_free(t);
+    edp=v;
+}
+#endif
+
 int loadfile(void) {
 
     HANDLE fp;
@@ -484,6 +461,7 @@ int loadfile(void) {
     if (NULL==(buf_i = (char *)m_alloc (BLS))) goto end_0;
     if (NULL==(buf_o = (char *)m_alloc (BLS))) goto end_1;
     if ((fp = openf(filename))==NULL)  goto end_2;
+    if (mapfile(fp, &tl)) goto p9;
 
 p0:
     n=0;
@@ -506,6 +484,7 @@ p2:
         }
     }
     if (n) goto p2;
+p9:
     closef(fp);
     getftime();
     e=1;
@@ -526,80 +505,85 @@ int is_makefile(const char *name)
 }
 
 /*----------------------------------------------------------------------------*/
-int savefile(char *name) {
+char savedly = 2; //sec
 
-    HANDLE fp;
-    unsigned char d,e,f,g,l,*q,*p=NULL;
-    int a,b,c,i,k,t,s;
-    char *buf_i;
-    char *buf_o;
+// The file is written in the background (edsave.cpp), hwnd gets
+// CMD_SAVED when it is done. A save still going on for the buffer,
+// or for that file, is waited for first.
 
-    e=l=g=d=a=b=t=s=0;
+int savefile(char *name, HWND hwnd) {
+    struct edvars *v, *e=edp;
+    char bak[MAX_PATH], path[MAX_PATH];
+    int k;
+
+    for (v=ed0; NULL!=v; v=v->next)
+        if (v->ssave_j && (v==e || samefile(name, save_name(v->ssave_j))))
+            edp=v, save_over();
+    edp=e;
 
     k = tabs;
     if (!tuse && !is_makefile(name))
         k = 0;
 
-    if (0==backupfile(name)) goto end_0;
+#ifdef _WIN32
+    unmapfile(name);
+#else
+    map_check(e);
+    // a file written in place, see save_target()
+    if (save_target(name, path)) unmapfile(name);
+#endif
+    if (0==backupname(name, bak)) return 0;
+    save_j=save_start(name, bak, k, unix_eol, hwnd);
+    return 1;
+}
 
-    if (NULL==(buf_o = (char *)m_alloc (BLS))) goto end_0;
-    if (NULL==(buf_i = (char *)m_alloc (BLS))) goto end_1;
-    if (NULL==(fp = creatf(name))) goto end_2;
-p0:
-    i=0; q=(unsigned char*)buf_o;
-    for (;;) {
-        if (d) goto p4;
-        if (b==0) {
-            if (0==(b=imin(BLS,flen-a)))
-                break;
-            copyfrom(buf_i, a, b);
-            p = (unsigned char*)buf_i;
-            a+=b;
-        }
-        d=*p++; t++; b--;
-        if (d==TABC || (d==32 && g==0)) {
-            s++;
-            d = 0;
-            if (k<2 || t%k)
-                continue;
-            d = 9;
-            s = 0;
-            goto p5;
-        }
+// the save of the current buffer is over, or waited for
+int save_over(void) {
+    char name[MAX_PATH];
+    unsigned long d;
+    int e, x;
 
-        g=1;
-p4:
-        if (s) {
-            f=32; s--;
-            goto p3;
-        }
-        if (d==10) {
-            if (l==0 && unix_eol==0) {
-                f=13; l=1; goto p3;
-            }
-            t=g=l=0;
-        }
-p5:
-        f=d; d=0;
-p3:
-        *q++=f; i++;
-        if (i>=BLS) {
-p1:
-            c=writf(fp, buf_o, i);
-            if (c<i) goto end_3;
-            goto p0;
-        }
+    strcpy(name, save_name(save_j));
+    x=save_exact(save_j);
+    e=save_end(save_j);
+    save_j=NULL;
+    if (e) {
+        u_setchg(1);
+        settitle();
+        oyncan_msgbox(e==SV_RENAME
+            ? "Rename failed:\n%s" : "Saving failed:\n%s", name, 1);
+        return 0;
     }
-    if (i) goto p1;
-    e=1;
-end_3:
-    closef(fp);
-end_2:
-    m_free(buf_i);
-end_1:
-    m_free(buf_o);
-end_0:
-    return e;
+
+    strcpy(filename,name);
+    fnameflg=1;
+    getftime();
+
+    if (savedly>0) {
+        d=savedly;
+        d*=10000000UL;
+        if (d>filetime.dwLowDateTime)
+            filetime.dwHighDateTime--;
+        filetime.dwLowDateTime-=d;
+        setftime();
+    }
+#ifndef _WIN32
+    if (map_p && 0==chg && x) remap();
+#endif
+
+    InfoMsg("Saved");
+    settitle();
+    return 1;
+}
+
+// CMD_SAVED, the saves that are done
+void save_check(void) {
+    struct edvars *e=edp;
+    for (edp=ed0; NULL!=edp; edp=edp->next)
+        if (save_j && save_done(save_j))
+            save_over();
+    edp=e;
+    settitle();
 }
 
 /*----------------------------------------------------------------------------*/
@@ -663,7 +647,7 @@ int LoadFile(LPSTR pszFileName) {
     GetFullPathName(pszFileName,256,tmp,NULL);
 
     for (p=ed0;p!=NULL;p=p->next) {
-        if (0==stricmp(tmp,p->sfilename)) {
+        if (samefile(tmp,p->sfilename)) {
             insfile(p);
             return 1;
         }}
@@ -679,27 +663,12 @@ int LoadFile(LPSTR pszFileName) {
 }
 
 
-char savedly = 2; //sec
-
-int SaveFile(LPSTR pszFileName) {
-    unsigned long d;
-
-    if (0==savefile(pszFileName)) return 0;
-    strcpy(filename,pszFileName);
-    fnameflg=1;
-    getftime();
+// the text as it is now goes to the file, with w it is there on return
+int SaveFile(LPSTR pszFileName, HWND hwnd, int w) {
+    if (0==savefile(pszFileName, hwnd)) return 0;
     u_setchg(0);
-
-    if (savedly>0) {
-        d=savedly;
-        d*=10000000UL;
-        if (d>filetime.dwLowDateTime)
-            filetime.dwHighDateTime--;
-        filetime.dwLowDateTime-=d;
-        setftime();
-    }
-
-    InfoMsg("Saved");
+    if (w) return save_over();
+    InfoMsg("Saving");
     settitle();
     return 1;
 }
@@ -708,16 +677,18 @@ int SaveFile(LPSTR pszFileName) {
 void clean_up(void) {
     void freehash(void);
     void clrcfg(void);
+    void free_search(void);
 
     while(NULL!=edp)
         delfile();
     clrcfg();
     freehash();
+    free_search();
 
 #ifdef BBOPT_MEMCHECK
     int n = m_alloc_size() - clip_s;
     if (ownd)
-        n-=sizeof(struct edvars)+EDSZ;
+        n-=sizeof(struct edvars);
     if (0!=n) {
         char buf[40];
         sprintf(buf,"alloc = %d", n);
@@ -762,7 +733,7 @@ int DoFileOpenSave(HWND hwnd, int mode) {
         "C-Files (*.c *.cpp *.h)\0*.c;*.cpp;*.h\0"
         ;
 
-    switch (mode) {
+    switch (mode&3) {
     case 0:
         ofn.Flags = OFN_EXPLORER | OFN_HIDEREADONLY | OFN_FILEMUSTEXIST | OFN_ALLOWMULTISELECT;
         if(GetOpenFileName(&ofn)==0)
@@ -804,8 +775,10 @@ int DoFileOpenSave(HWND hwnd, int mode) {
             goto save_as;
         fn = filename;
     save1:
-        if (SaveFile(fn)) goto succ;
-        err = "Saving failed:\n%s";
+        // with mode&4 it is written when this returns
+        if (SaveFile(fn, hwnd, mode&4)) goto succ;
+        r=-1;
+        goto end;
     p_err:
         oyncan_msgbox(err, fn, 1);
         r=-1;
@@ -830,7 +803,7 @@ int QueryDiscard_1(HWND hwnd, int f) {
         if (r==IDCANCEL) return 0;
         if (r==IDNO)     return 1;
     }
-    return DoFileOpenSave(hwnd, 2);
+    return DoFileOpenSave(hwnd, 2+4);
 }
 
 
@@ -864,7 +837,7 @@ int do_search (int msg, DWORD param)
     switch(msg) {
         case 0:
 
-        hwnd = (HWND)param;
+        hwnd = (HWND)(DWORD_PTR)param;
         s_dir=s_cont=0;
 
         if (getmark(&m) && m.y==0 && m.l<40) {
@@ -898,6 +871,20 @@ int do_search (int msg, DWORD param)
             SendMessage(hwnd,CMD_NSEARCH,0,0);
             return 1;
 
+        case IDRPLALL:
+            if (seabuf[0]==0) return 1;
+            {
+              struct sea sea;
+              sea.str=strcpy(tmpbuf,seabuf);
+              sea.sf=seamodeflg;
+              i=SendMessage(hwnd,CMD_RPLALL,(WPARAM)rplbuf,(LPARAM)&sea);
+            }
+            s_cont=0;
+            if (i<0) sprintf(tmpbuf,"error in pattern '%s'", seabuf);
+            else     sprintf(tmpbuf,"replaced %d", i);
+            InfoMsg(tmpbuf);
+            return 1;
+
         case IDUP: c=2;   goto s2;
     s1:
         case IDOK: c=1;
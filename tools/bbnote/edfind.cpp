@@ -0,0 +1,323 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDFIND.C - find all matches in the open buffers, with threads
+
+#include "edstruct.h"
+#include <ctype.h>
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/*
+    find_all() takes a snapshot of the text of each buffer (text_snap()
+    in edtext.cpp) and has them searched by worker threads, the biggest
+    buffers first, with a dfa for each thread since a dfa makes its
+    states as it goes. It waits for the threads, so the buffers do not
+    change meanwhile. A thread that gets no memory for its dfa leaves
+    its buffers to rmatch(), afterwards in the main thread.
+
+    The matches come as start/end pairs for each buffer, in the order of
+    the buffers, for "replace all" to put in with one undo step for each
+    buffer (ed_cmd(EK_RPLALL)), or for the search through all files to
+    know which one is next. Plain strings are searched as a regular
+    expression too.
+*/
+
+#define MAX_THREADS 16
+
+int find_threads;           // 0: one for each cpu
+
+struct fjob {
+    struct hits *h;
+    struct tsnap *snap;
+    int len;
+};
+
+struct fwork {
+    unsigned char *code;
+    struct fjob **j;
+    int first, step, count;
+    int tabc, word, max;
+    char nodfa;             // left for find_slow()
+};
+
+ST int f_alnum(struct tsnap *s, int o) {
+    int n;
+    unsigned char c = *snap_chunk(s, o, &n);
+    return isalnum(c) || c == '_';
+}
+
+ST int f_getchr(int o) {
+    return getchr(o);
+}
+
+// the next match from o, with rmatch() in the buffer itself when
+// there is no dfa
+ST int find_next(struct rdfa *d, struct fwork *w, struct fjob *j, int o, int *pm) {
+    struct rmres res[16];
+    int n;
+    if (d)
+        return rdfa_find(d, o, j->len, pm, snap_chunk, j->snap);
+    for (; o < j->len; o++)
+        if (0 != (n = rmatch(o, 0, j->len, w->code, res,
+                w->tabc < 0 ? f_getchr : r_getchr)))
+            return *pm = o, n;
+    return 0;
+}
+
+ST void find_job(struct rdfa *d, struct fwork *w, struct fjob *j) {
+    struct hits *h = j->h;
+    int word = w->word, max = w->max;
+    int o, m, n, e;
+    for (o = 0; o < j->len; o = e) {
+        if (0 == (n = find_next(d, w, j, o, &m)))
+            break;
+        e = m + n;
+        // whole words, as checkword()
+        if (word && ((m && f_alnum(j->snap, m-1))
+                || (e < j->len && f_alnum(j->snap, e)))) {
+            e = m + 1;
+            continue;
+        }
+        // realloc, these are made in the threads
+        if (h->n == h->size)
+            h->size = h->size * 2 + 64,
+            h->m = (int*)realloc(h->m, h->size * 2 * sizeof *h->m);
+        h->m[2*h->n] = m, h->m[2*h->n+1] = e;
+        if (++h->n == max)
+            break;
+    }
+}
+
+#ifdef _WIN32
+ST unsigned __stdcall find_thread(void *arg)
+#else
+ST void *find_thread(void *arg)
+#endif
+{
+    struct fwork *w = (struct fwork *)arg;
+    struct rdfa *d = rdfa_new(w->code, w->tabc);
+    int i;
+    w->nodfa = NULL == d;
+    if (w->nodfa)
+        return 0;
+    for (i = w->first; i < w->count; i += w->step)
+        find_job(d, w, w->j[i]);
+    rdfa_free(d);
+    return 0;
+}
+
+// The jobs of a worker that had no memory for its dfa, here in the
+// main thread. rmatch() reads the buffers as they are, which is what
+// was snapped, since they do not change while find_all() waits.
+ST void find_slow(struct fwork *w) {
+    struct edvars *e = edp;
+    struct fjob *j;
+    int i;
+    for (i = w->first; i < w->count; i += w->step)
+        j = w->j[i], edp = j->h->ev, find_job(NULL, w, j);
+    edp = e;
+}
+
+ST int cpu_count(void) {
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+// the first worker runs here, and so does one whose thread did not start
+ST void run_workers(struct fwork *w, int n) {
+    int i;
+#ifdef _WIN32
+    HANDLE t[MAX_THREADS];
+    for (i = 1; i < n; ++i)
+        t[i] = (HANDLE)_beginthreadex(NULL, 0, find_thread, &w[i], 0, NULL);
+    find_thread(&w[0]);
+    for (i = 1; i < n; ++i)
+        if (t[i])
+            WaitForSingleObject(t[i], INFINITE), CloseHandle(t[i]);
+        else
+            find_thread(&w[i]);
+#else
+    pthread_t t[MAX_THREADS];
+    char ok[MAX_THREADS];
+    for (i = 1; i < n; ++i)
+        ok[i] = 0 == pthread_create(&t[i], NULL, find_thread, &w[i]);
+    find_thread(&w[0]);
+    for (i = 1; i < n; ++i)
+        if (ok[i])
+            pthread_join(t[i], NULL);
+        else
+            find_thread(&w[i]);
+#endif
+}
+
+ST int by_size(const void *a, const void *b) {
+    return (*(struct fjob**)b)->len - (*(struct fjob**)a)->len;
+}
+
+// a plain string as a regular expression
+ST char *f_escape(char *d, const char *s) {
+    char *p = d;
+    for (; *s; s++) {
+        if (strchr("/[].!{}()$^?*+|", *s))
+            *p++ = '/';
+        *p++ = *s;
+    }
+    *p = 0;
+    return d;
+}
+
+/*----------------------------------------------------------------------------*/
+// Finds all matches, or the first 'max' ones, in the current buffer, or
+// with sf&128 in all buffers, or with sf&129 in the ones after the
+// current. The flags are those of ed_search(). Returns the number of
+// matches, -1 for an error in the pattern.
+
+int find_all(const char *str, int sf, int max, struct hits **ph) {
+    struct edvars *ev0 = edp, *ev;
+    struct fwork w[MAX_THREADS];
+    struct fjob *j, **jp;
+    struct hits **hp;
+    unsigned char *code;
+    char *q;
+    int i, n, k, r;
+
+    *ph = NULL;
+    q = (char*)m_alloc(2 * strlen(str) + 1);
+    if (0 == (sf & 64))
+        str = f_escape(q, str);
+    n = rcomp((unsigned char*)str, NULL, 0, (sf&16) == 0);
+    if (n)
+        code = (unsigned char*)m_alloc(n),
+        rcomp((unsigned char*)str, code, n, (sf&16) == 0);
+    m_free(q);
+    if (0 == n)
+        return -1;
+
+    for (n = 0, ev = ed0; ev; ev = ev->next)
+        n++;
+    j = (struct fjob*)c_alloc(n * sizeof *j);
+    jp = (struct fjob**)m_alloc(n * sizeof *jp);
+
+    for (k = i = 0, ev = ed0; ev; ev = ev->next, i++) {
+        if (ev == ev0) {
+            k = 1;
+            if ((sf & 129) == 129)
+                continue;
+        } else if (0 == (sf & 128) || ((sf & 1) && 0 == k))
+            continue;
+        if (0 == ev->sflen)
+            continue;
+        edp = ev;
+        j[i].h = c_new(struct hits);
+        j[i].h->ev = ev;
+        j[i].snap = text_snap();
+        j[i].len = flen;
+    }
+    edp = ev0;
+
+    for (k = i = 0; i < n; i++)
+        if (j[i].h)
+            jp[k++] = &j[i];
+    qsort(jp, k, sizeof *jp, by_size);
+
+    r = find_threads > 0 ? find_threads : cpu_count();
+    r = imax(1, imin(imin(r, MAX_THREADS), k));
+    for (i = 0; i < r; i++) {
+        w[i].code = code;
+        w[i].j = jp;
+        w[i].first = i;
+        w[i].step = r;
+        w[i].count = k;
+        w[i].tabc = (sf & 64) ? TABC : -1; // as ed_search() does
+        w[i].word = 0 != (sf & 32);
+        w[i].max = max;
+    }
+    if (k)
+        run_workers(w, r);
+    for (i = 0; i < r; i++)
+        if (w[i].nodfa)
+            find_slow(&w[i]);
+
+    for (hp = ph, r = i = 0; i < n; i++) {
+        if (NULL == j[i].h)
+            continue;
+        snap_free(j[i].snap);
+        if (0 == j[i].h->n) {
+            m_free(j[i].h);
+            continue;
+        }
+        r += j[i].h->n;
+        *hp = j[i].h, hp = &j[i].h->next;
+    }
+    m_free(jp);
+    m_free(j);
+    m_free(code);
+    return r;
+}
+
+/*----------------------------------------------------------------------------*/
+// Replace all goes from the end backwards, in runs of matches that are
+// close together, each run put in as one edit with the text between
+// its matches. Returns the new text for the run that ends with match
+// *pi-1, sets *pi to its first match, *pa and *pe to the part of the
+// buffer that it replaces and *pl to the length. q[] has the
+// replacement for each match, else it is r for all.
+
+#define RUN_GAP 1024
+
+char *rpl_run(struct hits *h, int *pi, int *pa, int *pe, int *pl, char **q, const char *r) {
+    int *m = h->m, i = *pi, j, k, l, n;
+    char *b, *p;
+
+    for (k = i-1; k > 0 && m[2*k] - m[2*k-1] < RUN_GAP; k--);
+    for (l = 0, j = k; j < i; j++) {
+        l += strlen(q ? q[j] : r);
+        if (j+1 < i)
+            l += m[2*j+2] - m[2*j+1];
+    }
+    p = b = (char*)m_alloc(l + 1);
+    for (j = k; j < i; j++) {
+        n = strlen(q ? q[j] : r);
+        memcpy(p, q ? q[j] : r, n), p += n;
+        if (j+1 < i)
+            copyfrom(p, m[2*j+1], n = m[2*j+2] - m[2*j+1]), p += n;
+    }
+    *pi = k, *pa = m[2*k], *pe = m[2*i-1], *pl = l;
+    return b;
+}
+
+void free_hits(struct hits *h) {
+    struct hits *n;
+    for (; h; h = n) {
+        n = h->next;
+        free(h->m);
+        m_free(h);
+    }
+}
+
+/*----------------------------------------------------------------------------*/
@@ -86,11 +86,13 @@ void ed_swapup(void);
 void ed_dupline(void);
 void ed_char(int);
 void ed_rplc(char *);
+void ed_rplall(struct hits *, struct sea *, char *);
 void ed_insert(char *);
 void ed_cmd(int, ...);
 void ed_fixup(void);
 void ed_mark(int, int);
 int  ed_search(struct sea *);
+void free_search(void);
 char *ed_make_rplc(char *, char *);
 
 /*----------------------------------------------------------------------------*/
@@ -204,73 +206,16 @@ void unmark(void) {
 /*----------------------------------------------------------------------------*/
 // undo / redo
 
-#define UD_INS 1
-#define UD_DEL 2
-#define UD_POS 3
-#define UD_CHG 4
-
-typedef struct undo_s {
-    struct undo_s *next;
-    int p;
-    int l;
-    char cmd;
-    char buf[1];
-} sud;
-
-sud **u_pp;
-
-sud *u_add(int cmd, int p, int l, int b) {
-    sud *up;
-
-    if (winflg&1) return NULL;
-
-    if (NULL!=(up=(struct undo_s *)m_alloc(sizeof(sud)+b))) {
-        up->next = *u_pp;
-        *u_pp    = up;
-        up->p    = p;
-        up->l    = l;
-        up->cmd  = cmd;
-    }
-    return up;
-}
-
-void u_setchg(int c) {
-    sud *up; int i;
-    for (i=0, up=undo_l; i<2; i++, up=redo_l)
-        for (;NULL!=up; up=up->next)
-            if (up->cmd==UD_POS)
-                up->cmd=UD_CHG;
-    chg=c;
-}
-
-
-void u_check(int a,int b) {     // called at exit of 'do-edit-cmd(int cmd)'
-    u_add(UD_POS+chg,a,b,0);
-
-}
-
-void u_reset(void) {            // called from 'close-the-file()'
-    freelist(&undo_l);
-    freelist(&redo_l);
-}
-
-void u_ins (int p, int l) {     // called from 'inschr(int pos, int cnt, char *what)'
-    u_add(UD_INS,p,l,0);
-}
-
-void u_del (int p, int l) {     // called from 'delchr(int pos, int cnt)'
-    sud *up=u_add(UD_DEL,p,l,l);
-    if (NULL!=up) copyfrom(up->buf, p, l);
-}
+// see edundo.cpp for the log
 
 static char msg_undo[]={'u','n'};
 static char msg_redo[]={'r','e'};
 static char msg_nour[]="nothing to ..do";
 
-void unredo(sud **u_p1, sud **u_p2, char *m) { // the one and only undo-redo
+void unredo(struct ulog *u_p1, struct ulog *u_p2, char *m) { // the one and only undo-redo
     sud *up; int p,l,a,e,c;
 
-    if (NULL==(up=*u_p1)) {
+    if (NULL==(up=u_top(u_p1))) {
         *(short*)(msg_nour+sizeof(msg_nour)-5) = *(short*)m;
         InfoMsg(msg_nour);
         return;
@@ -282,9 +227,9 @@ void unredo(sud **u_p1, sud **u_p2, char *m) { // the one and only undo-redo
     a=up->p;  c=up->cmd-UD_POS;  u_pp=u_p2;
 
     for (;;) {
-        *u_p1=up->next; m_free(up);
+        u_pop(u_p1);
 
-        if (NULL==(up=*u_p1) || UD_POS<=up->cmd)  break;
+        if (NULL==(up=u_top(u_p1)) || UD_POS<=up->cmd)  break;
 
         p=up->p, l=up->l;
 
@@ -312,11 +257,21 @@ p1:
 
 int entab(char* q, char *p, int n, int k) {
     unsigned char d,f,g,l;
-    int s,t,i;
+    int s,t,i,c;
+    const char *e;
     d=f=g=l=s=t=i=0;
     for (;;) {
         if (d) goto p4;
         if (n==0) break;
+        if (g && 0==s) {
+            // inside a line, up to the next TAB or LF as it is
+            e=ch_find(p,p+n,TABC,10);
+            if (0!=(c=(e ? e : p+n)-p)) {
+                if (q!=NULL) memcpy(q,p,c), q+=c;
+                p+=c, n-=c, t+=c, i+=c;
+                continue;
+            }
+        }
         d=*p++; t++; n--;
         if (d==TABC || (d==32 && g==0)) {
             s++; d=0;
@@ -342,11 +297,17 @@ p3:
 
 
 int detab(char* p, char *q, int n, int k) {
-    int i,r;
+    int i,r,m;
     unsigned char c;
 
     r=i=0;
     for (;n;) {
+        // up to the next TAB, LF, CR or 0 as it is
+        if (0!=(m=ch_ctl(q,q+n)-q)) {
+            if (NULL!=p) memcpy(p,q,m), p+=m;
+            q+=m, n-=m, i+=m, r+=m;
+            continue;
+        }
         c=*q++ ,n--;
         if (c==13) continue;
         if (c==0) break;
@@ -529,37 +490,7 @@ void delchr(int a, int n) {
 }
 
 /*----------------------------------------------------------------------------*/
-// basic next/prev line
-
-int nextline_v(int o, int n, int *v) {
-    int w=0,a;
-    for (;n--;) {
-        a=o;
-        for (;;) {
-            if (o==flen) { o=a; goto p1; }
-            if (getchr(o++)==10) break;
-        }
-        w++;
-    }
-p1:
-    if (v!=NULL) *v=w;
-    return o;
-}
-
-int prevline_v(int o, int n, int *v) {
-    int w=0;
-    for (;;) {
-        for (;;) {
-            if (o==0) goto p1;
-            if (getchr(--o)==10) break;
-        }
-        if (n--==0) { o++; break; }
-        w++;
-    }
-p1:
-    if (v!=NULL) *v=w;
-    return o;
-}
+// basic next/prev line, see also nextline_v() and prevline_v() in edtext.cpp
 
 int nextline(int o, int n) {
     return nextline_v(o,n,NULL);
@@ -574,8 +505,13 @@ int fixline (int p) {
 }
 
 int linelen(int o) {
-    int m=o;
-    for (;m<flen && getchr(m)!=10;m++);
+    const char *p,*q;
+    int m=o,n;
+    for (;m<flen;m+=n) {
+        p=(const char*)getchunk(NULL,m,&n);
+        if (NULL!=(q=ch_find(p,p+n,10,10)))
+            return m+(q-p)-o;
+    }
     return m-o;
 }
 
@@ -593,10 +529,15 @@ int movpage(int n) {
 }
 
 int delspc(int o) {
-    int n,l;
-    unsigned char d;
+    const char *p;
+    int n,l,k;
     o+=linelen(o);
-    for (n=o;n && ((d=getchr(n-1))==' ' || d==TABC);n--);
+    for (n=o;n;) {
+        p=(const char*)getchunk_b(n,&k);
+        for (l=k;l && (p[-1]==' ' || p[-1]==TABC);l--,p--);
+        n-=k-l;
+        if (l) break;
+    }
     l=o-n;
     if (l) delchr(n, l);
     return l;
@@ -623,16 +564,6 @@ void inschr_tab(int lp, int o, int k, int n, char *q) {
     m_free(p);
 }
 
-/*----------------------------------------------------------------------------*/
-// count lines
-
-int cntlf(int a, int e) {
-    int r=0;
-    for (;a<e;a++)
-        if (getchr(a)==10) r++;
-    return r;
-}
-
 /*----------------------------------------------------------------------------*/
 // dup/swap line helper functions
 
@@ -1697,12 +1628,13 @@ void ed_mark(int a, int b) {
 
 /*----------------------------------------------------------------------------*/
 void ed_cmd (int cmd, ...) {
-    int a,b,c,d; void *u; va_list vl;
+    int a,b,c,d,u; va_list vl;
 
     if (edp==NULL) return;
 
     a=fpos;
-    u=*(u_pp=&undo_l);
+    u_pp=&undo_l;
+    u=undo_l.n;
 
     va_start(vl,cmd);
 
@@ -1722,6 +1654,10 @@ void ed_cmd (int cmd, ...) {
     case EK_GOTO:           fpos=va_arg(vl,int);             ed_goto(); break;
 
     case EK_REPLACE:        ed_rplc     (va_arg(vl,char*));     break;
+    case EK_RPLALL:       { struct hits *h = va_arg(vl,struct hits*);
+                            struct sea *s = va_arg(vl,struct sea*);
+                            ed_rplall(h, s, va_arg(vl,char*)); }
+                            break;
     case EK_INSERT:         ed_insert   (va_arg(vl,char*));     break;
     case EK_INSBLK:         ed_insblk_0 (va_arg(vl,char*),0,0); break;
 
@@ -1817,9 +1753,9 @@ void ed_cmd (int cmd, ...) {
 
     ed_fixup();
 
-    if (u!=undo_l) {
-        u_check(a,fpos);
-        freelist(&redo_l);
+    if (u!=undo_l.n) {
+        u_close(a,fpos,u);
+        u_free(&redo_l);
         chg=1;
     }
 }
@@ -1858,6 +1794,11 @@ int checkword(int a, int e) {
 static struct rmres res[16];
 static char cres;
 
+// the compiled regex of the last search, for 'find next'
+static unsigned char *code;
+static struct rdfa *dfa;
+static char *dstr;
+
 int r_getchr(int o) {
     int c=getchr(o);
     if (c==TABC) return ' ';
@@ -1866,11 +1807,12 @@ int r_getchr(int o) {
 
 int ed_search(struct sea *sea) {
     int m=sea->from; char* q=sea->str; int sf=sea->sf;
-    int i,k,n,o,fl;
+    int i,k,n,o=0,fl;
     char *p,e;
+    const char *u,*v;
     char bstr[128];
     char cstr[128];
-    unsigned char *code;
+    static int dsf;
     static int pmat;
 
     k=1; i=fl=flen;
@@ -1884,15 +1826,25 @@ int ed_search(struct sea *sea) {
     if (0==(sf&16))             //ignore case
         strlwr(q), strupr(p);
 
-    for (;m!=i;m+=k)
-        if ((e=getchr(m))==q[0]||e==p[0])
-            for (o=m+(n=1);;o++,n++) {
-                if (q[n]==0) {
-                    if ((sf&32) && !checkword(m,o)) break; //words
-                    goto s01;
-                }
-                if (o>=fl || ((e=getchr(o))!=q[n] && e!=p[n])) break;
+    for (;m!=i;m+=k) {
+        // to the next place with the first char, a piece at a time
+        if (k>0) {
+            u=(const char*)getchunk(NULL,m,&n);
+            if (NULL==(v=ch_find(u,u+n,q[0],p[0]))) { m+=n-1; continue; }
+            m+=v-u;
+        } else {
+            u=(const char*)getchunk_b(m+1,&n);
+            if (NULL==(v=ch_rfind(u-n,u,q[0],p[0]))) { m-=n-1; continue; }
+            m-=u-1-v;
+        }
+        for (o=m+(n=1);;o++,n++) {
+            if (q[n]==0) {
+                if ((sf&32) && !checkword(m,o)) break; //words
+                goto s01;
             }
+            if (o>=fl || ((e=getchr(o))!=q[n] && e!=p[n])) break;
+        }
+    }
     return 0;
 s01:
     sea->a=m;
@@ -1906,30 +1858,48 @@ regsearch:
 
     if (m>=fl) return 0;
 
-    for (n=0,code=NULL;;) {
-        o=rcomp((unsigned char*)q,code,n,(sf&16)==0); //ignore case
-        if (o==0) return -1;
-        if (n) break;
-        code=(unsigned char*)m_alloc(n=o);
+    // keep the dfa for 'find next' and 'replace all'
+    if (NULL==dfa || strcmp(q,dstr) || (sf^dsf)&16) {
+        free_search();
+        for (n=0,code=NULL;;) {
+            o=rcomp((unsigned char*)q,code,n,(sf&16)==0); //ignore case
+            if (o==0) return -1;
+            if (n) break;
+            code=(unsigned char*)m_alloc(n=o);
+        }
+        dfa=rdfa_new(code,TABC);
+        dstr=strcpy((char*)m_alloc(strlen(q)+1),q), dsf=sf;
     }
     cres=code[0];
     for (;m!=i;m+=k) {
-        for (o=0;;o=n,m--) {
-            n=rmatch(m,0,fl,code,res,r_getchr);
-            if (n<=o || k>0 || m==0) break;
+        if (k>0 && dfa) {
+            if (0==(n=rdfa_find(dfa,m,fl,&m,getchunk,NULL))) break;
+        } else {
+            // backwards, or without memory for the dfa
+            for (o=0;;o=n,m--) {
+                n=dfa ? rdfa_match(dfa,m,fl,getchunk,NULL)
+                      : rmatch(m,0,fl,code,res,r_getchr);
+                if (n<=o || k>0 || m==0) break;
+            }
+            if (o>n) n=o, m++;
+            if (n==0) continue;
         }
-        if (o>n) n=o, m++;
-        if (n==0) continue;
         o=m+n;
         if (sf&32 && !checkword(m,o)) continue; //words
         pmat=n;
         break;
     }
-    m_free(code);
+    if (pmat && cres) rmatch(m,0,fl,code,res,r_getchr); //groups
     if (pmat) goto s01;
     return 0;
 }
 
+void free_search(void) {
+    if (dfa) rdfa_free(dfa);
+    m_free(code), m_free(dstr);
+    dfa=NULL; code=NULL; dstr=NULL;
+}
+
 char *ed_make_rplc(char *dst, char *src) {
     int i, p, w;
     unsigned char c, d, u;
@@ -1970,3 +1940,103 @@ char *ed_make_rplc(char *dst, char *src) {
 }
 
 /*----------------------------------------------------------------------------*/
+// replace all, with the matches of find_all() in this buffer. With
+// groups the replacements are made first, from the text as it was.
+// They go in from the end backwards, so that the positions before
+// stay as they are, and close ones together (see rpl_run()).
+void ed_rplall(struct hits *h, struct sea *sea, char *r) {
+    unsigned char *code=NULL;
+    char **q=NULL, *t=r, *b;
+    int i, n, a, e, l=strlen(r)+1;
+
+    cres=0;
+    if ((sea->sf&64) && strchr(r,'%')) {
+        n=rcomp((unsigned char*)sea->str,NULL,0,(sea->sf&16)==0);
+        code=(unsigned char*)m_alloc(n);
+        rcomp((unsigned char*)sea->str,code,n,(sea->sf&16)==0);
+        cres=code[0];
+    }
+    if (cres) {
+        q=(char**)m_alloc(h->n*sizeof *q);
+        for (i=0;i<h->n;i++) {
+            a=h->m[2*i], n=h->m[2*i+1]-a;
+            rmatch(a,0,flen,code,res,r_getchr);
+            q[i]=ed_make_rplc((char*)m_alloc(l*imax(n,tabs)),r);
+        }
+    } else if (sea->sf&64)
+        t=ed_make_rplc((char*)m_alloc(l*tabs),r);
+
+    for (i=h->n;i;) {
+        b=rpl_run(h,&i,&a,&e,&n,q,t);
+        delchr(a,e-a);
+        inschr(a,n,b);
+        m_free(b);
+    }
+    fpos=h->m[0];
+    ed_goto();
+
+    if (q) {
+        for (i=0;i<h->n;i++) m_free(q[i]);
+        m_free(q);
+    } else if (t!=r)
+        m_free(t);
+    if (code) m_free(code);
+}
+
+/*----------------------------------------------------------------------------*/
+// find next / previous, for the search dialog (CMD_NSEARCH). With
+// sf&128 it goes on in the other buffers. The match is marked and the
+// cursor put there. Returns as ed_search().
+int ed_nsearch(struct sea *s) {
+    struct edvars *ev0;
+    struct hits *h;
+    int r;
+
+    for (ev0=edp;;) {
+        r=ed_search(s);
+        if (r || 0==(s->sf&128)) break;
+        s->sf &= ~4;
+        if (s->sf & 1) {
+            // the following files are looked through all at once,
+            // then the search goes on in the first with a match
+            if (find_all(s->str, s->sf, 1, &h) <= 0) break;
+            edp=h->ev, settitle();
+            free_hits(h);
+            s->from=0;
+            continue;
+        }
+        if (s->sf & 2) {
+            if (edp==ed0) break;
+            prevfile();
+            s->from=flen;
+            continue;
+        }}
+    if (r<=0) {
+        edp=ev0;
+        settitle();
+    } else {
+       ed_cmd(KEY_HOME);
+       ed_cmd(EK_MARK,s->a,s->e);
+       ed_cmd(EK_GOTO,s->a);
+    }
+    return r;
+}
+
+// replace all (CMD_RPLALL), in all buffers with sf&128, with one undo
+// step for each. Returns how many, or -1 for a bad pattern.
+int ed_rplfiles(struct sea *s, char *r) {
+    struct edvars *ev0=edp;
+    struct hits *h0, *h;
+    int n;
+
+    n=find_all(s->str, s->sf&~1, 0, &h0);
+    for (h=h0; h; h=h->next) {
+        edp=h->ev;
+        ed_cmd(EK_RPLALL, h, s, r);
+    }
+    edp=ev0;
+    free_hits(h0);
+    return n;
+}
+
+/*----------------------------------------------------------------------------*/
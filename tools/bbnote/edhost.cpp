@@ -0,0 +1,106 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDHOST.C - what edproc.cpp has for the engine, without a window
+
+#include "edstruct.h"
+
+/*
+    The editor engine is edfunc, edfiles, edtext, edfind, edundo, edsave
+    and match3. With this instead of edproc.cpp and edprint.cpp it builds
+    without a window, as libbbnote.a from makefile-posix, see edtrace.cpp.
+
+    Nothing is painted. The status messages go to 'infomsg'. The boxes
+    go to stderr and are answered with "no", or else with "cancel" or
+    "ok", so nothing is discarded. Without a clipboard, the block copy
+    and paste use the first of the editor's own (ed_setclip()).
+*/
+
+struct winvars editw =
+{
+    0,0,0,0,
+    0,
+    0,0,100,50,         // 100 x 50 chars on a page
+    0,0,1,1,
+    0,
+    NULL,NULL,
+    0,0,
+    0,0
+    };
+
+struct winvars *winp = &editw;
+struct edvars *ed0,*edp;
+
+char scroll_lock;
+char moumrk=0;
+char linmrk=1;
+char  vmark=0;
+char  hsbar=0;
+char prjflg;
+char grep_cmd[256];
+char currentdir[256];
+char projectdir[256];
+char infomsg[128];
+
+/*----------------------------------------------------------------------------*/
+void ed_host(int x, int y) {
+    extern int clip_n;
+    pgx=imax(1,x), pgy=imax(1,y);
+    clip_n=0;
+    if (0==GetCurrentDirectory(256, currentdir)) currentdir[0]=0;
+    strcpy(projectdir, currentdir);
+}
+
+void InfoMsg(const char *info) {
+    strcpy(infomsg, info);
+}
+
+int oyncan_msgbox(const char *t, const char *s, int f) {
+    fprintf(stderr, t, s);
+    fprintf(stderr, "\n");
+    return f&4 ? IDNO : f&8 ? IDCANCEL : IDOK;
+}
+
+void settitle(void) {
+    if (edp)
+        upd=1, lmax=0;
+}
+
+void setwtext(void) {
+}
+
+void clrcfg(void) {
+}
+
+void freehash(void) {
+}
+
+/*----------------------------------------------------------------------------*/
+char *fname(char *p) {
+    char *q = p+strlen(p);
+    for (; q>p && q[-1]!='/'; q--);
+    return q;
+}
+
+char *makepath(char *d, char *p, const char *f) {
+    strcpy(d,p);
+    if (d[0] && f[0] && d[strlen(d)-1]!='/') strcat(d,"/");
+    strcat(d,f);
+    return d;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -224,30 +224,94 @@ struct lang *lang = &no_lang;
 char langcode[40];
 
 /*----------------------------------------------------------------------------*/
-#define HTS 53
+// keywords, in a perfect hash table that set_lang() makes: the hash
+// picks a bucket, the bucket's kw_d[] moves its keys to free slots,
+// so a word is compared with one key at most.
 
-struct strl *hashtab[HTS];
+const char **kw_tab;
+unsigned short *kw_d;
+int kw_nb, kw_sh, kw_max;
+unsigned kw_seed;
 
-int hashstr(const char *s) {
-    unsigned int h; char c;
-    for (h=0;0!=(c=*s++);h>>=1)
-      if ((h^=c)&1) h^=0xa709;
-    return h%HTS;
+#define KW_SLOT(h,d) ((((h)^(d))*2654435761U)>>kw_sh)
+
+ST unsigned kwhash(const char *s) {
+    unsigned h=kw_seed;
+    while (*s) h=(h^(unsigned char)*s++)*16777619;
+    return h;
 }
 
 void freehash(void) {
-    int i=0;
-    do freelist(&hashtab[i]); while (++i<HTS);
+    int i;
+    if (kw_tab) {
+        for (i=1<<(32-kw_sh);i--;) m_free((char*)kw_tab[i]);
+        m_free(kw_tab); m_free(kw_d);
+    }
+    kw_tab=NULL; kw_d=NULL;
     lang=NULL;
 }
 
-void inshash(const char *q) {
-    conslist(&hashtab[hashstr(q)], newstr(q));
+// bigger buckets first
+ST int kw_cmp(const void *a, const void *b) {
+    return ((const int*)b)[1] - ((const int*)a)[1];
+}
+
+ST int kw_fit(char **k, int n) {
+    unsigned *h; int *b,i,j,x,m,d,c;
+    m=1<<(32-kw_sh);
+    h=(unsigned*)m_alloc(n*sizeof(unsigned));
+    b=(int*)c_alloc(kw_nb*2*sizeof(int));
+    for (i=0;i<kw_nb;i++) b[2*i]=i;
+    for (i=0;i<n;i++) h[i]=kwhash(k[i]), b[2*(h[i]%kw_nb)+1]++;
+    qsort(b,kw_nb,2*sizeof(int),kw_cmp);
+    memset(kw_tab,0,m*sizeof(char*));
+    for (i=0;i<kw_nb && b[2*i+1];i++) {
+        x=b[2*i];
+        for (d=0;d<0x10000;d++) {
+            for (c=j=0;j<n;j++) {
+                if (h[j]%kw_nb!=(unsigned)x) continue;
+                if (kw_tab[KW_SLOT(h[j],d)]) break;
+                kw_tab[KW_SLOT(h[j],d)]=k[j], c++;
+            }
+            if (j==n) break;
+            // undo and try the next
+            for (j=0;c && j<n;j++)
+                if (h[j]%kw_nb==(unsigned)x
+                 && kw_tab[KW_SLOT(h[j],d)]==k[j])
+                    kw_tab[KW_SLOT(h[j],d)]=NULL, c--;
+        }
+        if (d==0x10000) break;
+        kw_d[x]=d;
+    }
+    m=i<kw_nb && b[2*i+1];
+    m_free(h); m_free(b);
+    return !m;
+}
+
+ST void kw_make(char **k, int n) {
+    int m;
+    if (0==n) return;
+    for (m=1,kw_sh=32;m<2*n;m*=2,kw_sh--);
+    kw_nb=n/2+1;
+    kw_tab=(const char**)m_alloc(m*sizeof(char*));
+    kw_d=(unsigned short*)c_alloc(kw_nb*sizeof(short));
+    // two keys with the same hash never fit, try another
+    for (kw_seed=2166136261U;!kw_fit(k,n);kw_seed++);
+}
+
+ST int kw_add(char **k, int n, const char *q) {
+    char buf[32]; int i;
+    strncpy(buf,q,31)[31]=0;
+    if (lang->flg & NOCASE) strlwr(buf);
+    for (i=0;i<n;i++) if (!strcmp(k[i],buf)) return n;
+    k[n]=strcpy((char*)m_alloc(strlen(buf)+1),buf);
+    if ((i=strlen(buf))>kw_max) kw_max=i;
+    return n+1;
 }
 
 void set_lang(const char *p) {
-    char buf[32]; const char *q, **cp;
-    struct lang **lp; int i;
+    char buf[32]; const char *q, **cp; char **k;
+    struct lang **lp; int i,n;
     extern char synhilite;
 
     buf[0]=0;
@@ -273,16 +337,25 @@ brk:
     freehash();
     lang=*lp;
 
+    for (n=0,cp=lang->keys;NULL!=*cp;cp++) n++;
+    if (NULL!=(cp=lang->prae))
+        for (;NULL!=*cp;cp++) n++;
+    k=(char**)m_alloc((n+1)*sizeof(char*));
+
+    kw_max=n=0;
     for (cp=lang->keys;NULL!=(q=*cp);cp++) {
-        inshash(q);
+        n=kw_add(k,n,q);
     }
 
     if (NULL!=(cp=lang->prae)) {
         for (buf[0]=**cp++; NULL!=(q=*cp); cp++) {
             strcpy(buf+1,q);
-            inshash(buf);
+            n=kw_add(k,n,buf);
         }}
 
+    kw_make(k,n);
+    m_free(k);
+
     langcode[0]=0;
     if (NULL!=(q=lang->cclass)) {
         rcomp((unsigned char*)q, (unsigned char*)langcode, sizeof(langcode),1);
@@ -292,23 +365,39 @@ brk:
 }
 
 /*----------------------------------------------------------------------------*/
-// step back for 20 lines and check for comments;
+// comments: the lexer state at the start of each line is kept with the
+// buffer in lex_p[], good for the first lex_n lines. insdelmem() puts
+// the first offset that changed into lex_v, so the lines from there on
+// are lexed again, when needed and not further than the page to paint.
+//
+// The state is 0, 1+i for in comment lang->cmt[i], or 128+j for in the
+// string lang->str[2*j], when its linefeed was escaped.
 
 #define CM 100
+#define LEX_OK 0x7fffffff
 
 int cmt[CM]; int cn;
 
-void checkcomment(int oo, int yn) {
-    int a,b,o,p,i;
-    unsigned char *s,c,d,f,ls;
-    const char **lc,*la,*le;
+ST void lex_put(int l, int st) {
+    if (l!=lex_n) return;
+    if (l==lex_size)
+        lex_size=lex_size*2+256,
+        lex_p=(unsigned char*)m_realloc(lex_p,lex_size);
+    lex_p[lex_n++]=st;
+}
 
-    if (langflg==0) return;
+// scan yn lines from o, which is the start of line l, and put the
+// comments from oo on into cmt[]
+ST void lex_scan(int o, int l, int yn, int oo) {
+    int a,b,p,i;
+    unsigned char *s,c,d,f,ls,st;
+    const char **lc,*la,*le;
 
-    a=cn=0; s=NULL; la=NULL;
-    o=prevline_v(oo, 20, &i); yn+=i;
-    f=ls=0;
     lc=lang->cmt;
+    a=o; s=NULL; la=NULL; f=ls=0; i=0;
+    st=lex_p[l];
+    if (st&128) f=2, s=(unsigned char*)lang->str+2*(st&127);
+    else if (st) f=1, i=st-1, la=strchr(lc[i],' ')+1;
 
     for (;yn>0 && o<flen;) {
         c=getchr(o++);
@@ -316,6 +405,8 @@ void checkcomment(int oo, int yn) {
             yn--;
             ls=0;
             if (f==2) f=0;
+            if (f==3) f=2;
+            lex_put(++l, f==1 ? 1+i : f==2 ? 128+(s-(unsigned char*)lang->str)/2 : 0);
             continue;
         }
         if (f==0)
@@ -334,6 +425,7 @@ void checkcomment(int oo, int yn) {
                         for (;p<flen && getchr(p++)!=10;);
                         yn--;
                         ls=0;
+                        lex_put(++l,0);
                         goto s1;
                     }
                     if (d!=getchr(p++)) break;
@@ -346,7 +438,10 @@ void checkcomment(int oo, int yn) {
         if (f==2) {
             if (c==*s) f=0;
             else
-            if (c==*(s+1)) o++;
+            if (c==*(s+1) && o<flen) {
+                if (getchr(o)==10) f=3;
+                else o++;
+            }
             continue;
         }
         if (c==*la) {
@@ -372,6 +467,26 @@ void checkcomment(int oo, int yn) {
    if (f==1) goto s2;
 }
 
+void checkcomment(int oo, int yn) {
+    int o,l;
+
+    if (langflg==0) return;
+
+    cn=0;
+    if (lex_lang!=lang)
+        lex_lang=lang, lex_n=0;
+    if (lex_v!=LEX_OK)
+        lex_n=imin(lex_n, cntlf(0, imin(lex_v, flen))+1), lex_v=LEX_OK;
+    lex_put(0,0);
+
+    o=prevline(oo,0);
+    l=cntlf(0,o);
+    if (l>=lex_n)
+        lex_scan(nextline(0,lex_n-1), lex_n-1, l-lex_n+1, LEX_OK);
+    if (l<lex_n)
+        lex_scan(o, l, yn, oo);
+}
+
 
 /*----------------------------------------------------------------------------*/
 int nextcmt(int o) {
@@ -386,7 +501,7 @@ int nextcmt(int o) {
 int cmpkey(int p, int n, char w, int *ip) {
     int i;
     unsigned char d,*cp; char buf[80];
-    struct strl *a;
+    const char *k; unsigned h;
 
     i=0; cp=(unsigned char*)buf; if (n>31) n=31;
     if (w) *cp++=w;
@@ -397,14 +512,14 @@ int cmpkey(int p, int n, char w, int *ip) {
         while (i<n && (d=getchr(p+i))<128 && (isalnum(d) || d=='_'));
 p2:
     if ((*ip=i)<1) return 0;
+    if (NULL==kw_tab || cp-(unsigned char*)buf>kw_max) return 0;
 
     *cp=0;
     if (lang->flg & NOCASE) strlwr(buf);
 
-    for (a=hashtab[hashstr(buf)];NULL!=a;a=a->next)
-        if (!strcmp(a->str,buf)) return 1;
-
-    return 0;
+    h=kwhash(buf);
+    k=kw_tab[KW_SLOT(h,kw_d[h%kw_nb])];
+    return NULL!=k && !strcmp(k,buf);
 
 p3:
 #define CLSZ 32
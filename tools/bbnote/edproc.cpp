@@ -1595,6 +1595,10 @@ showf:
             goto p0;
 
 
+        case CMD_SAVED:
+            save_check();
+            goto p0;
+
         case CMD_FILECHG:
         {
             struct edvars *p=edp;
@@ -1783,35 +1787,15 @@ config:
             goto p0;
         }
         unmark();
-        if (wParam!=0) {
-            struct sea *s=(struct sea *)lParam;
-            struct edvars *ev0;
-
-            for (ev0=edp;;) {
-                r=ed_search(s);
-                if (r || 0==(s->sf&128)) break;
-                s->sf &= ~4;
-                if (s->sf & 1) {
-                    if (edp->next==NULL) break;
-                    nextfile();
-                    s->from=0;
-                    continue;
-                }
-                if (s->sf & 2) {
-                    if (edp==ed0) break;
-                    prevfile();
-                    s->from=flen;
-                    continue;
-                }}
-            if (r<=0) {
-                edp=ev0;
-                settitle();
-            } else {
-               ed_cmd(KEY_HOME);
-               ed_cmd(EK_MARK,s->a,s->e);
-               ed_cmd(EK_GOTO,s->a);
-            }
-        }
+        if (wParam!=0)
+            r=ed_nsearch((struct sea *)lParam);
+        goto p0r;
+
+    case CMD_RPLALL:
+        // replace all, with one undo step for each file
+        resetmsg(hwnd);
+        unmark();
+        r=ed_rplfiles((struct sea *)lParam, (char *)wParam);
         goto p0r;
 
     }
@@ -0,0 +1,399 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDSAVE.C - writes a buffer to its file in the background
+
+#include "edstruct.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#endif
+
+/*
+    savefile() in edfiles.cpp has the text of the buffer written here
+    by a thread, while the editing goes on. The thread has a snapshot
+    of the pieces (text_snap()). Text that is in a text block is not
+    written to anymore, so the snapshot stays as it was until the
+    buffer is cleared, and clear_buffer() waits for the save.
+
+    The text goes to a new file next to the old one, which is flushed
+    to the disk and then renamed over the old one. The backup, if any,
+    is made before that as a link to the old one, or a copy on Windows
+    or where there are no links, so the old one stays where it is until
+    the rename. When the program or the system dies meanwhile, there is
+    the old file, or the new one, whole.
+
+    On posix a symlink is followed, the new file goes next to the file
+    it points to. Where the rename would lose something, another name
+    of a hard link, or the owner of a file not ours, the file is
+    written in place, with the backup copied first (save_target()).
+
+    When it is done, the thread posts CMD_SAVED to the window, which
+    then looks which saves are over (save_check()).
+*/
+
+#define SBS     65536       // what goes to the file at a time
+
+struct sjob {
+    struct tsnap *snap;
+    int len;
+    int tabs;               // write TABs for so many spaces, 0: none
+    int eol;                // LF only, else CR LF
+    int err;
+    int exact;              // the file loads to the text as it was
+    volatile int done;
+    HWND hwnd;
+#ifdef _WIN32
+    HANDLE t, fh;
+#else
+    pthread_t t;
+    int ok, fd;
+    char inplace;
+    char path[MAX_PATH];    // where a symlink goes
+#endif
+    char name[MAX_PATH], bak[MAX_PATH], tmp[MAX_PATH+8];
+};
+
+/*----------------------------------------------------------------------------*/
+ST int sv_exists(const char *name) {
+#ifdef _WIN32
+    return GetFileAttributes(name) != (DWORD)-1;
+#else
+    return 0 == access(name, F_OK);
+#endif
+}
+
+#ifndef _WIN32
+// the backup where there is no link, or before the file is written in place
+ST int sv_copy(const char *from, const char *to) {
+    char buf[SBS];
+    struct stat st;
+    int a, b, n, ok = 0;
+    if ((a = open(from, O_RDONLY)) < 0)
+        return 0;
+    if (0 == fstat(a, &st)
+     && (b = open(to, O_WRONLY|O_CREAT|O_TRUNC, st.st_mode & 07777)) >= 0) {
+        for (ok = 1; ok && (n = read(a, buf, sizeof buf)) > 0;)
+            ok = n == write(b, buf, n);
+        ok = ok && 0 == n && 0 == fsync(b);
+        ok = 0 == close(b) && ok;
+    }
+    close(a);
+    return ok;
+}
+#endif
+
+ST int sv_open(struct sjob *j) {
+#ifdef _WIN32
+    j->fh = CreateFile(j->tmp, GENERIC_WRITE, 0, NULL, CREATE_ALWAYS, 0, NULL);
+    return j->fh != INVALID_HANDLE_VALUE;
+#else
+    struct stat st;
+    int m;
+    if (j->inplace) {
+        if (j->bak[0] && sv_exists(j->path) && 0 == sv_copy(j->path, j->bak))
+            return 0;
+        return (j->fd = open(j->path, O_WRONLY|O_CREAT|O_TRUNC, 0666)) >= 0;
+    }
+    if ((j->fd = open(j->tmp, O_WRONLY|O_CREAT|O_TRUNC, 0666)) < 0)
+        return 0;
+    // keep the owner and the mode of the old one, without the set-id
+    // bits where the owner did not take
+    if (0 == stat(j->path, &st)) {
+        m = 0 == fchown(j->fd, st.st_uid, st.st_gid) ? 07777 : 0777;
+        fchmod(j->fd, st.st_mode & m);
+    }
+    return 1;
+#endif
+}
+
+ST int sv_put(struct sjob *j, const unsigned char *p, int n) {
+#ifdef _WIN32
+    DWORD r = 0;
+    return WriteFile(j->fh, p, n, &r, NULL) && (int)r == n;
+#else
+    int r;
+    for (; n; p += r, n -= r)
+        if ((r = write(j->fd, p, n)) <= 0) {
+            if (r < 0 && errno == EINTR) r = 0;
+            else return 0;
+        }
+    return 1;
+#endif
+}
+
+// all of it to the disk, before the rename goes there
+ST int sv_close(struct sjob *j, int ok) {
+#ifdef _WIN32
+    ok = ok && FlushFileBuffers(j->fh);
+    return CloseHandle(j->fh) && ok;
+#else
+    ok = ok && 0 == fsync(j->fd);
+    return 0 == close(j->fd) && ok;
+#endif
+}
+
+ST int sv_rename(struct sjob *j) {
+#ifdef _WIN32
+    // a copy leaves the old one where it is until the new one replaces it
+    if (j->bak[0] && sv_exists(j->name) && 0 == CopyFile(j->name, j->bak, FALSE))
+        return 0;
+    if (MoveFileEx(j->tmp, j->name, MOVEFILE_REPLACE_EXISTING|MOVEFILE_WRITE_THROUGH))
+        return 1;
+    if (GetLastError() != ERROR_CALL_NOT_IMPLEMENTED)
+        return 0;
+    // win9x
+    DeleteFile(j->name);
+    return 0 != MoveFile(j->tmp, j->name);
+#else
+    char d[MAX_PATH], *p;
+    int fd;
+    if (j->inplace)
+        return 1;
+    if (j->bak[0] && sv_exists(j->path)) {
+        unlink(j->bak);
+        // a link, or a copy, leaves the old one where it is until the rename
+        if (link(j->path, j->bak) && 0 == sv_copy(j->path, j->bak))
+            return 0;
+    }
+    if (rename(j->tmp, j->path))
+        return 0;
+    // the directory has the rename
+    p = strrchr(strcpy(d, j->path), '/');
+    if (NULL == p) strcpy(d, ".");
+    else p[p == d] = 0;
+    if ((fd = open(d, O_RDONLY)) >= 0)
+        fsync(fd), close(fd);
+    return 1;
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+// Spaces to TABs at the start of lines, if so, and LF to CR LF, as
+// the text is written, as savefile() did.
+
+ST int sv_text(struct sjob *j) {
+    const unsigned char *p = NULL;
+    const char *r;
+    unsigned char d,e,f,g,l,w,*q,*o;
+    int a,b,c,k,t,s;
+
+    if (NULL==(o = (unsigned char *)malloc(SBS))) return 0;
+    e=l=g=d=w=a=b=t=s=0;
+    j->exact=1;
+    k=j->tabs;
+    q=o;
+    for (;;) {
+        if (d) goto p4;
+        if (b==0) {
+            if (a==j->len)
+                break;
+            p=snap_chunk(j->snap, a, &b);
+            a+=b;
+        }
+        if (g && 0==s) {
+            // inside a line, up to the next TAB or LF as it is
+            r=ch_find((const char*)p, (const char*)p+b, TABC, 10);
+            c=imin(r ? r-(const char*)p : b, o+SBS-q);
+            if (c) {
+                if (memchr(p, 13, c)) j->exact=0;
+                memcpy(q, p, c);
+                p+=c, b-=c, t+=c, q+=c;
+                goto p6;
+            }
+        }
+        d=*p++; t++; b--;
+        // w has 1 for TABCs, 2 for spaces in the blanks so far, what
+        // loads back as other than it was makes it not exact
+        if (d==TABC || (d==32 && g==0)) {
+            s++;
+            w|=d==TABC ? 1 : 2;
+            d = 0;
+            if (k<2 || t%k)
+                continue;
+            d = 9;
+            s = 0;
+            if (w&2) j->exact=0;
+            w = 0;
+            goto p5;
+        }
+        if (d==13) j->exact=0;
+
+        g=1;
+p4:
+        if (s) {
+            if (w&1) j->exact=0;
+            w = 0;
+            f=32; s--;
+            goto p3;
+        }
+        if (d==10) {
+            if (l==0 && j->eol==0) {
+                f=13; l=1; goto p3;
+            }
+            t=g=l=0;
+        }
+p5:
+        f=d; d=0;
+p3:
+        *q++=f;
+p6:
+        if (q==o+SBS) {
+            if (0==sv_put(j, o, SBS)) goto end;
+            q=o;
+        }
+    }
+    if (s) j->exact=0;
+    e=sv_put(j, o, q-o);
+end:
+    free(o);
+    return e;
+}
+
+ST void sv_run(struct sjob *j) {
+    j->err = SV_WRITE;
+    if (sv_open(j)) {
+        if (sv_close(j, sv_text(j)))
+            j->err = sv_rename(j) ? 0 : SV_RENAME;
+        // the new one goes, unless it is all there is
+        if (j->err && j->tmp[0] && sv_exists(j->name))
+            remove(j->tmp);
+    }
+    j->done = 1;
+#ifdef _WIN32
+    if (j->hwnd)
+        PostMessage(j->hwnd, WM_COMMAND, CMD_SAVED, 0);
+#endif
+}
+
+#ifdef _WIN32
+ST unsigned __stdcall sv_thread(void *arg)
+#else
+ST void *sv_thread(void *arg)
+#endif
+{
+    sv_run((struct sjob *)arg);
+    return 0;
+}
+
+/*----------------------------------------------------------------------------*/
+// Puts where the new file goes to 'path', a symlink followed, and
+// returns 1 when it is written in place, 0 when it is renamed there.
+// Windows saves are renamed always.
+
+int save_target(const char *name, char *path) {
+    strcpy(path, name);
+#ifdef _WIN32
+    return 0;
+#else
+    struct stat st;
+    char *p;
+    if (lstat(name, &st))
+        return 0;
+    if (S_ISLNK(st.st_mode)) {
+        p = realpath(name, NULL);
+        if (NULL == p || strlen(p) >= MAX_PATH) {
+            free(p);
+            return 1;
+        }
+        strcpy(path, p), free(p);
+        if (stat(path, &st))
+            return 1;
+    }
+    return !S_ISREG(st.st_mode) || st.st_nlink > 1
+        || (0 != geteuid() && st.st_uid != geteuid());
+#endif
+}
+
+/*----------------------------------------------------------------------------*/
+// Starts to save the current buffer to 'name', with the old file as
+// 'bak' if that is not empty. k is the TAB width to write TABs with,
+// eol as unix_eol. hwnd gets CMD_SAVED when it is done.
+
+struct sjob *save_start(const char *name, const char *bak, int k, int eol, HWND hwnd) {
+    struct sjob *j = c_new(struct sjob);
+
+    strcpy(j->name, name);
+    strcpy(j->bak, bak);
+#ifdef _WIN32
+    sprintf(j->tmp, "%s.save~", name);
+#else
+    j->inplace = save_target(name, j->path);
+    if (0 == j->inplace)
+        sprintf(j->tmp, "%s.save~", j->path);
+#endif
+    j->tabs = k;
+    j->eol = eol;
+    j->hwnd = hwnd;
+    j->snap = text_snap();
+    j->len = flen;
+
+    // it is done here, if the thread does not start
+#ifdef _WIN32
+    j->t = (HANDLE)_beginthreadex(NULL, 0, sv_thread, j, 0, NULL);
+    if (NULL == j->t)
+        sv_run(j);
+#else
+    j->ok = 0 == pthread_create(&j->t, NULL, sv_thread, j);
+    if (0 == j->ok)
+        sv_run(j);
+#endif
+    return j;
+}
+
+int save_done(struct sjob *j) {
+    return j->done;
+}
+
+char *save_name(struct sjob *j) {
+    return j->name;
+}
+
+ST void sv_wait(struct sjob *j) {
+#ifdef _WIN32
+    if (j->t)
+        WaitForSingleObject(j->t, INFINITE), CloseHandle(j->t), j->t = NULL;
+#else
+    if (j->ok)
+        pthread_join(j->t, NULL), j->ok = 0;
+#endif
+}
+
+// waits for the save, and returns 1 when the file is saved and loads
+// back to the very text that was saved, so that it can be mapped as is
+int save_exact(struct sjob *j) {
+    sv_wait(j);
+    return 0 == j->err && j->exact;
+}
+
+// waits for the save, frees it and returns 0 when the file is saved,
+// else SV_WRITE or SV_RENAME
+int save_end(struct sjob *j) {
+    int e;
+    sv_wait(j);
+    e = j->err;
+    snap_free(j->snap);
+    m_free(j);
+    return e;
+}
+
+/*----------------------------------------------------------------------------*/
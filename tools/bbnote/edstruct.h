@@ -31,15 +31,58 @@
 #pragma warning(disable: 4244) // convert int to short
 #endif
 
+/*----------------------------------------------------------------------------*/
+// the undo log, edundo.cpp
+
+#define UD_INS 1
+#define UD_DEL 2
+#define UD_POS 3
+#define UD_CHG 4
+
+typedef struct undo_s {
+    int p;
+    int l;
+    int n;
+    char cmd;
+    char buf[1];
+} sud;
+
+struct ulog {
+    struct uchunk *top, *bot;
+    int size;               // of the chunks
+    int n;                  // records put so far, to see a change
+    int g;                  // groups in it
+};
+
+extern struct ulog *u_pp;
+extern int undo_mb;
+
+sud *u_add(int cmd, int p, int l, int b);
+sud *u_top(struct ulog *u);
+void u_pop(struct ulog *u);
+void u_free(struct ulog *u);
+void u_check(int a, int b);
+void u_close(int a, int b, int n);
+void u_ins(int p, int l);
+void u_del(int p, int l);
+
 /*----------------------------------------------------------------------------*/
 
 struct edvars {
     struct edvars *next;
 
-    struct bufpage *sprev_pg;
-    struct bufpage *snext_pg;
+    struct piece *spc_root;
+    struct textblk *stx_blk;
 
-    int  sbuf_a,sbuf_e;
+    int  scch_a,scch_e;
+    char *scch_p;
+
+    char *smap_p;
+    int  smap_n;
+
+    unsigned char *slex_p;          // lexer state at each line start
+    int  slex_n, slex_size, slex_v;
+    void *slex_lang;
 
     int sflen;
     int sfpga, slpos, sfpos;
@@ -47,7 +90,7 @@ struct edvars {
 
     int scurx,scury,sclft,slmax;
 
-    struct undo_s *sundo_l,*sredo_l;
+    struct ulog sundo_l,sredo_l;
 
     int  *sma,      *sme;
     int  *smxa,     *smxe;
@@ -62,10 +105,9 @@ struct edvars {
     char sflg;
 
     FILETIME sfiletime;
+    struct sjob *ssave_j;           // the save going on, edsave.cpp
     char sfnameflg;
     char sfilename[128];
-
-    char sbuffer[1];
 };
 
 #define changed()  (chg!=0)
@@ -73,16 +115,17 @@ struct edvars {
 
 extern struct edvars *ed0,*edp,*new_buffer(void);
 
-#define buffer  (edp->sbuffer)
-#define next_pg (edp->snext_pg)
-#define prev_pg (edp->sprev_pg)
-#define buf_a   (edp->sbuf_a)
-#define buf_e   (edp->sbuf_e)
-
 #define fpga    (edp->sfpga)
 #define lpos    (edp->slpos)
 #define fpos    (edp->sfpos)
 #define flen    (edp->sflen)
+#define map_p   (edp->smap_p)
+#define map_n   (edp->smap_n)
+#define lex_p   (edp->slex_p)
+#define lex_n   (edp->slex_n)
+#define lex_size (edp->slex_size)
+#define lex_v   (edp->slex_v)
+#define lex_lang (edp->slex_lang)
 
 #define plin    (edp->splin)
 #define tlin    (edp->stlin)
@@ -111,15 +154,38 @@ extern struct edvars *ed0,*edp,*new_buffer(void);
 #define fileflg  (edp->sflg)
 
 #define filetime (edp->sfiletime)
+#define save_j   (edp->ssave_j)
 #define fnameflg (edp->sfnameflg)
 #define filename (edp->sfilename)
 
 void clear_buffer(void);
+void clear_text(void);
+int  load_text(const char *p, int n);
+char *unmap_text(void);
+void swap_text(struct edvars *v);
 void insdelmem(int at, int len);
 void copyfrom(char*,int,int);
 void copyto(int,const char*,int);
 void clearchr(int,char,int);
 unsigned char getchr(int o);
+const unsigned char *getchunk(void *arg, int o, int *n);
+const unsigned char *getchunk_b(int o, int *n);
+int  ch_count(const char *p, int n, int c);
+const char *ch_find(const char *p, const char *e, int a, int b);
+const char *ch_rfind(const char *p, const char *e, int a, int b);
+const char *ch_ctl(const char *p, const char *e);
+struct tsnap *text_snap(void);
+void snap_free(struct tsnap *s);
+const unsigned char *snap_chunk(void *arg, int o, int *n);
+
+#define SV_WRITE  1
+#define SV_RENAME 2
+int  save_target(const char *name, char *path);
+struct sjob *save_start(const char *name, const char *bak, int k, int eol, HWND hwnd);
+int  save_done(struct sjob *j);
+char *save_name(struct sjob *j);
+int  save_exact(struct sjob *j);
+int  save_end(struct sjob *j);
 
 void u_reset(void);
 void u_setchg(int);
@@ -138,13 +204,18 @@ void insfile(struct edvars*);
 void NewFile(void);
 void CloseFile(void);
 int LoadFile(char *);
+int SaveFile(char *, HWND, int);
 int DoFileOpenSave(HWND hwnd, int mode);
 int QueryDiscard(HWND, int f);
 int QueryDiscard_1(HWND, int f);
 int loadfile(void);
 //int savefile(char *);
+int  save_over(void);
+void save_check(void);
 
 void InfoMsg(const char*);
+extern char infomsg[];
+void ed_host(int x, int y);     // edhost.cpp, without a window
 void make_dialog(const char*);
 extern char make_f,fsearch;
 extern char owscroll;
@@ -209,6 +280,15 @@ void ed_cmd(int cmd,...);
 
 struct sea { int from; char *str; int sf; int a; int e; };
 int  ed_search(struct sea *);
+int  r_getchr(int o);
+int  ed_nsearch(struct sea *);
+int  ed_rplfiles(struct sea *, char *);
+
+struct hits { struct hits *next; struct edvars *ev; int n, size; int *m; };
+int  find_all(const char *str, int sf, int max, struct hits **ph);
+void free_hits(struct hits *);
+char *rpl_run(struct hits *h, int *pi, int *pa, int *pe, int *pl, char **q, const char *r);
+extern int find_threads;
 
 int  movpage(int);
 void domarking(int);
@@ -229,6 +309,7 @@ int  detab(char*,char*,int,int);
 #define EK_RETAB    1010
 #define EK_DRAG_COPY   1011
 #define EK_DRAG_MOVE   1012
+#define EK_RPLALL   1013
 
 #define TABC 0x09
 
@@ -330,6 +411,11 @@ extern int My_CaretSize;
 int rcomp (unsigned char *in, unsigned char *out, int omax, int cf);
 struct rmres { int p; int w; };
 int rmatch(int s, int a, int e, unsigned char *m, struct rmres *m_ptr, int (*get)(int));
+typedef const unsigned char *(*rchunk)(void *arg, int o, int *n);
+struct rdfa *rdfa_new(unsigned char *code, int tabc);
+void rdfa_free(struct rdfa *d);
+int rdfa_match(struct rdfa *d, int s, int e, rchunk getchunk, void *arg);
+int rdfa_find(struct rdfa *d, int s, int e, int *pm, rchunk getchunk, void *arg);
 
 #define OW_CLEAR 1001
 #define OW_PRINT 1002
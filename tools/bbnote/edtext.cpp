@@ -0,0 +1,857 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDTEXT.C - the text store: a balanced tree of pieces
+
+#include "edstruct.h"
+
+/*
+    The text of a buffer is a sequence of pieces, each of which points
+    to a run of bytes in a text block. The pieces are the nodes of an
+    AVL tree in text order, and every node knows the length of its
+    subtree, so that finding an offset and inserting or deleting there
+    takes O(log n) in the number of pieces, wherever in the file it is.
+
+    Text blocks are only ever appended to. Inserted text goes to the
+    end of the newest block, and when that continues the piece that
+    was inserted last (as when typing), the piece just gets longer.
+    Deleted text stays in its block until the buffer is cleared.
+
+    getchr() keeps the piece where it was last looking, so that walking
+    the text byte by byte does not search the tree for every byte.
+
+    A big file can also be mapped into memory and given to load_text(),
+    then its pieces point right into the mapping. Where there are TABs
+    to expand or CRs to drop, the piece only knows how long it will be
+    and how many lines it has, and gets expanded into a text block when
+    it is first looked at. Pieces from the mapping are copied to a text
+    block as well before they are written to.
+
+    Every node also counts the linefeeds in its piece and its subtree,
+    so the line of an offset and the offset of a line are found in the
+    tree too. New text reads as zeros until copyto() fills it, which
+    then fixes the counts on its way.
+*/
+
+#define TBS     65536   // text block size
+
+struct textblk {
+    struct textblk *next;
+    int size, used;
+    char cont[1];
+};
+
+struct piece {
+    struct piece *left, *right;
+    char *p;    // the text
+    int len;    // its length
+    int sum;    // length of the subtree
+    int lf;     // linefeeds in the piece
+    int lfs;    // linefeeds in the subtree
+    int h;      // height of the subtree
+    int raw;    // its length in the mapping, while not yet expanded
+};
+
+#define pc_root (edp->spc_root)
+#define tx_blk  (edp->stx_blk)
+#define cch_a   (edp->scch_a)
+#define cch_e   (edp->scch_e)
+#define cch_p   (edp->scch_p)
+
+#define uncache() (cch_a=cch_e=0)
+
+/*----------------------------------------------------------------------------*/
+// byte scanning
+
+// The loops that look at the text go through it a piece at a time
+// (getchunk(), getchunk_b()) and use these on each, 16 bytes at a time
+// with SSE2, else byte by byte.
+
+#if defined __SSE2__ || defined _M_X64 || (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#include <emmintrin.h>
+#define SC_SSE2
+#endif
+
+#ifdef SC_SSE2
+
+#define SC_LOAD(p) _mm_loadu_si128((const __m128i*)(p))
+#define SC_EQ(x, v) _mm_cmpeq_epi8(x, v)
+
+ST int sc_first(unsigned m) {
+#ifdef __GNUC__
+    return __builtin_ctz(m);
+#else
+    int i;
+    for (i = 0; 0 == (m & 1); m >>= 1, i++);
+    return i;
+#endif
+}
+
+ST int sc_last(unsigned m) {
+#ifdef __GNUC__
+    return 31 - __builtin_clz(m);
+#else
+    int i;
+    for (i = 15; 0 == (m & 0x8000); m <<= 1, i--);
+    return i;
+#endif
+}
+
+#endif
+
+// how many c in p[0..n)
+int ch_count(const char *p, int n, int c) {
+    const char *e = p + n;
+    int r = 0;
+#ifdef SC_SSE2
+    __m128i v = _mm_set1_epi8((char)c), z = _mm_setzero_si128(), s, u;
+    int k;
+    while (e - p >= 64) {
+        // each byte of s and u counts to 255 at most
+        k = imin((e - p) >> 6, 127);
+        for (s = u = z; k; k--, p += 64) {
+            s = _mm_sub_epi8(s, SC_EQ(SC_LOAD(p), v));
+            u = _mm_sub_epi8(u, SC_EQ(SC_LOAD(p + 16), v));
+            s = _mm_sub_epi8(s, SC_EQ(SC_LOAD(p + 32), v));
+            u = _mm_sub_epi8(u, SC_EQ(SC_LOAD(p + 48), v));
+        }
+        s = _mm_add_epi64(_mm_sad_epu8(s, z), _mm_sad_epu8(u, z));
+        r += _mm_cvtsi128_si32(s) + _mm_cvtsi128_si32(_mm_srli_si128(s, 8));
+    }
+    for (; p < e; p++)
+        r += *p == (char)c;
+#else
+    while (NULL != (p = (const char *)memchr(p, c, e - p)))
+        p++, r++;
+#endif
+    return r;
+}
+
+// the first a or b from p to e, NULL if none
+const char *ch_find(const char *p, const char *e, int a, int b) {
+#ifdef SC_SSE2
+    __m128i va = _mm_set1_epi8((char)a), vb = _mm_set1_epi8((char)b), x;
+    unsigned m;
+    for (; e - p >= 16; p += 16) {
+        x = SC_LOAD(p);
+        if (0 != (m = _mm_movemask_epi8(_mm_or_si128(SC_EQ(x, va), SC_EQ(x, vb)))))
+            return p + sc_first(m);
+    }
+#endif
+    for (; p < e; p++)
+        if (*p == (char)a || *p == (char)b)
+            return p;
+    return NULL;
+}
+
+// the last a or b from p to e, NULL if none
+const char *ch_rfind(const char *p, const char *e, int a, int b) {
+#ifdef SC_SSE2
+    __m128i va = _mm_set1_epi8((char)a), vb = _mm_set1_epi8((char)b), x;
+    unsigned m;
+    for (; e - p >= 16; e -= 16) {
+        x = SC_LOAD(e - 16);
+        if (0 != (m = _mm_movemask_epi8(_mm_or_si128(SC_EQ(x, va), SC_EQ(x, vb)))))
+            return e - 16 + sc_last(m);
+    }
+#endif
+    while (e > p)
+        if (*--e == (char)a || *e == (char)b)
+            return e;
+    return NULL;
+}
+
+// the first control char (below 32) from p to e, else e
+const char *ch_ctl(const char *p, const char *e) {
+#ifdef SC_SSE2
+    __m128i v = _mm_set1_epi8(31), x;
+    unsigned m;
+    for (; e - p >= 16; p += 16) {
+        x = SC_LOAD(p);
+        if (0 != (m = _mm_movemask_epi8(SC_EQ(_mm_min_epu8(x, v), x))))
+            return p + sc_first(m);
+    }
+#endif
+    for (; p < e; p++)
+        if ((unsigned char)*p < 32)
+            break;
+    return p;
+}
+
+/*----------------------------------------------------------------------------*/
+// tree helpers
+
+ST int pc_h(struct piece *t) {
+    return t ? t->h : 0;
+}
+
+ST int pc_sum(struct piece *t) {
+    return t ? t->sum : 0;
+}
+
+ST int pc_lfs(struct piece *t) {
+    return t ? t->lfs : 0;
+}
+
+ST struct piece *pc_fix(struct piece *t) {
+    t->h   = 1 + imax(pc_h(t->left), pc_h(t->right));
+    t->sum = t->len + pc_sum(t->left) + pc_sum(t->right);
+    t->lfs = t->lf + pc_lfs(t->left) + pc_lfs(t->right);
+    return t;
+}
+
+ST struct piece *pc_rotr(struct piece *t) {
+    struct piece *l = t->left;
+    t->left = l->right;
+    l->right = pc_fix(t);
+    return pc_fix(l);
+}
+
+ST struct piece *pc_rotl(struct piece *t) {
+    struct piece *r = t->right;
+    t->right = r->left;
+    r->left = pc_fix(t);
+    return pc_fix(r);
+}
+
+ST struct piece *pc_bal(struct piece *t) {
+    int d = pc_h(t->left) - pc_h(t->right);
+    if (d > 1) {
+        if (pc_h(t->left->left) < pc_h(t->left->right))
+            t->left = pc_rotl(t->left);
+        return pc_rotr(t);
+    }
+    if (d < -1) {
+        if (pc_h(t->right->right) < pc_h(t->right->left))
+            t->right = pc_rotr(t->right);
+        return pc_rotl(t);
+    }
+    return pc_fix(t);
+}
+
+// insert n such that it starts at offset o, which must be a piece boundary
+ST struct piece *pc_ins(struct piece *t, int o, struct piece *n) {
+    int l;
+    if (NULL==t)
+        return pc_fix(n);
+    l = pc_sum(t->left);
+    if (o <= l)
+        t->left = pc_ins(t->left, o, n);
+    else
+        t->right = pc_ins(t->right, o-l-t->len, n);
+    return pc_bal(t);
+}
+
+// unlink the first piece of t into *m
+ST struct piece *pc_unmin(struct piece *t, struct piece **m) {
+    if (NULL==t->left) {
+        *m = t;
+        return t->right;
+    }
+    t->left = pc_unmin(t->left, m);
+    return pc_bal(t);
+}
+
+// delete the piece that starts at offset o
+ST struct piece *pc_del(struct piece *t, int o) {
+    struct piece *m, *r;
+    int l = pc_sum(t->left);
+    if (o < l)
+        t->left = pc_del(t->left, o);
+    else
+    if (o > l)
+        t->right = pc_del(t->right, o-l-t->len);
+    else {
+        r = t->right, m = t->left;
+        if (NULL!=r) {
+            r = pc_unmin(r, &m);
+            m->left = t->left;
+            m->right = r;
+        }
+        m_free(t);
+        return m ? pc_bal(m) : m;
+    }
+    return pc_bal(t);
+}
+
+// resize the piece that contains offset o by d and add f to its linefeeds
+ST void pc_size(struct piece *t, int o, int d, int f) {
+    int l;
+    for (;;) {
+        t->sum += d;
+        t->lfs += f;
+        l = pc_sum(t->left);
+        if (o < l) {
+            t = t->left;
+        } else if (o >= l + t->len) {
+            o -= l + t->len;
+            t = t->right;
+        } else {
+            t->len += d;
+            t->lf += f;
+            return;
+        }
+    }
+}
+
+// the piece that contains offset o, and its start
+ST struct piece *pc_find(int o, int *a) {
+    struct piece *t = pc_root;
+    int b = 0, l;
+    while (t) {
+        l = pc_sum(t->left);
+        if (o < b + l) {
+            t = t->left;
+        } else if (o >= b + l + t->len) {
+            b += l + t->len;
+            t = t->right;
+        } else {
+            *a = b + l;
+            break;
+        }
+    }
+    return t;
+}
+
+#define lf_count(p, n) ch_count(p, n, 10)
+
+ST struct piece *pc_new(char *p, int len, int lf) {
+    struct piece *n = c_new(struct piece);
+    n->p = p;
+    n->len = len;
+    n->lf = lf;
+    return n;
+}
+
+ST void pc_free(struct piece *t) {
+    if (NULL==t) return;
+    pc_free(t->left);
+    pc_free(t->right);
+    m_free(t);
+}
+
+/*----------------------------------------------------------------------------*/
+// room for n bytes of new text at the end of the newest block
+
+ST char *tx_alloc(int n) {
+    struct textblk *b = tx_blk;
+    char *p;
+    if (NULL==b || b->size - b->used < n) {
+        int s = imax(n, TBS);
+        b = (struct textblk *)m_alloc(sizeof(struct textblk) - 1 + s);
+        b->size = s;
+        b->used = 0;
+        if (n >= TBS && tx_blk) {
+            // a big one, keep the current block for what comes next
+            b->next = tx_blk->next;
+            tx_blk->next = b;
+        } else {
+            b->next = tx_blk;
+            tx_blk = b;
+        }
+    }
+    p = b->cont + b->used;
+    b->used += n;
+    memset(p, 0, n);
+    return p;
+}
+
+// expand TABs and drop CRs as loadfile() does, b is the column
+ST int tx_expand(char *d, const char *p, int n, int *pb) {
+    int b = *pb, r = 0, k;
+    char c;
+    while (n) {
+        // up to the next TAB, LF or CR as it is
+        if (0 != (k = ch_ctl(p, p + n) - p)) {
+            memcpy(d + r, p, k);
+            p += k, n -= k, r += k, b += k;
+            continue;
+        }
+        c=*p++, n--, b++;
+        switch (c) {
+        case 10: b=0; break;
+        case  9: c=(char)TABC; if (b%tabs) p--,n++; break;
+        case 13: b--; continue;
+        }
+        d[r++]=c;
+    }
+    *pb = b;
+    return r;
+}
+
+// how long that will be, looking at the TABs only
+ST int tx_measure(const char *p, int n, int *pb) {
+    const char *e = p + n, *t, *q;
+    int b = *pb, r = n - ch_count(p, n, 13), k;
+    for (;;) {
+        t = (const char *)memchr(p, 9, e - p);
+        if (NULL==t) t = e;
+        q = ch_rfind(p, t, 10, 10);
+        q = q ? q + 1 : p;
+        b = (q > p ? 0 : b) + (t - q) - ch_count(q, t - q, 13);
+        if (t == e) break;
+        k = tabs - b % tabs;
+        r += k - 1, b += k;
+        p = t + 1;
+    }
+    *pb = b;
+    return r;
+}
+
+// the text of a piece, expanded from the mapping when first needed
+ST char *pc_text(struct piece *t) {
+    char *p;
+    int b = 0;
+    if (t->raw) {
+        p = tx_alloc(t->len);
+        tx_expand(p, t->p, t->raw, &b);
+        t->p = p, t->raw = 0;
+    }
+    return t->p;
+}
+
+// can the piece that ends at offset o grow by n more bytes in place?
+ST struct piece *tx_tail(int o, int n) {
+    struct piece *t;
+    struct textblk *b = tx_blk;
+    int a;
+    if (0==o || NULL==b || b->size - b->used < n)
+        return NULL;
+    t = pc_find(o-1, &a);
+    if (t && a + t->len == o && t->p + t->len == b->cont + b->used)
+        return t;
+    return NULL;
+}
+
+// split the piece that contains offset o, so that a piece starts at o
+ST void tx_split(int o) {
+    struct piece *t;
+    int a, k, l, f;
+    if (o >= flen || NULL==(t=pc_find(o, &a)) || a==o)
+        return;
+    k = o - a, l = t->len;
+    f = lf_count(pc_text(t) + k, l - k);
+    pc_size(pc_root, o, k - l, -f);
+    pc_root = pc_ins(pc_root, o, pc_new(t->p + k, l - k, f));
+}
+
+/*----------------------------------------------------------------------------*/
+// insert (len>0) or delete (len<0) at offset o
+
+ST void tx_insert(int o, int n) {
+    struct piece *t = tx_tail(o, n);
+    if (t) {
+        tx_alloc(n);
+        pc_size(pc_root, o-1, n, 0);
+        return;
+    }
+    tx_split(o);
+    pc_root = pc_ins(pc_root, o, pc_new(tx_alloc(n), n, 0));
+}
+
+ST void tx_delete(int o, int n) {
+    struct piece *t;
+    int a;
+    tx_split(o);
+    tx_split(o + n);
+    while (n > 0) {
+        t = pc_find(o, &a);
+        n -= t->len;
+        pc_root = pc_del(pc_root, o);
+    }
+}
+
+void insdelmem (int o, int len) {
+    uncache();
+    if (o < lex_v)
+        lex_v = o;
+    if (len > 0)
+        tx_insert(o, len);
+    else
+    if (len < 0)
+        tx_delete(o, -len);
+    flen += len;
+}
+
+/*----------------------------------------------------------------------------*/
+// load from memory that stays there, normally a mapped file
+
+#define MPS     TBS     // longest piece in the mapping
+
+ST int is_mapped(const char *p) {
+    return map_n && p >= map_p && p < map_p + map_n;
+}
+
+ST void tx_append(const char *p, int n, int f, int raw) {
+    struct piece *t = pc_new((char *)p, n, f);
+    t->raw = raw;
+    pc_root = pc_ins(pc_root, flen, t);
+    flen += n;
+}
+
+int load_text(const char *p, int n) {
+    const char *e = p + n, *q;
+    char *d;
+    int b = 0, c, k, f, r, tl = 0;
+
+    map_p = (char *)p, map_n = n;
+    for (; p < e; p += k) {
+        // prefer to end a piece with a line
+        k = imin(MPS, e - p);
+        for (q = p + k; q > p && q[-1] != 10; q--);
+        if (q > p) k = q - p;
+        tl += f = lf_count(p, k);
+        r = ch_count(p, k, 13);
+        if (NULL==memchr(p, 9, k)) {
+            // as it is, or expanded later without CRs
+            tx_append(p, k - r, f, r ? k : 0);
+            b = q > p ? 0 : b + k - r;
+        } else if (0==b) {
+            // expanded later from the start of a line
+            tx_append(p, tx_measure(p, k, &b), f, k);
+        } else {
+            // a very long line with TABs, expand now
+            c = b;
+            d = tx_alloc(tx_measure(p, k, &c));
+            tx_append(d, tx_expand(d, p, k, &b), f, 0);
+        }
+    }
+    uncache();
+    return tl;
+}
+
+// copy a piece from the mapping to a text block
+ST void tx_own(struct piece *t) {
+    char *p;
+    if (is_mapped(pc_text(t))) {
+        p = tx_alloc(t->len);
+        memcpy(p, t->p, t->len);
+        t->p = p;
+    }
+}
+
+// ... all of them, to let the mapping go
+ST void tx_unmap(struct piece *t) {
+    if (NULL==t) return;
+    tx_unmap(t->left);
+    tx_own(t);
+    tx_unmap(t->right);
+}
+
+char *unmap_text(void) {
+    char *p = map_p;
+    tx_unmap(pc_root);
+    map_p = NULL, map_n = 0;
+    uncache();
+    return p;
+}
+
+// trade the text, and the mapping it reads from, with buffer v
+void swap_text(struct edvars *v) {
+    struct edvars t = *edp;
+    pc_root = v->spc_root, v->spc_root = t.spc_root;
+    tx_blk = v->stx_blk, v->stx_blk = t.stx_blk;
+    map_p = v->smap_p, v->smap_p = t.smap_p;
+    map_n = v->smap_n, v->smap_n = t.smap_n;
+    uncache(), v->scch_a = v->scch_e = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+void clear_text(void) {
+    struct textblk *b, *n;
+    for (b = tx_blk; b; b = n)
+        n = b->next, m_free(b);
+    pc_free(pc_root);
+    pc_root = NULL;
+    tx_blk = NULL;
+    map_p = NULL, map_n = 0;
+    flen = 0;
+    uncache();
+    m_free(lex_p);
+    lex_p = NULL, lex_n = lex_size = 0;
+}
+
+/*----------------------------------------------------------------------------*/
+// buffer access
+
+// the text at offset o and how many bytes of it are contiguous
+ST char *getmem(int o, int *n) {
+    struct piece *t;
+    int a;
+    t = pc_find(o, &a);
+    cch_a = a;
+    cch_e = a + t->len;
+    cch_p = pc_text(t);
+    *n = cch_e - o;
+    return cch_p + (o - a);
+}
+
+// the same to write to, the mapping is read-only
+ST char *getmem_w(int o, int *n) {
+    int a;
+    tx_own(pc_find(o, &a));
+    return getmem(o, n);
+}
+
+unsigned char getchr(int o) {
+    int n;
+    if (o<cch_a || o>=cch_e) {
+        if (o<0 || o>=flen) return 0;
+        return *getmem(o, &n);
+    }
+    return *(cch_p+(o-cch_a));
+}
+
+// read-only text at o and how much of it there is in one piece, for
+// the regex search (arg is not used, it is the current buffer)
+const unsigned char *getchunk(void *arg, int o, int *n) {
+    if (o<cch_a || o>=cch_e)
+        return (const unsigned char*)getmem(o, n);
+    *n = cch_e - o;
+    return (const unsigned char*)cch_p + (o - cch_a);
+}
+
+// the same backwards: the text before o ends at the pointer, and *n
+// bytes of it are there in one piece, o must be > 0
+const unsigned char *getchunk_b(int o, int *n) {
+    if (o<=cch_a || o>cch_e)
+        getmem(o-1, n);
+    *n = o - cch_a;
+    return (const unsigned char*)cch_p + (o - cch_a);
+}
+
+// the linefeeds in a piece change as it is written to
+ST void lf_fix(int o, int f) {
+    if (f) pc_size(pc_root, o, 0, f);
+}
+
+void copyto(int dst, const char *src, int l) {
+    int b; char *p;
+    for (;l;) {
+        p=getmem_w(dst, &b);
+        b=imin(l,b);
+        lf_fix(dst, lf_count(src,b) - lf_count(p,b));
+        memmove(p,src,b);
+        l-=b; src+=b; dst+=b;
+    }
+    upd=1;
+}
+
+void copyfrom(char *dst, int src, int l) {
+    int b; char *p;
+    for (;l;) {
+        p=getmem(src, &b);
+        b=imin(l,b);
+        memmove(dst,p,b);
+        l-=b; src+=b; dst+=b;
+    }
+}
+
+void clearchr(int dst, char c, int l) {
+    int b; char *p;
+    for (;l;) {
+        p=getmem_w(dst, &b);
+        b=imin(l,b);
+        lf_fix(dst, (c==10 ? b : 0) - lf_count(p,b));
+        memset(p,c,b);
+        l-=b; dst+=b;
+    }
+    upd=1;
+}
+
+/*----------------------------------------------------------------------------*/
+// snapshots
+
+// The text of the current buffer as a list of its pieces, to be read
+// by other threads. Raw pieces are cooked here, since that writes to
+// the tree. Text in a block is not written to again, so a snapshot
+// stays as it was while the buffer is edited, until it is cleared or
+// its mapping goes.
+
+struct tsnap {
+    int n, hint;
+    int *a;             // where the pieces start, a[n] is the length
+    const char **p;
+};
+
+ST void pc_walk(struct tsnap *s, struct piece *t, int *o) {
+    for (; t; t = t->right) {
+        pc_walk(s, t->left, o);
+        if (s->p)
+            s->a[s->n] = *o, s->p[s->n] = pc_text(t);
+        s->n++, *o += t->len;
+    }
+}
+
+struct tsnap *text_snap(void) {
+    struct tsnap *s = c_new(struct tsnap);
+    int o = 0;
+    pc_walk(s, pc_root, &o);
+    s->a = (int*)m_alloc((s->n+1) * sizeof *s->a);
+    s->p = (const char**)m_alloc((s->n+1) * sizeof *s->p);
+    s->n = o = 0;
+    pc_walk(s, pc_root, &o);
+    s->a[s->n] = o;
+    return s;
+}
+
+void snap_free(struct tsnap *s) {
+    if (NULL == s) return;
+    m_free(s->a);
+    m_free(s->p);
+    m_free(s);
+}
+
+// like getchunk(), with the snapshot as arg
+const unsigned char *snap_chunk(void *arg, int o, int *n) {
+    struct tsnap *s = (struct tsnap *)arg;
+    int i = s->hint, l, r;
+    if (o < s->a[i] || o >= s->a[i+1]) {
+        for (l = 0, r = s->n; r - l > 1; )
+            if (s->a[i = (l + r) / 2] <= o) l = i; else r = i;
+        s->hint = i = l;
+    }
+    *n = s->a[i+1] - o;
+    return (const unsigned char *)s->p[i] + (o - s->a[i]);
+}
+
+/*----------------------------------------------------------------------------*/
+// lines
+
+#define LFNEAR  4096    // look that far byte by byte before asking the tree
+
+// the linefeeds in front of offset o
+ST int lf_before(int o) {
+    struct piece *t = pc_root;
+    int r = 0, l;
+    while (t) {
+        l = pc_sum(t->left);
+        if (o < l) {
+            t = t->left;
+            continue;
+        }
+        o -= l, r += pc_lfs(t->left);
+        if (o < t->len) {
+            if (o < t->len/2)
+                return r + lf_count(pc_text(t), o);
+            return r + t->lf - lf_count(pc_text(t) + o, t->len - o);
+        }
+        o -= t->len, r += t->lf;
+        t = t->right;
+    }
+    return r;
+}
+
+// the offset behind the k-th linefeed
+ST int lf_pos(int k) {
+    struct piece *t = pc_root;
+    int b = 0, l;
+    const char *p;
+    while (t && k > 0) {
+        l = pc_lfs(t->left);
+        if (k <= l) {
+            t = t->left;
+            continue;
+        }
+        k -= l, b += pc_sum(t->left);
+        if (k <= t->lf) {
+            // a mapped file can change under us, don't trust t->lf here
+            for (p = pc_text(t); NULL != (p = (const char *)
+                    memchr(p, 10, t->p + t->len - p)); p++)
+                if (0 == --k)
+                    return b + (p - t->p) + 1;
+            return b + t->len;
+        }
+        k -= t->lf, b += t->len;
+        t = t->right;
+    }
+    return b;
+}
+
+int cntlf(int a, int e) {
+    const char *p;
+    int r=0,n;
+    if (e-a > LFNEAR)
+        return lf_before(e) - lf_before(a);
+    for (e=imin(e,flen);a<e;a+=n) {
+        p=(const char*)getchunk(NULL,a,&n);
+        n=imin(n,e-a);
+        r+=lf_count(p,n);
+    }
+    return r;
+}
+
+int nextline_v(int o, int n, int *v) {
+    const char *p,*q;
+    int w=0,a,m=o+LFNEAR,l,d,k;
+    for (;n--;) {
+        a=o;
+        for (;;) {
+            if (o==flen) { o=a; goto p1; }
+            if (o>=m) goto p2;
+            p=(const char*)getchunk(NULL,o,&k);
+            k=imin(k,m-o);
+            if (NULL!=(q=ch_find(p,p+k,10,10))) {
+                o+=q-p+1;
+                break;
+            }
+            o+=k;
+        }
+        w++;
+    }
+p1:
+    if (v!=NULL) *v=w;
+    return o;
+p2:
+    // far away, there are no linefeeds between a and o
+    l=lf_before(a);
+    d=imin(n+1, pc_lfs(pc_root)-l);
+    w+=d;
+    o=d ? lf_pos(l+d) : a;
+    goto p1;
+}
+
+int prevline_v(int o, int n, int *v) {
+    const char *p,*q;
+    int w=0,m=o-LFNEAR,l,k;
+    for (;;) {
+        for (;;) {
+            if (o==0) goto p1;
+            if (o<=m) goto p2;
+            p=(const char*)getchunk_b(o,&k);
+            k=imin(k,o-m);
+            if (NULL!=(q=ch_rfind(p-k,p,10,10))) {
+                o-=p-q;
+                break;
+            }
+            o-=k;
+        }
+        if (n--==0) { o++; break; }
+        w++;
+    }
+p1:
+    if (v!=NULL) *v=w;
+    return o;
+p2:
+    // far away, o is in the line to go back n lines from
+    l=lf_before(o);
+    if (l<=n) w+=l, o=0;
+    else      w+=n, o=lf_pos(l-n);
+    goto p1;
+}
+
+/*----------------------------------------------------------------------------*/
@@ -0,0 +1,686 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDTRACE.C - replays editor command traces through ed_cmd (posix, headless)
+
+/*
+    usage: edtrace [options] [file...]
+
+    -t <trace>      replay this trace
+    -n <count>      otherwise generate a trace of so many commands,
+                    default 20000
+    -r <seed>       random seed for the generated text and trace
+    -w <trace>      write the generated trace to a file
+    -s <size>       with no file, edit a generated text of that size,
+                    default 16M (k/M/G suffixes work)
+    -g <x>x<y>      the page in chars, default 100x50
+    -o <file>       where save goes, with a generated trace a save also
+                    comes every 5000 commands
+    -R <file>       write the results to a file
+    -B <file>       compare with the results of another build: fails
+                    when the text at the end is not the same, or when
+                    the median or the 90th percentile of a command, or
+                    the peak memory, is more than -l percent over
+    -l <percent>    default 25
+
+    The files are loaded with LoadFile(), each into a buffer, the trace
+    starts in the first one. The commands go to the engine as EditProc()
+    in edproc.cpp has them go there. After each one the page is read
+    with getchr(), as edprint.cpp would paint it, and that time counts
+    to the command too.
+
+    A trace has one command per line:
+
+    key <name> [n]  a key, n times, as KEY_<name> in eddef.h, e.g.
+                    key DOWN 10, key C_V, key S_END (marks, as with
+                    shift)
+    type <text>     the chars as typed, \n is RET, \t is TAB, \s a blank
+    insert <text>   EK_INSERT, as from a tool
+    goto <pos>      EK_GOTO, also N% or $ for the end
+    line <n>        EK_GOTOLINE, also N% of the lines at load time
+    mark <n>        mark n bytes from the cursor, or back with -n
+    find <f> <text> find next, as from the search dialog, f has b for
+                    backwards, c for the case, w for words, r for a
+                    regex, a for all files, or is -
+    replace <f> <text> <by>  replace all, as from the search dialog,
+                    the text without blanks (\s)
+    undo, redo      key C_Z, key CS_Z
+    retab <a> <b>   EK_RETAB, TABs from a to b
+    next, prev      the next, previous buffer
+    open <file>     LoadFile()
+    save [file]     SaveFile() in the background, to the -o file
+    close           CloseFile()
+    # ...           nothing
+
+    At the end it shows for each command how many and how long they
+    took: the median, the 90th and 99th percentile and the longest.
+*/
+
+#include "edstruct.h"
+#include <time.h>
+#include <sys/resource.h>
+
+#define BLS     4096
+
+ST const char *out;
+ST unsigned sink;
+ST int lines;
+
+ST double usec_now(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// VmHWM is the peak of all, RssAnon what is not the mapped files
+ST long status_kb(const char *key) {
+    char line[200];
+    long kb = 0;
+    int n = strlen(key);
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp) {
+        while (fgets(line, sizeof line, fp))
+            if (0 == strncmp(line, key, n) && line[n] == ':')
+                kb = atol(line + n + 1);
+        fclose(fp);
+    }
+    return kb;
+}
+
+ST long peak_kb(void) {
+    struct rusage ru;
+    long kb = status_kb("VmHWM");
+    if (0 == kb && 0 == getrusage(RUSAGE_SELF, &ru))
+        kb = ru.ru_maxrss;
+    return kb;
+}
+
+ST unsigned rnd_s = 1;
+
+ST unsigned rnd(unsigned n) {
+    rnd_s = rnd_s * 1103515245 + 12345;
+    return (rnd_s >> 8) % n;
+}
+
+ST double get_size(const char *s) {
+    char *e;
+    double d = strtod(s, &e);
+    switch (*e) {
+    case 'g': case 'G': d *= 1024;
+    case 'm': case 'M': d *= 1024;
+    case 'k': case 'K': d *= 1024;
+    }
+    return d;
+}
+
+/*----------------------------------------------------------------------------*/
+// the times of each command
+
+struct op {
+    const char *name;
+    int n, size;
+    float *t;               // in us
+};
+
+ST struct op ops[200];
+ST int nops;
+
+ST struct op *get_op(const char *name) {
+    struct op *o;
+    for (o = ops; o < ops + nops; o++)
+        if (0 == strcmp(o->name, name))
+            return o;
+    if (nops == sizeof ops / sizeof *ops)
+        return NULL;
+    o->name = name;
+    nops++;
+    return o;
+}
+
+ST void add_time(struct op *o, double t) {
+    if (o->n == o->size)
+        o->t = (float*)realloc(o->t, (o->size = imax(256, 2 * o->size)) * sizeof *o->t);
+    o->t[o->n++] = (float)t;
+}
+
+ST int cmp_float(const void *a, const void *b) {
+    float x = *(const float*)a, y = *(const float*)b;
+    return x < y ? -1 : x > y;
+}
+
+ST float pct(struct op *o, int p) {
+    return o->t[(int)((o->n - 1) * (double)p / 100 + 0.5)];
+}
+
+/*----------------------------------------------------------------------------*/
+// the engine, as EditProc() drives it
+
+#define K(n) { #n, KEY_##n }
+
+ST const struct { const char *name; int cmd; } keys[] = {
+    K(RET), K(BACK), K(TAB), K(UP), K(DOWN), K(RIGHT), K(LEFT),
+    K(NEXT), K(PRIOR), K(HOME), K(END), K(INSERT), K(DELETE),
+    K(S_BACK), K(S_TAB), K(S_UP), K(S_DOWN), K(S_RIGHT), K(S_LEFT),
+    K(S_NEXT), K(S_PRIOR), K(S_HOME), K(S_END), K(S_INSERT), K(S_DELETE),
+    K(C_RET), K(C_BACK), K(C_UP), K(C_DOWN), K(C_RIGHT), K(C_LEFT),
+    K(C_NEXT), K(C_PRIOR), K(C_HOME), K(C_END), K(C_INSERT), K(C_DELETE),
+    K(A_RET), K(A_UP), K(A_DOWN), K(A_INSERT), K(A_DELETE),
+    K(C_A), K(C_B), K(C_C), K(C_D), K(C_U), K(C_V), K(C_X), K(C_Z), K(CS_Z),
+    K(C_0), K(C_7), K(C_8), K(C_9),
+};
+
+// WM_KEYDOWN, shift with the cursor keys marks
+ST void key(int n) {
+    if (n >= KEY_S_UP && n <= KEY_S_END) {
+        vmark = 0;
+        domarking(1);
+        ed_cmd(n - 100);
+        domarking(1);
+        return;
+    }
+    domarking(0);
+    ed_cmd(n);
+    if (n != KEY_C_A && n != KEY_C_U && n != KEY_C_7 && n != KEY_C_8
+     && n != KEY_C_9 && n != KEY_C_0 && n != KEY_TAB && n != KEY_S_TAB)
+        unmark();
+}
+
+// the page as edprint.cpp reads it
+ST void paint(void) {
+    int o, y, x, n, e;
+    unsigned s = 0;
+    if (NULL == edp)
+        return;
+    for (o = fpga, y = 0; y <= pgy; y++, o += e + 1) {
+        e = linelen(o);
+        n = imin(e, clft + pgx + 1);
+        for (x = clft; x < n; x++)
+            s += getchr(o + x);
+        if (o + e >= flen)
+            break;
+    }
+    sink += s;
+}
+
+ST int unescape(char *d, const char *s) {
+    char *p = d;
+    for (; *s; s++) {
+        if (*s == '\\' && s[1]) {
+            s++;
+            if (*s == 'n') *p++ = 10;
+            else if (*s == 't') *p++ = 9;
+            else if (*s == 's') *p++ = ' ';
+            else *p++ = *s;
+        } else
+            *p++ = *s;
+    }
+    *p = 0;
+    return p - d;
+}
+
+ST int get_flags(const char *f) {
+    int sf = 0;
+    for (; *f; f++)
+        switch (*f) {
+        case 'b': sf |= 2; break;
+        case 'c': sf |= 16; break;
+        case 'w': sf |= 32; break;
+        case 'r': sf |= 64; break;
+        case 'a': sf |= 128; break;
+        }
+    return sf;
+}
+
+ST int open_file(char *name) {
+    if (0 == LoadFile(name))
+        return 0;
+    ed_cmd(EK_INIT, 0, 0, 0);
+    return 1;
+}
+
+/*----------------------------------------------------------------------------*/
+// the trace
+
+ST int run_trace(FILE *fp) {
+    char line[1000], txt[1000], *a, *b;
+    static char last[1000];
+    struct op *o;
+    struct sea s;
+    double t;
+    int i, n, r = 0, f, sf;
+
+    for (f = 0; fgets(line, sizeof line, fp); f = r) {
+        line[strcspn(line, "\r\n")] = 0;
+        if (0 == line[0] || '#' == line[0])
+            continue;
+        a = line + strcspn(line, " ");
+        if (*a) *a++ = 0;
+        n = atoi(a);
+        r = 0;
+        // with all closed, there is only open
+        if (NULL == edp && strcmp(line, "open"))
+            continue;
+
+        if (0 == strcmp(line, "key")) {
+            b = a + strcspn(a, " ");
+            n = *b ? atoi(b) : 1, *b = 0;
+            for (i = 0; i < (int)(sizeof keys / sizeof *keys); i++)
+                if (0 == strcmp(a, keys[i].name))
+                    break;
+            if (i == sizeof keys / sizeof *keys) {
+                fprintf(stderr, "edtrace: no key %s\n", a);
+                return 0;
+            }
+            o = get_op(keys[i].name);
+            while (n-- > 0) {
+                t = usec_now();
+                key(keys[i].cmd);
+                paint();
+                add_time(o, usec_now() - t);
+            }
+            continue;
+        }
+
+        if (0 == strcmp(line, "type")) {
+            unescape(txt, a);
+            for (b = txt; *b; b++) {
+                o = get_op(*b == 10 ? "RET" : *b == 9 ? "TAB" : "char");
+                t = usec_now();
+                if (*b == 10) key(KEY_RET);
+                else if (*b == 9) key(KEY_TAB);
+                else ed_cmd(EK_CHAR, (unsigned char)*b);
+                paint();
+                add_time(o, usec_now() - t);
+            }
+            continue;
+        }
+
+        t = usec_now();
+        if (0 == strcmp(line, "insert")) {
+            unescape(txt, a);
+            ed_cmd(EK_INSERT, txt);
+            o = get_op("insert");
+        } else if (0 == strcmp(line, "goto")) {
+            if (*a == '$') n = flen;
+            else if (strchr(a, '%')) n = (int)((double)flen * n / 100);
+            ed_cmd(EK_GOTO, imax(0, imin(n, flen)));
+            o = get_op("goto");
+        } else if (0 == strcmp(line, "line")) {
+            if (strchr(a, '%')) n = (int)((double)lines * n / 100);
+            ed_cmd(EK_GOTOLINE, imax(0, n - 1));
+            o = get_op("line");
+        } else if (0 == strcmp(line, "mark")) {
+            n = imax(0, imin(fpos + n, flen));
+            ed_cmd(EK_MARK, imin(fpos, n), imax(fpos, n));
+            o = get_op("mark");
+        } else if (0 == strcmp(line, "find")) {
+            b = a + strcspn(a, " ");
+            if (*b) *b++ = 0;
+            sf = get_flags(a);
+            sf |= sf & 2 ? 0 : 1;
+            unescape(txt, b);
+            // on from the last one, as the dialog does
+            if (f && 0 == strcmp(last, b))
+                sf |= 4;
+            strcpy(last, b);
+            unmark();
+            s.from = fpos, s.str = txt, s.sf = sf;
+            sink += ed_nsearch(&s);
+            o = get_op("find");
+            r = 1;
+        } else if (0 == strcmp(line, "replace")) {
+            b = a + strcspn(a, " ");
+            if (*b) *b++ = 0;
+            s.sf = get_flags(a);
+            a = b + strcspn(b, " ");
+            if (*a) *a++ = 0;
+            unescape(txt, b);
+            unescape(last, a);
+            unmark();
+            s.from = fpos, s.str = txt;
+            sink += ed_rplfiles(&s, last);
+            last[0] = 0;
+            o = get_op("replace");
+        } else if (0 == strcmp(line, "undo")) {
+            key(KEY_C_Z);
+            o = get_op("undo");
+        } else if (0 == strcmp(line, "redo")) {
+            key(KEY_CS_Z);
+            o = get_op("redo");
+        } else if (0 == strcmp(line, "retab")) {
+            ed_cmd(EK_RETAB, n, atoi(a + strcspn(a, " ")));
+            o = get_op("retab");
+        } else if (0 == strcmp(line, "next")) {
+            nextfile();
+            o = get_op("next");
+        } else if (0 == strcmp(line, "prev")) {
+            prevfile();
+            o = get_op("prev");
+        } else if (0 == strcmp(line, "open")) {
+            if (0 == open_file(a))
+                fprintf(stderr, "edtrace: cannot read %s\n", a);
+            o = get_op("open");
+        } else if (0 == strcmp(line, "save")) {
+            if (*a) b = a;
+            else if (NULL == (b = (char*)out)) continue;
+            SaveFile(b, NULL, 0);
+            o = get_op("save");
+        } else if (0 == strcmp(line, "close")) {
+            CloseFile();
+            o = get_op("close");
+        } else {
+            fprintf(stderr, "edtrace: what is '%s'\n", line);
+            return 0;
+        }
+        paint();
+        add_time(o, usec_now() - t);
+
+        // CMD_SAVED, as the window would get it meanwhile
+        save_check();
+    }
+    return 1;
+}
+
+// a session: go somewhere, look around, type, mark, copy and paste,
+// search, undo
+ST void make_trace(FILE *fp, int count) {
+    static const char *w[] = {
+        "int", "return", "foo", "bar", "x", "if", "while", "0;", "=",
+        "(x)", "{", "}", "request", "session", "\\n", "\\t",
+    };
+    static const char *f[] = {
+        "- session", "- 404", "c WARN", "w cache", "b request",
+        "r [0-9]+/.html", "r user.*closed", "rc ^INFO",
+    };
+    static const char *m[] = {
+        "DOWN", "UP", "NEXT", "PRIOR", "END", "HOME", "C_RIGHT", "C_LEFT",
+    };
+    int i, k, s;
+    for (i = s = 0; i < count; ) {
+        if (out && i >= s)
+            fprintf(fp, "save\n"), s += 5000;
+        switch (rnd(20)) {
+        case 0: fprintf(fp, "line %d%%\n", rnd(100)), i++; break;
+        case 1: fprintf(fp, "goto %d%%\n", rnd(100)), i++; break;
+        case 2: fprintf(fp, "key C_%s\n", rnd(2) ? "HOME" : "END"), i++; break;
+        case 3: case 4: case 5:
+            fprintf(fp, "key %s %d\n", m[rnd(8)], 1 + rnd(20)), i++;
+            break;
+        case 6:
+            fprintf(fp, "key S_DOWN %d\nkey C_%c\n", 1 + rnd(10), "CXC"[rnd(3)]);
+            fprintf(fp, "key DOWN %d\nkey C_V\n", rnd(40)), i += 4;
+            break;
+        case 7:
+            fprintf(fp, "mark %d\nkey C_U\n", rnd(200) - 100), i += 2;
+            break;
+        case 8:
+            for (k = 1 + rnd(4); k-- && i < count; i++)
+                fprintf(fp, "find %s\n", f[rnd(sizeof f / sizeof *f)]);
+            break;
+        case 9:
+            for (k = 1 + rnd(6); k-- && i < count; i++)
+                fprintf(fp, "undo\n");
+            if (rnd(2))
+                fprintf(fp, "redo\n"), i++;
+            break;
+        case 10:
+            fprintf(fp, "key BACK %d\n", 1 + rnd(8)), i++;
+            break;
+        case 11:
+            fprintf(fp, "key %s\n", rnd(2) ? "DELETE" : "C_DELETE"), i++;
+            break;
+        case 12:
+            if (0 == rnd(50))
+                fprintf(fp, "replace - session\\s%d conn\\s%d\n", rnd(10), rnd(10)), i++;
+            else
+                fprintf(fp, "key A_%s\n", rnd(2) ? "RET" : "DOWN"), i++;
+            break;
+        default:
+            for (k = 1 + rnd(6); k-- && i < count; i++)
+                fprintf(fp, "type %s \n", w[rnd(sizeof w / sizeof *w)]);
+        }
+    }
+}
+
+// something that looks like a log file or source
+ST int make_text(const char *fn, double size) {
+    static const char *w[] = {
+        "INFO", "WARN", "request", "served", "from", "cache", "user",
+        "session", "opened", "closed", "GET", "/index.html", "200", "404",
+        "int", "return", "if", "(x)", "{", "}", "=", "0;", "while",
+    };
+    char buf[BLS];
+    double l = 0;
+    int n, k;
+    FILE *fp = fopen(fn, "wb");
+    if (NULL == fp) return 0;
+    while (l < size) {
+        n = sprintf(buf, "%08u ", rnd(100000000));
+        for (k = rnd(4); k--;)
+            buf[n++] = 9;
+        for (k = 2 + rnd(12); k--;)
+            n += sprintf(buf+n, "%s ", w[rnd(sizeof w / sizeof *w)]);
+        buf[n-1] = 10;
+        n = (int)imin(n, size - l);
+        fwrite(buf, 1, n, fp), l += n;
+    }
+    return 0 == fclose(fp);
+}
+
+/*----------------------------------------------------------------------------*/
+// results
+
+ST unsigned checksum(void) {
+    char buf[BLS];
+    unsigned h = 2166136261u;
+    struct edvars *e = edp;
+    int o, n, i;
+    for (edp = ed0; edp; edp = edp->next)
+        for (o = 0; o < flen; o += n) {
+            n = imin(BLS, flen - o);
+            copyfrom(buf, o, n);
+            for (i = 0; i < n; i++)
+                h = (h ^ (unsigned char)buf[i]) * 16777619;
+        }
+    edp = e;
+    return h;
+}
+
+ST void write_results(FILE *fp, unsigned text, long peak) {
+    struct op *o;
+    for (o = ops; o < ops + nops; o++)
+        if (o->n)
+            fprintf(fp, "op %s %d %.2f %.2f %.2f %.2f\n", o->name, o->n,
+                pct(o, 50), pct(o, 90), pct(o, 99), o->t[o->n - 1]);
+    fprintf(fp, "text %08x\n", text);
+    fprintf(fp, "peak %ld\n", peak);
+}
+
+// what is more than l percent over, and at least a us
+ST int over(double a, double b, int l) {
+    return a > b * (100 + l) / 100 && a > b + 1;
+}
+
+ST int compare(const char *fn, unsigned text, long peak, int l) {
+    char line[200], name[100];
+    float p50, p90;
+    unsigned h;
+    long k;
+    struct op *o;
+    int n, bad = 0;
+    FILE *fp = fopen(fn, "r");
+
+    if (NULL == fp) {
+        fprintf(stderr, "edtrace: cannot read %s\n", fn);
+        return 0;
+    }
+    while (fgets(line, sizeof line, fp)) {
+        if (4 == sscanf(line, "op %99s %d %f %f", name, &n, &p50, &p90)) {
+            for (o = ops; o < ops + nops; o++)
+                if (0 == strcmp(o->name, name) && o->n == n)
+                    break;
+            if (o == ops + nops)
+                continue;
+            if (over(pct(o, 50), p50, l) || over(pct(o, 90), p90, l))
+                printf("slower   %-10s %.2f / %.2f us, was %.2f / %.2f\n",
+                    name, pct(o, 50), pct(o, 90), p50, p90), bad++;
+        } else if (1 == sscanf(line, "text %x", &h)) {
+            if (h != text)
+                printf("text     %08x, was %08x\n", text, h), bad++;
+        } else if (1 == sscanf(line, "peak %ld", &k)) {
+            if (over(peak, k, l))
+                printf("peak     %ld kB, was %ld kB\n", peak, k), bad++;
+        }
+    }
+    fclose(fp);
+    printf("compare  with %s: %d worse, %s\n", fn, bad, bad ? "fail" : "pass");
+    return 0 == bad;
+}
+
+/*----------------------------------------------------------------------------*/
+int main(int argc, char **argv) {
+    const char *trace = NULL, *wtrace = NULL, *res = NULL, *base = NULL;
+    char tmp[MAX_PATH] = "";
+    double size = 16*1024*1024, t0, t1, t2;
+    int count = 20000, i, l = 25, x = 100, y = 50, nf = 0, n, len;
+    long heap0;
+    unsigned text;
+    struct op *o;
+    FILE *fp;
+
+    for (i = 1; i < argc; i++) {
+        const char *a = argv[i];
+        if (0 == strcmp(a, "-t") && i+1 < argc) trace = argv[++i];
+        else if (0 == strcmp(a, "-n") && i+1 < argc) count = atoi(argv[++i]);
+        else if (0 == strcmp(a, "-r") && i+1 < argc) rnd_s = atoi(argv[++i]);
+        else if (0 == strcmp(a, "-w") && i+1 < argc) wtrace = argv[++i];
+        else if (0 == strcmp(a, "-s") && i+1 < argc) size = get_size(argv[++i]);
+        else if (0 == strcmp(a, "-g") && i+1 < argc) sscanf(argv[++i], "%dx%d", &x, &y);
+        else if (0 == strcmp(a, "-o") && i+1 < argc) out = argv[++i];
+        else if (0 == strcmp(a, "-R") && i+1 < argc) res = argv[++i];
+        else if (0 == strcmp(a, "-B") && i+1 < argc) base = argv[++i];
+        else if (0 == strcmp(a, "-l") && i+1 < argc) l = atoi(argv[++i]);
+        else if (a[0] != '-') argv[++nf] = argv[i];
+        else {
+            fprintf(stderr, "usage: edtrace [-t trace | -n count] [-r seed]"
+                " [-w trace] [-s size] [-g XxY] [-o file] [-R file]"
+                " [-B file] [-l percent] [file...]\n");
+            return 1;
+        }
+    }
+    if (size > 0x7fffffff - 0x100000) {
+        fprintf(stderr, "edtrace: the editor is limited to 2G\n");
+        return 1;
+    }
+
+    ed_host(x, y);
+    if (0 == nf) {
+        // the text first, so that the trace is the same for each size
+        strcpy(tmp, "/tmp/edtrace.XXXXXX");
+        if ((i = mkstemp(tmp)) < 0 || close(i) || 0 == make_text(tmp, size)) {
+            fprintf(stderr, "edtrace: cannot write %s\n", tmp);
+            return 1;
+        }
+        argv[++nf] = tmp;
+    }
+
+    t0 = usec_now();
+    for (len = i = 0; i < nf; i++) {
+        if (0 == open_file(argv[1+i])) {
+            fprintf(stderr, "edtrace: cannot read %s\n", argv[1+i]);
+            return 1;
+        }
+        len += flen;
+    }
+    t1 = usec_now();
+    edp = ed0;
+    lines = tlin;
+    heap0 = status_kb("RssAnon");
+
+    if (trace)
+        fp = fopen(trace, "rb");
+    else if (wtrace)
+        fp = fopen(wtrace, "w+b");
+    else
+        fp = tmpfile();
+    if (NULL == fp) {
+        fprintf(stderr, "edtrace: cannot open trace\n");
+        return 1;
+    }
+    if (NULL == trace) {
+        make_trace(fp, count);
+        rewind(fp);
+    }
+
+    t2 = usec_now();
+    i = run_trace(fp);
+    t2 = usec_now() - t2;
+    fclose(fp);
+    if (0 == i)
+        return 1;
+
+    // the saves still going on are over
+    for (edp = ed0; edp; edp = edp->next)
+        if (save_j) save_over();
+    edp = ed0;
+    text = checksum();
+
+    printf("size     %d bytes, %d lines in %d files, loaded in %.1f ms\n",
+        len, lines, nf, (t1 - t0) / 1e3);
+    printf("%-10s %8s %9s %9s %9s %9s %9s\n", "command", "count",
+        "p50 us", "p90 us", "p99 us", "max us", "total ms");
+    for (n = 0, o = ops; o < ops + nops; o++) {
+        double s = 0;
+        if (0 == o->n)
+            continue;
+        qsort(o->t, o->n, sizeof *o->t, cmp_float);
+        for (i = 0; i < o->n; i++)
+            s += o->t[i];
+        printf("%-10s %8d %9.2f %9.2f %9.2f %9.1f %9.1f\n", o->name, o->n,
+            pct(o, 50), pct(o, 90), pct(o, 99), o->t[o->n - 1], s / 1e3);
+        n += o->n;
+    }
+    printf("trace    %d commands in %.1f ms, %.2f us each\n",
+        n, t2 / 1e3, t2 / imax(n, 1));
+    for (len = i = 0, edp = ed0; edp; edp = edp->next)
+        len += undo_l.size + redo_l.size, i += undo_l.g;
+    edp = ed0;
+    printf("memory   peak %ld kB, heap %ld kB, %ld kB after loading,"
+        " %d undo steps in %d kB\n", peak_kb(), status_kb("RssAnon"),
+        heap0, i, len >> 10);
+    printf("text     %08x\n", text);
+
+    i = 1;
+    if (res) {
+        if (NULL == (fp = fopen(res, "w"))) {
+            fprintf(stderr, "edtrace: cannot write %s\n", res);
+            i = 0;
+        } else
+            write_results(fp, text, peak_kb()), fclose(fp);
+    }
+    if (base)
+        i = compare(base, text, peak_kb(), l) && i;
+
+    clean_up();
+    if (tmp[0])
+        unlink(tmp);
+    for (o = ops; o < ops + nops; o++)
+        free(o->t);
+    return i ? 0 : 1;
+}
+
+/*----------------------------------------------------------------------------*/
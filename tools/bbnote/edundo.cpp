@@ -0,0 +1,224 @@
+/*---------------------------------------------------------------------------*
+
+  This file is part of the BBNote source code
+
+  Copyright 2003-2009 grischka@users.sourceforge.net
+
+  BBNote is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+ *---------------------------------------------------------------------------*/
+// EDUNDO.C - the undo / redo log
+
+#include "edstruct.h"
+#include <stddef.h>
+
+/*
+    Each buffer has two logs, undo_l and redo_l. A log is a stack of
+    records, one after the other in big chunks, with the size of each
+    record also behind it, to pop them from the top.
+
+    An edit command (ed_cmd) puts the UD_INS/UD_DEL records of what it
+    did, then one UD_POS (UD_CHG) record that closes the group, with the
+    cursor from before and after. unredo() in edfunc.cpp takes back the
+    group on top, putting the reverse into the other log.
+
+    Chars typed or deleted in a row go into the group of the one before,
+    up to a line (u_close()). Over 'undo_mb' the oldest groups go.
+*/
+
+struct uchunk {
+    struct uchunk *prev, *next;
+    int a, e, size;         // the records are from d+a to d+e
+    int pad;
+    char d[1];
+};
+
+#define UCHUNK  65536
+#define U_RUN   256         // longest run of chars put together
+
+// a record with b bytes of text, padded, and its size behind it
+#define U_SIZE(b) ((int)((offsetof(sud, buf) + (b) + 3) & ~3) + (int)sizeof(int))
+#define U_BACK(p) (((int*)(p))[-1])
+
+struct ulog *u_pp;
+int undo_mb = 64;           // for each buffer, 0: no limit
+
+/*----------------------------------------------------------------------------*/
+sud *u_add(int cmd, int p, int l, int b) {
+    struct ulog *u = u_pp;
+    struct uchunk *c = u->top;
+    sud *r;
+    int s = U_SIZE(b), k;
+
+    if (winflg&1) return NULL;
+
+    if (NULL==c || c->e + s > c->size) {
+        k = imax(UCHUNK, s);
+        if (NULL==(c=(struct uchunk*)m_alloc(offsetof(struct uchunk, d) + k)))
+            return NULL;
+        c->a = c->e = 0, c->size = k;
+        c->next = NULL;
+        if (NULL!=(c->prev=u->top)) u->top->next = c;
+        else u->bot = c;
+        u->top = c, u->size += k;
+    }
+    r = (sud*)(c->d + c->e);
+    r->p = p, r->l = l, r->n = b, r->cmd = cmd;
+    c->e += s;
+    U_BACK(c->d + c->e) = s;
+    u->n++;
+    if (cmd >= UD_POS) u->g++;
+    return r;
+}
+
+sud *u_top(struct ulog *u) {
+    struct uchunk *c = u->top;
+    if (NULL==c) return NULL;
+    return (sud*)(c->d + c->e - U_BACK(c->d + c->e));
+}
+
+void u_pop(struct ulog *u) {
+    struct uchunk *c = u->top;
+    sud *r = u_top(u);
+    if (NULL==r) return;
+    if (r->cmd >= UD_POS) u->g--;
+    c->e -= U_BACK(c->d + c->e);
+    if (c->e == c->a) {
+        if (NULL!=(u->top=c->prev)) u->top->next = NULL;
+        else u->bot = NULL;
+        u->size -= c->size;
+        m_free(c);
+    }
+}
+
+void u_free(struct ulog *u) {
+    struct uchunk *c, *n;
+    for (c = u->bot; c; c = n)
+        n = c->next, m_free(c);
+    u->top = u->bot = NULL;
+    u->size = u->g = 0;
+}
+
+// the record before r, which is in *pc
+ST sud *u_prev(struct uchunk **pc, sud *r) {
+    struct uchunk *c = *pc;
+    char *p = (char*)r;
+    if (p == c->d + c->a) {
+        if (NULL==(c=c->prev)) return NULL;
+        *pc = c, p = c->d + c->e;
+    }
+    return (sud*)(p - U_BACK(p));
+}
+
+// over undo_mb, the oldest groups go, but not the last one
+ST void u_trim(struct ulog *u) {
+    struct uchunk *c;
+    sud *r;
+    int f;
+    while (undo_mb && u->size > undo_mb<<20 && u->g > 1)
+        do {
+            c = u->bot;
+            r = (sud*)(c->d + c->a);
+            c->a += U_SIZE(r->n);
+            if (0 != (f = r->cmd >= UD_POS)) u->g--;
+            if (c->a == c->e) {
+                u->bot = c->next, u->bot->prev = NULL;
+                u->size -= c->size;
+                m_free(c);
+            }
+        } while (0 == f);
+}
+
+/*----------------------------------------------------------------------------*/
+void u_setchg(int c) {
+    struct ulog *u; struct uchunk *k; sud *r; int i, o;
+    for (i=0, u=&undo_l; i<2; i++, u=&redo_l)
+        for (k=u->bot; k; k=k->next)
+            for (o=k->a; o<k->e; o+=U_SIZE(r->n)) {
+                r=(sud*)(k->d+o);
+                if (r->cmd==UD_POS)
+                    r->cmd=UD_CHG;
+            }
+    chg=c;
+}
+
+void u_check(int a,int b) {     // called at exit of 'do-edit-cmd(int cmd)'
+    u_add(UD_POS+chg,a,b,0);
+}
+
+void u_reset(void) {            // called from 'close-the-file()'
+    u_free(&undo_l);
+    u_free(&redo_l);
+}
+
+void u_ins (int p, int l) {     // called from 'inschr(int pos, int cnt, char *what)'
+    u_add(UD_INS,p,l,0);
+}
+
+void u_del (int p, int l) {     // called from 'delchr(int pos, int cnt)'
+    sud *up=u_add(UD_DEL,p,l,l);
+    if (NULL!=up) copyfrom(up->buf, p, l);
+}
+
+/*----------------------------------------------------------------------------*/
+// Closes the group of an edit that moved the cursor from a to b, n is
+// undo_l.n from before. One char typed or deleted next to the last
+// one, in a group of its own too, goes with that one.
+
+void u_close(int a, int b, int n) {
+    struct ulog *u = &undo_l;
+    struct uchunk *c = u->top;
+    sud *r, *m, *q, *o;
+    char t[2*U_RUN];
+    int p, l, mp, mc;
+
+    u_pp = u;
+    if (u->n != n+1 || 0==chg)
+        goto p1;
+    r = u_top(u);
+    if (NULL==r || r->cmd >= UD_POS
+     || NULL==(m=u_prev(&c, r)) || m->cmd < UD_POS || m->l != a
+     || NULL==(q=u_prev(&c, m)) || q->cmd != r->cmd
+     || (NULL!=(o=u_prev(&c, q)) && o->cmd < UD_POS)
+     || q->l + r->l > U_RUN)
+        goto p1;
+
+    if (r->cmd==UD_INS) {
+        if (r->p != q->p + q->l || cntlf(q->p, r->p + r->l))
+            goto p1;
+        q->l += r->l;
+        u_pop(u);
+        m->l = b;
+        return;
+    }
+
+    if (memchr(r->buf, 10, r->l) || memchr(q->buf, 10, q->l))
+        goto p1;
+    if (r->p + r->l == q->p)        // backspace
+        memcpy(t, r->buf, r->l), memcpy(t + r->l, q->buf, q->l);
+    else if (r->p == q->p)          // delete
+        memcpy(t, q->buf, q->l), memcpy(t + q->l, r->buf, r->l);
+    else
+        goto p1;
+    p = imin(r->p, q->p), l = q->l + r->l;
+    mp = m->p, mc = m->cmd;
+    u_pop(u), u_pop(u), u_pop(u);
+    if (NULL!=(r=u_add(UD_DEL, p, l, l)))
+        memcpy(r->buf, t, l);
+    u_add(mc, mp, b, 0);
+    return;
+
+p1:
+    u_check(a, b);
+    u_trim(u);
+}
+
+/*----------------------------------------------------------------------------*/
@@ -25,6 +25,12 @@ int rcomp (unsigned char *in, unsigned char *out, int omax, int cf);
 struct rmres { int p; int w; };
 int rmatch(int s, int a, int e, unsigned char *m, struct rmres *m_ptr, int (*getchr)(int));
 
+typedef const unsigned char *(*rchunk)(void *arg, int o, int *n);
+struct rdfa *rdfa_new(unsigned char *code, int tabc);
+void rdfa_free(struct rdfa *d);
+int rdfa_match(struct rdfa *d, int s, int e, rchunk getchunk, void *arg);
+int rdfa_find(struct rdfa *d, int s, int e, int *pm, rchunk getchunk, void *arg);
+
 enum codes {
     e_succ     = 1  ,
     e_char     = 2  ,
@@ -43,6 +49,7 @@ enum codes {
 
 /*---------------------------------------------------------------------------*/
 #include <string.h>
+#include <stdlib.h>
 
 #define ST static
 
@@ -475,6 +482,334 @@ e_fail:
     }
 }
 
+/*---------------------------------------------------------------------------*/
+/*
+    The same code, run as a DFA for searching big texts.
+
+    rmatch() tries the ways through the code one after the other and
+    calls getchr() for every char it looks at, over again for each way
+    and each start position. Here a state is the set of places in the
+    code that all the ways have reached, made the first time the text
+    leads to it and then kept with a table for the next states, so that
+    the search costs one lookup per char. The text is read in chunks
+    as it is stored, through getchunk(arg, ...). A dfa must be used by one
+    thread at a time since it makes its states as it goes.
+
+    '^' and '$' depend on the chars around, so a state remembers whether
+    the char before was a line end, and it accepts either before a line
+    end or before another char, or both.
+
+    rdfa_match() gives the longest match at a position, like rmatch()
+    without the groups. rdfa_find() runs with a new way started at each
+    char until some match ends, and then looks for the first position
+    where one starts. With only one char that can start a match, it
+    skips to it with memchr.
+*/
+
+#define DFA_MAX 512         // states before the cache is thrown away
+#define DFA_HSZ 1024        // hash table for the states, power of 2
+
+#define R_BOL   1           // the char before was a line end
+#define R_INI   2           // the start is still to be taken
+
+struct rdcache {
+    int ns, np, pmax, flushed;
+    int *next;              // the next states, -1 if not known yet
+    unsigned char *acc;     // 1: accepts before a char, 2: before a line end
+    int *kern;              // where a state's set starts in the pool
+    int *pool;              // the sets: count, flags, positions
+    int htab[DFA_HSZ];      // state+1, 0 if free
+};
+
+struct rdfa {
+    unsigned char *code;
+    int clen, canlf, nfb, fb;
+    unsigned char xl[256];  // the chars as the code sees them
+    unsigned char first[256];
+    int *set, *stk, *kb;
+    unsigned *mark, gen;
+    struct rdcache c[2];    // 0: anchored, 1: searching
+};
+
+ST int r_isnl(int c) {
+    return c==10 || c==13;
+}
+
+ST int r_len(unsigned char *m) {
+    switch (*m) {
+    case e_char: case e_nocase: case e_grp_a: return 2;
+    case e_class: return 1+CLSZ;
+    case e_back: case e_que: case e_jmp: return 3;
+    default: return 1;
+    }
+}
+
+// does the instruction at m take the char c
+ST int r_eats(unsigned char *m, int c) {
+    switch (*m) {
+    case e_char: return m[1]==c;
+    case e_nocase: return m[1]==lwc_ger((unsigned char)c);
+    case e_class: return 0==(m[1+((c>>3)&(CLSZ-1))] & (1<<(c&7)));
+    case e_dot: return !r_isnl(c);
+    case e_nospc: return c!=' ' && c!=9 && !r_isnl(c);
+    default: return 0;
+    }
+}
+
+// follow the jumps from the set k (and from the start with u), before
+// a line end with f. The places that take a char go to d->set.
+ST int r_close(struct rdfa *d, int *k, int f, int u, int *acc) {
+    unsigned char *m;
+    int n, sp, pc, b;
+
+    if (++d->gen==0)
+        memset(d->mark, 0, d->clen*sizeof *d->mark), d->gen=1;
+    for (sp=0; sp<k[0]; sp++)
+        d->stk[sp]=k[2+sp];
+    if (u)
+        d->stk[sp++]=1;
+    b=k[1]&R_BOL;
+    *acc=n=0;
+    while (sp) {
+        pc=d->stk[--sp];
+        if (d->mark[pc]==d->gen)
+            continue;
+        d->mark[pc]=d->gen;
+        m=d->code+pc;
+        switch (*m) {
+        case e_succ: *acc=1; break;
+        case e_bol: if (b) d->stk[sp++]=pc+1; break;
+        case e_eol: if (f) d->stk[sp++]=pc+1; break;
+        case e_grp_a: d->stk[sp++]=pc+2; break;
+        case e_grp_b: d->stk[sp++]=pc+1; break;
+        case e_jmp: d->stk[sp++]=pc+3+*(short*)&m[1]; break;
+        case e_back:
+        case e_que:
+            d->stk[sp++]=pc+3;
+            d->stk[sp++]=pc+3+*(short*)&m[1];
+            break;
+        default: d->set[n++]=pc; break;
+        }
+    }
+    return n;
+}
+
+ST int r_state(struct rdfa *d, struct rdcache *dc, int *k) {
+    unsigned h=k[0]*7+k[1];
+    int i, s, a, *q, n=k[0]+2;
+
+    for (i=0;i<k[0];i++)
+        h=h*31+k[2+i];
+    for (i=h&(DFA_HSZ-1);;i=(i+1)&(DFA_HSZ-1)) {
+        if (0==(s=dc->htab[i]))
+            break;
+        q=dc->pool+dc->kern[--s];
+        if (q[0]==k[0] && 0==memcmp(q+1, k+1, (n-1)*sizeof *k))
+            return s;
+    }
+    if (dc->ns==DFA_MAX || dc->np+n>dc->pmax)
+        return -1;
+    s=dc->ns++;
+    dc->htab[i]=s+1;
+    dc->kern[s]=dc->np;
+    memcpy(dc->pool+dc->np, k, n*sizeof *k);
+    dc->np+=n;
+    memset(dc->next+s*256, -1, 256*sizeof *dc->next);
+    // only what was reached by taking chars may accept
+    r_close(d, k, 0, 0, &a), dc->acc[s]=a;
+    r_close(d, k, 1, 0, &a), dc->acc[s]|=a<<1;
+    return s;
+}
+
+ST void r_flush(struct rdfa *d, struct rdcache *dc) {
+    int k[2];
+    dc->ns=dc->np=0;
+    memset(dc->htab, 0, sizeof dc->htab);
+    // 0 and 1 are the empty sets, with R_BOL as the number
+    k[0]=0, k[1]=0, r_state(d, dc, k);
+    k[1]=R_BOL, r_state(d, dc, k);
+    dc->flushed++;
+}
+
+ST int r_cmp(const void *a, const void *b) {
+    return *(const int*)a - *(const int*)b;
+}
+
+ST int r_intern(struct rdfa *d, struct rdcache *dc, int *k) {
+    int s;
+    qsort(k+2, k[0], sizeof *k, r_cmp);
+    if ((s=r_state(d, dc, k))<0)
+        r_flush(d, dc), s=r_state(d, dc, k);
+    return s;
+}
+
+// the state after s by the char c, not known yet
+ST int r_step(struct rdfa *d, struct rdcache *dc, int s, int c) {
+    int *k=d->kb, *q, i, n, a, f=dc->flushed;
+
+    q=dc->pool+dc->kern[s];
+    memcpy(k, q, (q[0]+2)*sizeof *k);
+    n=r_close(d, k, r_isnl(c), dc==d->c+1 || (k[1]&R_INI), &a);
+    for (k[0]=0,i=0;i<n;i++)
+        if (r_eats(d->code+d->set[i], d->xl[c]))
+            k[2+k[0]++]=d->set[i]+r_len(d->code+d->set[i]);
+    k[1]=r_isnl(c)?R_BOL:0;
+    n=r_intern(d, dc, k);
+    if (f==dc->flushed)
+        dc->next[s*256+c]=n;
+    return n;
+}
+
+ST int r_getc(int o, rchunk getchunk, void *arg) {
+    int n;
+    return *getchunk(arg, o, &n);
+}
+
+ST int r_bol(int o, rchunk getchunk, void *arg) {
+    return o==0 || r_isnl(r_getc(o-1, getchunk, arg));
+}
+
+struct rdfa *rdfa_new(unsigned char *code, int tabc) {
+    struct rdfa *d;
+    unsigned char *m;
+    int i, j, n, a, f, k[2];
+
+    d=(struct rdfa*)calloc(1, sizeof *d);
+    if (NULL==d)
+        return NULL;
+    d->code=code;
+    for (m=code+1; *m!=e_succ; m+=r_len(m))
+        if (r_eats(m, 10) || r_eats(m, 13))
+            d->canlf=1;
+    d->clen=n=m+1-code;
+
+    d->set=(int*)malloc(n*sizeof(int));
+    d->stk=(int*)malloc((3*n+2)*sizeof(int));
+    d->kb=(int*)malloc((n+2)*sizeof(int));
+    d->mark=(unsigned*)calloc(n, sizeof(unsigned));
+    f=d->set && d->stk && d->kb && d->mark;
+    for (i=0;i<2;i++) {
+        struct rdcache *dc=d->c+i;
+        dc->next=(int*)malloc(DFA_MAX*256*sizeof(int));
+        dc->acc=(unsigned char*)malloc(DFA_MAX);
+        dc->kern=(int*)malloc(DFA_MAX*sizeof(int));
+        dc->pmax=DFA_MAX*16+2*(n+2);
+        dc->pool=(int*)malloc(dc->pmax*sizeof(int));
+        f=f && dc->next && dc->acc && dc->kern && dc->pool;
+    }
+    // about 1M each, the caller falls back to rmatch()
+    if (0==f) {
+        rdfa_free(d);
+        return NULL;
+    }
+    for (i=0;i<2;i++)
+        r_flush(d, d->c+i);
+
+    for (i=0;i<256;i++)
+        d->xl[i]=(unsigned char)i;
+    if (tabc>=0)
+        d->xl[tabc&255]=' ';
+
+    // the chars that can start a match
+    for (k[0]=0,f=0;f<4;f++) {
+        k[1]=f&R_BOL;
+        n=r_close(d, k, f>>1, 1, &a);
+        for (j=0;j<n;j++)
+            for (i=0;i<256;i++)
+                if (r_eats(code+d->set[j], d->xl[i]))
+                    d->first[i]=1;
+    }
+    for (i=0;i<256;i++)
+        if (d->first[i])
+            d->fb=i, d->nfb++;
+    return d;
+}
+
+void rdfa_free(struct rdfa *d) {
+    int i;
+    for (i=0;i<2;i++)
+        free(d->c[i].next), free(d->c[i].acc),
+        free(d->c[i].kern), free(d->c[i].pool);
+    free(d->set), free(d->stk), free(d->kb), free(d->mark);
+    free(d);
+}
+
+// the longest match at s, 0 if none
+int rdfa_match(struct rdfa *d, int s, int e, rchunk getchunk, void *arg) {
+    struct rdcache *dc=d->c;
+    const unsigned char *p;
+    int i, n, c, t, st, k[2], r=s;
+
+    if (s>=e || 0==d->first[r_getc(s, getchunk, arg)])
+        return 0;
+    k[0]=0, k[1]=R_INI|(r_bol(s, getchunk, arg)?R_BOL:0);
+    st=r_intern(d, dc, k);
+    for (i=s,n=0;;i++,n--) {
+        if (i==e) {
+            if (dc->acc[st]&2) r=i;
+            break;
+        }
+        if (n==0)
+            p=getchunk(arg, i, &n);
+        c=*p++;
+        if (dc->acc[st] & (r_isnl(c)?2:1))
+            r=i;
+        if ((t=dc->next[st*256+c])<0)
+            t=r_step(d, dc, st, c);
+        if ((st=t)<2) // nothing left
+            break;
+    }
+    return r-s;
+}
+
+// the first match from s on: its length, and the position in *pm
+int rdfa_find(struct rdfa *d, int s, int e, int *pm, rchunk getchunk, void *arg) {
+    struct rdcache *dc=d->c+1;
+    const unsigned char *p, *q;
+    unsigned char *acc=dc->acc;
+    int *next=dc->next;
+    int i, j, n, c, t, st, lo, fb;
+
+    if (s>=e)
+        return 0;
+    fb=d->nfb==1 ? d->fb : -1;
+    st=r_bol(s, getchunk, arg);
+    for (i=s;i<e;i+=n) {
+        p=getchunk(arg, i, &n);
+        if (n>e-i)
+            n=e-i;
+        for (j=0;j<n;j++) {
+            c=p[j];
+            if (st<2 && fb>=0 && c!=fb) {
+                // nothing going on, skip to where a match can start
+                q=(const unsigned char*)memchr(p+j, fb, n-j);
+                st=r_isnl(q ? q[-1] : p[n-1]);
+                if (NULL==q)
+                    break;
+                c=*q, j=q-p;
+            }
+            if (acc[st] && (acc[st] & (r_isnl(c)?2:1)))
+                goto found;
+            if ((t=next[st*256+c])<0)
+                t=r_step(d, dc, st, c);
+            st=t;
+        }
+    }
+    if (0==(acc[st]&2))
+        return 0;
+    i=e, j=0;
+found:
+    // a match ends at i+j, and the first one starts before that,
+    // on the same line if the code does not take line ends
+    i+=j, lo=s;
+    if (0==d->canlf)
+        for (lo=i-1;lo>s && !r_isnl(r_getc(lo-1, getchunk, arg));lo--);
+    for (;lo<i;lo++)
+        if (0!=(n=rdfa_match(d, lo, e, getchunk, arg)))
+            return *pm=lo, n;
+    return 0;
+}
+
 /*---------------------------------------------------------------------------*/
 #ifdef match_main
 
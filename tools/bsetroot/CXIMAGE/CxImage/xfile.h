@@ -59,6 +59,10 @@ public:
 		return (bool)(nWrote == 1);
 		}
 	virtual long	GetC() = 0;
+	// Zero-copy read, for files that are held in memory: returns the
+	// next *size bytes (fewer at the end, *size is set to what it gives)
+	// and skips them, or NULL if the file can't do that, then use Read.
+	virtual BYTE*	ReadPtr(size_t *size) { return NULL; }
 };
 
 #endif //__xfile_h
@@ -72,8 +72,12 @@ bool CxImageBMP::Decode(CxFile * hFile)
 	bool bTopDownDib = head.biHeight<0; //<Flanders> check if it's a top-down bitmap
 	if (bTopDownDib) head.biHeight=-head.biHeight;
 
+	// LoadInto: uncompressed rows can go straight to the target
+	info.bTargetRows = info.pfnTarget != NULL && dwCompression == BI_RGB
+		&& (dwBitCount == 32 || dwBitCount == 24 || dwBitCount <= 8);
+
 	if (!Create(head.biWidth,head.biHeight,head.biBitCount,CXIMAGE_FORMAT_BMP))
-		throw "Can't allocate memory";
+		throw info.bTargetRows ? info.szLastError : "Can't allocate memory";
 
 	info.xDPI = (long) floor(head.biXPelsPerMeter * 254.0 / 10000.0 + 0.5);
 	info.yDPI = (long) floor(head.biYPelsPerMeter * 254.0 / 10000.0 + 0.5);
@@ -99,6 +103,29 @@ bool CxImageBMP::Decode(CxFile * hFile)
 
 	if (info.nEscape) throw "Cancelled"; // <vho> - cancel decoding
 
+	if (info.bTargetRows){
+		if (bf.bfOffBits != 0L) hFile->Seek(off + bf.bfOffBits,SEEK_SET);
+		DWORD dwLine = dwBitCount == 32 ? 4*head.biWidth : info.dwEffWidth;
+		BYTE* pLine = (BYTE*)malloc(dwLine);
+		if (pLine == NULL) throw "can't allocate memory";
+		for (long y=0; y<head.biHeight; y++){
+			if (info.nEscape) break;
+			if (hFile->Read(pLine, dwLine, 1) != 1) memset(pLine, 0, dwLine); //truncated file
+			long ty = bTopDownDib ? y : head.biHeight-1-y;
+			if (dwBitCount == 32){
+				BYTE *src = pLine, *dst = TargetLine(ty);
+				for (long x=0; x<head.biWidth; x++, src+=4, dst+=4){
+					dst[0]=src[0]; dst[1]=src[1]; dst[2]=src[2]; dst[3]=0;
+				}
+			} else {
+				TargetRow(ty, pLine);
+			}
+		}
+		free(pLine);
+		if (info.nEscape) throw "Cancelled";
+		return true;
+	}
+
 	switch (dwBitCount) {
 		case 32 :
 			if (bf.bfOffBits != 0L) hFile->Seek(off + bf.bfOffBits,SEEK_SET);
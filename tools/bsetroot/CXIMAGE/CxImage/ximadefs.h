@@ -28,14 +28,6 @@
  #define CXIMAGE_SUPPORT_WINDOWS 0
 #endif
 
-#ifndef min
-#define min(a,b) (((a)<(b))?(a):(b))
-#endif
-#ifndef max
-#define max(a,b) (((a)>(b))?(a):(b))
-#endif
-
-
 #ifdef WIN32
 #include <windows.h>
 //#include <tchar.h>
@@ -47,6 +39,13 @@
 #include <stdio.h>
 #include <math.h>
 
+#ifndef min
+#define min(a,b) (((a)<(b))?(a):(b))
+#endif
+#ifndef max
+#define max(a,b) (((a)>(b))?(a):(b))
+#endif
+
 
 #ifdef __BORLANDC__
 #define _complex complex
@@ -59,13 +58,16 @@
 #include <stdlib.h>
 #include <string.h>
 
+// sized to match the windows headers also on LP64 systems,
+// BITMAPINFOHEADER & co. are read and written as raw structs
 typedef unsigned char  BYTE;
 typedef unsigned short WORD;
-typedef unsigned long  DWORD;
+typedef unsigned int   DWORD;
 typedef unsigned int   UINT;
+typedef unsigned long  DWORD_PTR;
 
 typedef DWORD          COLORREF;
-typedef unsigned int   HANDLE;
+typedef void*          HANDLE;
 typedef void*          HRGN;
 
 #define BOOL bool
@@ -97,14 +99,14 @@ typedef struct tagRGBQUAD {
 
 typedef struct tagBITMAPINFOHEADER{
     DWORD      biSize;
-    long       biWidth;
-    long       biHeight;
+    int        biWidth;
+    int        biHeight;
     WORD       biPlanes;
     WORD       biBitCount;
     DWORD      biCompression;
     DWORD      biSizeImage;
-    long       biXPelsPerMeter;
-    long       biYPelsPerMeter;
+    int        biXPelsPerMeter;
+    int        biYPelsPerMeter;
     DWORD      biClrUsed;
     DWORD      biClrImportant;
 } BITMAPINFOHEADER;
@@ -149,6 +151,10 @@ typedef struct tagcomplex {
 
 #define _cabs(c) sqrt(c.x*c.x+c.y*c.y)
 
+#ifndef MAX_PATH
+#define MAX_PATH 260
+#endif
+
 #endif
 
 
@@ -116,11 +116,9 @@ bool CxImage::Encode(CxFile *hFile, DWORD imagetype)
 	}
 #endif
 
-#if 0
-
-#if CXIMAGE_SUPPORT_ICO
-	if (imagetype==CXIMAGE_FORMAT_ICO){
-		CxImageICO newima;
+#if CXIMAGE_SUPPORT_JPG
+	if (imagetype==CXIMAGE_FORMAT_JPG){
+		CxImageJPG newima;
 		newima.Ghost(this);
 		if (newima.Encode(hFile)){
 			return true;
@@ -130,9 +128,9 @@ bool CxImage::Encode(CxFile *hFile, DWORD imagetype)
 		}
 	}
 #endif
-#if CXIMAGE_SUPPORT_TIF
-	if (imagetype==CXIMAGE_FORMAT_TIF){
-		CxImageTIF newima;
+#if CXIMAGE_SUPPORT_PNG
+	if (imagetype==CXIMAGE_FORMAT_PNG){
+		CxImagePNG newima;
 		newima.Ghost(this);
 		if (newima.Encode(hFile)){
 			return true;
@@ -142,9 +140,12 @@ bool CxImage::Encode(CxFile *hFile, DWORD imagetype)
 		}
 	}
 #endif
-#if CXIMAGE_SUPPORT_JPG
-	if (imagetype==CXIMAGE_FORMAT_JPG){
-		CxImageJPG newima;
+
+#if 0
+
+#if CXIMAGE_SUPPORT_ICO
+	if (imagetype==CXIMAGE_FORMAT_ICO){
+		CxImageICO newima;
 		newima.Ghost(this);
 		if (newima.Encode(hFile)){
 			return true;
@@ -154,9 +155,9 @@ bool CxImage::Encode(CxFile *hFile, DWORD imagetype)
 		}
 	}
 #endif
-#if CXIMAGE_SUPPORT_GIF
-	if (imagetype==CXIMAGE_FORMAT_GIF){
-		CxImageGIF newima;
+#if CXIMAGE_SUPPORT_TIF
+	if (imagetype==CXIMAGE_FORMAT_TIF){
+		CxImageTIF newima;
 		newima.Ghost(this);
 		if (newima.Encode(hFile)){
 			return true;
@@ -166,9 +167,9 @@ bool CxImage::Encode(CxFile *hFile, DWORD imagetype)
 		}
 	}
 #endif
-#if CXIMAGE_SUPPORT_PNG
-	if (imagetype==CXIMAGE_FORMAT_PNG){
-		CxImagePNG newima;
+#if CXIMAGE_SUPPORT_GIF
+	if (imagetype==CXIMAGE_FORMAT_GIF){
+		CxImageGIF newima;
 		newima.Ghost(this);
 		if (newima.Encode(hFile)){
 			return true;
@@ -319,24 +320,23 @@ bool CxImage::Load(const char * filename, DWORD imagetype)
 	bool bOK = Decode(hFile,imagetype);
 	fclose(hFile);*/
 
+	// the file is mapped into memory, and read from there by all tries
+	CxMappedFile file;
+	if (!file.Open(filename)) return false;
+
 	/* automatic file type recognition */
 	bool bOK = false;
 	if ( imagetype > 0 && imagetype < CMAX_IMAGE_FORMATS ){
-		FILE* hFile;    //file handle to read the image
-		if ((hFile=fopen(filename,"rb"))==NULL)  return false;
-		bOK = Decode(hFile,imagetype);
-		fclose(hFile);
+		bOK = Decode(&file,imagetype);
 		if (bOK) return bOK;
+		file.Seek(0,SEEK_SET);
 	}
 
 	char szError[256];
 	strcpy(szError,info.szLastError); //save the first error
 
 	// if failed, try automatic recognition of the file...
-	FILE* hFile;
-	if ((hFile=fopen(filename,"rb"))==NULL)  return false;
-	bOK = Decode(hFile,CXIMAGE_FORMAT_UNKNOWN);
-	fclose(hFile);
+	bOK = Decode(&file,CXIMAGE_FORMAT_UNKNOWN);
 
 	if (!bOK && imagetype > 0) strcpy(info.szLastError,szError); //restore the first error
 
@@ -437,6 +437,35 @@ CxImage::CxImage(BYTE * buffer, DWORD size, DWORD imagetype)
 	Decode(&stream,imagetype);
 }
 ////////////////////////////////////////////////////////////////////////////////
+// Decode straight into the 32 bit buffer that 'target' returns, see
+// CXTARGETPROC. The BMP, JPG, PNG and GIF decoders write the rows there
+// as they go, other formats and the cases that need the whole image
+// (interlaced PNG, compressed BMP, animated GIF) are converted after.
+// Only the format, size and palette are left in this object.
+// Note: 'target' may be called again if a decoder fails half way.
+bool CxImage::LoadInto(const char * filename, DWORD imagetype, CXTARGETPROC target, void *param)
+{
+	info.pfnTarget = target;
+	info.pTargetParam = param;
+	info.pTarget = NULL;
+	bool bOK = Load(filename, imagetype);
+	if (bOK && !info.bTargetRows){
+		info.pfnTarget = target;
+		info.pTargetParam = param;
+		bOK = TargetCreate();
+		if (bOK){
+			BYTE *src = GetBits() + info.dwEffWidth * (head.biHeight - 1);
+			for (long y=0; y<head.biHeight; y++, src-=info.dwEffWidth)
+				TargetRow(y, src);
+		}
+	}
+	Destroy();
+	info.pfnTarget = NULL;
+	info.pTarget = NULL;
+	info.bTargetRows = false;
+	return bOK;
+}
+////////////////////////////////////////////////////////////////////////////////
 bool CxImage::Decode(BYTE * buffer, DWORD size, DWORD imagetype)
 {
 	CxMemFile file(buffer,size);
@@ -449,25 +478,34 @@ bool CxImage::Decode(FILE *hFile, DWORD imagetype)
 	return Decode(&file,imagetype);
 }
 ////////////////////////////////////////////////////////////////////////////////
+// the load options for the format decoders
+void CxImage::PassHints(CxImage &ima)
+{
+	ima.SetJpegScale(info.nJpegScale, info.nJpegMinWidth, info.nJpegMinHeight);
+	ima.SetJpegMaxMemory(info.nJpegMaxMemory);
+	ima.info.pfnTarget = info.pfnTarget;
+	ima.info.pTargetParam = info.pTargetParam;
+}
+////////////////////////////////////////////////////////////////////////////////
 bool CxImage::Decode(CxFile *hFile, DWORD imagetype)
 {
 
 	if (imagetype==CXIMAGE_FORMAT_UNKNOWN){
 		DWORD pos = hFile->Tell();
 #if CXIMAGE_SUPPORT_BMP
-		{ CxImageBMP newima; if (newima.Decode(hFile)) { Transfer(newima); return true; } else hFile->Seek(pos,SEEK_SET); }
+		{ CxImageBMP newima; PassHints(newima); if (newima.Decode(hFile)) { Transfer(newima); return true; } else hFile->Seek(pos,SEEK_SET); }
 #endif
 #if CXIMAGE_SUPPORT_JPG
-		{ CxImageJPG newima; if (newima.Decode(hFile)) { Transfer(newima); return true; } else hFile->Seek(pos,SEEK_SET); }
+		{ CxImageJPG newima; PassHints(newima); if (newima.Decode(hFile)) { Transfer(newima); return true; } else hFile->Seek(pos,SEEK_SET); }
 #endif
 #if CXIMAGE_SUPPORT_ICO
 		{ CxImageICO newima; if (newima.Decode(hFile)) { Transfer(newima); return true; } else hFile->Seek(pos,SEEK_SET); }
 #endif
 #if CXIMAGE_SUPPORT_GIF
-		{ CxImageGIF newima; if (newima.Decode(hFile)) { Transfer(newima); return true; } else hFile->Seek(pos,SEEK_SET); }
+		{ CxImageGIF newima; PassHints(newima); if (newima.Decode(hFile)) { Transfer(newima); return true; } else hFile->Seek(pos,SEEK_SET); }
 #endif
 #if CXIMAGE_SUPPORT_PNG
-		{ CxImagePNG newima; if (newima.Decode(hFile)) { Transfer(newima); return true; } else hFile->Seek(pos,SEEK_SET); }
+		{ CxImagePNG newima; PassHints(newima); if (newima.Decode(hFile)) { Transfer(newima); return true; } else hFile->Seek(pos,SEEK_SET); }
 #endif
 #if CXIMAGE_SUPPORT_TIF
 		{ CxImageTIF newima; if (newima.Decode(hFile)) { Transfer(newima); return true; } else hFile->Seek(pos,SEEK_SET); }
@@ -498,6 +536,7 @@ bool CxImage::Decode(CxFile *hFile, DWORD imagetype)
 #if CXIMAGE_SUPPORT_BMP
 	if (imagetype==CXIMAGE_FORMAT_BMP){
 		CxImageBMP newima;
+		PassHints(newima);
 		if (newima.Decode(hFile)){
 			Transfer(newima);
 			return true;
@@ -510,6 +549,7 @@ bool CxImage::Decode(CxFile *hFile, DWORD imagetype)
 #if CXIMAGE_SUPPORT_JPG
 	if (imagetype==CXIMAGE_FORMAT_JPG){
 		CxImageJPG newima;
+		PassHints(newima);
 		if (newima.Decode(hFile)){
 			Transfer(newima);
 			return true;
@@ -537,6 +577,7 @@ bool CxImage::Decode(CxFile *hFile, DWORD imagetype)
 	if (imagetype==CXIMAGE_FORMAT_GIF){
 		CxImageGIF newima;
 		newima.SetFrame(GetFrame()); //<REC>,29/01/02: handles multipage
+		PassHints(newima);
 		if (newima.Decode(hFile)){
 			Transfer(newima);
 			return true;
@@ -550,6 +591,7 @@ bool CxImage::Decode(CxFile *hFile, DWORD imagetype)
 #if CXIMAGE_SUPPORT_PNG
 	if (imagetype==CXIMAGE_FORMAT_PNG){
 		CxImagePNG newima;
+		PassHints(newima);
 		if (newima.Decode(hFile)){
 			Transfer(newima);
 			return true;
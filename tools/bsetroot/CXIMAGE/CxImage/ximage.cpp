@@ -22,6 +22,8 @@ void CxImage::Startup(DWORD imagetype)
 	info.nQuality=75;
 	info.nAlphaMax=255;
 	info.nBkgndIndex=-1;
+	info.nPngLevel=-1;
+	info.nPngThreads=1;
 	info.bEnabled=true;
 	SetXDPI(72);
 	SetYDPI(72);
@@ -150,7 +152,11 @@ void* CxImage::Create(DWORD dwWidth, DWORD dwHeight, long wBpp, long imagetype)
 //    head.biYPelsPerMeter = 0; See SetYDPI
     head.biClrImportant = 0;
 
-	pDib = malloc(GetSize()); // alloc memory block to store our bitmap
+	// with a decode target, the decoder writes the rows there instead
+	if (info.bTargetRows)
+		pDib = malloc(head.biSize + GetPaletteSize());
+	else
+		pDib = malloc(GetSize()); // alloc memory block to store our bitmap
     if (!pDib) return NULL;
 
 	//clear the palette
@@ -173,9 +179,55 @@ void* CxImage::Create(DWORD dwWidth, DWORD dwHeight, long wBpp, long imagetype)
 
 	info.pImage=GetBits();
 
+	if (info.bTargetRows && !TargetCreate()){
+		free(pDib); pDib=NULL;
+		return NULL;
+	}
+
     return pDib; //return handle to the DIB
 }
 ////////////////////////////////////////////////////////////////////////////////
+// LoadInto: ask the caller for the buffer, now that the size is known
+bool CxImage::TargetCreate()
+{
+	info.pTarget = info.pfnTarget(info.pTargetParam, head.biWidth, head.biHeight, &info.nTargetStride);
+	if (info.pTarget == NULL) strcpy(info.szLastError,"No buffer for the pixels");
+	return info.pTarget != NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
+// LoadInto: convert one row with 'bpp' bits per pixel (1,4,8 or 24, by
+// default those of the dib) to BGRX and store it at line y of the target
+void CxImage::TargetRow(long y, BYTE *src, WORD bpp)
+{
+	RGBQUAD *dst = (RGBQUAD*)TargetLine(y);
+	long x, w = head.biWidth;
+	if (bpp == 0) bpp = head.biBitCount;
+	if (bpp == 24){
+		for (x=0; x<w; x++, src+=3){
+			dst[x].rgbBlue=src[0]; dst[x].rgbGreen=src[1]; dst[x].rgbRed=src[2]; dst[x].rgbReserved=0;
+		}
+	} else {
+		// the palette once per row, with the index masked to the bits
+		// of the dib and black for the unused entries as GetPixelColor()
+		RGBQUAD lut[256];
+		RGBQUAD *pal = GetPalette();
+		DWORD i, n, mask = head.biBitCount < 8 ? (1<<head.biBitCount)-1 : 255;
+		for (i=0; i<256; i++){
+			n = i & mask;
+			if (pal && n < head.biClrUsed) lut[i] = pal[n];
+			else lut[i].rgbBlue = lut[i].rgbGreen = lut[i].rgbRed = 0;
+			lut[i].rgbReserved = 0;
+		}
+		if (bpp == 8){
+			for (x=0; x<w; x++) dst[x] = lut[src[x]];
+		} else {
+			BYTE m = (BYTE)((1<<bpp)-1);
+			for (x=0; x<w; x++)
+				dst[x] = lut[(src[(x*bpp)>>3] >> (8-bpp-((x*bpp)&7))) & m];
+		}
+	}
+}
+////////////////////////////////////////////////////////////////////////////////
 // returns the pointer to the image pixels
 BYTE* CxImage::GetBits()
 { 
@@ -68,6 +68,7 @@
 #include "xfile.h"
 #include "xiofile.h"
 #include "xmemfile.h"
+#include "xmapfile.h"
 
 #include "ximadefs.h"   //<vho> adjust some #define
 
@@ -123,6 +124,11 @@ CMAX_IMAGE_FORMATS
 
 struct rgb_color { BYTE r,g,b; };
 
+// LoadInto: called once the image size is known, returns the first (top)
+// row of the caller's 32 bit BGRX buffer and its stride in bytes, which
+// is negative for bottom-up buffers, or NULL to cancel the decoding.
+typedef BYTE* (*CXTARGETPROC)(void *param, long width, long height, long *stride);
+
 /////////////////////////////////////////////////////////////////////////////
 // CxImage class
 /////////////////////////////////////////////////////////////////////////////
@@ -152,6 +158,17 @@ typedef struct tagCxImageInfo {
 	long    xOffset;
 	long    yOffset;
 	DWORD   dwEncodeOption;     //for GIF, TIF : 0=def.1=unc,2=fax3,3=fax4,4=pack,5=jpg
+	BYTE    nJpegScale;         //used for JPEG : max. DCT scale denominator (1,2,4,8)
+	long    nJpegMinWidth;      //used for JPEG : don't scale below this size
+	long    nJpegMinHeight;
+	long    nJpegMaxMemory;     //used for JPEG : bytes, beyond that to a temp file (0=no limit)
+	CXTARGETPROC pfnTarget;     //LoadInto : where the pixels go
+	void*   pTargetParam;
+	BYTE*   pTarget;            //top row of the target, once known
+	long    nTargetStride;
+	bool    bTargetRows;        //the decoder writes the rows into the target
+	long    nPngLevel;          //used for PNG : zlib level 0..9, -1=default
+	long    nPngThreads;        //used for PNG : deflate threads, 0=one per cpu, 1=libpng's own
 
 } CXIMAGEINFO;
 
@@ -197,6 +214,14 @@ public:
 
 	BYTE    GetJpegQuality() const {return info.nQuality;}
 	void    SetJpegQuality(BYTE q) {info.nQuality = q;}
+	BYTE    GetJpegScale() const {return info.nJpegScale;}
+	void    SetJpegScale(BYTE q, long minwidth = 0, long minheight = 0)
+		{info.nJpegScale = q; info.nJpegMinWidth = minwidth; info.nJpegMinHeight = minheight;}
+	long    GetJpegMaxMemory() const {return info.nJpegMaxMemory;}
+	void    SetJpegMaxMemory(long bytes) {info.nJpegMaxMemory = bytes;}
+	long    GetPngLevel() const {return info.nPngLevel;}
+	void    SetPngCompression(long level, long threads = 1)
+		{info.nPngLevel = level; info.nPngThreads = threads;}
 
 	long    GetXDPI()       const {return info.xDPI;}
 	long    GetYDPI()       const {return info.yDPI;}
@@ -274,6 +299,7 @@ public:
 	bool Decode(FILE * hFile, DWORD imagetype);
 	bool Decode(CxFile * hFile, DWORD imagetype);
 	bool Decode(BYTE * buffer, DWORD size, DWORD imagetype);
+	bool LoadInto(const char * filename, DWORD imagetype, CXTARGETPROC target, void *param);
 #endif //CXIMAGE_SUPPORT_DECODE
 
 #if CXIMAGE_SUPPORT_ENCODE
@@ -415,6 +441,10 @@ protected:
 	float HueToRGB(float n1,float n2, float hue);
 	void Bitfield2RGB(BYTE *src, WORD redmask, WORD greenmask, WORD bluemask, BYTE bpp);
 	static int CompareColors(const void *elem1, const void *elem2);
+	void PassHints(CxImage &ima);
+	bool TargetCreate();
+	BYTE* TargetLine(long y) {return info.pTarget + y*info.nTargetStride;}
+	void TargetRow(long y, BYTE *src, WORD bpp = 0);
 
 	void*               pDib; //contains the header, the palette, the pixels
 	BITMAPINFOHEADER    head; //stadnard header
@@ -27,6 +27,9 @@ bool CxImageGIF::Decode(CxFile *fp)
 
 	if (fp == NULL) return false;
 
+	// a broken file may make the decoder use a byte of it before it is read
+	memset(byte_buff,0,sizeof(byte_buff));
+
 	fp->Read(&dscgif,/*sizeof(dscgif)*/13,1);
 	//if (strncmp(dscgif.header,"GIF8",3)!=0) {
 	if (strncmp(dscgif.header,"GIF8",4)!=0) return FALSE;
@@ -100,7 +103,10 @@ bool CxImageGIF::Decode(CxFile *fp)
 			if (iImage>0 && gifgce.dispmeth==1) previmage.Copy(*this);
 			if (iImage==0)	first_transparent_index = info.nBkgndIndex;
 
-			Create(image.w, image.h, bpp, CXIMAGE_FORMAT_GIF);
+			// LoadInto: a plain first frame can go straight to the target
+			info.bTargetRows = info.pfnTarget != NULL && iImage == 0 && info.nFrame == 0 && bTrueColor < 2;
+			if (!Create(image.w, image.h, bpp, CXIMAGE_FORMAT_GIF) && info.bTargetRows)
+				return false;
 
 			if ((image.pf & 0x80) || (dscgif.pflds & 0x80)) {
 				unsigned char r[256], g[256], b[256];
@@ -269,14 +275,21 @@ bool CxImageGIF::DecodeExtension(CxFile *fp)
 int CxImageGIF::get_byte(CxFile* file)
 {
 	if (ibf>=GIFBUFTAM){
-		// FW 06/02/98 >>>
-		ibfmax = file->Read( buf , 1 , GIFBUFTAM) ;
-		if( ibfmax < GIFBUFTAM ) buf[ ibfmax ] = 255 ;
-		// FW 06/02/98 <<<
+		size_t n = GIFBUFTAM;
+		pbuf = file->ReadPtr(&n); // no copy from CxMappedFile
+		if (pbuf){
+			ibfmax = (int)n;
+		} else {
+			pbuf = buf;
+			// FW 06/02/98 >>>
+			ibfmax = file->Read( buf , 1 , GIFBUFTAM) ;
+			if( ibfmax < GIFBUFTAM ) buf[ ibfmax ] = 255 ;
+			// FW 06/02/98 <<<
+		}
 		ibf = 0;
 	}
 	if (ibf>=ibfmax) return -1; //<DP> avoid overflows
-	return buf[ibf++];
+	return pbuf[ibf++];
 }
 ////////////////////////////////////////////////////////////////////////////////
 /*   - This function takes a full line of pixels (one BYTE per pixel) and
@@ -290,6 +303,25 @@ int CxImageGIF::get_byte(CxFile* file)
 */
 int CxImageGIF::out_line(CImageIterator* iter, unsigned char *pixels, int linelen)
 {
+	if (info.bTargetRows){
+		// LoadInto: one byte per pixel yet, whatever the bpp of the dib
+		long y = interlaced ? iypos : iheight-1-iter->GetY();
+		if (y < 0 || y >= iheight) return -1;
+		TargetRow(y, pixels, 8);
+		if (interlaced){
+			if ((iypos += istep) >= iheight) {
+				do {
+					if (ipass++ > 0) istep /= 2;
+					iypos = istep / 2;
+				}
+				while (iypos > iheight);
+			}
+		} else {
+			(void)iter->PrevRow();
+		}
+		return 0;
+	}
+
 	//<DP> for 1 & 4 bpp images, the pixels are compressed
 	if (head.biBitCount < 8){
 		for(long x=0;x<head.biWidth;x++){
@@ -855,9 +887,33 @@ short CxImageGIF::init_exp(short size)
 	slot = newcodes = (short)(ending + 1);
 	navail_bytes = nbits_left = 0;
 
-	memset(stack,0,MAX_CODES + 1);
-	memset(prefix,0,MAX_CODES + 1);
-	memset(suffix,0,MAX_CODES + 1);
+	memset(stack,0,sizeof(stack));
+	memset(prefix,0,sizeof(prefix));
+	memset(suffix,0,sizeof(suffix));
+	return(0);
+}
+////////////////////////////////////////////////////////////////////////////////
+/* get_block()
+ * - reads the next 'count' bytes of the GIF file into 'dest', in one piece
+ * where they are in the buffer already. Returns 0, or else a negative
+ * number in case of file errors...
+ */
+int CxImageGIF::get_block(CxFile* file, BYTE *dest, int count)
+{
+	int n, x;
+	while (count > 0){
+		if (ibf < ibfmax && ibf < GIFBUFTAM){
+			n = min(count, ibfmax - ibf);
+			memcpy(dest, pbuf + ibf, n);
+			ibf += n;
+		} else {
+			if ((x = get_byte(file)) < 0) return(x);
+			*dest = (BYTE)x;
+			n = 1;
+		}
+		dest += n;
+		count -= n;
+	}
 	return(0);
 }
 ////////////////////////////////////////////////////////////////////////////////
@@ -868,7 +924,7 @@ short CxImageGIF::init_exp(short size)
  */
 short CxImageGIF::get_next_code(CxFile* file)
 {
-	short i, x;
+	short x;
 	DWORD ret;
 
 	if (nbits_left == 0) {
@@ -878,10 +934,7 @@ short CxImageGIF::get_next_code(CxFile* file)
 			if ((navail_bytes = (short)get_byte(file)) < 0)
 				return(navail_bytes);
 			else if (navail_bytes) {
-				for (i = 0; i < navail_bytes; ++i) {
-					if ((x = (short)get_byte(file)) < 0) return(x);
-					byte_buff[i] = (BYTE)x;
-				}
+				if ((x = (short)get_block(file, byte_buff, navail_bytes)) < 0) return(x);
 			}
 		}
 		b1 = *pbytes++;
@@ -899,10 +952,7 @@ short CxImageGIF::get_next_code(CxFile* file)
 			if ((navail_bytes = (short)get_byte(file)) < 0)
 				return(navail_bytes);
 			else if (navail_bytes){
-				for (i = 0; i < navail_bytes; ++i){
-					if ((x = (short)get_byte(file)) < 0) return(x);
-					byte_buff[i] = (BYTE)x;
-				}
+				if ((x = (short)get_block(file, byte_buff, navail_bytes)) < 0) return(x);
 			}
 		}
 		b1 = *pbytes++;
@@ -916,6 +966,43 @@ short CxImageGIF::get_next_code(CxFile* file)
 }
 ////////////////////////////////////////////////////////////////////////////////
 
+/* GIF_NEXT_CODE(c)
+ * - the same as c = get_next_code(file), but it takes the bits from the
+ * local 'acc' while the current block lasts. get_next_code() is only
+ * called at the end of a block (and for the odd cases it deals with);
+ * before that, the bits that are left are given back to it: 'own' tells
+ * whether 'acc' or b1 and nbits_left hold them.
+ */
+#define GIF_NEXT_CODE(c) \
+	{ \
+		if (!own && navail_bytes >= 0 && nbits_left <= 8){ \
+			acc = nbits_left ? (DWORD)b1 >> (8 - nbits_left) : 0; \
+			nacc = nbits_left; \
+			own = true; \
+		} \
+		if (own && nacc < curr_size){ \
+			while (nacc <= 24 && navail_bytes > 0){ \
+				acc |= (DWORD)*pbytes++ << nacc; \
+				nacc += 8; \
+				--navail_bytes; \
+			} \
+		} \
+		if (own && nacc >= curr_size){ \
+			c = (short)(acc & code_mask[curr_size]); \
+			acc >>= curr_size; \
+			nacc -= curr_size; \
+		} else { \
+			if (own){ \
+				pbytes -= nacc >> 3; \
+				navail_bytes = (short)(navail_bytes + (nacc >> 3)); \
+				nbits_left = (short)(nacc & 7); \
+				if (nbits_left) b1 = pbytes[-1]; \
+				own = false; \
+			} \
+			c = get_next_code(file); \
+		} \
+	}
+
 /* short decoder(linewidth)
  *    short linewidth;               * Pixels per line of image *
  *
@@ -931,6 +1018,14 @@ short CxImageGIF::get_next_code(CxFile* file)
  * width of a line (as specified in the Image header) to make your own
  * code a bit simpler, but it isn't absolutely necessary.
  *
+ * The whole frame (linewidth * iheight pixels) is decoded into one run
+ * of memory, and the string of a code is copied from where it was
+ * decoded before (lzwpos[], lzwlen[]), rather than unwound backwards
+ * through the prefix list. The prefix and suffix tables are still kept:
+ * odd strings from bad codes are unwound through them as they always
+ * were, and so are the pixels of data that goes on past the frame. The
+ * pixels come out the same as with the plain Wilhite decoder.
+ *
  * Returns: 0 if successful, else negative.  (See ERRS.H)
  *
  */
@@ -940,48 +1035,122 @@ short CxImageGIF::get_next_code(CxFile* file)
  */
 short CxImageGIF::decoder(CxFile* file, CImageIterator* iter, short linewidth, int &bad_code_count)
 {
-	register BYTE *sp, *bufptr;
-	BYTE *buf;
-	register short code, fc, oc, bufcnt;
-	short c, size, ret;
+	BYTE *sp, *bufptr, *row, *src;
+	BYTE *buf, *base, *lin, *linend;
+	short code, fc, oc, c, size, ret;
+	int bufcnt, ncopy, last, oclen, i;
+	DWORD ocpos, pos;
+	DWORD acc = 0;
+	int nacc = 0;
+	bool own = false, bFlush = true, bClear, bExact;
+	BYTE first = 0;
 
 	/* Initialize for decoding a new image... */
 	bad_code_count = 0;
 	if ((size = (short)get_byte(file)) < 0)	return(size);
 	if (size < 2 || 9 < size)				return(BAD_CODE_SIZE);
+	if (linewidth <= 0)						return(0);
 	// out_line = outline;
 	init_exp(size);
 	//printf("L %d %x\n",linewidth,size);
 
 	/* Initialize in case they forgot to put in a clear code.
 	 * (This shouldn't happen, but we'll try and decode it anyway...)
+	 * oclen == 0 means that the string of oc isn't at ocpos.
 	 */
 	oc = fc = 0;
+	ocpos = 0;
+	oclen = 0;
 
    /* Allocate space for the decode buffer */
 	if ((buf = new BYTE[linewidth + 1]) == NULL) return(OUT_OF_MEMORY);
+	memset(buf, 0, linewidth + 1);
+
+	/* And for the whole frame, after the single pixel strings and with
+	 * room for 8 byte copies at the end. Without it, the pixels go through
+	 * 'buf' only.
+	 */
+	base = lin = linend = NULL;
+	if (iheight > 0) base = (BYTE*)malloc(clear + (DWORD)linewidth * iheight + 8);
+	if (base){
+		for (i = 0; i < clear; i++){
+			base[i] = (BYTE)i;
+			lzwpos[i] = i;
+			lzwlen[i] = 1;
+		}
+		lin = base + clear;
+		linend = lin + (DWORD)linewidth * iheight;
+	} else {
+		memset(lzwlen, 0, clear * sizeof(WORD));
+	}
+	lzwlen[clear] = lzwlen[ending] = 0;
 
    /* Set up the stack pointer and decode buffer pointer */
 	sp = stack;
-	bufptr = buf;
+	row = bufptr = lin ? lin : buf;
 	bufcnt = linewidth;
+	ret = 0;
 
-   /* This is the main loop.  For each code we get we pass through the
-	* linked list of prefix codes, pushing the corresponding "character" for
-	* each code onto the stack.  When the list reaches a single "character"
-	* we push that on the stack too, and then start unstacking each
-    * character for output in the correct order.  Special handling is
-	* included for the clear code, and the whole thing ends when we get
-    * an ending code.
+   /* This is the main loop.  For each code we get we find its string:
+	* copied from where it was decoded before, or, for the odd ones, by
+	* passing through the linked list of prefix codes, pushing the
+	* corresponding "character" for each code onto the stack.  Special
+	* handling is included for the clear code, and the whole thing ends
+	* when we get an ending code.
     */
-	while ((c = get_next_code(file)) != ending) {
+	for (;;) {
+		GIF_NEXT_CODE(c)
+
+		/* The usual case first: a string in the table, which goes into
+		* 'lin' right after the last one.
+		*/
+		if ((unsigned short)c < (unsigned short)slot && lzwlen[c] && row != buf
+			&& linend - bufptr >= lzwlen[c]){
+			src = base + lzwpos[c];
+			ncopy = lzwlen[c];
+			if (ncopy <= 8)
+				memmove(bufptr, src, 8);
+			else
+				memcpy(bufptr, src, ncopy);
+			if (slot < top_slot){
+				lzwpos[slot] = ocpos;
+				lzwlen[slot] = (WORD)(oclen ? oclen + 1 : 0);
+				suffix[slot] = (BYTE)(fc = *src);
+				prefix[slot++] = oc;
+				oc = c;
+				ocpos = (DWORD)(bufptr - base);
+				oclen = ncopy;
+				if (slot >= top_slot && curr_size < 12){
+					top_slot <<= 1;
+					++curr_size;
+				}
+			}
+			bufptr += ncopy;
+			if (bufptr - row >= linewidth){
+				while (bufptr - row >= linewidth){
+					memcpy(buf, row, linewidth);
+					if ((ret = (short)out_line(iter, buf, linewidth)) < 0) break;
+					row += linewidth;
+				}
+				if (ret < 0){
+					bFlush = false;
+					break;
+				}
+			}
+			continue;
+		}
+
+		if (c == ending) break;
 		/* If we had a file error, return without completing the decode*/
 		if (c < 0){
-			delete[] buf;
-			return(0);
+			bFlush = false;
+			break;
 		}
+		src = NULL;
+		ncopy = 0;
 		/* If the code is a clear code, reinitialize all necessary items.*/
-		if (c == clear){
+		bClear = c == clear;
+		if (bClear){
 			curr_size = (short)(size + 1);
 			slot = newcodes;
 			top_slot = (short)(1 << curr_size);
@@ -989,7 +1158,7 @@ short CxImageGIF::decoder(CxFile* file, CImageIterator* iter, short linewidth, i
 			/* Continue reading codes until we get a non-clear code
 			* (Another unlikely, but possible case...)
 			*/
-			while ((c = get_next_code(file)) == clear);
+			do GIF_NEXT_CODE(c) while (c == clear);
 
 			/* If we get an ending code immediately after a clear code
 			* (Yet another unlikely case), then break out of the loop.
@@ -1003,93 +1172,149 @@ short CxImageGIF::decoder(CxFile* file, CImageIterator* iter, short linewidth, i
 			*/
 			if (c >= slot) c = 0;
 			oc = fc = c;
-
-			/* And let us not forget to put the char into the buffer... And
-			* if, on the off chance, we were exactly one pixel from the end
-			* of the line, we have to send the buffer to the out_line()
-			* routine...
-			*/
-			*bufptr++ = (BYTE)c;
-			if (--bufcnt == 0) {
-				if ((ret = (short)out_line(iter, buf, linewidth)) < 0) {
-					delete[] buf;
-					return(ret);
-				}
-				bufptr = buf;
-				bufcnt = linewidth;
-            }
+			last = (BYTE)c;
 		} else {
 			/* In this case, it's not a clear code or an ending code, so
 			* it must be a code code...  So we can now decode the code into
-			* a stack of character codes. (Clear as mud, right?)
+			* a string of character codes. (Clear as mud, right?)
 			*/
 			code = c;
+			last = -1;
 
 			/* Here we go again with one of those off chances...  If, on the
 			* off chance, the code we got is beyond the range of those already
 			* set up (Another thing which had better NOT happen...) we trick
 			* the decoder into thinking it actually got the last code read.
 			* (Hmmn... I'm not sure why this works...  But it does...)
+			* That is the last string and its first pixel again.
 			*/
 			if (code >= slot) {
 				if (code > slot) ++bad_code_count;
 				code = oc;
-				*sp++ = (BYTE)fc;
-            }
+				last = (BYTE)fc;
+			}
 
-			/* Here we scan back along the linked list of prefixes, pushing
-			* helpless characters (ie. suffixes) onto the stack as we do so.
-			*/
-			while (code >= newcodes) {
-				*sp++ = suffix[code];
-				code = prefix[code];
-            }
-
-			/* Push the last character on the stack, and set up the new
-			* prefix and suffix, and if the required slot number is greater
-			* than that allowed by the current bit size, increase the bit
-			* size.  (NOTE - If we are all full, we *don't* save the new
-			* suffix and prefix...  I'm not certain if this is correct...
-			* it might be more proper to overwrite the last code...
+			if (last < 0 && lzwlen[code]){
+				src = base + lzwpos[code];
+				ncopy = lzwlen[code];
+			} else if (last >= 0 && oclen){
+				src = base + ocpos;
+				ncopy = oclen;
+			} else {
+				/* Here we scan back along the linked list of prefixes, pushing
+				* helpless characters (ie. suffixes) onto the stack as we do so.
+				* A list that is longer than the stack is bad data.
+				*/
+				if (last >= 0) *sp++ = (BYTE)last;
+				last = -1;
+				while (code >= newcodes && sp < stack + MAX_CODES) {
+					*sp++ = suffix[code];
+					code = prefix[code];
+				}
+				if (code >= newcodes){
+					bFlush = false;
+					break;
+				}
+				*sp++ = (BYTE)code;
+			}
+			first = src ? *src : sp[-1];
+		}
+
+		/* The string goes into 'lin' while there is room, else into 'buf'
+		* like before.
+		*/
+		if (row != buf && linend - bufptr < (sp - stack) + ncopy + (last >= 0)){
+			memcpy(buf, row, bufptr - row);
+			bufcnt = linewidth - (int)(bufptr - row);
+			bufptr = buf + (bufptr - row);
+			row = buf;
+			oclen = 0;
+		}
+		pos = row != buf ? (DWORD)(bufptr - base) : 0;
+
+		if (!bClear){
+			/* Set up the new prefix and suffix, and if the required slot
+			* number is greater than that allowed by the current bit size,
+			* increase the bit size.  (NOTE - If we are all full, we *don't*
+			* save the new suffix and prefix...  I'm not certain if this is
+			* correct... it might be more proper to overwrite the last code...
+			* The string of the new code is that of the last one and the
+			* first pixel of this one, at ocpos.  The string of this code is
+			* at pos, if it holds still.
 			*/
-			*sp++ = (BYTE)code;
 			if (slot < top_slot){
-				suffix[slot] = (BYTE)(fc = (BYTE)code);
+				lzwpos[slot] = ocpos;
+				lzwlen[slot] = (WORD)(oclen ? oclen + 1 : 0);
+				if (c >= slot)
+					bExact = c == slot && lzwlen[slot] && fc == first;
+				else
+					bExact = src && last < 0;
+				suffix[slot] = (BYTE)(fc = first);
 				prefix[slot++] = oc;
 				oc = c;
-            }
+				ocpos = pos;
+				oclen = 0;
+				if (bExact && row != buf)
+					oclen = (int)(sp - stack) + ncopy + (last >= 0);
+			}
 			if (slot >= top_slot){
 				if (curr_size < 12) {
 					top_slot <<= 1;
 					++curr_size;
 				}
 			}
+		} else {
+			/* the first pixel after a clear code */
+			ocpos = pos;
+			oclen = row != buf && c >= 0 && base ? 1 : 0;
+		}
 
-			/* Now that we've pushed the decoded string (in reverse order)
-			* onto the stack, lets pop it off and put it into our decode
-			* buffer...  And when the decode buffer is full, write another
-			* line...
-			*/
+		/* Now lets put the string into our decode buffer...  And when the
+		* decode buffer is full, write another line...
+		*/
+		if (row != buf){
+			if (ncopy > 8)
+				memcpy(bufptr, src, ncopy);
+			else if (ncopy)
+				memmove(bufptr, src, 8);
+			bufptr += ncopy;
+			if (last >= 0) *bufptr++ = (BYTE)last;
+			while (sp > stack) *bufptr++ = *(--sp);
+			while (bufptr - row >= linewidth){
+				memcpy(buf, row, linewidth);
+				if ((ret = (short)out_line(iter, buf, linewidth)) < 0) break;
+				row += linewidth;
+			}
+		} else {
+			if (sp == stack){
+				if (last >= 0) *sp++ = (BYTE)last;
+				while (ncopy > 0) *sp++ = src[--ncopy];
+			}
 			while (sp > stack) {
 				*bufptr++ = *(--sp);
 				if (--bufcnt == 0) {
-					if ((ret = (short)out_line(iter, buf, linewidth)) < 0) {
-						delete[] buf;
-						return(ret);
-					}
+					if ((ret = (short)out_line(iter, buf, linewidth)) < 0) break;
 					bufptr = buf;
 					bufcnt = linewidth;
 				}
 			}
 		}
+		if (ret < 0){
+			bFlush = false;
+			break;
+		}
 	}
-	ret = 0;
-	if (bufcnt != linewidth)
+	if (row != buf) bufcnt = linewidth - (int)(bufptr - row);
+	if (bFlush && bufcnt != linewidth){
+		if (row != buf) memcpy(buf, row, linewidth - bufcnt);
 		ret = (short)out_line(iter, buf, (linewidth - bufcnt));
+	}
+	free(base);
 	delete[] buf;
 	return(ret);
 }
-////////////////////////////////////////////////////////////////////////////////
+#undef GIF_NEXT_CODE
+////////////////
 int CxImageGIF::get_num_frames(CxFile *fp,struct_TabCol* TabColSrc)
 {
 	struct_image image;
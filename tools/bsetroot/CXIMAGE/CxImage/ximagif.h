@@ -177,6 +177,7 @@ protected:
 	int ibf;
 	int ibfmax;
 	BYTE buf[GIFBUFTAM + 1];
+	BYTE *pbuf;	// buf, or the data of a file held in memory
 // Implementation
 	int GifNextPixel ();
 	void Putword (int w, CxFile* fp );
@@ -190,6 +191,7 @@ protected:
 	short get_next_code(CxFile*);
 	short decoder(CxFile*, CImageIterator* iter, short linewidth, int &bad_code_count);
 	int get_byte(CxFile*);
+	int get_block(CxFile*, BYTE *dest, int count);
 	int out_line(CImageIterator* iter, unsigned char *pixels, int linelen);
 	int get_num_frames(CxFile *f,struct_TabCol* TabColSrc);
 
@@ -217,6 +219,12 @@ protected:
 	BYTE stack[MAX_CODES + 1];            /* Stack for storing pixels */
 	BYTE suffix[MAX_CODES + 1];           /* Suffix table */
 	WORD prefix[MAX_CODES + 1];           /* Prefix linked list */
+	/* Where the string of a code can be copied from in the decoded frame,
+	* and how long it is. A length of 0 means it has to be unwound through
+	* prefix[] and suffix[] instead.
+	*/
+	DWORD lzwpos[MAX_CODES + 1];
+	WORD lzwlen[MAX_CODES + 1];
 
 //LZW GIF Image compression routines
 	long htab [HSIZE];
@@ -70,6 +70,8 @@ bool CxImageJPG::Decode(CxFile * hFile)
 	}
 	/* Now we can initialize the JPEG decompression object. */
 	jpeg_create_decompress(&cinfo);
+	// the coefficients of progressive images may go to a temp file
+	if (info.nJpegMaxMemory > 0) cinfo.mem->max_memory_to_use = info.nJpegMaxMemory;
 
 	/* Step 2: specify data source (eg, a file) */
 	//jpeg_stdio_src(&cinfo, infile);
@@ -87,6 +89,24 @@ bool CxImageJPG::Decode(CxFile * hFile)
  *}
  */ //</DP>
 
+	// let the idct do the downscaling, as far as the result stays
+	// at least as large as asked for. The used scale is reported back.
+	if (info.nJpegScale > 1){
+		unsigned d = 8;
+		while (d > 1 && (d > info.nJpegScale
+			|| (long)((cinfo.image_width + d - 1) / d) < info.nJpegMinWidth
+			|| (long)((cinfo.image_height + d - 1) / d) < info.nJpegMinHeight))
+			d >>= 1;
+		cinfo.scale_num = 1;
+		cinfo.scale_denom = d;
+		info.nJpegScale = (BYTE)d;
+	}
+
+	// true color: have the library write the dib's BGR order, or the
+	// BGRX of LoadInto, straight into the rows. No copy, no swap pass.
+	if (cinfo.out_color_space==JCS_RGB && cinfo.num_components==3)
+		cinfo.out_color_space = info.pfnTarget ? JCS_EXT_BGRX : JCS_EXT_BGR;
+
 	/* Step 5: Start decompressor */
 	jpeg_start_decompress(&cinfo);
 
@@ -95,7 +115,9 @@ bool CxImageJPG::Decode(CxFile * hFile)
 	* output image dimensions available, as well as the output colormap
 	* if we asked for color quantization.
 	*/
-	Create(cinfo.image_width, cinfo.image_height, 8*cinfo.num_components, CXIMAGE_FORMAT_JPG);
+	info.bTargetRows = info.pfnTarget != NULL && cinfo.quantize_colors == FALSE;
+	if (!Create(cinfo.output_width, cinfo.output_height, 8*cinfo.num_components, CXIMAGE_FORMAT_JPG))
+		longjmp(jerr.setjmp_buffer, 1);
 
 	if (cinfo.density_unit==2){
 		SetXDPI((254*cinfo.X_density)/100);
@@ -134,8 +156,44 @@ bool CxImageJPG::Decode(CxFile * hFile)
 
 		if (info.nEscape) longjmp(jerr.setjmp_buffer, 1); // <vho> - cancel decoding
 		
+		if (cinfo.out_color_space==JCS_EXT_BGRX){
+			JSAMPROW row=TargetLine(cinfo.output_scanline);
+			(void) jpeg_read_scanlines(&cinfo, &row, 1);
+			continue;
+		}
+		if (cinfo.out_color_space==JCS_EXT_BGR){
+			JSAMPROW row=iter.GetRow();
+			(void) jpeg_read_scanlines(&cinfo, &row, 1);
+			iter.PrevRow();
+			continue;
+		}
 		(void) jpeg_read_scanlines(&cinfo, buffer, 1);
 		// info.nProgress = (long)(100*cinfo.output_scanline/cinfo.output_height);
+		if (info.bTargetRows){
+			// LoadInto: straight to BGRX, no dib and no swap pass
+			BYTE k,*dst,*src;
+			dst=TargetLine(cinfo.output_scanline-1);
+			src=buffer[0];
+			long x, w=cinfo.output_width;
+			if (cinfo.num_components==3){
+				for(x=0; x<w; x++, src+=3, dst+=4){
+					dst[0]=src[2]; dst[1]=src[1]; dst[2]=src[0]; dst[3]=0;
+				}
+			} else if (cinfo.num_components==4){
+				for(x=0; x<w; x++, src+=4, dst+=4){
+					k=src[3];
+					dst[0]=(BYTE)((k * src[2])/255);
+					dst[1]=(BYTE)((k * src[1])/255);
+					dst[2]=(BYTE)((k * src[0])/255);
+					dst[3]=0;
+				}
+			} else {
+				for(x=0; x<w; x++, src++, dst+=4){
+					dst[0]=dst[1]=dst[2]=src[0]; dst[3]=0;
+				}
+			}
+			continue;
+		}
 		//<DP> Step 6a: CMYK->RGB */ 
 		if ((cinfo.num_components==4)&&(cinfo.quantize_colors==FALSE)){
 			BYTE k,*dst,*src;
@@ -161,7 +219,8 @@ bool CxImageJPG::Decode(CxFile * hFile)
 	*/
 
 	//<DP> Step 7A: Swap red and blue components */ 
-	if ((cinfo.num_components==3)&&(cinfo.quantize_colors==FALSE)){
+	if ((cinfo.num_components==3)&&(cinfo.quantize_colors==FALSE)&&!info.bTargetRows
+		&&(cinfo.out_color_space!=JCS_EXT_BGR)){
 		BYTE *r,*b,t,*r0;
 		long x,y;
 		r0=GetBits();
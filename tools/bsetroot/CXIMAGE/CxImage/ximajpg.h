@@ -199,6 +199,14 @@ public:
 	{
 		size_t nbytes;
 		CxFileJpg* pSource = (CxFileJpg*)cinfo->src;
+		// files in memory: all the rest at once, without a copy
+		nbytes = (size_t)-1;
+		pSource->next_input_byte = pSource->m_pFile->ReadPtr(&nbytes);
+		if (pSource->next_input_byte){
+			pSource->bytes_in_buffer = nbytes;
+			pSource->m_bStartOfFile = FALSE;
+			return TRUE;
+		}
 		nbytes = pSource->m_pFile->Read(pSource->m_pBuffer,1,eBufSize);
 		if (nbytes <= 0){
 			if (pSource->m_bStartOfFile)	//* Treat empty input file as fatal error 
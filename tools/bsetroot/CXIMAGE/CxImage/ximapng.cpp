@@ -10,6 +10,7 @@
 #if CXIMAGE_SUPPORT_PNG
 
 #include "ximaiter.h"
+#include "../zlib/pdeflate.h"
 
 ////////////////////////////////////////////////////////////////////////////////
 void CxImagePNG::ima_png_error(png_struct *png_ptr, char *message)
@@ -111,7 +112,10 @@ bool CxImagePNG::Decode(CxFile *hFile)
 	if (pixel_depth >  16 ) pixel_depth=24;
 	if (pixel_depth == 16 ) pixel_depth=8;
 
-	Create(info_ptr->width, info_ptr->height, pixel_depth, CXIMAGE_FORMAT_PNG);
+	// LoadInto: without interlacing, the rows can go straight to the target
+	info.bTargetRows = info.pfnTarget != NULL && info_ptr->interlace_type == 0;
+	if (!Create(info_ptr->width, info_ptr->height, pixel_depth, CXIMAGE_FORMAT_PNG))
+		longjmp(png_ptr->jmpbuf, 1);
 
 	if (info_ptr->num_palette>0)
 	  SetPalette((rgb_color*)info_ptr->palette,info_ptr->num_palette);
@@ -195,7 +199,10 @@ bool CxImagePNG::Decode(CxFile *hFile)
 				if (info_ptr->bit_depth==2 && pass==(number_passes-1))
 					expand2to4bpp(row_pointers);
 				//copy the pixels
-				iter.SetRow(row_pointers, info.dwEffWidth);
+				if (info.bTargetRows)
+					TargetRow(y, row_pointers);
+				else
+					iter.SetRow(row_pointers, info.dwEffWidth);
 				//go on
 				iter.PrevRow();
 			}
@@ -244,6 +251,101 @@ bool CxImagePNG::Decode(CxFile *hFile)
 	return TRUE;
 }
 ////////////////////////////////////////////////////////////////////////////////
+// The parallel save path: libpng writes the chunks, the rows are filtered
+// here as png_write_find_filter does it and then deflated all at once on
+// several threads by pdeflate().
+struct png_zrows {
+	BYTE *buf;		//filter type + filtered row, for all rows
+	BYTE *prev;		//the previous row, unfiltered
+	long rowbytes;
+	long bpp;		//bytes per pixel, at least 1
+	long rows;
+	bool filter;	//otherwise all rows get filter type 0
+};
+////////////////////////////////////////////////////////////////////////////////
+// residuals of one filter type into dst, returns the sum of their absolute
+// values, or something above 'mins' as soon as it gets larger than that
+#define PNG_ZSUM(p) v = dst[i] = (BYTE)(row[i] - (p)), sum += v < 128 ? v : 256 - v
+static DWORD png_zfilter(BYTE *dst, const BYTE *row, const BYTE *prev, long n, long bpp, int type, DWORD mins)
+{
+	DWORD sum = 0;
+	long i = 0;
+	int v, a, b, c, pa, pb, pc;
+	switch (type){
+	case 0:
+		for (; i < n && sum <= mins; i++) PNG_ZSUM(0);
+		break;
+	case 1:
+		for (; i < bpp && i < n; i++) PNG_ZSUM(0);
+		for (; i < n && sum <= mins; i++) PNG_ZSUM(row[i-bpp]);
+		break;
+	case 2:
+		for (; i < n && sum <= mins; i++) PNG_ZSUM(prev[i]);
+		break;
+	case 3:
+		for (; i < bpp && i < n; i++) PNG_ZSUM(prev[i] >> 1);
+		for (; i < n && sum <= mins; i++) PNG_ZSUM((row[i-bpp] + prev[i]) >> 1);
+		break;
+	case 4:
+		for (; i < bpp && i < n; i++) PNG_ZSUM(prev[i]);
+		for (; i < n && sum <= mins; i++){
+			a = row[i-bpp], b = prev[i], c = prev[i-bpp];
+			pa = abs(b - c), pb = abs(a - c), pc = abs(a + b - c - c);
+			PNG_ZSUM((pa <= pb && pa <= pc) ? a : (pb <= pc) ? b : c);
+		}
+		break;
+	}
+	return sum;
+}
+////////////////////////////////////////////////////////////////////////////////
+static void png_zrow(png_zrows *z, const BYTE *row)
+{
+	BYTE *dst = z->buf + z->rows++ * (z->rowbytes + 1);
+	int best = 0;
+	if (z->filter){
+		// the filter with the least sum, the first of equal ones
+		DWORD sum, mins = (DWORD)~0 >> 1;
+		for (int t = 0; t < 5; t++){
+			sum = png_zfilter(dst + 1, row, z->prev, z->rowbytes, z->bpp, t, mins);
+			if (sum < mins) mins = sum, best = t;
+		}
+	}
+	dst[0] = (BYTE)best;
+	if (best != 4) // otherwise still there from the last try
+		png_zfilter(dst + 1, row, z->prev, z->rowbytes, z->bpp, best, (DWORD)~0);
+	memcpy(z->prev, row, z->rowbytes);
+}
+////////////////////////////////////////////////////////////////////////////////
+// set up after png_write_info, returns false to write the rows with libpng
+static bool png_zbegin(png_zrows *z, png_struct *png_ptr, long threads)
+{
+	if (threads == 1) return false;
+	z->rowbytes = png_ptr->rowbytes;
+	z->bpp = (png_ptr->pixel_depth + 7) >> 3;
+	z->filter = png_ptr->do_filter != PNG_FILTER_NONE;
+	z->buf = (BYTE*)malloc((z->rowbytes + 1) * png_ptr->height);
+	z->prev = (BYTE*)calloc(z->rowbytes, 1);
+	if (z->buf && z->prev) return true;
+	free(z->buf); free(z->prev);
+	z->buf = z->prev = NULL;
+	return false;
+}
+////////////////////////////////////////////////////////////////////////////////
+static void png_zend(png_zrows *z, png_struct *png_ptr, long threads)
+{
+	Bytef *data;
+	uLongf len;
+	int err = pdeflate(&data, &len, z->buf, z->rows * (z->rowbytes + 1),
+		png_ptr->zlib_level, png_ptr->zlib_strategy, threads);
+	free(z->buf); free(z->prev);
+	z->prev = NULL;
+	z->buf = data;	//freed by the error handler if the write fails
+	if (err != Z_OK) png_error(png_ptr, "zlib error");
+	png_write_compressed_image(png_ptr, data, len);
+	free(data);
+	z->buf = NULL;
+}
+////////////////////////////////////////////////////////////////////////////////
 bool CxImagePNG::Encode(CxFile *hFile)
 {
 	if (hFile==NULL) return false;
@@ -252,6 +354,8 @@ bool CxImagePNG::Encode(CxFile *hFile)
 	BYTE trans[256];	//for transparency (don't move)
 	png_struct *png_ptr;
 	png_info *info_ptr;
+	png_zrows zrows;
+	memset(&zrows,0,sizeof(zrows));
 
   try{
    /* Create and initialize the png_struct with the desired error handler
@@ -276,6 +380,7 @@ bool CxImagePNG::Encode(CxFile *hFile)
 	if (setjmp(png_ptr->jmpbuf)){
 		/* If we get here, we had a problem reading the file */
 		if (info_ptr->palette) free(info_ptr->palette);
+		free(zrows.buf); free(zrows.prev);
 		png_destroy_write_struct(&png_ptr,  (png_infopp)&info_ptr);
 		throw "Error saving PNG file";
 	}
@@ -287,6 +392,8 @@ bool CxImagePNG::Encode(CxFile *hFile)
 	// use custom I/O functions
     png_set_write_fn(png_ptr,hFile,(png_rw_ptr)user_write_data,(png_flush_ptr)user_flush_data);
 
+	if (info.nPngLevel >= 0) png_set_compression_level(png_ptr, info.nPngLevel);
+
 	/* set the file information here */
 	info_ptr->width = GetWidth();
 	info_ptr->height = GetHeight();
@@ -367,6 +474,7 @@ bool CxImagePNG::Encode(CxFile *hFile)
 
 		/* write the file information */
 		png_write_info(png_ptr, info_ptr);
+		bool bParallel = png_zbegin(&zrows, png_ptr, info.nPngThreads);
 		
 		//<Ranger> "10+row_stride" fix heap deallocation problem during debug???
 		BYTE *row_pointers = new BYTE[10+row_stride];
@@ -382,17 +490,20 @@ bool CxImagePNG::Encode(CxFile *hFile)
 				row_pointers[ax*4+1]=c.rgbGreen;
 				row_pointers[ax*4]=c.rgbRed;
 			}
-			png_write_row(png_ptr, row_pointers);
+			if (bParallel) png_zrow(&zrows, row_pointers);
+			else png_write_row(png_ptr, row_pointers);
 			ay--;
 		} while(iter.PrevRow());
 		
 		delete [] row_pointers;
+		if (bParallel) png_zend(&zrows, png_ptr, info.nPngThreads);
 	}
 	else
 #endif //CXIMAGE_SUPPORT_ALPHA	// <vho>
 	{
 		/* write the file information */
 		png_write_info(png_ptr, info_ptr);
+		bool bParallel = png_zbegin(&zrows, png_ptr, info.nPngThreads);
 		/* If you are only writing one row at a time, this works */
 		BYTE *row_pointers = new BYTE[10+row_stride];
   		iter.Upset();
@@ -401,10 +512,12 @@ bool CxImagePNG::Encode(CxFile *hFile)
 			//HACK BY OP
 			if (info_ptr->color_type == 2 /*COLORTYPE_COLOR*/)
 				RGBtoBGR(row_pointers, row_stride);
-			png_write_row(png_ptr, row_pointers);
+			if (bParallel) png_zrow(&zrows, row_pointers);
+			else png_write_row(png_ptr, row_pointers);
 		} while(iter.PrevRow());
 		
 		delete [] row_pointers;
+		if (bParallel) png_zend(&zrows, png_ptr, info.nPngThreads);
 	}
 
 #if CXIMAGE_SUPPORT_ALPHA	// <vho>
@@ -0,0 +1,108 @@
+#include "xmapfile.h"
+
+#ifndef WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#endif
+
+//////////////////////////////////////////////////////////
+bool CxMappedFile::Open(const char *filename)
+{
+	if (m_pBuffer) return false;	// Can't re-open without closing first
+
+	m_Position = m_Size = m_Edge = 0;
+	m_bFreeOnClose = false;
+
+#ifdef WIN32
+	HANDLE hFile = CreateFileA(filename, GENERIC_READ, FILE_SHARE_READ, NULL,
+		OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (hFile == INVALID_HANDLE_VALUE) return false;
+	DWORD size = GetFileSize(hFile, NULL);
+	if (size != 0 && size != INVALID_FILE_SIZE){
+		m_hMap = CreateFileMapping(hFile, NULL, PAGE_READONLY, 0, 0, NULL);
+		if (m_hMap){
+			m_pBuffer = (BYTE*)MapViewOfFile(m_hMap, FILE_MAP_READ, 0, 0, 0);
+			if (m_pBuffer == NULL){
+				CloseHandle(m_hMap);
+				m_hMap = NULL;
+			}
+		}
+	}
+	if (m_pBuffer){
+		m_bMapped = true;
+	} else if (size != INVALID_FILE_SIZE){
+		// no mapping (empty file, or network drive...): read it in
+		DWORD nRead = 0;
+		m_pBuffer = (BYTE*)malloc(size + 1);
+		if (m_pBuffer && !ReadFile(hFile, m_pBuffer, size, &nRead, NULL))
+			nRead = 0;
+		size = nRead;
+		m_bFreeOnClose = true;
+	}
+	CloseHandle(hFile);
+#else
+	int fd = open(filename, O_RDONLY);
+	if (fd < 0) return false;
+	struct stat st;
+	DWORD size = 0;
+	if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size == (DWORD)st.st_size){
+		size = (DWORD)st.st_size;
+		if (size){
+			void *p = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+			if (p != MAP_FAILED){
+#ifdef MADV_SEQUENTIAL
+				madvise(p, size, MADV_SEQUENTIAL);
+#endif
+				m_pBuffer = (BYTE*)p;
+				m_bMapped = true;
+			}
+		}
+	}
+	if (m_pBuffer == NULL){
+		// no mapping (empty file, pipe...): read it in
+		DWORD nEdge = size ? size : 65536;
+		m_pBuffer = (BYTE*)malloc(nEdge);
+		m_bFreeOnClose = true;
+		size = 0;
+		while (m_pBuffer){
+			ssize_t n = read(fd, m_pBuffer + size, nEdge - size);
+			if (n <= 0) break;
+			size += (DWORD)n;
+			if (size == nEdge){
+				nEdge *= 2;
+				BYTE *pNew = (BYTE*)realloc(m_pBuffer, nEdge);
+				if (pNew == NULL) break;
+				m_pBuffer = pNew;
+			}
+		}
+	}
+	close(fd);
+#endif
+
+	if (m_pBuffer == NULL) return false;
+	m_Size = size;
+	m_Edge = size;
+	return true;
+}
+//////////////////////////////////////////////////////////
+bool CxMappedFile::Close()
+{
+	if (m_pBuffer && m_bMapped){
+#ifdef WIN32
+		UnmapViewOfFile(m_pBuffer);
+		CloseHandle(m_hMap);
+		m_hMap = NULL;
+#else
+		munmap(m_pBuffer, m_Size);
+#endif
+		m_pBuffer = NULL;
+		m_bMapped = false;
+	}
+	CxMemFile::Close();
+	m_pBuffer = NULL;
+	m_Position = m_Size = m_Edge = 0;
+	return true;
+}
+//////////////////////////////////////////////////////////
@@ -0,0 +1,46 @@
+#if !defined(__xmapfile_h)
+#define __xmapfile_h
+
+#include "xmemfile.h"
+
+//////////////////////////////////////////////////////////
+// Read only file that is served from memory: the file is mapped
+// (or, where that fails, read in whole) on Open, after that Read,
+// GetC and Seek are plain memory operations, and ReadPtr gives the
+// data without a copy. Used by CxImage::Load for local files.
+class DLL_EXP CxMappedFile : public CxMemFile
+	{
+public:
+	CxMappedFile()
+	{
+		m_bMapped = false;
+#ifdef WIN32
+		m_hMap = NULL;
+#endif
+	}
+//////////////////////////////////////////////////////////
+	~CxMappedFile()
+	{
+		Close();
+	}
+//////////////////////////////////////////////////////////
+	bool Open(const char *filename);
+	virtual bool Close();
+	bool	IsMapped() { return m_bMapped; }
+//////////////////////////////////////////////////////////
+	virtual size_t	Write(const void *buffer, size_t size, size_t count) { return 0; }
+	virtual bool	PutC(unsigned char c) { return false; }
+	virtual long	GetC()
+	{
+		if (m_Position >= (long)m_Size) return EOF;
+		return m_pBuffer[m_Position++];
+	}
+
+protected:
+	bool	m_bMapped;
+#ifdef WIN32
+	HANDLE	m_hMap;
+#endif
+	};
+
+#endif
@@ -107,6 +107,18 @@ long CxMemFile::GetC()
 	return *(BYTE*)((BYTE*)m_pBuffer + m_Position++);
 }
 //////////////////////////////////////////////////////////
+BYTE* CxMemFile::ReadPtr(size_t *size)
+{
+	if (m_pBuffer==NULL || m_Position >= (long)m_Size) return NULL;
+
+	size_t nLeft = m_Size - m_Position;
+	if (*size > nLeft) *size = nLeft;
+
+	BYTE* p = m_pBuffer + m_Position;
+	m_Position += *size;
+	return p;
+}
+//////////////////////////////////////////////////////////
 void CxMemFile::Alloc(DWORD dwNewLen)
 {
 	if (dwNewLen > (DWORD)m_Edge)
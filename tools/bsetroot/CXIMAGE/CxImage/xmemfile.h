@@ -53,6 +53,7 @@ public:
 	virtual long	Error();
 	virtual bool	PutC(unsigned char c);
 	virtual long	GetC();
+	virtual BYTE*	ReadPtr(size_t *size);
 
 protected:
 	void	Alloc(DWORD nBytes);
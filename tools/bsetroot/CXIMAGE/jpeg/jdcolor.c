@@ -157,6 +157,55 @@ ycc_rgb_convert (j_decompress_ptr cinfo,
 }
 
 
+/*
+ * YCbCr -> BGR or BGRX (JCS_EXT_BGR, JCS_EXT_BGRX): the same as above,
+ * for applications that keep their pixels in Windows DIB order.  The
+ * X byte of BGRX is set to 0.
+ */
+
+METHODDEF(void)
+ycc_bgr_convert (j_decompress_ptr cinfo,
+		 JSAMPIMAGE input_buf, JDIMENSION input_row,
+		 JSAMPARRAY output_buf, int num_rows)
+{
+  my_cconvert_ptr cconvert = (my_cconvert_ptr) cinfo->cconvert;
+  register int y, cb, cr;
+  register JSAMPROW outptr;
+  register JSAMPROW inptr0, inptr1, inptr2;
+  register JDIMENSION col;
+  JDIMENSION num_cols = cinfo->output_width;
+  int pixelsize = cinfo->out_color_components;
+  /* copy these pointers into registers if possible */
+  register JSAMPLE * range_limit = cinfo->sample_range_limit;
+  register int * Crrtab = cconvert->Cr_r_tab;
+  register int * Cbbtab = cconvert->Cb_b_tab;
+  register INT32 * Crgtab = cconvert->Cr_g_tab;
+  register INT32 * Cbgtab = cconvert->Cb_g_tab;
+  SHIFT_TEMPS
+
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = *output_buf++;
+    for (col = 0; col < num_cols; col++) {
+      y  = GETJSAMPLE(inptr0[col]);
+      cb = GETJSAMPLE(inptr1[col]);
+      cr = GETJSAMPLE(inptr2[col]);
+      outptr[2] = range_limit[y + Crrtab[cr]];
+      outptr[1] = range_limit[y +
+			      ((int) RIGHT_SHIFT(Cbgtab[cb] + Crgtab[cr],
+						 SCALEBITS))];
+      outptr[0] = range_limit[y + Cbbtab[cb]];
+      if (pixelsize == 4)
+	outptr[3] = 0;
+      outptr += pixelsize;
+    }
+  }
+}
+
+
 /**************** Cases other than YCbCr -> RGB **************/
 
 
@@ -191,6 +240,38 @@ null_convert (j_decompress_ptr cinfo,
 }
 
 
+/*
+ * RGB -> BGR or BGRX: swap red and blue while interleaving.
+ */
+
+METHODDEF(void)
+rgb_bgr_convert (j_decompress_ptr cinfo,
+		 JSAMPIMAGE input_buf, JDIMENSION input_row,
+		 JSAMPARRAY output_buf, int num_rows)
+{
+  register JSAMPROW inptr0, inptr1, inptr2, outptr;
+  register JDIMENSION col;
+  JDIMENSION num_cols = cinfo->output_width;
+  int pixelsize = cinfo->out_color_components;
+
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = *output_buf++;
+    for (col = 0; col < num_cols; col++) {
+      outptr[0] = inptr2[col];	/* needn't bother with GETJSAMPLE() here */
+      outptr[1] = inptr1[col];
+      outptr[2] = inptr0[col];
+      if (pixelsize == 4)
+	outptr[3] = 0;
+      outptr += pixelsize;
+    }
+  }
+}
+
+
 /*
  * Color conversion for grayscale: just copy the data.
  * This also works for YCbCr -> grayscale conversion, in which
@@ -360,6 +441,10 @@ jinit_color_deconverter (j_decompress_ptr cinfo)
     if (cinfo->jpeg_color_space == JCS_YCbCr) {
       cconvert->pub.color_convert = ycc_rgb_convert;
       build_ycc_rgb_table(cinfo);
+#ifdef JPEG_SIMD_SUPPORTED
+      if (jsimd_can_ycc_rgb(cinfo))
+	cconvert->pub.color_convert = jsimd_ycc_rgb_convert;
+#endif
     } else if (cinfo->jpeg_color_space == JCS_GRAYSCALE) {
       cconvert->pub.color_convert = gray_rgb_convert;
     } else if (cinfo->jpeg_color_space == JCS_RGB && RGB_PIXELSIZE == 3) {
@@ -368,6 +453,23 @@ jinit_color_deconverter (j_decompress_ptr cinfo)
       ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
     break;
 
+  case JCS_EXT_BGR:
+  case JCS_EXT_BGRX:
+    cinfo->out_color_components =
+      cinfo->out_color_space == JCS_EXT_BGR ? 3 : 4;
+    if (cinfo->jpeg_color_space == JCS_YCbCr) {
+      cconvert->pub.color_convert = ycc_bgr_convert;
+      build_ycc_rgb_table(cinfo);
+#ifdef JPEG_SIMD_SUPPORTED
+      if (jsimd_can_ycc_rgb(cinfo))
+	cconvert->pub.color_convert = jsimd_ycc_rgb_convert;
+#endif
+    } else if (cinfo->jpeg_color_space == JCS_RGB) {
+      cconvert->pub.color_convert = rgb_bgr_convert;
+    } else
+      ERREXIT(cinfo, JERR_CONVERSION_NOTIMPL);
+    break;
+
   case JCS_CMYK:
     cinfo->out_color_components = 4;
     if (cinfo->jpeg_color_space == JCS_YCCK) {
@@ -231,21 +231,29 @@ jpeg_make_d_derived_tbl (j_decompress_ptr cinfo, boolean isDC, int tblno,
    * First we set all the table entries to 0, indicating "too long";
    * then we iterate through the Huffman codes that are short enough and
    * fill in all the entries that correspond to bit sequences starting
-   * with that code.
+   * with that code.  Where the magnitude bits that follow the code fit
+   * in the lookahead as well, the entry also gets the value they encode
+   * (Figure F.12, same as HUFF_EXTEND).
    */
 
-  MEMZERO(dtbl->look_nbits, SIZEOF(dtbl->look_nbits));
+  MEMZERO(dtbl->lookup, SIZEOF(dtbl->lookup));
 
   p = 0;
   for (l = 1; l <= HUFF_LOOKAHEAD; l++) {
     for (i = 1; i <= (int) htbl->bits[l]; i++, p++) {
       /* l = current code's length, p = its index in huffcode[] & huffval[]. */
+      int sym = htbl->huffval[p];
+      int s = sym & 15;		/* # of magnitude bits after the code */
       /* Generate left-justified code followed by all possible bit sequences */
       lookbits = huffcode[p] << (HUFF_LOOKAHEAD-l);
-      for (ctr = 1 << (HUFF_LOOKAHEAD-l); ctr > 0; ctr--) {
-	dtbl->look_nbits[lookbits] = l;
-	dtbl->look_sym[lookbits] = htbl->huffval[p];
-	lookbits++;
+      for (ctr = 0; ctr < (1 << (HUFF_LOOKAHEAD-l)); ctr++) {
+	INT32 entry = (INT32) l | ((INT32) sym << 8);
+	if (s != 0 && l + s <= HUFF_LOOKAHEAD) {
+	  int bits = (ctr >> (HUFF_LOOKAHEAD-l-s)) & ((1 << s) - 1);
+	  int value = bits < (1 << (s-1)) ? bits - (1 << s) + 1 : bits;
+	  entry |= (INT32) (value + LOOK_VALUE_BIAS) << 16;
+	}
+	dtbl->lookup[lookbits + ctr] = entry;
       }
     }
   }
@@ -513,111 +521,287 @@ process_restart (j_decompress_ptr cinfo)
  * this module, since we'll just re-assign them on the next call.)
  */
 
-METHODDEF(boolean)
-decode_mcu (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
+LOCAL(boolean)
+decode_mcu_slow (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
 {
   huff_entropy_ptr entropy = (huff_entropy_ptr) cinfo->entropy;
   int blkn;
   BITREAD_STATE_VARS;
   savable_state state;
 
-  /* Process restart marker if needed; may have to suspend */
-  if (cinfo->restart_interval) {
-    if (entropy->restarts_to_go == 0)
-      if (! process_restart(cinfo))
-	return FALSE;
-  }
+  /* Load up working state */
+  BITREAD_LOAD_STATE(cinfo,entropy->bitstate);
+  ASSIGN_STATE(state, entropy->saved);
 
-  /* If we've run out of data, just leave the MCU set to zeroes.
-   * This way, we return uniform gray for the remainder of the segment.
-   */
-  if (! entropy->pub.insufficient_data) {
+  /* Outer loop handles each block in the MCU */
 
-    /* Load up working state */
-    BITREAD_LOAD_STATE(cinfo,entropy->bitstate);
-    ASSIGN_STATE(state, entropy->saved);
+  for (blkn = 0; blkn < cinfo->blocks_in_MCU; blkn++) {
+    JBLOCKROW block = MCU_data[blkn];
+    d_derived_tbl * dctbl = entropy->dc_cur_tbls[blkn];
+    d_derived_tbl * actbl = entropy->ac_cur_tbls[blkn];
+    register int s, k, r, v;
+
+    /* Decode a single block's worth of coefficients */
+
+    /* Section F.2.2.1: decode the DC coefficient difference */
+    v = 0;
+    HUFF_DECODE_VALUE(s, v, br_state, dctbl, return FALSE, label1);
+    if (s) {
+      CHECK_BIT_BUFFER(br_state, s, return FALSE);
+      r = GET_BITS(s);
+      v = HUFF_EXTEND(r, s);
+    }
 
-    /* Outer loop handles each block in the MCU */
+    if (entropy->dc_needed[blkn]) {
+      /* Convert DC difference to actual value, update last_dc_val */
+      int ci = cinfo->MCU_membership[blkn];
+      v += state.last_dc_val[ci];
+      state.last_dc_val[ci] = v;
+      /* Output the DC coefficient (assumes jpeg_natural_order[0] = 0) */
+      (*block)[0] = (JCOEF) v;
+    }
 
-    for (blkn = 0; blkn < cinfo->blocks_in_MCU; blkn++) {
-      JBLOCKROW block = MCU_data[blkn];
-      d_derived_tbl * dctbl = entropy->dc_cur_tbls[blkn];
-      d_derived_tbl * actbl = entropy->ac_cur_tbls[blkn];
-      register int s, k, r;
+    if (entropy->ac_needed[blkn]) {
 
-      /* Decode a single block's worth of coefficients */
+      /* Section F.2.2.2: decode the AC coefficients */
+      /* Since zeroes are skipped, output area must be cleared beforehand */
+      for (k = 1; k < DCTSIZE2; k++) {
+	v = 0;
+	HUFF_DECODE_VALUE(s, v, br_state, actbl, return FALSE, label2);
 
-      /* Section F.2.2.1: decode the DC coefficient difference */
-      HUFF_DECODE(s, br_state, dctbl, return FALSE, label1);
-      if (s) {
-	CHECK_BIT_BUFFER(br_state, s, return FALSE);
-	r = GET_BITS(s);
-	s = HUFF_EXTEND(r, s);
-      }
+	r = s >> 4;
+	s &= 15;
 
-      if (entropy->dc_needed[blkn]) {
-	/* Convert DC difference to actual value, update last_dc_val */
-	int ci = cinfo->MCU_membership[blkn];
-	s += state.last_dc_val[ci];
-	state.last_dc_val[ci] = s;
-	/* Output the DC coefficient (assumes jpeg_natural_order[0] = 0) */
-	(*block)[0] = (JCOEF) s;
+	if (s) {
+	  CHECK_BIT_BUFFER(br_state, s, return FALSE);
+	  v = GET_BITS(s);
+	  v = HUFF_EXTEND(v, s);
+	}
+	if (v) {
+	  k += r;
+	  /* Output coefficient in natural (dezigzagged) order.
+	   * Note: the extra entries in jpeg_natural_order[] will save us
+	   * if k >= DCTSIZE2, which could happen if the data is corrupted.
+	   */
+	  (*block)[jpeg_natural_order[k]] = (JCOEF) v;
+	} else {
+	  if (r != 15)
+	    break;
+	  k += 15;
+	}
       }
 
-      if (entropy->ac_needed[blkn]) {
-
-	/* Section F.2.2.2: decode the AC coefficients */
-	/* Since zeroes are skipped, output area must be cleared beforehand */
-	for (k = 1; k < DCTSIZE2; k++) {
-	  HUFF_DECODE(s, br_state, actbl, return FALSE, label2);
-      
-	  r = s >> 4;
-	  s &= 15;
-      
-	  if (s) {
-	    k += r;
-	    CHECK_BIT_BUFFER(br_state, s, return FALSE);
-	    r = GET_BITS(s);
-	    s = HUFF_EXTEND(r, s);
-	    /* Output coefficient in natural (dezigzagged) order.
-	     * Note: the extra entries in jpeg_natural_order[] will save us
-	     * if k >= DCTSIZE2, which could happen if the data is corrupted.
-	     */
-	    (*block)[jpeg_natural_order[k]] = (JCOEF) s;
-	  } else {
-	    if (r != 15)
-	      break;
-	    k += 15;
-	  }
-	}
+    } else {
 
-      } else {
-
-	/* Section F.2.2.2: decode the AC coefficients */
-	/* In this path we just discard the values */
-	for (k = 1; k < DCTSIZE2; k++) {
-	  HUFF_DECODE(s, br_state, actbl, return FALSE, label3);
-      
-	  r = s >> 4;
-	  s &= 15;
-      
-	  if (s) {
-	    k += r;
-	    CHECK_BIT_BUFFER(br_state, s, return FALSE);
-	    DROP_BITS(s);
-	  } else {
-	    if (r != 15)
-	      break;
-	    k += 15;
-	  }
+      /* Section F.2.2.2: decode the AC coefficients */
+      /* In this path we just discard the values */
+      for (k = 1; k < DCTSIZE2; k++) {
+	v = 0;
+	HUFF_DECODE_VALUE(s, v, br_state, actbl, return FALSE, label3);
+
+	r = s >> 4;
+	s &= 15;
+
+	if (s) {
+	  CHECK_BIT_BUFFER(br_state, s, return FALSE);
+	  DROP_BITS(s);
+	  v = 1;
+	}
+	if (v) {
+	  k += r;
+	} else {
+	  if (r != 15)
+	    break;
+	  k += 15;
 	}
+      }
+
+    }
+  }
 
+  /* Completed MCU, so update state */
+  BITREAD_SAVE_STATE(cinfo,entropy->bitstate);
+  ASSIGN_STATE(entropy->saved, state);
+  return TRUE;
+}
+
+
+/*
+ * Same as decode_mcu_slow, for when the source buffer holds enough data for
+ * the whole MCU even in the worst case.  Then we can take bytes from it
+ * without checking for its end or for suspension, and refill the bit buffer
+ * several bytes at a time.  A block cannot need more than 64 codes of up to
+ * 16 bits and as many values of up to 15 bits, which is 248 bytes, or twice
+ * that if every other byte is a stuffed zero.
+ *
+ * This gives up and returns FALSE when it meets a marker or an invalid
+ * code, without having changed any state but the coefficients, which
+ * decode_mcu clears again before decode_mcu_slow deals with the MCU.
+ */
+
+#define FAST_BYTES_PER_BLOCK  512	/* see above, plus room to prefetch */
+
+/* Ensure there are at least 16 bits in get_buffer.
+ * On hitting a marker, stay on it and shift in zeroes.
+ */
+#define FILL_BIT_BUFFER_FAST \
+	{ if (bits_left <= 16) {  \
+	    int nbytes;  \
+	    for (nbytes = 0; nbytes < (BIT_BUF_SIZE-16) / 8; nbytes++) {  \
+	      register int c = GETJOCTET(*buffer++);  \
+	      if (c == 0xFF) {  \
+		if (GETJOCTET(*buffer) == 0)  \
+		  buffer++;	/* FF/00 is an FF data byte */  \
+		else {  \
+		  buffer--; c = 0; hit_marker = TRUE;  \
+		}  \
+	      }  \
+	      get_buffer = (get_buffer << 8) | c;  \
+	    }  \
+	    bits_left += (BIT_BUF_SIZE-16) / 8 * 8; } }
+
+/* As HUFF_DECODE_VALUE, with codes longer than the lookahead done inline */
+#define HUFF_DECODE_FAST(result,value,htbl) \
+	{ register int nb; register INT32 look;  \
+	  FILL_BIT_BUFFER_FAST;  \
+	  look = htbl->lookup[PEEK_BITS(HUFF_LOOKAHEAD)];  \
+	  if ((nb = LOOK_NBITS(look)) != 0) {  \
+	    result = LOOK_SYM(look);  \
+	    if (LOOK_HAS_VALUE(look)) {  \
+	      nb += result & 15;  \
+	      value = LOOK_VALUE(look);  \
+	      result &= ~15;  \
+	    }  \
+	  } else {  \
+	    nb = HUFF_LOOKAHEAD+1;  \
+	    while ((INT32) PEEK_BITS(nb) > htbl->maxcode[nb])  \
+	      if (++nb > 16)  \
+		return FALSE;	/* bad code */  \
+	    result = htbl->pub->huffval[(int) (PEEK_BITS(nb) + htbl->valoffset[nb])];  \
+	  }  \
+	  DROP_BITS(nb); }
+
+LOCAL(boolean)
+decode_mcu_fast (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
+{
+  huff_entropy_ptr entropy = (huff_entropy_ptr) cinfo->entropy;
+  register bit_buf_type get_buffer = entropy->bitstate.get_buffer;
+  register int bits_left = entropy->bitstate.bits_left;
+  register const JOCTET * buffer = cinfo->src->next_input_byte;
+  boolean hit_marker = FALSE;
+  int blkn;
+  savable_state state;
+
+  ASSIGN_STATE(state, entropy->saved);
+
+  for (blkn = 0; blkn < cinfo->blocks_in_MCU; blkn++) {
+    JBLOCKROW block = MCU_data[blkn];
+    d_derived_tbl * dctbl = entropy->dc_cur_tbls[blkn];
+    d_derived_tbl * actbl = entropy->ac_cur_tbls[blkn];
+    register int s, k, r, v;
+
+    v = 0;
+    HUFF_DECODE_FAST(s, v, dctbl);
+    if (s) {
+      FILL_BIT_BUFFER_FAST;
+      r = GET_BITS(s);
+      v = HUFF_EXTEND(r, s);
+    }
+
+    if (entropy->dc_needed[blkn]) {
+      int ci = cinfo->MCU_membership[blkn];
+      v += state.last_dc_val[ci];
+      state.last_dc_val[ci] = v;
+      (*block)[0] = (JCOEF) v;
+    }
+
+    if (entropy->ac_needed[blkn]) {
+      for (k = 1; k < DCTSIZE2; k++) {
+	v = 0;
+	HUFF_DECODE_FAST(s, v, actbl);
+	r = s >> 4;
+	s &= 15;
+	if (s) {
+	  FILL_BIT_BUFFER_FAST;
+	  v = GET_BITS(s);
+	  v = HUFF_EXTEND(v, s);
+	}
+	if (v) {
+	  k += r;
+	  (*block)[jpeg_natural_order[k]] = (JCOEF) v;
+	} else {
+	  if (r != 15)
+	    break;
+	  k += 15;
+	}
+      }
+    } else {
+      for (k = 1; k < DCTSIZE2; k++) {
+	v = 0;
+	HUFF_DECODE_FAST(s, v, actbl);
+	r = s >> 4;
+	s &= 15;
+	if (s) {
+	  FILL_BIT_BUFFER_FAST;
+	  DROP_BITS(s);
+	  v = 1;
+	}
+	if (v) {
+	  k += r;
+	} else {
+	  if (r != 15)
+	    break;
+	  k += 15;
+	}
       }
     }
+  }
 
-    /* Completed MCU, so update state */
-    BITREAD_SAVE_STATE(cinfo,entropy->bitstate);
-    ASSIGN_STATE(entropy->saved, state);
+  /* The bits after a marker are made up; let decode_mcu_slow handle it */
+  if (hit_marker)
+    return FALSE;
+
+  /* Completed MCU, so update state */
+  cinfo->src->bytes_in_buffer -= buffer - cinfo->src->next_input_byte;
+  cinfo->src->next_input_byte = buffer;
+  entropy->bitstate.get_buffer = get_buffer;
+  entropy->bitstate.bits_left = bits_left;
+  ASSIGN_STATE(entropy->saved, state);
+  return TRUE;
+}
+
+
+METHODDEF(boolean)
+decode_mcu (j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
+{
+  huff_entropy_ptr entropy = (huff_entropy_ptr) cinfo->entropy;
+  int blkn;
+
+  /* Process restart marker if needed; may have to suspend */
+  if (cinfo->restart_interval) {
+    if (entropy->restarts_to_go == 0)
+      if (! process_restart(cinfo))
+	return FALSE;
+  }
+
+  /* If we've run out of data, just leave the MCU set to zeroes.
+   * This way, we return uniform gray for the remainder of the segment.
+   */
+  if (! entropy->pub.insufficient_data) {
+    boolean done = FALSE;
+
+    if (cinfo->unread_marker == 0 &&
+	cinfo->src->bytes_in_buffer >=
+	  (size_t) cinfo->blocks_in_MCU * FAST_BYTES_PER_BLOCK) {
+      done = decode_mcu_fast(cinfo, MCU_data);
+      if (! done) {
+	/* Start over from the zeroed blocks the caller gave us */
+	for (blkn = 0; blkn < cinfo->blocks_in_MCU; blkn++)
+	  jzero_far((void FAR *) MCU_data[blkn], SIZEOF(JBLOCK));
+      }
+    }
+    if (! done && ! decode_mcu_slow(cinfo, MCU_data))
+      return FALSE;
   }
 
   /* Account for restart interval (no-op if not using restarts) */
@@ -21,7 +21,7 @@
 
 /* Derived data constructed for each Huffman table */
 
-#define HUFF_LOOKAHEAD	8	/* # of bits of lookahead */
+#define HUFF_LOOKAHEAD	10	/* # of bits of lookahead (at most 15) */
 
 typedef struct {
   /* Basic tables: (element [0] of each array is unused) */
@@ -36,15 +36,28 @@ typedef struct {
   /* Link to public Huffman table (needed only in jpeg_huff_decode) */
   JHUFF_TBL *pub;
 
-  /* Lookahead tables: indexed by the next HUFF_LOOKAHEAD bits of
+  /* Lookahead table: indexed by the next HUFF_LOOKAHEAD bits of
    * the input data stream.  If the next Huffman code is no more
    * than HUFF_LOOKAHEAD bits long, we can obtain its length and
-   * the corresponding symbol directly from these tables.
+   * the corresponding symbol directly from this table.  If the
+   * magnitude bits that follow the code (the low 4 bits of the symbol
+   * give their count) fit in the lookahead too, the entry also holds
+   * the sign-extended coefficient value they encode.
    */
-  int look_nbits[1<<HUFF_LOOKAHEAD]; /* # bits, or 0 if too long */
-  UINT8 look_sym[1<<HUFF_LOOKAHEAD]; /* symbol, or unused */
+  INT32 lookup[1<<HUFF_LOOKAHEAD]; /* see LOOK_xxx macros below */
 } d_derived_tbl;
 
+/* Fields of a lookup[] entry: bits 0..7 are the code length, or 0 if
+ * too long; bits 8..15 the symbol; bits 16..30 the coefficient value
+ * plus LOOK_VALUE_BIAS, or 0 if the entry holds no value (a value is
+ * never 0, and never needs more than 14 bits plus sign).
+ */
+#define LOOK_VALUE_BIAS		0x4000
+#define LOOK_NBITS(entry)	((int) ((entry) & 0xFF))
+#define LOOK_SYM(entry)		((int) (((entry) >> 8) & 0xFF))
+#define LOOK_HAS_VALUE(entry)	((entry) >= ((INT32) 1 << 16))
+#define LOOK_VALUE(entry)	((int) ((entry) >> 16) - LOOK_VALUE_BIAS)
+
 /* Expand a Huffman table definition into the derived format */
 EXTERN(void) jpeg_make_d_derived_tbl
 	JPP((j_decompress_ptr cinfo, boolean isDC, int tblno,
@@ -69,16 +82,23 @@ EXTERN(void) jpeg_make_d_derived_tbl
  * necessary.
  */
 
-typedef INT32 bit_buf_type;	/* type of bit-extraction buffer */
-#define BIT_BUF_SIZE  32	/* size of buffer in bits */
-
 /* If long is > 32 bits on your machine, and shifting/masking longs is
  * reasonably fast, making bit_buf_type be long and setting BIT_BUF_SIZE
  * appropriately should be a win.  Unfortunately we can't define the size
  * with something like  #define BIT_BUF_SIZE (sizeof(bit_buf_type)*8)
  * because not all machines measure sizeof in 8-bit bytes.
+ * We know that the 64-bit targets we build for have a 64-bit size_t
+ * (long is only 32 bits on Win64), so we use that there.
  */
 
+#if defined(_WIN64) || defined(__x86_64__) || defined(__aarch64__) || defined(__LP64__)
+typedef size_t bit_buf_type;	/* type of bit-extraction buffer */
+#define BIT_BUF_SIZE  64	/* size of buffer in bits */
+#else
+typedef INT32 bit_buf_type;	/* type of bit-extraction buffer */
+#define BIT_BUF_SIZE  32	/* size of buffer in bits */
+#endif
+
 typedef struct {		/* Bitreading state saved across MCUs */
   bit_buf_type get_buffer;	/* current bit-extraction buffer */
   int bits_left;		/* # of unused bits in it */
@@ -171,10 +191,16 @@ EXTERN(boolean) jpeg_fill_bit_buffer
  * 2. If the lookahead table contains no entry, the next code must be
  *    more than HUFF_LOOKAHEAD bits long.
  * 3. jpeg_huff_decode returns -1 if forced to suspend.
+ *
+ * HUFF_DECODE_VALUE works the same, but when the lookahead entry also
+ * holds the value of the magnitude bits, it consumes those bits as well,
+ * stores the value into "value", and clears the low 4 bits of "result"
+ * so that the caller sees no more bits left to read.  Otherwise "value"
+ * is left alone; the caller should preset it to 0.
  */
 
 #define HUFF_DECODE(result,state,htbl,failaction,slowlabel) \
-{ register int nb, look; \
+{ register int nb; register INT32 look; \
   if (bits_left < HUFF_LOOKAHEAD) { \
     if (! jpeg_fill_bit_buffer(&state,get_buffer,bits_left, 0)) {failaction;} \
     get_buffer = state.get_buffer; bits_left = state.bits_left; \
@@ -182,10 +208,37 @@ EXTERN(boolean) jpeg_fill_bit_buffer
       nb = 1; goto slowlabel; \
     } \
   } \
-  look = PEEK_BITS(HUFF_LOOKAHEAD); \
-  if ((nb = htbl->look_nbits[look]) != 0) { \
+  look = htbl->lookup[PEEK_BITS(HUFF_LOOKAHEAD)]; \
+  if ((nb = LOOK_NBITS(look)) != 0) { \
     DROP_BITS(nb); \
-    result = htbl->look_sym[look]; \
+    result = LOOK_SYM(look); \
+  } else { \
+    nb = HUFF_LOOKAHEAD+1; \
+slowlabel: \
+    if ((result=jpeg_huff_decode(&state,get_buffer,bits_left,htbl,nb)) < 0) \
+	{ failaction; } \
+    get_buffer = state.get_buffer; bits_left = state.bits_left; \
+  } \
+}
+
+#define HUFF_DECODE_VALUE(result,value,state,htbl,failaction,slowlabel) \
+{ register int nb; register INT32 look; \
+  if (bits_left < HUFF_LOOKAHEAD) { \
+    if (! jpeg_fill_bit_buffer(&state,get_buffer,bits_left, 0)) {failaction;} \
+    get_buffer = state.get_buffer; bits_left = state.bits_left; \
+    if (bits_left < HUFF_LOOKAHEAD) { \
+      nb = 1; goto slowlabel; \
+    } \
+  } \
+  look = htbl->lookup[PEEK_BITS(HUFF_LOOKAHEAD)]; \
+  if ((nb = LOOK_NBITS(look)) != 0) { \
+    result = LOOK_SYM(look); \
+    if (LOOK_HAS_VALUE(look)) { \
+      DROP_BITS(nb + (result & 15)); \
+      value = LOOK_VALUE(look); \
+      result &= ~15; \
+    } else \
+      DROP_BITS(nb); \
   } else { \
     nb = HUFF_LOOKAHEAD+1; \
 slowlabel: \
@@ -0,0 +1,834 @@
+/*
+ * jdsimd.c
+ *
+ * This file is not part of the Independent JPEG Group's distribution.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file contains SSE2 and AVX2 versions of the decompressor's inner
+ * loops for x86-64: the islow inverse DCT (jidctint.c), h2v1 and h2v2
+ * fancy upsampling (jdsample.c) and YCbCr->RGB/BGR/BGRX color conversion
+ * (jdcolor.c).  They produce the same output as the C code, byte for byte.
+ * SSE2 is always there on x86-64; AVX2 is detected at run time and used
+ * for the IDCT.  Setting JSIMD_FORCENONE=1 or JSIMD_FORCESSE2=1 in the
+ * environment turns off all of this or just the AVX2 part.
+ */
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jdct.h"		/* Private declarations for DCT subsystem */
+
+#ifdef JPEG_SIMD_SUPPORTED
+
+#include <emmintrin.h>
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define JSIMD_AVX2
+#else
+#include <cpuid.h>
+#define JSIMD_AVX2	__attribute__((target("avx2")))
+#endif
+
+
+/* 0 = no SIMD, 1 = SSE2, 2 = SSE2 + AVX2; -1 = not yet checked.
+ * Several threads may race to set it, but they all write the same value.
+ */
+
+static int simd_level = -1;
+
+LOCAL(int)
+jsimd_level (void)
+{
+  if (simd_level < 0) {
+    int level = 1;
+    unsigned int a, b, c, d, xcr0 = 0;
+    char * env;
+
+#ifdef _MSC_VER
+    int r[4];
+    __cpuid(r, 1);
+    c = (unsigned int) r[2];
+    if ((c & (1 << 27)) != 0)
+      xcr0 = (unsigned int) _xgetbv(0);
+    __cpuid(r, 0);
+    b = 0;
+    if (r[0] >= 7) {
+      __cpuidex(r, 7, 0);
+      b = (unsigned int) r[1];
+    }
+#else
+    if (! __get_cpuid(1, &a, &b, &c, &d))
+      c = 0;
+    if ((c & (1 << 27)) != 0)	/* OSXSAVE: xgetbv is there */
+      __asm__ ("xgetbv" : "=a" (xcr0), "=d" (d) : "c" (0));
+    b = 0;
+    if (__get_cpuid_max(0, NULL) >= 7)
+      __cpuid_count(7, 0, a, b, c, d);
+#endif
+    /* AVX2, with the ymm state saved by the OS */
+    if ((b & (1 << 5)) != 0 && (xcr0 & 6) == 6)
+      level = 2;
+
+    if ((env = getenv("JSIMD_FORCESSE2")) != NULL && env[0] == '1')
+      level = 1;
+    if ((env = getenv("JSIMD_FORCENONE")) != NULL && env[0] == '1')
+      level = 0;
+    simd_level = level;
+  }
+  return simd_level;
+}
+
+
+/**************** Inverse DCT, islow ****************/
+
+/* The constants and descaling of jidctint.c */
+
+#define CONST_BITS  13
+#define PASS1_BITS  2
+
+#define FIX_0_298631336  ((INT32)  2446)
+#define FIX_0_390180644  ((INT32)  3196)
+#define FIX_0_541196100  ((INT32)  4433)
+#define FIX_0_765366865  ((INT32)  6270)
+#define FIX_0_899976223  ((INT32)  7373)
+#define FIX_1_175875602  ((INT32)  9633)
+#define FIX_1_501321110  ((INT32)  12299)
+#define FIX_1_847759065  ((INT32)  15137)
+#define FIX_1_961570560  ((INT32)  16069)
+#define FIX_2_053119869  ((INT32)  16819)
+#define FIX_2_562915447  ((INT32)  20995)
+#define FIX_3_072711026  ((INT32)  25172)
+
+/* jidctint.c does its arithmetic in INT32, which is 64 bits on LP64 systems.
+ * Here everything is done in 32 bit lanes, so the SIMD code only gets the
+ * blocks where nothing can overflow; the rest (which only corrupt or
+ * contrived files produce) goes to jpeg_idct_islow.  Every intermediate
+ * value of a pass is a sum of its inputs weighted by no more than 61214
+ * in total, so inputs below 32768 keep it under 2^31.  The SSE2 version
+ * also pairs up its inputs in 16 bit lanes, which needs them below 16384.
+ * Without overflow the zero-AC shortcuts of jidctint.c give the same
+ * results as the full computation, so they need no special treatment;
+ * the output is range limited by saturation, which matches the
+ * range_limit table for results in -512..511.
+ */
+
+#define PAIR(a,b)  _mm_set_epi16((short) (b), (short) (a), (short) (b), \
+				 (short) (a), (short) (b), (short) (a), \
+				 (short) (b), (short) (a))
+
+
+/* Transpose an 8x8 matrix of 16 bit values. */
+
+INLINE LOCAL(void)
+transpose_sse2 (__m128i x[8])
+{
+  __m128i a0, a1, a2, a3, a4, a5, a6, a7;
+  __m128i b0, b1, b2, b3, b4, b5, b6, b7;
+
+  a0 = _mm_unpacklo_epi16(x[0], x[1]);
+  a1 = _mm_unpackhi_epi16(x[0], x[1]);
+  a2 = _mm_unpacklo_epi16(x[2], x[3]);
+  a3 = _mm_unpackhi_epi16(x[2], x[3]);
+  a4 = _mm_unpacklo_epi16(x[4], x[5]);
+  a5 = _mm_unpackhi_epi16(x[4], x[5]);
+  a6 = _mm_unpacklo_epi16(x[6], x[7]);
+  a7 = _mm_unpackhi_epi16(x[6], x[7]);
+  b0 = _mm_unpacklo_epi32(a0, a2);
+  b1 = _mm_unpackhi_epi32(a0, a2);
+  b2 = _mm_unpacklo_epi32(a1, a3);
+  b3 = _mm_unpackhi_epi32(a1, a3);
+  b4 = _mm_unpacklo_epi32(a4, a6);
+  b5 = _mm_unpackhi_epi32(a4, a6);
+  b6 = _mm_unpacklo_epi32(a5, a7);
+  b7 = _mm_unpackhi_epi32(a5, a7);
+  x[0] = _mm_unpacklo_epi64(b0, b4);
+  x[1] = _mm_unpackhi_epi64(b0, b4);
+  x[2] = _mm_unpacklo_epi64(b1, b5);
+  x[3] = _mm_unpackhi_epi64(b1, b5);
+  x[4] = _mm_unpacklo_epi64(b2, b6);
+  x[5] = _mm_unpackhi_epi64(b2, b6);
+  x[6] = _mm_unpacklo_epi64(b3, b7);
+  x[7] = _mm_unpackhi_epi64(b3, b7);
+}
+
+
+/* Four lanes (hi = 0: elements 0..3, hi = 1: 4..7) of a 1-D IDCT pass
+ * over the vectors x[0..7].  The multiplications of jidctint.c are
+ * regrouped into pairwise products, so that each is a single pmaddwd of
+ * two inputs; e.g. tmp2 = z2 * FIX_0_541196100 + z3 * (FIX_0_541196100 -
+ * FIX_1_847759065).  z3 and z4 are the 16 bit sums x7 + x3 and x5 + x1.
+ */
+
+INLINE LOCAL(void)
+idct_half_sse2 (const __m128i x[8], __m128i z3, __m128i z4, int hi,
+		__m128i out[8], __m128i bias, int shift)
+{
+  __m128i u, tmp0, tmp1, tmp2, tmp3, tmp10, tmp11, tmp12, tmp13;
+
+#define UNPACK(a,b)  (hi ? _mm_unpackhi_epi16(a, b) : _mm_unpacklo_epi16(a, b))
+
+  /* Even part */
+
+  u = UNPACK(x[2], x[6]);
+  tmp3 = _mm_madd_epi16(u, PAIR(FIX_0_541196100 + FIX_0_765366865,
+				FIX_0_541196100));
+  tmp2 = _mm_madd_epi16(u, PAIR(FIX_0_541196100,
+				FIX_0_541196100 - FIX_1_847759065));
+  u = UNPACK(x[0], x[4]);
+  tmp0 = _mm_madd_epi16(u, PAIR(1 << CONST_BITS, 1 << CONST_BITS));
+  tmp1 = _mm_madd_epi16(u, PAIR(1 << CONST_BITS, -(1 << CONST_BITS)));
+  tmp0 = _mm_add_epi32(tmp0, bias);
+  tmp1 = _mm_add_epi32(tmp1, bias);
+
+  tmp10 = _mm_add_epi32(tmp0, tmp3);
+  tmp13 = _mm_sub_epi32(tmp0, tmp3);
+  tmp11 = _mm_add_epi32(tmp1, tmp2);
+  tmp12 = _mm_sub_epi32(tmp1, tmp2);
+
+  /* Odd part; z3 and z4 take in the z5 rotation */
+
+  u = UNPACK(z3, z4);
+  z3 = _mm_madd_epi16(u, PAIR(FIX_1_175875602 - FIX_1_961570560,
+			      FIX_1_175875602));
+  z4 = _mm_madd_epi16(u, PAIR(FIX_1_175875602,
+			      FIX_1_175875602 - FIX_0_390180644));
+  u = UNPACK(x[7], x[1]);
+  tmp0 = _mm_add_epi32(z3, _mm_madd_epi16(u,
+	   PAIR(FIX_0_298631336 - FIX_0_899976223, - FIX_0_899976223)));
+  tmp3 = _mm_add_epi32(z4, _mm_madd_epi16(u,
+	   PAIR(- FIX_0_899976223, FIX_1_501321110 - FIX_0_899976223)));
+  u = UNPACK(x[5], x[3]);
+  tmp1 = _mm_add_epi32(z4, _mm_madd_epi16(u,
+	   PAIR(FIX_2_053119869 - FIX_2_562915447, - FIX_2_562915447)));
+  tmp2 = _mm_add_epi32(z3, _mm_madd_epi16(u,
+	   PAIR(- FIX_2_562915447, FIX_3_072711026 - FIX_2_562915447)));
+
+#undef UNPACK
+
+  /* Final output stage */
+
+  out[0] = _mm_srai_epi32(_mm_add_epi32(tmp10, tmp3), shift);
+  out[7] = _mm_srai_epi32(_mm_sub_epi32(tmp10, tmp3), shift);
+  out[1] = _mm_srai_epi32(_mm_add_epi32(tmp11, tmp2), shift);
+  out[6] = _mm_srai_epi32(_mm_sub_epi32(tmp11, tmp2), shift);
+  out[2] = _mm_srai_epi32(_mm_add_epi32(tmp12, tmp1), shift);
+  out[5] = _mm_srai_epi32(_mm_sub_epi32(tmp12, tmp1), shift);
+  out[3] = _mm_srai_epi32(_mm_add_epi32(tmp13, tmp0), shift);
+  out[4] = _mm_srai_epi32(_mm_sub_epi32(tmp13, tmp0), shift);
+}
+
+
+/* One 1-D pass over the 8 vectors x[], results packed back to 16 bits. */
+
+INLINE LOCAL(void)
+idct_pass_sse2 (__m128i x[8], int shift)
+{
+  __m128i lo[8], hi[8];
+  __m128i bias = _mm_set1_epi32(1 << (shift-1));
+  __m128i z3 = _mm_add_epi16(x[7], x[3]);
+  __m128i z4 = _mm_add_epi16(x[5], x[1]);
+  int i;
+
+  idct_half_sse2(x, z3, z4, 0, lo, bias, shift);
+  idct_half_sse2(x, z3, z4, 1, hi, bias, shift);
+  for (i = 0; i < DCTSIZE; i++)
+    x[i] = _mm_packs_epi32(lo[i], hi[i]);
+}
+
+
+/* Nonzero lanes where a 16 bit value is outside -2^bits..2^bits-1 */
+
+#define OUTSIDE16(v,bits) \
+	_mm_xor_si128(_mm_srai_epi16(v, bits), _mm_srai_epi16(v, 15))
+
+
+/* All AC terms zero: the block is flat.  This is the jidctint.c code
+ * for that case, which matters only for its results on overflow.
+ */
+
+LOCAL(void)
+idct_flat (j_decompress_ptr cinfo, JCOEFPTR coef_block, int quantval,
+	   JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  JSAMPLE *range_limit = IDCT_range_limit(cinfo);
+  int dcval = ((ISLOW_MULT_TYPE) coef_block[0] * quantval) << PASS1_BITS;
+  JSAMPLE outval = range_limit[(int) DESCALE((INT32) dcval, PASS1_BITS+3)
+			       & RANGE_MASK];
+  JSAMPROW outptr;
+  int ctr, i;
+  SHIFT_TEMPS
+
+  for (ctr = 0; ctr < DCTSIZE; ctr++) {
+    outptr = output_buf[ctr] + output_col;
+    for (i = 0; i < DCTSIZE; i++)
+      outptr[i] = outval;
+  }
+}
+
+
+LOCAL(void)
+idct_islow_sse2 (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		 JCOEFPTR coef_block,
+		 JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  ISLOW_MULT_TYPE * quantptr = (ISLOW_MULT_TYPE *) compptr->dct_table;
+  __m128i x[8], c, q, h, ac, bad;
+  int i;
+
+  /* Dequantize.  Products are checked to fit in 15 bits: the high word
+   * and the top two bits of the low word must all be sign copies.
+   */
+  ac = _mm_setzero_si128();
+  bad = _mm_setzero_si128();
+  for (i = 0; i < DCTSIZE; i++) {
+    c = _mm_loadu_si128((const __m128i *) (coef_block + i*DCTSIZE));
+    q = _mm_packs_epi32(
+	  _mm_loadu_si128((const __m128i *) (quantptr + i*DCTSIZE)),
+	  _mm_loadu_si128((const __m128i *) (quantptr + i*DCTSIZE + 4)));
+    x[i] = _mm_mullo_epi16(c, q);
+    h = _mm_mulhi_epi16(c, q);
+    bad = _mm_or_si128(bad, _mm_xor_si128(h, _mm_srai_epi16(x[i], 15)));
+    bad = _mm_or_si128(bad, OUTSIDE16(x[i], 14));
+    ac = _mm_or_si128(ac, i ? c : _mm_slli_si128(_mm_srli_si128(c, 2), 2));
+  }
+  /* the packs above may saturate quantizers over 32767; that only
+   * matters for nonzero coefficients, whose products then fail the check
+   */
+  if (_mm_movemask_epi8(_mm_cmpeq_epi16(ac, _mm_setzero_si128())) == 0xFFFF) {
+    idct_flat(cinfo, coef_block, quantptr[0], output_buf, output_col);
+    return;
+  }
+  if (_mm_movemask_epi8(_mm_cmpeq_epi16(bad, _mm_setzero_si128())) != 0xFFFF)
+    goto slow;
+
+  /* Pass 1: columns.  Rows of the results are rows of the workspace. */
+
+  idct_pass_sse2(x, CONST_BITS-PASS1_BITS);
+  bad = _mm_setzero_si128();
+  for (i = 0; i < DCTSIZE; i++)
+    bad = _mm_or_si128(bad, OUTSIDE16(x[i], 14));
+  if (_mm_movemask_epi8(_mm_cmpeq_epi16(bad, _mm_setzero_si128())) != 0xFFFF)
+    goto slow;
+
+  /* Pass 2: rows, as columns of the transposed workspace */
+
+  transpose_sse2(x);
+  idct_pass_sse2(x, CONST_BITS+PASS1_BITS+3);
+  bad = _mm_setzero_si128();
+  for (i = 0; i < DCTSIZE; i++)
+    bad = _mm_or_si128(bad, OUTSIDE16(x[i], 9));
+  if (_mm_movemask_epi8(_mm_cmpeq_epi16(bad, _mm_setzero_si128())) != 0xFFFF)
+    goto slow;
+
+  transpose_sse2(x);
+  for (i = 0; i < DCTSIZE; i += 2) {
+    c = _mm_packus_epi16(_mm_add_epi16(x[i], _mm_set1_epi16(CENTERJSAMPLE)),
+			 _mm_add_epi16(x[i+1], _mm_set1_epi16(CENTERJSAMPLE)));
+    _mm_storel_epi64((__m128i *) (output_buf[i] + output_col), c);
+    _mm_storel_epi64((__m128i *) (output_buf[i+1] + output_col),
+		     _mm_srli_si128(c, 8));
+  }
+  return;
+
+slow:
+  jpeg_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+}
+
+
+/* The AVX2 version keeps all 8 columns in one register as 32 bit lanes
+ * and follows jidctint.c operation by operation.
+ */
+
+#define MUL32(v,c)  _mm256_mullo_epi32(v, _mm256_set1_epi32(c))
+
+INLINE LOCAL(void) JSIMD_AVX2
+transpose_avx2 (__m256i x[8])
+{
+  __m256i t0, t1, t2, t3, t4, t5, t6, t7;
+  __m256i u0, u1, u2, u3, u4, u5, u6, u7;
+
+  t0 = _mm256_unpacklo_epi32(x[0], x[1]);
+  t1 = _mm256_unpackhi_epi32(x[0], x[1]);
+  t2 = _mm256_unpacklo_epi32(x[2], x[3]);
+  t3 = _mm256_unpackhi_epi32(x[2], x[3]);
+  t4 = _mm256_unpacklo_epi32(x[4], x[5]);
+  t5 = _mm256_unpackhi_epi32(x[4], x[5]);
+  t6 = _mm256_unpacklo_epi32(x[6], x[7]);
+  t7 = _mm256_unpackhi_epi32(x[6], x[7]);
+  u0 = _mm256_unpacklo_epi64(t0, t2);
+  u1 = _mm256_unpackhi_epi64(t0, t2);
+  u2 = _mm256_unpacklo_epi64(t1, t3);
+  u3 = _mm256_unpackhi_epi64(t1, t3);
+  u4 = _mm256_unpacklo_epi64(t4, t6);
+  u5 = _mm256_unpackhi_epi64(t4, t6);
+  u6 = _mm256_unpacklo_epi64(t5, t7);
+  u7 = _mm256_unpackhi_epi64(t5, t7);
+  x[0] = _mm256_permute2x128_si256(u0, u4, 0x20);
+  x[1] = _mm256_permute2x128_si256(u1, u5, 0x20);
+  x[2] = _mm256_permute2x128_si256(u2, u6, 0x20);
+  x[3] = _mm256_permute2x128_si256(u3, u7, 0x20);
+  x[4] = _mm256_permute2x128_si256(u0, u4, 0x31);
+  x[5] = _mm256_permute2x128_si256(u1, u5, 0x31);
+  x[6] = _mm256_permute2x128_si256(u2, u6, 0x31);
+  x[7] = _mm256_permute2x128_si256(u3, u7, 0x31);
+}
+
+
+INLINE LOCAL(void) JSIMD_AVX2
+idct_pass_avx2 (__m256i x[8], int shift)
+{
+  __m256i tmp0, tmp1, tmp2, tmp3, tmp10, tmp11, tmp12, tmp13;
+  __m256i z1, z2, z3, z4, z5;
+  __m256i bias = _mm256_set1_epi32(1 << (shift-1));
+
+  /* Even part */
+
+  z1 = MUL32(_mm256_add_epi32(x[2], x[6]), FIX_0_541196100);
+  tmp2 = _mm256_add_epi32(z1, MUL32(x[6], - FIX_1_847759065));
+  tmp3 = _mm256_add_epi32(z1, MUL32(x[2], FIX_0_765366865));
+
+  tmp0 = _mm256_add_epi32(_mm256_slli_epi32(_mm256_add_epi32(x[0], x[4]),
+					    CONST_BITS), bias);
+  tmp1 = _mm256_add_epi32(_mm256_slli_epi32(_mm256_sub_epi32(x[0], x[4]),
+					    CONST_BITS), bias);
+
+  tmp10 = _mm256_add_epi32(tmp0, tmp3);
+  tmp13 = _mm256_sub_epi32(tmp0, tmp3);
+  tmp11 = _mm256_add_epi32(tmp1, tmp2);
+  tmp12 = _mm256_sub_epi32(tmp1, tmp2);
+
+  /* Odd part */
+
+  z1 = _mm256_add_epi32(x[7], x[1]);
+  z2 = _mm256_add_epi32(x[5], x[3]);
+  z3 = _mm256_add_epi32(x[7], x[3]);
+  z4 = _mm256_add_epi32(x[5], x[1]);
+  z5 = MUL32(_mm256_add_epi32(z3, z4), FIX_1_175875602);
+
+  tmp0 = MUL32(x[7], FIX_0_298631336);
+  tmp1 = MUL32(x[5], FIX_2_053119869);
+  tmp2 = MUL32(x[3], FIX_3_072711026);
+  tmp3 = MUL32(x[1], FIX_1_501321110);
+  z1 = MUL32(z1, - FIX_0_899976223);
+  z2 = MUL32(z2, - FIX_2_562915447);
+  z3 = _mm256_add_epi32(MUL32(z3, - FIX_1_961570560), z5);
+  z4 = _mm256_add_epi32(MUL32(z4, - FIX_0_390180644), z5);
+
+  tmp0 = _mm256_add_epi32(tmp0, _mm256_add_epi32(z1, z3));
+  tmp1 = _mm256_add_epi32(tmp1, _mm256_add_epi32(z2, z4));
+  tmp2 = _mm256_add_epi32(tmp2, _mm256_add_epi32(z2, z3));
+  tmp3 = _mm256_add_epi32(tmp3, _mm256_add_epi32(z1, z4));
+
+  /* Final output stage */
+
+  x[0] = _mm256_srai_epi32(_mm256_add_epi32(tmp10, tmp3), shift);
+  x[7] = _mm256_srai_epi32(_mm256_sub_epi32(tmp10, tmp3), shift);
+  x[1] = _mm256_srai_epi32(_mm256_add_epi32(tmp11, tmp2), shift);
+  x[6] = _mm256_srai_epi32(_mm256_sub_epi32(tmp11, tmp2), shift);
+  x[2] = _mm256_srai_epi32(_mm256_add_epi32(tmp12, tmp1), shift);
+  x[5] = _mm256_srai_epi32(_mm256_sub_epi32(tmp12, tmp1), shift);
+  x[3] = _mm256_srai_epi32(_mm256_add_epi32(tmp13, tmp0), shift);
+  x[4] = _mm256_srai_epi32(_mm256_sub_epi32(tmp13, tmp0), shift);
+}
+
+
+/* Nonzero if all 32 bit lanes of the or-ed absolute values are below 2^15 */
+
+#define FITS15(acc)  _mm256_testz_si256(acc, _mm256_set1_epi32(~0x7FFF))
+
+
+LOCAL(void) JSIMD_AVX2
+idct_islow_avx2 (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		 JCOEFPTR coef_block,
+		 JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  ISLOW_MULT_TYPE * quantptr = (ISLOW_MULT_TYPE *) compptr->dct_table;
+  __m256i x[8], big, p;
+  __m128i c, ac;
+  int i;
+
+  ac = _mm_setzero_si128();
+  big = _mm256_setzero_si256();
+  for (i = 0; i < DCTSIZE; i++) {
+    c = _mm_loadu_si128((const __m128i *) (coef_block + i*DCTSIZE));
+    ac = _mm_or_si128(ac, i ? c : _mm_slli_si128(_mm_srli_si128(c, 2), 2));
+    x[i] = _mm256_mullo_epi32(_mm256_cvtepi16_epi32(c),
+	     _mm256_loadu_si256((const __m256i *) (quantptr + i*DCTSIZE)));
+    big = _mm256_or_si256(big, _mm256_abs_epi32(x[i]));
+  }
+  if (_mm_testz_si128(ac, ac)) {
+    idct_flat(cinfo, coef_block, quantptr[0], output_buf, output_col);
+    return;
+  }
+  if (! FITS15(big))
+    goto slow;
+
+  /* Pass 1: columns */
+
+  idct_pass_avx2(x, CONST_BITS-PASS1_BITS);
+  big = _mm256_setzero_si256();
+  for (i = 0; i < DCTSIZE; i++)
+    big = _mm256_or_si256(big, _mm256_abs_epi32(x[i]));
+  if (! FITS15(big))
+    goto slow;
+
+  /* Pass 2: rows */
+
+  transpose_avx2(x);
+  idct_pass_avx2(x, CONST_BITS+PASS1_BITS+3);
+  big = _mm256_setzero_si256();
+  for (i = 0; i < DCTSIZE; i++)
+    big = _mm256_or_si256(big, _mm256_add_epi32(x[i], _mm256_set1_epi32(512)));
+  if (! _mm256_testz_si256(big, _mm256_set1_epi32(~1023)))
+    goto slow;
+
+  /* Pack to bytes, four rows at a time; the dword permute undoes the
+   * lane interleaving of the packs.
+   */
+  transpose_avx2(x);
+  for (i = 0; i < DCTSIZE; i += 4) {
+    p = _mm256_packus_epi16(
+	  _mm256_add_epi16(_mm256_packs_epi32(x[i], x[i+1]),
+			   _mm256_set1_epi16(CENTERJSAMPLE)),
+	  _mm256_add_epi16(_mm256_packs_epi32(x[i+2], x[i+3]),
+			   _mm256_set1_epi16(CENTERJSAMPLE)));
+    p = _mm256_permutevar8x32_epi32(p, _mm256_setr_epi32(0, 4, 1, 5,
+							 2, 6, 3, 7));
+    c = _mm256_castsi256_si128(p);
+    _mm_storel_epi64((__m128i *) (output_buf[i] + output_col), c);
+    _mm_storel_epi64((__m128i *) (output_buf[i+1] + output_col),
+		     _mm_srli_si128(c, 8));
+    c = _mm256_extracti128_si256(p, 1);
+    _mm_storel_epi64((__m128i *) (output_buf[i+2] + output_col), c);
+    _mm_storel_epi64((__m128i *) (output_buf[i+3] + output_col),
+		     _mm_srli_si128(c, 8));
+  }
+  return;
+
+slow:
+  jpeg_idct_islow(cinfo, compptr, coef_block, output_buf, output_col);
+}
+
+
+GLOBAL(int)
+jsimd_can_idct_islow (void)
+{
+  if (DCTSIZE != 8 || BITS_IN_JSAMPLE != 8 || SIZEOF(JCOEF) != 2 ||
+      SIZEOF(ISLOW_MULT_TYPE) != 4)
+    return 0;
+  return jsimd_level() > 0;
+}
+
+
+GLOBAL(void)
+jsimd_idct_islow (j_decompress_ptr cinfo, jpeg_component_info * compptr,
+		  JCOEFPTR coef_block,
+		  JSAMPARRAY output_buf, JDIMENSION output_col)
+{
+  if (simd_level > 1)
+    idct_islow_avx2(cinfo, compptr, coef_block, output_buf, output_col);
+  else
+    idct_islow_sse2(cinfo, compptr, coef_block, output_buf, output_col);
+}
+
+
+/**************** Fancy upsampling ****************/
+
+/* 16 input samples at a time, with the same 16 bit arithmetic as the
+ * C code; the first and last columns and what is left at the end of a
+ * row are done as in jdsample.c.  Loads reach one sample to each side
+ * of the 16, so the vector loop stops one short of the last column.
+ */
+
+#define LOAD16(p)	_mm_loadu_si128((const __m128i *) (p))
+#define LO16(v)		_mm_unpacklo_epi8(v, _mm_setzero_si128())
+#define HI16(v)		_mm_unpackhi_epi8(v, _mm_setzero_si128())
+
+GLOBAL(void)
+jsimd_h2v1_fancy_upsample (j_decompress_ptr cinfo,
+			   jpeg_component_info * compptr,
+			   JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  JSAMPARRAY output_data = *output_data_ptr;
+  JSAMPROW inptr, outptr;
+  JDIMENSION col, width = compptr->downsampled_width;
+  __m128i prev, cur, next, c3, even_lo, even_hi, odd_lo, odd_hi, e, o;
+  __m128i one = _mm_set1_epi16(1), two = _mm_set1_epi16(2);
+  int invalue, inrow;
+
+  for (inrow = 0; inrow < cinfo->max_v_samp_factor; inrow++) {
+    inptr = input_data[inrow];
+    outptr = output_data[inrow];
+    /* Special case for first column */
+    invalue = GETJSAMPLE(inptr[0]);
+    outptr[0] = (JSAMPLE) invalue;
+    outptr[1] = (JSAMPLE) ((invalue * 3 + GETJSAMPLE(inptr[1]) + 2) >> 2);
+
+    for (col = 1; col + 17 <= width; col += 16) {
+      prev = LOAD16(inptr + col - 1);
+      cur = LOAD16(inptr + col);
+      next = LOAD16(inptr + col + 1);
+      c3 = LO16(cur);
+      c3 = _mm_add_epi16(c3, _mm_add_epi16(c3, c3));
+      even_lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(c3, LO16(prev)),
+					     one), 2);
+      odd_lo = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(c3, LO16(next)),
+					    two), 2);
+      c3 = HI16(cur);
+      c3 = _mm_add_epi16(c3, _mm_add_epi16(c3, c3));
+      even_hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(c3, HI16(prev)),
+					     one), 2);
+      odd_hi = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(c3, HI16(next)),
+					    two), 2);
+      e = _mm_packus_epi16(even_lo, even_hi);
+      o = _mm_packus_epi16(odd_lo, odd_hi);
+      _mm_storeu_si128((__m128i *) (outptr + 2*col), _mm_unpacklo_epi8(e, o));
+      _mm_storeu_si128((__m128i *) (outptr + 2*col + 16),
+		       _mm_unpackhi_epi8(e, o));
+    }
+
+    inptr += col;
+    outptr += 2*col;
+    for (; col < width - 1; col++) {
+      invalue = GETJSAMPLE(*inptr++) * 3;
+      *outptr++ = (JSAMPLE) ((invalue + GETJSAMPLE(inptr[-2]) + 1) >> 2);
+      *outptr++ = (JSAMPLE) ((invalue + GETJSAMPLE(*inptr) + 2) >> 2);
+    }
+
+    /* Special case for last column */
+    invalue = GETJSAMPLE(*inptr);
+    *outptr++ = (JSAMPLE) ((invalue * 3 + GETJSAMPLE(inptr[-1]) + 1) >> 2);
+    *outptr++ = (JSAMPLE) invalue;
+  }
+}
+
+
+GLOBAL(void)
+jsimd_h2v2_fancy_upsample (j_decompress_ptr cinfo,
+			   jpeg_component_info * compptr,
+			   JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr)
+{
+  JSAMPARRAY output_data = *output_data_ptr;
+  JSAMPROW inptr0, inptr1, outptr;
+  JDIMENSION col, width = compptr->downsampled_width;
+  __m128i a, b, lastsum, thissum, nextsum, even[2], odd[2], e, o;
+  __m128i seven = _mm_set1_epi16(7), eight = _mm_set1_epi16(8);
+  int thiscolsum, lastcolsum, nextcolsum;
+  int inrow, outrow, v, h;
+
+  inrow = outrow = 0;
+  while (outrow < cinfo->max_v_samp_factor) {
+    for (v = 0; v < 2; v++) {
+      /* inptr0 points to nearest input row, inptr1 points to next nearest */
+      inptr0 = input_data[inrow];
+      inptr1 = input_data[v == 0 ? inrow-1 : inrow+1];
+      outptr = output_data[outrow++];
+
+      /* Special case for first column */
+      thiscolsum = GETJSAMPLE(inptr0[0]) * 3 + GETJSAMPLE(inptr1[0]);
+      nextcolsum = GETJSAMPLE(inptr0[1]) * 3 + GETJSAMPLE(inptr1[1]);
+      outptr[0] = (JSAMPLE) ((thiscolsum * 4 + 8) >> 4);
+      outptr[1] = (JSAMPLE) ((thiscolsum * 3 + nextcolsum + 7) >> 4);
+
+      /* Column sums 3 * nearer + further, for col-1, col and col+1 */
+#define COLSUM(p0,p1) \
+      (a = h ? HI16(LOAD16(p0)) : LO16(LOAD16(p0)), \
+       b = h ? HI16(LOAD16(p1)) : LO16(LOAD16(p1)), \
+       _mm_add_epi16(_mm_add_epi16(a, a), _mm_add_epi16(a, b)))
+
+      for (col = 1; col + 17 <= width; col += 16) {
+	for (h = 0; h < 2; h++) {
+	  lastsum = COLSUM(inptr0 + col - 1, inptr1 + col - 1);
+	  thissum = COLSUM(inptr0 + col, inptr1 + col);
+	  nextsum = COLSUM(inptr0 + col + 1, inptr1 + col + 1);
+	  thissum = _mm_add_epi16(thissum, _mm_add_epi16(thissum, thissum));
+	  even[h] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(thissum, lastsum),
+						 eight), 4);
+	  odd[h] = _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(thissum, nextsum),
+						seven), 4);
+	}
+	e = _mm_packus_epi16(even[0], even[1]);
+	o = _mm_packus_epi16(odd[0], odd[1]);
+	_mm_storeu_si128((__m128i *) (outptr + 2*col), _mm_unpacklo_epi8(e, o));
+	_mm_storeu_si128((__m128i *) (outptr + 2*col + 16),
+			 _mm_unpackhi_epi8(e, o));
+      }
+#undef COLSUM
+
+      lastcolsum = GETJSAMPLE(inptr0[col-1]) * 3 + GETJSAMPLE(inptr1[col-1]);
+      thiscolsum = GETJSAMPLE(inptr0[col]) * 3 + GETJSAMPLE(inptr1[col]);
+      for (; col < width - 1; col++) {
+	nextcolsum = GETJSAMPLE(inptr0[col+1]) * 3 + GETJSAMPLE(inptr1[col+1]);
+	outptr[2*col] = (JSAMPLE) ((thiscolsum * 3 + lastcolsum + 8) >> 4);
+	outptr[2*col+1] = (JSAMPLE) ((thiscolsum * 3 + nextcolsum + 7) >> 4);
+	lastcolsum = thiscolsum; thiscolsum = nextcolsum;
+      }
+
+      /* Special case for last column */
+      outptr[2*col] = (JSAMPLE) ((thiscolsum * 3 + lastcolsum + 8) >> 4);
+      outptr[2*col+1] = (JSAMPLE) ((thiscolsum * 4 + 7) >> 4);
+    }
+    inrow++;
+  }
+}
+
+
+GLOBAL(int)
+jsimd_can_fancy_upsample (void)
+{
+  if (BITS_IN_JSAMPLE != 8)
+    return 0;
+  return jsimd_level() > 0;
+}
+
+
+/**************** YCbCr -> RGB/BGR/BGRX ****************/
+
+/* The color deconverter tables hold, for x = Cb or Cr less CENTERJSAMPLE,
+ *	Cr=>R	(FIX(1.40200) * x + ONE_HALF) >> 16
+ *	Cb=>B	(FIX(1.77200) * x + ONE_HALF) >> 16
+ *	Cb,Cr=>G (- FIX(0.34414) * Cb - FIX(0.71414) * Cr + ONE_HALF) >> 16
+ * These are computed here with pmaddwd, which needs the constants to fit
+ * in 16 bits; they do after splitting them as c0 * x + c1 * (2^k * x):
+ * 91881 = 27881 + 2 * 32000, 116130 = 2 + 4 * 29032, 46802 = 2 * 23401.
+ */
+
+#define SCALEBITS	16
+#define ONE_HALF	((INT32) 1 << (SCALEBITS-1))
+#define YCC_FIX(x)	((INT32) ((x) * (1L<<SCALEBITS) + 0.5))
+
+INLINE LOCAL(__m128i)
+ycc_term (__m128i a, __m128i b, __m128i k)
+{
+  __m128i half = _mm_set1_epi32(ONE_HALF);
+  __m128i lo = _mm_madd_epi16(_mm_unpacklo_epi16(a, b), k);
+  __m128i hi = _mm_madd_epi16(_mm_unpackhi_epi16(a, b), k);
+
+  return _mm_packs_epi32(_mm_srai_epi32(_mm_add_epi32(lo, half), SCALEBITS),
+			 _mm_srai_epi32(_mm_add_epi32(hi, half), SCALEBITS));
+}
+
+
+/* Convert 8 pixels, giving 16 bit R, G and B. */
+
+INLINE LOCAL(void)
+ycc_rgb8 (__m128i y, __m128i cb, __m128i cr,
+	  __m128i * r, __m128i * g, __m128i * b)
+{
+  __m128i center = _mm_set1_epi16(CENTERJSAMPLE);
+
+  cb = _mm_sub_epi16(cb, center);
+  cr = _mm_sub_epi16(cr, center);
+  *r = _mm_add_epi16(y, ycc_term(cr, _mm_add_epi16(cr, cr),
+				 PAIR(27881, 32000)));
+  *g = _mm_add_epi16(y, ycc_term(cb, _mm_add_epi16(cr, cr),
+				 PAIR(- YCC_FIX(0.34414), - YCC_FIX(0.71414) / 2)));
+  *b = _mm_add_epi16(y, ycc_term(cb, _mm_slli_epi16(cb, 2),
+				 PAIR(2, 29032)));
+}
+
+
+/* 4 pixels of 4 bytes to 12 bytes, in the low bytes */
+
+INLINE LOCAL(__m128i)
+pack3 (__m128i v)
+{
+  __m128i lo = _mm_and_si128(v, _mm_set_epi32(0, 0xFFFFFF, 0, 0xFFFFFF));
+  __m128i hi = _mm_and_si128(_mm_srli_epi64(v, 8),
+			     _mm_set_epi32(0xFFFF, (int) 0xFF000000,
+					   0xFFFF, (int) 0xFF000000));
+
+  v = _mm_or_si128(lo, hi);
+  return _mm_or_si128(_mm_move_epi64(v),
+		      _mm_slli_si128(_mm_srli_si128(v, 8), 6));
+}
+
+
+GLOBAL(void)
+jsimd_ycc_rgb_convert (j_decompress_ptr cinfo,
+		       JSAMPIMAGE input_buf, JDIMENSION input_row,
+		       JSAMPARRAY output_buf, int num_rows)
+{
+  JSAMPROW inptr0, inptr1, inptr2, outptr;
+  JDIMENSION col, num_cols = cinfo->output_width;
+  JSAMPLE * range_limit = cinfo->sample_range_limit;
+  int pixelsize = cinfo->out_color_components;
+  int bgr = cinfo->out_color_space != JCS_RGB;
+  int y, cb, cr, k, rpos, bpos;
+  __m128i vy, vcb, vcr, r[2], g[2], b[2], c0, c1, c2, p01, p2x, px[4];
+  SHIFT_TEMPS
+
+  rpos = bgr ? 2 : 0;
+  bpos = 2 - rpos;
+  while (--num_rows >= 0) {
+    inptr0 = input_buf[0][input_row];
+    inptr1 = input_buf[1][input_row];
+    inptr2 = input_buf[2][input_row];
+    input_row++;
+    outptr = *output_buf++;
+
+    /* 16 pixels at a time.  The 3 byte stores write 4 bytes beyond their
+     * pixels, so those keep clear of the last 2 pixels of the row.
+     */
+    for (col = 0; col + 16 + (pixelsize == 3 ? 2 : 0) <= num_cols; col += 16) {
+      vy = LOAD16(inptr0 + col);
+      vcb = LOAD16(inptr1 + col);
+      vcr = LOAD16(inptr2 + col);
+      ycc_rgb8(LO16(vy), LO16(vcb), LO16(vcr), &r[0], &g[0], &b[0]);
+      ycc_rgb8(HI16(vy), HI16(vcb), HI16(vcr), &r[1], &g[1], &b[1]);
+      c0 = _mm_packus_epi16(r[0], r[1]);
+      c1 = _mm_packus_epi16(g[0], g[1]);
+      c2 = _mm_packus_epi16(b[0], b[1]);
+      if (bgr) {
+	__m128i t = c0; c0 = c2; c2 = t;
+      }
+      p01 = _mm_unpacklo_epi8(c0, c1);
+      p2x = _mm_unpacklo_epi8(c2, _mm_setzero_si128());
+      px[0] = _mm_unpacklo_epi16(p01, p2x);
+      px[1] = _mm_unpackhi_epi16(p01, p2x);
+      p01 = _mm_unpackhi_epi8(c0, c1);
+      p2x = _mm_unpackhi_epi8(c2, _mm_setzero_si128());
+      px[2] = _mm_unpacklo_epi16(p01, p2x);
+      px[3] = _mm_unpackhi_epi16(p01, p2x);
+      if (pixelsize == 4) {
+	for (k = 0; k < 4; k++)
+	  _mm_storeu_si128((__m128i *) (outptr + 16*k), px[k]);
+      } else {
+	for (k = 0; k < 4; k++)
+	  _mm_storeu_si128((__m128i *) (outptr + 12*k), pack3(px[k]));
+      }
+      outptr += 16 * pixelsize;
+    }
+
+    for (; col < num_cols; col++) {
+      y  = GETJSAMPLE(inptr0[col]);
+      cb = GETJSAMPLE(inptr1[col]) - CENTERJSAMPLE;
+      cr = GETJSAMPLE(inptr2[col]) - CENTERJSAMPLE;
+      outptr[rpos] = range_limit[y + (int)
+	RIGHT_SHIFT(YCC_FIX(1.40200) * cr + ONE_HALF, SCALEBITS)];
+      outptr[1] = range_limit[y + (int)
+	RIGHT_SHIFT(- YCC_FIX(0.34414) * cb - YCC_FIX(0.71414) * cr + ONE_HALF,
+		    SCALEBITS)];
+      outptr[bpos] = range_limit[y + (int)
+	RIGHT_SHIFT(YCC_FIX(1.77200) * cb + ONE_HALF, SCALEBITS)];
+      if (pixelsize == 4)
+	outptr[3] = 0;
+      outptr += pixelsize;
+    }
+  }
+}
+
+
+GLOBAL(int)
+jsimd_can_ycc_rgb (j_decompress_ptr cinfo)
+{
+  if (BITS_IN_JSAMPLE != 8)
+    return 0;
+  if (cinfo->out_color_space == JCS_RGB &&
+      (RGB_PIXELSIZE != 3 || RGB_RED != 0 || RGB_GREEN != 1 || RGB_BLUE != 2))
+    return 0;
+  return jsimd_level() > 0;
+}
+
+#endif /* JPEG_SIMD_SUPPORTED */
@@ -0,0 +1,164 @@
+/*
+ * jmemtemp.c
+ *
+ * This file is not part of the Independent JPEG Group's distribution.
+ * For conditions of distribution and use, see the accompanying README file.
+ *
+ * This file provides the system-dependent portion of the JPEG memory
+ * manager, based on jmemnobs.c and jmemansi.c.  Without a limit, it is
+ * the same as jmemnobs.c: everything comes from malloc().  Once the
+ * application (or the JPEGMEM environment variable) sets max_memory_to_use,
+ * the virtual arrays that do not fit, such as the coefficient buffer of a
+ * progressive JPEG, are kept in a temporary file instead.
+ */
+
+#define JPEG_INTERNALS
+#include "jinclude.h"
+#include "jpeglib.h"
+#include "jmemsys.h"		/* import the system-dependent declarations */
+
+#ifndef HAVE_STDLIB_H		/* <stdlib.h> should declare malloc(),free() */
+extern void * malloc JPP((size_t size));
+extern void free JPP((void *ptr));
+#endif
+
+#ifndef SEEK_SET		/* pre-ANSI systems may not define this; */
+#define SEEK_SET  0		/* if not, assume 0 is correct */
+#endif
+
+
+/*
+ * Memory allocation and freeing are controlled by the regular library
+ * routines malloc() and free().
+ */
+
+GLOBAL(void *)
+jpeg_get_small (j_common_ptr cinfo, size_t sizeofobject)
+{
+  return (void *) malloc(sizeofobject);
+}
+
+GLOBAL(void)
+jpeg_free_small (j_common_ptr cinfo, void * object, size_t sizeofobject)
+{
+  free(object);
+}
+
+
+/*
+ * "Large" objects are treated the same as "small" ones.
+ */
+
+GLOBAL(void FAR *)
+jpeg_get_large (j_common_ptr cinfo, size_t sizeofobject)
+{
+  return (void FAR *) malloc(sizeofobject);
+}
+
+GLOBAL(void)
+jpeg_free_large (j_common_ptr cinfo, void FAR * object, size_t sizeofobject)
+{
+  free(object);
+}
+
+
+/*
+ * This routine computes the total memory space available for allocation.
+ * With no limit set, all of it; otherwise what is left of the limit.
+ */
+
+GLOBAL(long)
+jpeg_mem_available (j_common_ptr cinfo, long min_bytes_needed,
+		    long max_bytes_needed, long already_allocated)
+{
+  if (cinfo->mem->max_memory_to_use <= 0)
+    return max_bytes_needed;
+  return cinfo->mem->max_memory_to_use - already_allocated;
+}
+
+
+/*
+ * Backing store (temporary file) management.
+ * The temporary file is opened such that it goes away by itself when it
+ * is closed, or when the program exits: with tmpfile() where that is
+ * usable, and on Windows (where tmpfile() wants to write to the root
+ * of the drive) as a named file in %TMP% with the 'D' (delete on close)
+ * and 'T' (try to keep in cache) flags.
+ */
+
+METHODDEF(void)
+read_backing_store (j_common_ptr cinfo, backing_store_ptr info,
+		    void FAR * buffer_address,
+		    long file_offset, long byte_count)
+{
+  if (fseek(info->temp_file, file_offset, SEEK_SET))
+    ERREXIT(cinfo, JERR_TFILE_SEEK);
+  if (JFREAD(info->temp_file, buffer_address, byte_count)
+      != (size_t) byte_count)
+    ERREXIT(cinfo, JERR_TFILE_READ);
+}
+
+
+METHODDEF(void)
+write_backing_store (j_common_ptr cinfo, backing_store_ptr info,
+		     void FAR * buffer_address,
+		     long file_offset, long byte_count)
+{
+  if (fseek(info->temp_file, file_offset, SEEK_SET))
+    ERREXIT(cinfo, JERR_TFILE_SEEK);
+  if (JFWRITE(info->temp_file, buffer_address, byte_count)
+      != (size_t) byte_count)
+    ERREXIT(cinfo, JERR_TFILE_WRITE);
+}
+
+
+METHODDEF(void)
+close_backing_store (j_common_ptr cinfo, backing_store_ptr info)
+{
+  fclose(info->temp_file);
+}
+
+
+GLOBAL(void)
+jpeg_open_backing_store (j_common_ptr cinfo, backing_store_ptr info,
+			 long total_bytes_needed)
+{
+#ifdef _WIN32
+  char * name = _tempnam(NULL, "jpg");
+
+  info->temp_file = NULL;
+  info->temp_name[0] = '\0';
+  if (name != NULL) {
+    strncpy(info->temp_name, name, TEMP_NAME_LENGTH-1);
+    info->temp_name[TEMP_NAME_LENGTH-1] = '\0';
+    info->temp_file = fopen(name, "w+bTD");
+    free(name);
+  }
+#else
+  info->temp_name[0] = '\0';
+  info->temp_file = tmpfile();
+#endif
+  if (info->temp_file == NULL)
+    ERREXITS(cinfo, JERR_TFILE_CREATE, info->temp_name);
+  info->read_backing_store = read_backing_store;
+  info->write_backing_store = write_backing_store;
+  info->close_backing_store = close_backing_store;
+}
+
+
+/*
+ * These routines take care of any system-dependent initialization and
+ * cleanup required.
+ */
+
+GLOBAL(long)
+jpeg_mem_init (j_common_ptr cinfo)
+{
+  return 0;			/* no limit, unless the application sets one */
+}
+
+GLOBAL(void)
+jpeg_mem_term (j_common_ptr cinfo)
+{
+  /* no work */
+}
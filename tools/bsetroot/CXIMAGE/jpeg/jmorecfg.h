@@ -301,6 +301,14 @@ typedef int boolean;
 #define QUANT_1PASS_SUPPORTED       /* 1-pass color quantization? */
 #define QUANT_2PASS_SUPPORTED       /* 2-pass color quantization? */
 
+/* SSE2/AVX2 versions of the islow IDCT, fancy upsampling and YCbCr->RGB
+ * conversion for x86-64 (jdsimd.c).  Define NO_JPEG_SIMD to leave out.
+ */
+#if !defined(NO_JPEG_SIMD) && (defined(__x86_64__) || defined(_M_X64)) && \
+    (defined(_MSC_VER) || defined(__clang__) || __GNUC__ >= 5)
+#define JPEG_SIMD_SUPPORTED
+#endif
+
 /* more capability options later, no doubt */
 
 
@@ -327,6 +327,13 @@ struct jpeg_color_quantizer {
 #define jzero_far		jZeroFar
 #define jpeg_zigzag_order	jZIGTable
 #define jpeg_natural_order	jZAGTable
+#define jsimd_can_idct_islow	jSCIslow
+#define jsimd_idct_islow	jSIslow
+#define jsimd_can_fancy_upsample jSCFancy
+#define jsimd_h2v1_fancy_upsample jSH2V1Fancy
+#define jsimd_h2v2_fancy_upsample jSH2V2Fancy
+#define jsimd_can_ycc_rgb	jSCYccRgb
+#define jsimd_ycc_rgb_convert	jSYccRgb
 #endif /* NEED_SHORT_EXTERNAL_NAMES */
 
 
@@ -382,6 +389,27 @@ extern const int jpeg_zigzag_order[]; /* natural coef order to zigzag order */
 #endif
 extern const int jpeg_natural_order[]; /* zigzag coef order to natural order */
 
+#ifdef JPEG_SIMD_SUPPORTED
+/* SIMD versions of decompression routines in jdsimd.c; the jsimd_can_xxx
+ * checks tell whether the cpu and the build settings allow them.
+ */
+EXTERN(int) jsimd_can_idct_islow JPP((void));
+EXTERN(void) jsimd_idct_islow
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JCOEFPTR coef_block, JSAMPARRAY output_buf, JDIMENSION output_col));
+EXTERN(int) jsimd_can_fancy_upsample JPP((void));
+EXTERN(void) jsimd_h2v1_fancy_upsample
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+EXTERN(void) jsimd_h2v2_fancy_upsample
+    JPP((j_decompress_ptr cinfo, jpeg_component_info * compptr,
+	 JSAMPARRAY input_data, JSAMPARRAY * output_data_ptr));
+EXTERN(int) jsimd_can_ycc_rgb JPP((j_decompress_ptr cinfo));
+EXTERN(void) jsimd_ycc_rgb_convert
+    JPP((j_decompress_ptr cinfo, JSAMPIMAGE input_buf, JDIMENSION input_row,
+	 JSAMPARRAY output_buf, int num_rows));
+#endif
+
 /* Suppress undefined-structure complaints if necessary. */
 
 #ifdef INCOMPLETE_TYPES_BROKEN
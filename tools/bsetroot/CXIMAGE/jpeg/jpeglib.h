@@ -209,7 +209,9 @@ typedef enum {
 	JCS_RGB,		/* red/green/blue */
 	JCS_YCbCr,		/* Y/Cb/Cr (also known as YUV) */
 	JCS_CMYK,		/* C/M/Y/K */
-	JCS_YCCK		/* Y/Cb/Cr/K */
+	JCS_YCCK,		/* Y/Cb/Cr/K */
+	JCS_EXT_BGR,		/* blue/green/red, output only */
+	JCS_EXT_BGRX		/* blue/green/red/0, output only */
 } J_COLOR_SPACE;
 
 /* DCT/IDCT algorithm options. */
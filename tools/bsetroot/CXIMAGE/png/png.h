@@ -1566,6 +1566,10 @@ extern PNG_EXPORT(void,png_write_rows) PNGARG((png_structp png_ptr,
 extern PNG_EXPORT(void,png_write_image) PNGARG((png_structp png_ptr,
    png_bytepp image));
 
+/* write image data that the application filtered and compressed itself */
+extern PNG_EXPORT(void,png_write_compressed_image) PNGARG((png_structp png_ptr,
+   png_bytep data, png_size_t length));
+
 /* writes the end of the PNG file. */
 extern PNG_EXPORT(void,png_write_end) PNGARG((png_structp png_ptr,
    png_infop info_ptr));
@@ -2962,6 +2966,12 @@ PNG_EXTERN void png_do_write_interlace PNGARG((png_row_infop row_info,
 PNG_EXTERN void png_read_filter_row PNGARG((png_structp png_ptr,
    png_row_infop row_info, png_bytep row, png_bytep prev_row, int filter));
 
+#if defined(PNG_SSE_CODE_SUPPORTED)
+/* unfilter a row with SSE2/SSSE3, returns 0 if not done (pngsse.c) */
+PNG_EXTERN int png_read_filter_row_sse PNGARG((png_row_infop row_info,
+   png_bytep row, png_bytep prev_row, int filter));
+#endif
+
 /* Choose the best filter to use and filter the row data */
 PNG_EXTERN void png_write_find_filter PNGARG((png_structp png_ptr,
    png_row_infop row_info));
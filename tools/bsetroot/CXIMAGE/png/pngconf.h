@@ -1341,6 +1341,15 @@ typedef z_stream FAR *  png_zstreamp;
 #endif
 /* - see pnggccrd.c for info about what is currently enabled */
 
+/* SSE2/SSSE3 intrinsics for png_read_filter_row on x86-64, see pngsse.c .
+ * The makefile must compile and load pngsse.c; SSSE3 is detected at run
+ * time.  Define PNG_NO_SSE_CODE to use the plain C code only.
+ */
+#if !defined(PNG_NO_SSE_CODE) && !defined(PNG_HAVE_ASSEMBLER_READ_FILTER_ROW) \
+   && (defined(__x86_64__) || defined(_M_X64))
+#  define PNG_SSE_CODE_SUPPORTED
+#endif
+
 #endif /* PNG_INTERNAL */
 #endif /* PNG_READ_SUPPORTED */
 
@@ -2667,6 +2667,11 @@ png_read_filter_row(png_structp png_ptr, png_row_infop row_info, png_bytep row,
 {
    png_debug(1, "in png_read_filter_row\n");
    png_debug2(2,"row = %lu, filter = %d\n", png_ptr->row_number, filter);
+#if defined(PNG_SSE_CODE_SUPPORTED)
+   if (filter > PNG_FILTER_VALUE_NONE && filter < PNG_FILTER_VALUE_LAST &&
+       png_read_filter_row_sse(row_info, row, prev_row, filter))
+      return;
+#endif
    switch (filter)
    {
       case PNG_FILTER_VALUE_NONE:
@@ -0,0 +1,297 @@
+/* pngsse.c - SSE2/SSSE3 version of png_read_filter_row
+ *
+ * For x86-64 CPUs, with compilers that have the SSE intrinsics (gcc,
+ * clang, MSVC).  Unlike pnggccrd.c and pngvcrd.c this needs no inline
+ * assembler, and so works also for 64 bit builds.
+ *
+ * For conditions of distribution and use, see copyright notice in png.h
+ *
+ * Sub, Avg and Paeth are done for 3 and 4 byte pixels (8 bit RGB and
+ * RGBA), Up for all pixel sizes.  The results are the same as from the
+ * C code in pngrutil.c, byte for byte.  SSE2 is always there on x86-64;
+ * SSSE3 (pabsw, for Paeth) is detected at run time.
+ */
+
+#define PNG_INTERNAL
+#include "png.h"
+
+#if defined(PNG_SSE_CODE_SUPPORTED)
+
+#include <emmintrin.h>
+
+#if defined(_MSC_VER)
+#  include <intrin.h>
+#  include <tmmintrin.h>
+#  define PNG_SSSE3_CODE
+#  define PNG_SSSE3_FUNC
+#elif defined(__clang__) || (defined(__GNUC__) && __GNUC__ >= 5)
+#  include <cpuid.h>
+#  include <tmmintrin.h>
+#  define PNG_SSSE3_CODE
+#  define PNG_SSSE3_FUNC __attribute__((target("ssse3")))
+#endif
+
+/* 0 = not yet checked, 1 = SSE2, 2 = SSE2 + SSSE3.  Several threads may
+ * race to set it, but they all write the same value. */
+static int png_sse_level;
+
+static int
+png_sse_detect(void)
+{
+   int level = 1;
+#if defined(PNG_SSSE3_CODE)
+#  if defined(_MSC_VER)
+   int r[4];
+   __cpuid(r, 1);
+   if (r[2] & (1 << 9))
+      level = 2;
+#  else
+   unsigned int a, b, c, d;
+   if (__get_cpuid(1, &a, &b, &c, &d) && (c & bit_SSSE3))
+      level = 2;
+#  endif
+#endif
+   return level;
+}
+
+/* pixels of 3 or 4 bytes in the low bytes of a register.  The unaligned
+ * 32 bit moves go through png_memcpy, which the compiler inlines. */
+static __m128i
+png_load4(png_bytep p)
+{
+   int t;
+   png_memcpy(&t, p, 4);
+   return _mm_cvtsi32_si128(t);
+}
+
+static __m128i
+png_load3(png_bytep p)
+{
+   int t = 0;
+   png_memcpy(&t, p, 3);
+   return _mm_cvtsi32_si128(t);
+}
+
+static void
+png_store4(png_bytep p, __m128i v)
+{
+   int t = _mm_cvtsi128_si32(v);
+   png_memcpy(p, &t, 4);
+}
+
+static void
+png_store3(png_bytep p, __m128i v)
+{
+   int t = _mm_cvtsi128_si32(v);
+   png_memcpy(p, &t, 3);
+}
+
+static void
+png_sse_up(png_bytep rp, png_bytep pp, png_uint_32 n)
+{
+   for (; n >= 16; n -= 16, rp += 16, pp += 16)
+      _mm_storeu_si128((__m128i *)rp, _mm_add_epi8(
+         _mm_loadu_si128((const __m128i *)rp),
+         _mm_loadu_si128((const __m128i *)pp)));
+   for (; n; n--, rp++, pp++)
+      *rp = (png_byte)(*rp + *pp);
+}
+
+/* Sub is a running sum over the pixels.  It is done for 4 pixels at
+ * once with shifted adds, plus the carry from the last pixel before. */
+static void
+png_sse_sub4(png_bytep rp, png_uint_32 n)
+{
+   __m128i a = _mm_setzero_si128();
+   __m128i x;
+
+   for (; n >= 16; n -= 16, rp += 16)
+   {
+      x = _mm_loadu_si128((const __m128i *)rp);
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+      x = _mm_add_epi8(x, a);
+      _mm_storeu_si128((__m128i *)rp, x);
+      a = _mm_shuffle_epi32(x, 0xff);
+   }
+   for (; n >= 4; n -= 4, rp += 4)
+   {
+      a = _mm_add_epi8(png_load4(rp), a);
+      png_store4(rp, a);
+   }
+}
+
+static void
+png_sse_sub3(png_bytep rp, png_uint_32 n)
+{
+   __m128i a = _mm_setzero_si128();
+   __m128i x;
+
+   /* 12 bytes per step, but 16 byte loads, so keep off the end */
+   for (; n >= 16; n -= 12, rp += 12)
+   {
+      x = _mm_loadu_si128((const __m128i *)rp);
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+      a = _mm_or_si128(a, _mm_slli_si128(a, 3));
+      a = _mm_or_si128(a, _mm_slli_si128(a, 6));
+      x = _mm_add_epi8(x, a);
+      _mm_storel_epi64((__m128i *)rp, x);
+      png_store4(rp + 8, _mm_srli_si128(x, 8));
+      a = _mm_and_si128(_mm_srli_si128(x, 9), _mm_cvtsi32_si128(0xffffff));
+   }
+   for (; n >= 3; n -= 3, rp += 3)
+   {
+      a = _mm_add_epi8(png_load3(rp), a);
+      png_store3(rp, a);
+   }
+}
+
+/* Avg: (a + b) / 2 is pavgb, which rounds up, less the odd bit */
+static void
+png_sse_avg(png_bytep rp, png_bytep pp, png_uint_32 n, int bpp)
+{
+   const __m128i one = _mm_set1_epi8(1);
+   __m128i a = _mm_setzero_si128();
+   __m128i b, d;
+
+   if (bpp == 4)
+   {
+      for (; n >= 4; n -= 4, rp += 4, pp += 4)
+      {
+         b = png_load4(pp);
+         d = png_load4(rp);
+         d = _mm_add_epi8(d, _mm_sub_epi8(_mm_avg_epu8(a, b),
+            _mm_and_si128(_mm_xor_si128(a, b), one)));
+         png_store4(rp, d);
+         a = d;
+      }
+      return;
+   }
+
+   /* the 4th byte is junk but stays in its lane.  The last pixel
+    * can't be read with 4 bytes. */
+   for (; n >= 3; n -= 3, rp += 3, pp += 3)
+   {
+      if (n > 3)
+         b = png_load4(pp), d = png_load4(rp);
+      else
+         b = png_load3(pp), d = png_load3(rp);
+      d = _mm_add_epi8(d, _mm_sub_epi8(_mm_avg_epu8(a, b),
+         _mm_and_si128(_mm_xor_si128(a, b), one)));
+      png_store3(rp, d);
+      a = d;
+   }
+}
+
+/* Paeth, in 16 bit lanes.  'a' is left, 'b' above, 'c' above left.
+ * For the first pixel a = c = 0, which makes it the same as Up. */
+#define PNG_SSE_PAETH(abs16) \
+   { \
+      __m128i pa, pb, pc, m; \
+      pa = _mm_sub_epi16(b, c); \
+      pb = _mm_sub_epi16(a, c); \
+      pc = _mm_add_epi16(pa, pb); \
+      pa = abs16(pa); \
+      pb = abs16(pb); \
+      pc = abs16(pc); \
+      m = _mm_min_epi16(pc, _mm_min_epi16(pa, pb)); \
+      /* first of a, b, c which is nearest */ \
+      pb = _mm_cmpeq_epi16(pb, m); \
+      pa = _mm_cmpeq_epi16(pa, m); \
+      m = _mm_or_si128(_mm_and_si128(pb, b), _mm_andnot_si128(pb, c)); \
+      m = _mm_or_si128(_mm_and_si128(pa, a), _mm_andnot_si128(pa, m)); \
+      d = _mm_add_epi8(d, _mm_packus_epi16(m, m)); \
+   }
+
+#define PNG_SSE_PAETH_LOOP(abs16) \
+   { \
+      const __m128i z = _mm_setzero_si128(); \
+      __m128i a = z, b, c = z, d; \
+      if (bpp == 4) \
+      { \
+         for (; n >= 4; n -= 4, rp += 4, pp += 4) \
+         { \
+            b = _mm_unpacklo_epi8(png_load4(pp), z); \
+            d = png_load4(rp); \
+            PNG_SSE_PAETH(abs16) \
+            png_store4(rp, d); \
+            a = _mm_unpacklo_epi8(d, z); \
+            c = b; \
+         } \
+         return; \
+      } \
+      for (; n >= 3; n -= 3, rp += 3, pp += 3) \
+      { \
+         if (n > 3) \
+            b = png_load4(pp), d = png_load4(rp); \
+         else \
+            b = png_load3(pp), d = png_load3(rp); \
+         b = _mm_unpacklo_epi8(b, z); \
+         PNG_SSE_PAETH(abs16) \
+         png_store3(rp, d); \
+         a = _mm_unpacklo_epi8(d, z); \
+         c = b; \
+      } \
+   }
+
+static __m128i
+png_abs16_sse2(__m128i x)
+{
+   return _mm_max_epi16(x, _mm_sub_epi16(_mm_setzero_si128(), x));
+}
+
+static void
+png_sse2_paeth(png_bytep rp, png_bytep pp, png_uint_32 n, int bpp)
+   PNG_SSE_PAETH_LOOP(png_abs16_sse2)
+
+#if defined(PNG_SSSE3_CODE)
+PNG_SSSE3_FUNC static void
+png_ssse3_paeth(png_bytep rp, png_bytep pp, png_uint_32 n, int bpp)
+   PNG_SSE_PAETH_LOOP(_mm_abs_epi16)
+#endif
+
+/* Returns 0 if it's nothing for us, then the C code does it. */
+int /* PRIVATE */
+png_read_filter_row_sse(png_row_infop row_info, png_bytep row,
+   png_bytep prev_row, int filter)
+{
+   png_uint_32 n = row_info->rowbytes;
+   int bpp = (row_info->pixel_depth + 7) >> 3;
+
+   if (png_sse_level == 0)
+      png_sse_level = png_sse_detect();
+
+   if (filter == PNG_FILTER_VALUE_UP)
+   {
+      png_sse_up(row, prev_row, n);
+      return 1;
+   }
+
+   if (bpp != 3 && bpp != 4)
+      return 0;
+
+   switch (filter)
+   {
+      case PNG_FILTER_VALUE_SUB:
+         if (bpp == 4)
+            png_sse_sub4(row, n);
+         else
+            png_sse_sub3(row, n);
+         return 1;
+      case PNG_FILTER_VALUE_AVG:
+         png_sse_avg(row, prev_row, n, bpp);
+         return 1;
+      case PNG_FILTER_VALUE_PAETH:
+#if defined(PNG_SSSE3_CODE)
+         if (png_sse_level == 2)
+            png_ssse3_paeth(row, prev_row, n, bpp);
+         else
+#endif
+            png_sse2_paeth(row, prev_row, n, bpp);
+         return 1;
+   }
+   return 0;
+}
+
+#endif /* PNG_SSE_CODE_SUPPORTED */
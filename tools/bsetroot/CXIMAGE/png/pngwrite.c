@@ -713,6 +713,33 @@ png_write_image(png_structp png_ptr, png_bytepp image)
    }
 }
 
+/* Write image data that the application has already filtered and
+ * compressed, as one complete zlib stream, in place of png_write_image()
+ * or png_write_row().  This allows to compress elsewhere, for example on
+ * several threads.  The stream is split into IDAT chunks of zbuf_size.
+ */
+void PNGAPI
+png_write_compressed_image(png_structp png_ptr, png_bytep data,
+   png_size_t length)
+{
+   png_size_t n;
+
+   png_debug(1, "in png_write_compressed_image\n");
+   if (!(png_ptr->mode & PNG_WROTE_INFO_BEFORE_PLTE))
+      png_error(png_ptr,
+         "png_write_info was never called before png_write_compressed_image.");
+   if (png_ptr->mode & PNG_HAVE_IDAT)
+      png_error(png_ptr, "Image data already written");
+
+   do
+   {
+      n = length < png_ptr->zbuf_size ? length : png_ptr->zbuf_size;
+      png_write_IDAT(png_ptr, data, n);
+      data += n;
+      length -= n;
+   } while (length);
+}
+
 /* called by user to write a row of image data */
 void PNGAPI
 png_write_row(png_structp png_ptr, png_bytep row)
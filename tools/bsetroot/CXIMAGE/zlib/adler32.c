@@ -5,7 +5,7 @@
 
 /* @(#) $Id$ */
 
-#include "zlib.h"
+#include "zutil.h"
 
 #define BASE 65521L /* largest prime smaller than 65536 */
 #define NMAX 5552
@@ -17,6 +17,70 @@
 #define DO8(buf,i)  DO4(buf,i); DO4(buf,i+4);
 #define DO16(buf)   DO8(buf,0); DO8(buf,8);
 
+#ifdef Z_X86_SIMD
+#include <tmmintrin.h>
+
+/* 32 bytes per step: s1 gets the byte sums (psadbw), s2 the sums
+   weighted with 32..1 (pmaddubsw), plus 32 times s1 from before each
+   step.  NMAX/32 steps at most between the modulo reductions. */
+local Z_TARGET("ssse3") uLong adler32_ssse3(adler, buf, len)
+    uLong adler;
+    const Bytef *buf;
+    uInt len;
+{
+    unsigned long s1 = adler & 0xffff;
+    unsigned long s2 = (adler >> 16) & 0xffff;
+    uInt blocks = len / 32;
+    const __m128i tap1 = _mm_setr_epi8(32,31,30,29,28,27,26,25,
+                                       24,23,22,21,20,19,18,17);
+    const __m128i tap2 = _mm_setr_epi8(16,15,14,13,12,11,10,9,
+                                       8,7,6,5,4,3,2,1);
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i ones = _mm_set1_epi16(1);
+
+    len -= blocks * 32;
+    while (blocks) {
+        uInt n = blocks < NMAX / 32 ? blocks : NMAX / 32;
+        __m128i v_ps = _mm_cvtsi32_si128((int)(s1 * n));
+        __m128i v_s2 = _mm_cvtsi32_si128((int)s2);
+        __m128i v_s1 = zero;
+        __m128i b1, b2;
+        blocks -= n;
+        do {
+            b1 = _mm_loadu_si128((const __m128i *)buf);
+            b2 = _mm_loadu_si128((const __m128i *)(buf + 16));
+            v_ps = _mm_add_epi32(v_ps, v_s1);
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b1, zero));
+            v_s2 = _mm_add_epi32(v_s2,
+                _mm_madd_epi16(_mm_maddubs_epi16(b1, tap1), ones));
+            v_s1 = _mm_add_epi32(v_s1, _mm_sad_epu8(b2, zero));
+            v_s2 = _mm_add_epi32(v_s2,
+                _mm_madd_epi16(_mm_maddubs_epi16(b2, tap2), ones));
+            buf += 32;
+        } while (--n);
+        v_s2 = _mm_add_epi32(v_s2, _mm_slli_epi32(v_ps, 5));
+
+        /* add up the lanes */
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0xb1));
+        v_s1 = _mm_add_epi32(v_s1, _mm_shuffle_epi32(v_s1, 0x4e));
+        s1 += (unsigned)_mm_cvtsi128_si32(v_s1);
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0xb1));
+        v_s2 = _mm_add_epi32(v_s2, _mm_shuffle_epi32(v_s2, 0x4e));
+        s2 = (unsigned)_mm_cvtsi128_si32(v_s2);
+
+        s1 %= BASE;
+        s2 %= BASE;
+    }
+    while (len--) {
+        s1 += *buf++;
+        s2 += s1;
+    }
+    s1 %= BASE;
+    s2 %= BASE;
+    return (s2 << 16) | s1;
+}
+#endif
+
 /* ========================================================================= */
 uLong ZEXPORT adler32(adler, buf, len)
     uLong adler;
@@ -28,6 +92,10 @@ uLong ZEXPORT adler32(adler, buf, len)
     int k;
 
     if (buf == Z_NULL) return 1L;
+#ifdef Z_X86_SIMD
+    if (len >= 64 && (z_cpu_features() & Z_CPU_SSSE3))
+        return adler32_ssse3(adler, buf, len);
+#endif
 
     while (len > 0) {
         k = len < NMAX ? len : NMAX;
@@ -46,3 +114,28 @@ uLong ZEXPORT adler32(adler, buf, len)
     }
     return (s2 << 16) | s1;
 }
+
+/* ========================================================================= */
+uLong ZEXPORT adler32_combine(adler1, adler2, len2)
+    uLong adler1;
+    uLong adler2;
+    z_off_t len2;
+{
+    unsigned long sum1;
+    unsigned long sum2;
+    unsigned rem;
+
+    /* s1 of the combination is s1 of both minus the extra initial 1,
+       s2 gets len2 times s1 of the first part on top of both s2 */
+    rem = (unsigned)(len2 % BASE);
+    sum1 = adler1 & 0xffff;
+    sum2 = rem * sum1;
+    sum2 %= BASE;
+    sum1 += (adler2 & 0xffff) + BASE - 1;
+    sum2 += ((adler1 >> 16) & 0xffff) + ((adler2 >> 16) & 0xffff) + BASE - rem;
+    if (sum1 >= BASE) sum1 -= BASE;
+    if (sum1 >= BASE) sum1 -= BASE;
+    if (sum2 >= ((unsigned long)BASE << 1)) sum2 -= ((unsigned long)BASE << 1);
+    if (sum2 >= BASE) sum2 -= BASE;
+    return sum1 | (sum2 << 16);
+}
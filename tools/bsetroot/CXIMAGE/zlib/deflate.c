@@ -298,10 +298,17 @@ int ZEXPORT deflateSetDictionary (strm, dictionary, dictLength)
     uInt n;
     IPos hash_head = 0;
 
-    if (strm == Z_NULL || strm->state == Z_NULL || dictionary == Z_NULL ||
-        strm->state->status != INIT_STATE) return Z_STREAM_ERROR;
+    if (strm == Z_NULL || strm->state == Z_NULL || dictionary == Z_NULL)
+        return Z_STREAM_ERROR;
 
     s = strm->state;
+    /* raw streams (noheader) start in BUSY_STATE, they can be primed
+     * as long as no input was taken yet.
+     */
+    if (s->noheader ? s->status != BUSY_STATE || s->strstart != 0 ||
+                      s->lookahead != 0
+                    : s->status != INIT_STATE) return Z_STREAM_ERROR;
+
     strm->adler = adler32(strm->adler, dictionary, dictLength);
 
     if (length < MIN_MATCH) return Z_OK;
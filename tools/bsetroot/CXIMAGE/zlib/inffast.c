@@ -12,6 +12,18 @@
 
 struct inflate_codes_state {int dummy;}; /* for buggy compilers */
 
+/* 64 bit little endian machines get the wide bit buffer version below */
+#if !defined(NO_INFFAST64) && (defined(__x86_64__) || defined(_M_X64) || \
+    defined(__aarch64__) || defined(_M_ARM64)) && \
+    !(defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__)
+#  define INFFAST64
+#  ifdef _MSC_VER
+typedef unsigned __int64 bit64;
+#  else
+typedef unsigned long long bit64;
+#  endif
+#endif
+
 /* simplify the use of the inflate_huft type with some defines */
 #define exop word.what.Exop
 #define bits word.what.Bits
@@ -25,6 +37,222 @@ struct inflate_codes_state {int dummy;}; /* for buggy compilers */
    at least ten.  The ten bytes are six bytes for the longest length/
    distance pair plus four bytes for overloading the bit buffer. */
 
+#ifdef INFFAST64
+
+/* The 64 bit version: the bit buffer is refilled with one unaligned
+   little endian load of eight bytes, which leaves at least 56 bits.
+   That is enough for up to three literals (15 bits each at most), or
+   for one length/distance pair (15+5+15+13 bits), without checking
+   again.  The bits above k in b are either zero or the true bits of
+   the next input bytes, so that reloading them with OR is harmless.
+
+   Matches are copied with 16 or 8 byte moves, or, for distances less
+   than eight, with an 8 byte pattern of the repeated bytes.  These may
+   write up to 15 bytes after the match, which is why the loop wants
+   258+16 bytes of room in the window rather than 258. */
+
+#define REFILL64 {\
+  bit64 t_; zmemcpy(&t_, p, 8); b |= t_ << k;\
+  c = (63 - k) >> 3; p += c; n -= c; k |= 56;}
+
+#define UNGRAB64 {c=z->avail_in-n;c=(k>>3)<c?k>>3:c;n+=c;p-=c;k-=c<<3;\
+  b&=((bit64)1<<k)-1;}
+
+#define UPDATE64 {s->bitb=(uLong)b;s->bitk=k;UPDIN UPDOUT}
+
+int inflate_fast(bl, bd, tl, td, s, z)
+uInt bl, bd;
+inflate_huft *tl;
+inflate_huft *td; /* need separate declaration for Borland C++ */
+inflate_blocks_statef *s;
+z_streamp z;
+{
+  inflate_huft *t;      /* temporary pointer */
+  uInt e;               /* extra bits or operation */
+  bit64 b;              /* bit buffer */
+  uInt k;               /* bits in bit buffer */
+  Bytef *p;             /* input data pointer */
+  uInt n;               /* bytes available there */
+  Bytef *q;             /* output window write pointer */
+  uInt m;               /* bytes to end of window or read pointer */
+  uInt ml;              /* mask for literal/length tree */
+  uInt md;              /* mask for distance tree */
+  uInt c;               /* bytes to copy */
+  uInt d;               /* distance back to copy from */
+  Bytef *r;             /* copy source pointer */
+
+  /* load input, output, bit values */
+  p=z->next_in;n=z->avail_in;b=s->bitb;k=s->bitk;
+  LOADOUT
+
+  /* initialize masks */
+  ml = inflate_mask[bl];
+  md = inflate_mask[bd];
+
+  /* do until not enough input or output space for fast loop */
+  while (m >= 258 + 16 && n >= 8)
+  {
+    REFILL64
+
+    /* literals straight from the first level table */
+    if ((e = (t = tl + ((uInt)b & ml))->exop) == 0)
+    {
+      DUMPBITS(t->bits)
+      *q++ = (Byte)t->base;
+      m--;
+      if ((e = (t = tl + ((uInt)b & ml))->exop) == 0)
+      {
+        DUMPBITS(t->bits)
+        *q++ = (Byte)t->base;
+        m--;
+        if ((e = (t = tl + ((uInt)b & ml))->exop) == 0)
+        {
+          DUMPBITS(t->bits)
+          *q++ = (Byte)t->base;
+          m--;
+        }
+      }
+      continue;
+    }
+
+    do {
+      DUMPBITS(t->bits)
+      if (e & 16)
+      {
+        /* get extra bits for length */
+        e &= 15;
+        c = t->base + ((uInt)b & inflate_mask[e]);
+        DUMPBITS(e)
+        Tracevv((stderr, "inflate:         * length %u\n", c));
+
+        /* decode distance base of block to copy */
+        e = (t = td + ((uInt)b & md))->exop;
+        do {
+          DUMPBITS(t->bits)
+          if (e & 16)
+          {
+            /* get extra bits to add to distance base */
+            e &= 15;
+            d = t->base + ((uInt)b & inflate_mask[e]);
+            DUMPBITS(e)
+            Tracevv((stderr, "inflate:         * distance %u\n", d));
+
+            /* do the copy */
+            m -= c;
+            if ((uInt)(q - s->window) < d)
+            {
+              r = q - d;
+              do {
+                r += s->end - s->window;        /* force pointer in window */
+              } while (r < s->window);          /* covers invalid distances */
+              e = s->end - r;
+              if (c > e)
+              {
+                c -= e;                         /* wrapped copy */
+                do {
+                    *q++ = *r++;
+                } while (--e);
+                r = s->window;
+              }
+              do {
+                  *q++ = *r++;
+              } while (--c);
+            }
+            else if (d >= 16)
+            {
+              r = q - d;
+              for (;;) {
+                zmemcpy(q, r, 16);
+                if (c <= 16)
+                  break;
+                q += 16; r += 16; c -= 16;
+              }
+              q += c;
+            }
+            else if (d >= 8)
+            {
+              r = q - d;
+              for (;;) {
+                zmemcpy(q, r, 8);
+                if (c <= 8)
+                  break;
+                q += 8; r += 8; c -= 8;
+              }
+              q += c;
+            }
+            else
+            {
+              /* a run with a short period: fill a pattern of whole
+                 periods and store that */
+              Byte pat[8];
+              r = q - d;
+              for (e = 0; e < 8; e++)
+                pat[e] = r[e % d];
+              e = 8 - 8 % d;
+              for (;;) {
+                zmemcpy(q, pat, 8);
+                if (c <= e)
+                  break;
+                q += e; c -= e;
+              }
+              q += c;
+            }
+            break;
+          }
+          else if ((e & 64) == 0)
+          {
+            t += t->base;
+            e = (t += ((uInt)b & inflate_mask[e]))->exop;
+          }
+          else
+          {
+            z->msg = (char*)"invalid distance code";
+            UNGRAB64
+            UPDATE64
+            return Z_DATA_ERROR;
+          }
+        } while (1);
+        break;
+      }
+      if ((e & 64) == 0)
+      {
+        t += t->base;
+        if ((e = (t += ((uInt)b & inflate_mask[e]))->exop) == 0)
+        {
+          DUMPBITS(t->bits)
+          Tracevv((stderr, t->base >= 0x20 && t->base < 0x7f ?
+                    "inflate:         * literal '%c'\n" :
+                    "inflate:         * literal 0x%02x\n", t->base));
+          *q++ = (Byte)t->base;
+          m--;
+          break;
+        }
+      }
+      else if (e & 32)
+      {
+        Tracevv((stderr, "inflate:         * end of block\n"));
+        UNGRAB64
+        UPDATE64
+        return Z_STREAM_END;
+      }
+      else
+      {
+        z->msg = (char*)"invalid literal/length code";
+        UNGRAB64
+        UPDATE64
+        return Z_DATA_ERROR;
+      }
+    } while (1);
+  }
+
+  /* not enough input or output--restore pointers and return */
+  UNGRAB64
+  UPDATE64
+  return Z_OK;
+}
+
+#else /* !INFFAST64 */
+
 int inflate_fast(bl, bd, tl, td, s, z)
 uInt bl, bd;
 inflate_huft *tl;
@@ -181,3 +409,5 @@ z_streamp z;
   UPDATE
   return Z_OK;
 }
+
+#endif /* INFFAST64 */
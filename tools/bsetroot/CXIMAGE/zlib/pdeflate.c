@@ -0,0 +1,246 @@
+/* pdeflate.c -- deflate a memory buffer on several threads
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ *
+ * Not part of the zlib distribution.  The input is cut into chunks that
+ * are deflated independently, as pigz does: each chunk is a raw deflate
+ * stream primed with the 32K of input before it as dictionary, so that
+ * matches may still reach back into the previous chunk.  All chunks but
+ * the last end with a sync flush, which leaves them byte aligned and not
+ * final, such that they can be put together one after the other.  The
+ * result gets the zlib header and the Adler-32 of the whole input, which
+ * is combined from the Adler-32s of the chunks.
+ */
+
+/* @(#) $Id$ */
+
+#include <stdlib.h>
+#include "zutil.h"
+#include "pdeflate.h"
+
+#ifdef _WIN32
+#  include <windows.h>
+#  include <process.h>
+#else
+#  include <pthread.h>
+#  include <unistd.h>
+#endif
+
+#define CHUNK_SIZE  (128*1024)  /* input per chunk */
+#define DICT_SIZE   (32*1024)   /* priming from the chunk before */
+#define MAX_THREADS 64
+
+typedef struct chunk_s {
+    const Bytef *in;    /* the input of this chunk */
+    uInt len;
+    uInt dict;          /* bytes before 'in' to prime the window with */
+    int last;           /* finish the stream, otherwise sync flush */
+    Bytef *out;         /* the raw deflate data, malloc'ed */
+    uLong out_len;
+    uLong adler;        /* of the input */
+    int err;
+} chunk;
+
+typedef struct worker_s {
+    chunk *c;
+    int first, count, step; /* does chunks first, first+step, ... */
+    int level, strategy;
+} worker;
+
+/* ===========================================================================
+   Deflates one chunk into c->out, growing the buffer if it was too small.
+*/
+local void deflate_chunk(c, level, strategy)
+    chunk *c;
+    int level;
+    int strategy;
+{
+    z_stream s;
+    uLong size;
+    Bytef *p;
+    int err;
+
+    c->adler = adler32(adler32(0L, Z_NULL, 0), c->in, c->len);
+
+    s.zalloc = (alloc_func)0;
+    s.zfree = (free_func)0;
+    s.opaque = (voidpf)0;
+    c->err = deflateInit2(&s, level, Z_DEFLATED, -MAX_WBITS, 8, strategy);
+    if (c->err != Z_OK) return;
+    if (c->dict)
+        deflateSetDictionary(&s, c->in - c->dict, c->dict);
+
+    /* stored blocks worst case, plus the sync flush */
+    size = c->len + (c->len >> 12) + (c->len >> 14) + 64;
+    c->out = (Bytef*)malloc(size);
+    err = c->out ? Z_OK : Z_MEM_ERROR;
+
+    s.next_in = (Bytef*)c->in;
+    s.avail_in = c->len;
+    while (err == Z_OK) {
+        s.next_out = c->out + s.total_out;
+        s.avail_out = (uInt)(size - s.total_out);
+        err = deflate(&s, c->last ? Z_FINISH : Z_SYNC_FLUSH);
+        if (err == Z_STREAM_END
+            || (!c->last && s.avail_out != 0 && err != Z_STREAM_ERROR)) {
+            err = Z_STREAM_END;
+            break;
+        }
+        if (err != Z_OK && err != Z_BUF_ERROR) break;
+        p = (Bytef*)realloc(c->out, size *= 2);
+        if (p == Z_NULL) { err = Z_MEM_ERROR; break; }
+        c->out = p;
+        err = Z_OK;
+    }
+    c->out_len = s.total_out;
+    deflateEnd(&s);
+    c->err = err == Z_STREAM_END ? Z_OK : err;
+}
+
+/* ===========================================================================
+ */
+#ifdef _WIN32
+local unsigned __stdcall worker_thread(void *arg)
+#else
+local void *worker_thread(void *arg)
+#endif
+{
+    worker *w = (worker*)arg;
+    int i;
+    for (i = w->first; i < w->count; i += w->step)
+        deflate_chunk(&w->c[i], w->level, w->strategy);
+    return 0;
+}
+
+local int cpu_count()
+{
+#ifdef _WIN32
+    SYSTEM_INFO si;
+    GetSystemInfo(&si);
+    return (int)si.dwNumberOfProcessors;
+#else
+    return (int)sysconf(_SC_NPROCESSORS_ONLN);
+#endif
+}
+
+/* ===========================================================================
+   Runs the workers, the first one on the calling thread.  A worker whose
+   thread could not be started is run here as well.
+*/
+local void run_workers(w, n)
+    worker *w;
+    int n;
+{
+    int i;
+#ifdef _WIN32
+    HANDLE t[MAX_THREADS];
+    for (i = 1; i < n; ++i)
+        t[i] = (HANDLE)_beginthreadex(NULL, 0, worker_thread, &w[i], 0, NULL);
+    worker_thread(&w[0]);
+    for (i = 1; i < n; ++i)
+        if (t[i])
+            WaitForSingleObject(t[i], INFINITE), CloseHandle(t[i]);
+        else
+            worker_thread(&w[i]);
+#else
+    pthread_t t[MAX_THREADS];
+    char ok[MAX_THREADS];
+    for (i = 1; i < n; ++i)
+        ok[i] = 0 == pthread_create(&t[i], NULL, worker_thread, &w[i]);
+    worker_thread(&w[0]);
+    for (i = 1; i < n; ++i)
+        if (ok[i])
+            pthread_join(t[i], NULL);
+        else
+            worker_thread(&w[i]);
+#endif
+}
+
+/* ===========================================================================
+ */
+int ZEXPORT pdeflate (dest, destLen, source, sourceLen, level, strategy, threads)
+    Bytef **dest;
+    uLongf *destLen;
+    const Bytef *source;
+    uLong sourceLen;
+    int level;
+    int strategy;
+    int threads;
+{
+    worker w[MAX_THREADS];
+    chunk *c;
+    Bytef *out;
+    uLong len, adler;
+    uInt header, level_flags;
+    int count, i, err;
+
+    *dest = Z_NULL;
+    *destLen = 0;
+    if (level == Z_DEFAULT_COMPRESSION) level = 6;
+    if (level < 0 || level > 9 || strategy < 0 || strategy > Z_HUFFMAN_ONLY)
+        return Z_STREAM_ERROR;
+
+    if (threads <= 0)
+        threads = cpu_count();
+    count = (int)((sourceLen + CHUNK_SIZE - 1) / CHUNK_SIZE);
+    if (threads > count) threads = count;
+    if (threads > MAX_THREADS) threads = MAX_THREADS;
+    /* not worth splitting, as one stream it compresses a bit better */
+    if (threads < 2) threads = count = 1;
+
+    c = (chunk*)calloc(count, sizeof(chunk));
+    if (c == Z_NULL) return Z_MEM_ERROR;
+    for (i = 0; i < count; i++) {
+        len = (uLong)i * CHUNK_SIZE;
+        c[i].in = source + len;
+        c[i].len = (uInt)(i < count - 1 ? CHUNK_SIZE : sourceLen - len);
+        c[i].dict = (uInt)(len < DICT_SIZE ? len : DICT_SIZE);
+        c[i].last = i == count - 1;
+    }
+    for (i = 0; i < threads; i++) {
+        w[i].c = c;
+        w[i].first = i;
+        w[i].count = count;
+        w[i].step = threads;
+        w[i].level = level;
+        w[i].strategy = strategy;
+    }
+    run_workers(w, threads);
+
+    /* zlib header, as deflate() writes it */
+    header = (Z_DEFLATED + ((MAX_WBITS-8)<<4)) << 8;
+    level_flags = (level-1) >> 1;
+    if (level_flags > 3) level_flags = 3;
+    header |= (level_flags << 6);
+    header += 31 - (header % 31);
+
+    err = Z_OK;
+    len = 2 + 4;
+    adler = adler32(0L, Z_NULL, 0);
+    for (i = 0; i < count; i++) {
+        if (c[i].err != Z_OK) err = c[i].err;
+        len += c[i].out_len;
+        adler = adler32_combine(adler, c[i].adler, (z_off_t)c[i].len);
+    }
+    out = err == Z_OK ? (Bytef*)malloc(len) : Z_NULL;
+    if (out == Z_NULL && err == Z_OK) err = Z_MEM_ERROR;
+
+    if (out) {
+        out[0] = (Byte)(header >> 8);
+        out[1] = (Byte)(header & 0xff);
+        len = 2;
+        for (i = 0; i < count; i++) {
+            zmemcpy(out + len, c[i].out, (uInt)c[i].out_len);
+            len += c[i].out_len;
+        }
+        out[len++] = (Byte)(adler >> 24);
+        out[len++] = (Byte)(adler >> 16);
+        out[len++] = (Byte)(adler >> 8);
+        out[len++] = (Byte)(adler & 0xff);
+        *dest = out;
+        *destLen = len;
+    }
+    for (i = 0; i < count; i++)
+        free(c[i].out);
+    free(c);
+    return err;
+}
@@ -0,0 +1,36 @@
+/* pdeflate.h -- deflate a memory buffer on several threads
+ * For conditions of distribution and use, see copyright notice in zlib.h
+ *
+ * Not part of the zlib distribution, see pdeflate.c.
+ */
+
+#ifndef _PDEFLATE_H
+#define _PDEFLATE_H
+
+#include "zlib.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+ZEXTERN int ZEXPORT pdeflate OF((Bytef **dest, uLongf *destLen,
+                                 const Bytef *source, uLong sourceLen,
+                                 int level, int strategy, int threads));
+/*
+     Compresses the source buffer into a single zlib stream like compress2,
+   with the work spread over the given number of threads, 0 meaning one per
+   cpu.  strategy is as in deflateInit2.  Upon exit, *dest is the compressed
+   data allocated with malloc, for the caller to free(), and *destLen is its
+   size.  With one thread or a short input the result is the same as from
+   deflateInit2 with windowBits 15 and memLevel 8, and one deflate call with
+   Z_FINISH.
+
+     pdeflate returns Z_OK if success, Z_MEM_ERROR if there was not enough
+   memory, Z_STREAM_ERROR if level or strategy is invalid.
+*/
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _PDEFLATE_H */
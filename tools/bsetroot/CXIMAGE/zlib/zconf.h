@@ -33,6 +33,7 @@
 #  define compress2	z_compress2
 #  define uncompress	z_uncompress
 #  define adler32	z_adler32
+#  define adler32_combine z_adler32_combine
 #  define crc32		z_crc32
 #  define get_crc_table z_get_crc_table
 
@@ -470,6 +470,12 @@ ZEXTERN int ZEXPORT deflateSetDictionary OF((z_streamp strm,
    applies to the whole dictionary even if only a subset of the dictionary is
    actually used by the compressor.)
 
+     A raw deflate stream (negative windowBits in deflateInit2) can be primed
+   with a dictionary as well, for example with the data that precedes the
+   input in a larger stream that is compressed in pieces.  The dictionary is
+   then not recorded in the output, the decompressor sees it as earlier
+   output in the same stream.
+
      deflateSetDictionary returns Z_OK if success, or Z_STREAM_ERROR if a
    parameter is invalid (such as NULL dictionary) or the stream state is
    inconsistent (for example if deflate has already been called for this stream
@@ -835,6 +841,15 @@ ZEXTERN uLong ZEXPORT adler32 OF((uLong adler, const Bytef *buf, uInt len));
      if (adler != original_adler) error();
 */
 
+ZEXTERN uLong ZEXPORT adler32_combine OF((uLong adler1, uLong adler2,
+                                          z_off_t len2));
+/*
+     Combine two Adler-32 checksums into one.  For two sequences of bytes, seq1
+   and seq2 with lengths len1 and len2, Adler-32 checksums were calculated for
+   each, adler1 and adler2.  adler32_combine() returns the Adler-32 checksum of
+   seq1 and seq2 concatenated, requiring only adler1, adler2, and len2.
+*/
+
 ZEXTERN uLong ZEXPORT crc32   OF((uLong crc, const Bytef *buf, uInt len));
 /*
      Update a running crc with the bytes buf[0..len-1] and return the updated
@@ -55,6 +55,41 @@ const char * ZEXPORT zError(err)
     return ERR_MSG(err);
 }
 
+#ifdef Z_X86_SIMD
+#  ifdef _MSC_VER
+#    include <intrin.h>
+#  else
+#    include <cpuid.h>
+#  endif
+
+/* Z_CPU_xxx flags, from cpuid on the first call.  Threads may race to
+   set the cache, but they all write the same value. */
+local int cpu_features = -1;
+
+int z_cpu_features()
+{
+    if (cpu_features < 0) {
+        unsigned c = 0;
+        int f = 0;
+#  ifdef _MSC_VER
+        int r[4];
+        __cpuid(r, 1);
+        c = (unsigned)r[2];
+#  else
+        unsigned a, b, d;
+        if (!__get_cpuid(1, &a, &b, &c, &d))
+            c = 0;
+#  endif
+        if (c & (1 << 9))
+            f |= Z_CPU_SSSE3;
+        if (c & (1 << 1))
+            f |= Z_CPU_PCLMUL;
+        cpu_features = f;
+    }
+    return cpu_features;
+}
+#endif
+
 
 #ifndef HAVE_MEMCPY
 
@@ -209,6 +209,21 @@ extern const char *z_errmsg[10]; /* indexed by 2-zlib_error */
 
 typedef uLong (ZEXPORT *check_func) OF((uLong check, const Bytef *buf,
 				       uInt len));
+
+/* x86-64: crc32 with PCLMULQDQ and adler32 with SSSE3, if the cpu has
+   them (see z_cpu_features in zutil.c).  Define NO_Z_SIMD to leave out. */
+#if !defined(NO_Z_SIMD) && (defined(__x86_64__) || defined(_M_X64)) && \
+    (defined(_MSC_VER) || defined(__clang__) || __GNUC__ >= 5)
+#  define Z_X86_SIMD
+#  define Z_CPU_SSSE3   1
+#  define Z_CPU_PCLMUL  2
+   extern int z_cpu_features OF((void));
+#  ifdef _MSC_VER
+#    define Z_TARGET(x)
+#  else
+#    define Z_TARGET(x) __attribute__((target(x)))
+#  endif
+#endif
 voidpf zcalloc OF((voidpf opaque, unsigned items, unsigned size));
 void   zcfree  OF((voidpf opaque, voidpf ptr));
 
@@ -0,0 +1,123 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// A plain 24-bit BMP writer, fed with 32-bit rows as they come from
+// BImage. Rows are converted straight into a large output buffer, so
+// that no full size 24-bit copy of the image is needed.
+
+#include "BBApi.h"
+#include "bsetroot.h"
+
+#define ST static
+
+#define BMP_BUFSIZE (1024*1024)
+
+ST void put16(BYTE *p, unsigned v)
+{
+    p[0] = (BYTE)v, p[1] = (BYTE)(v >> 8);
+}
+
+ST void put32(BYTE *p, unsigned v)
+{
+    put16(p, v), put16(p + 2, v >> 16);
+}
+
+ST void bmp_flush(struct bmpfile *b)
+{
+    if (b->len && 1 != fwrite(b->buf, b->len, 1, b->fp))
+        b->error = 1;
+    b->len = 0;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+int bmp_create(struct bmpfile *b, const char *path, int width, int height)
+{
+    BYTE *h;
+    unsigned rowbytes = (width * 3 + 3) & ~3;
+    unsigned size = rowbytes * height;
+
+    memset(b, 0, sizeof *b);
+    b->fp = fopen(path, "wb");
+    if (NULL == b->fp)
+        return 0;
+    b->buf = (BYTE*)malloc(BMP_BUFSIZE);
+    if (NULL == b->buf) {
+        fclose(b->fp);
+        b->fp = NULL;
+        return 0;
+    }
+    setvbuf(b->fp, NULL, _IONBF, 0);
+    b->width = width;
+    b->height = height;
+    b->rowbytes = rowbytes;
+
+    // BITMAPFILEHEADER + BITMAPINFOHEADER, little endian
+    h = b->buf;
+    memset(h, 0, 54);
+    h[0] = 'B', h[1] = 'M';
+    put32(h + 2, 54 + size);   // bfSize
+    put32(h + 10, 54);         // bfOffBits
+    put32(h + 14, 40);         // biSize
+    put32(h + 18, width);
+    put32(h + 22, height);     // positive: bottom-up
+    put16(h + 26, 1);          // biPlanes
+    put16(h + 28, 24);         // biBitCount
+    put32(h + 34, size);       // biSizeImage
+    put32(h + 38, 2835);       // 72 dpi
+    put32(h + 42, 2835);
+    b->len = 54;
+    return 1;
+}
+
+// write 'rows' rows of 32-bit BGRX pixels, bottom row first
+void bmp_write_rows(struct bmpfile *b, const void *pixels, int rows)
+{
+    const BYTE *s = (const BYTE*)pixels;
+    BYTE *d;
+    int x, w = b->width;
+
+    while (rows-- > 0) {
+        if (b->len + b->rowbytes > BMP_BUFSIZE)
+            bmp_flush(b);
+        d = b->buf + b->len;
+        for (x = 0; x < w; ++x, d += 3, s += 4)
+            d[0] = s[0], d[1] = s[1], d[2] = s[2];
+        for (x = w * 3; x < b->rowbytes; ++x)
+            *d++ = 0;
+        b->len += b->rowbytes;
+        b->rows++;
+    }
+}
+
+// returns 0 if anything went wrong
+int bmp_close(struct bmpfile *b)
+{
+    if (NULL == b->fp)
+        return 0;
+    bmp_flush(b);
+    if (fclose(b->fp) || b->rows != b->height)
+        b->error = 1;
+    free(b->buf);
+    b->fp = NULL;
+    return !b->error;
+}
+
+//===========================================================================
@@ -23,6 +23,7 @@
 #include "BImage.h"
 #include "bbroot.h"
 #include "bbrc.h"
+#include "bsetroot.h"
 
 #ifdef TINY_IMAGE
 const char *szAppName = "bsetroot 2.1-tiny";
@@ -73,39 +74,37 @@ void show_help(void)
 }
 
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-// Image interface
-
-typedef void *HIMG;
-const char *image_getversion(void);
-const char *image_getlasterror(void);
-
-HIMG image_create_fromfile(const char *path);
-HIMG image_create_frombmp(HBITMAP bmp);
-HIMG image_create_fromraw(int w, int h, void *pixels);
-int image_save(HIMG img, const char *path);
-void image_destroy(HIMG Img);
-
-int image_getwidth(HIMG img);
-int image_getheight(HIMG img);
-
-RGBQUAD image_getpixel(HIMG img, int x, int y);
-int image_setpixel(HIMG img, int x, int y, RGBQUAD c);
-int image_resample(HIMG *img, int w, int h);
-
-// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-/* bimage utils */
-HIMG DesktopGradient(struct rootinfo *r, int width, int height);
-void Modula(HIMG Img, int x, int y, COLORREF fg);
-void copy_img(HIMG Img1, HIMG Img2, int x0, int y0, int xs, int ys, int hueIntensity, int saturationValue);
-int load_bmp(const char *filename, HIMG *pImg, string_node *searchpaths, const char *search_base);
-
 /* system wallpaper interface */
 int setwallpaper(const char *wpfile, int wpstyle);
 void set_background_color (COLORREF color);
 
-/* parsing */
-char *make_full_path(char *buffer, const char *filename, const char *search_base);
-char *read_line(FILE *fp, char *buffer);
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// monitors for -layout, in the coordinates of the tiled wallpaper,
+// which starts at the top-left of the primary monitor
+
+struct mon_list { RECT rc[16]; int n, w, h; };
+
+ST BOOL CALLBACK mon_enum_proc(HMONITOR hMon, HDC hdc, LPRECT r, LPARAM lp)
+{
+    struct mon_list *m = (struct mon_list *)lp;
+    RECT *d;
+    int x, y;
+    if (m->n == 16)
+        return FALSE;
+    d = &m->rc[m->n++];
+    x = (r->left % m->w + m->w) % m->w;
+    y = (r->top % m->h + m->h) % m->h;
+    SetRect(d, x, y, x + r->right - r->left, y + r->bottom - r->top);
+    return TRUE;
+}
+
+ST void get_monitors(struct mon_list *m, int w, int h)
+{
+    BOOL (WINAPI* pEnumDisplayMonitors)(HDC, LPCRECT, MONITORENUMPROC, LPARAM);
+    m->n = 0, m->w = w, m->h = h;
+    if (load_imp(&pEnumDisplayMonitors, "USER32.DLL", "EnumDisplayMonitors"))
+        pEnumDisplayMonitors(NULL, NULL, mon_enum_proc, (LPARAM)m);
+}
 
 // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
 // main
@@ -121,24 +120,22 @@ int WINAPI WinMain(
     char temp[MAX_PATH];
     char buffer[2048];
 
-    HIMG Img = NULL;
-    HIMG Back = NULL;
-
-    int bmp_width;
-    int bmp_height;
     int screen_width;
     int screen_height;
 
     struct rootinfo RI;
     struct rootinfo *r = &RI;
+    struct rootjob J;
+    struct mon_list M;
 
-    char *p; int n; FILE *fp; MSG msg;
+    char *p; int n; MSG msg;
 
     // stop hourglass cursor:
     while (PeekMessage(&msg, NULL, 0, 0, PM_REMOVE));
 
     // clear the structure
     init_root(r);
+    root_init_job(&J, r, 0, 0);
 
     strcpy (buffer, lpCmdLine);
     // replace tabs
@@ -154,16 +151,9 @@ int WINAPI WinMain(
     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
     // Read switches from bsetroot.rc
 
-    fp = fopen(make_full_path(temp, "bsetroot.rc", NULL), "rb");
-    if (fp) {
-        while (read_line(fp, temp)) {
-            if ('-' == temp[0] && !parse_root(r, temp)) {
-                sprintf(buffer, "Error: in bsetroot.rc:\n%s", temp);
-                error_msg = buffer;
-                goto theend;
-            }
-        }
-        fclose(fp);
+    if (!read_rcfile(r, make_full_path(temp, "bsetroot.rc", NULL), buffer)) {
+        error_msg = buffer;
+        goto theend;
     }
 
     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
@@ -185,7 +175,7 @@ int WINAPI WinMain(
 
     screen_width = GetSystemMetrics(SM_CXSCREEN);
     screen_height = GetSystemMetrics(SM_CYSCREEN);
-    if (r->vdesk) {
+    if (r->vdesk || r->layout[0]) {
         int v_screen_width = GetSystemMetrics(SM_CXVIRTUALSCREEN);
         int v_screen_height = GetSystemMetrics(SM_CYVIRTUALSCREEN);
         if (v_screen_width && v_screen_height) {
@@ -195,134 +185,32 @@ int WINAPI WinMain(
     }
 
     // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-    // try to load the image
-
-    bmp_width = bmp_height = 0;
-
-    if (r->bmp) {
-        n = load_bmp(r->wpfile, &Img, r->paths, r->search_base);
-
-        if (n == 1) {
-            sprintf(buffer, "Error: Could not find image:\n%s", r->wpfile);
-            error_msg = buffer;
-
-        } else if (n == 2) {
-            sprintf(buffer, "Error: Could not load image - %s:\n%s", image_getlasterror(), r->wpfile);
-            error_msg = buffer;
-        }
-
-        if (Img) {
-            bmp_width  = image_getwidth(Img);
-            bmp_height = image_getheight(Img);
-
-            if (r->scale && r->scale != 100) {
-                int w = bmp_width * r->scale / 100;
-                int h = bmp_height * r->scale / 100;
-                image_resample(&Img, w, h);
-                bmp_width  = image_getwidth(Img);
-                bmp_height = image_getheight(Img);
-            }
-
-            if (r->convert) {
-                screen_width = bmp_width;
-                screen_height = bmp_height;
-            }
-
-            if (WP_NONE == r->wpstyle)
-                r->wpstyle = WP_FULL;
-
-        } else {
-            r->wpstyle = WP_NONE;
-        }
+    // load the image, make the gradient, put them together
+
+    J.screen_width = screen_width;
+    J.screen_height = screen_height;
+    J.desk_color = GetSysColor(COLOR_DESKTOP);
+    if (r->layout[0]) {
+        get_monitors(&M, screen_width, screen_height);
+        J.monitors = M.rc;
+        J.monitor_count = M.n;
     }
 
-    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
-    // create background texture, if any
-
-    if (r->gradient
-        || r->mod
-        || (r->solid
-            && (r->interlaced || (r->save && NULL == Img)))) {
-
-        Back = DesktopGradient(r, screen_width, screen_height);
-        if (r->mod)
-            Modula(Back, r->modx, r->mody, r->modfg);
-
-    } else if (0 == r->save) {
-        // default bsetbg behaviour: use os wallpaper / SysColor
-        if (r->solid)
-            set_background_color(r->color1);
-
-        if (Img && (r->sat < 255 || r->hue > 0)) {
-            if (false == r->solid)
-                r->color1 = GetSysColor(COLOR_DESKTOP);
-
-            Back = DesktopGradient(r, bmp_width, bmp_height);
-
-            copy_img(Back, Img,
-                0, 0, bmp_width, bmp_height, r->hue, r->sat);
-        }
-
-        goto write_image;
-    }
-
-    if (Img)
-    {
-        if (WP_FULL == r->wpstyle
-            && (bmp_width != screen_width || bmp_height != screen_height)) {
-            image_resample(&Img, screen_width, screen_height);
-            bmp_width  = image_getwidth(Img);
-            bmp_height = image_getheight(Img);
-        }
-
-        if (NULL == Back) {
-            // do we need a background anyway?
-            if (r->sat < 255 || r->hue > 0
-                || bmp_width != screen_width
-                || bmp_height != screen_height
-               ) {
-                if (false == r->solid)
-                    r->color1 = GetSysColor(COLOR_DESKTOP);
-                Back = DesktopGradient(r, screen_width, screen_height);
-            }
-        }
+    n = root_render(&J);
+    error_msg = J.error_msg;
+    if (0 == n)
+        goto theend;
 
-        if (Back) {
-            if (WP_TILE == r->wpstyle) {
-                int x0, y0;
-                for (x0 = 0; x0 < screen_width;  x0+=bmp_width)
-                for (y0 = 0; y0 < screen_height; y0+=bmp_height)
-                    copy_img(Back, Img,
-                        x0, y0, bmp_width, bmp_height, r->hue, r->sat);
-            } else {
-                int x0 = (screen_width  - bmp_width) / 2;
-                int y0 = (screen_height - bmp_height) / 2;
-                copy_img(Back, Img,
-                    x0, y0, bmp_width, bmp_height, r->hue, r->sat);
-            }
-        }
-    }
-    // since we have a fullscreen image now, set tile mode
-    r->wpstyle = WP_TILE;
+    if (J.set_color)
+        set_background_color(r->color1);
 
-write_image:
     if (0 == r->save) {
-        if (r->convert)
-        {
-            error_msg = "Error: -convert needs -save";
-            goto theend;
-        }
         if (!GetEnvironmentVariable("APPDATA", temp, sizeof temp))
             GetWindowsDirectory(temp, sizeof temp);
         join_path(r->bsetroot_bmp, temp, "bsetroot.bmp");
     }
 
-    if (Back || Img) {
-        if (Back)
-            image_save(Back, r->bsetroot_bmp);
-        else
-            image_save(Img, r->bsetroot_bmp);
-    }
+    root_save(&J, r->bsetroot_bmp);
 
     if (0 == r->save) {
         if (!setwallpaper(r->bsetroot_bmp, r->wpstyle))
@@ -330,8 +218,7 @@ write_image:
     }
 
 theend:
-    image_destroy(Back);
-    image_destroy(Img);
+    root_free_job(&J);
     n = 0;
     if (error_msg) {
         if (0 == r->quiet)
@@ -343,83 +230,6 @@ theend:
     return n;
 }
 
-//===========================================================================
-void copy_img(HIMG Img1, HIMG Img2,
-    int x0, int y0, int xs, int ys, int hueIntensity, int saturationValue)
-{
-    unsigned ih = 255 - hueIntensity; int x, y;
-    for (y = 0; y < ys; y++)
-    for (x = 0; x < xs; x++)
-    {
-        // First we read the original pixel's color...
-        RGBQUAD pix1 = image_getpixel(Img2, x, y);
-        unsigned r = pix1.rgbRed;
-        unsigned g = pix1.rgbGreen;
-        unsigned b = pix1.rgbBlue;
-        // ...then we apply saturation...
-        if (saturationValue<255)
-        {
-            unsigned greyscale =
-                (79*r + 156*g + 21*b) * (255-saturationValue)/256 + 255;
-
-            r = (r*saturationValue + greyscale)>>8;
-            g = (g*saturationValue + greyscale)>>8;
-            b = (b*saturationValue + greyscale)>>8;
-        }
-        // ...and hue according to color and intensity...
-        if (hueIntensity>0)
-        {
-            RGBQUAD pix2 = image_getpixel(Img1, x0+x, y0+y);
-            r = (ih*r + hueIntensity*pix2.rgbRed   + 255)>>8;
-            g = (ih*g + hueIntensity*pix2.rgbGreen + 255)>>8;
-            b = (ih*b + hueIntensity*pix2.rgbBlue  + 255)>>8;
-        }
-        pix1.rgbRed   = r;
-        pix1.rgbGreen = g;
-        pix1.rgbBlue  = b;
-        image_setpixel(Img1, x0+x, y0+y, pix1);
-    }
-}
-
-//===========================================================================
-HIMG DesktopGradient(struct rootinfo *r, int width, int height)
-{
-    struct bimage *b;
-    HIMG h;
-    StyleItem si;
-
-    si.type = r->type,
-    si.Color = r->color1,
-    si.ColorTo = r->color2,
-    si.interlaced = !!r->interlaced,
-    si.bevelstyle = r->bevelstyle,
-    si.bevelposition = r->bevelposition;
-    si.parentRelative = false;
-
-    bimage_init(true, true);
-    b = bimage_create(width, height, &si);
-    h = image_create_fromraw(width, height, bimage_getpixels(b));
-    bimage_destroy(b);
-    return h;
-}
-
-//===========================================================================
-void Modula(HIMG Img, int mx, int my, COLORREF fg)
-{
-    RGBQUAD q; int x, y;
-    int width  = image_getwidth(Img);
-    int height = image_getheight(Img);
-    *(COLORREF*)&q = switch_rgb(fg);
-    if (my > 1)
-        for (y = height-my; y >= 0; y-=my)
-        for (x = 0; x < width; x++)
-            image_setpixel(Img, x, y, q);
-    if (mx > 1)
-        for (y = height; --y >= 0;)
-        for (x = mx-1; x < width; x+= mx)
-            image_setpixel(Img, x, y, q);
-}
-
 //===========================================================================
 // API: ParseItem
 // Purpose: parses a given string and assigns settings to a StyleItem class
@@ -492,84 +302,3 @@ void set_background_color (COLORREF color)
 }
 
 //===========================================================================
-bool FileExists(LPCSTR szFileName)
-{
-    DWORD a = GetFileAttributes(szFileName);
-    return (DWORD)-1 != a && 0 == (a & FILE_ATTRIBUTE_DIRECTORY);
-}
-
-char *make_full_path(char *buffer, const char *filename, const char *search_base)
-{
-    char exe_path[MAX_PATH];
-    if (search_base && search_base[0]) {
-        join_path(buffer, search_base, filename);
-        if (FileExists(buffer))
-            return buffer;
-    }
-
-    get_exe_path(NULL, exe_path, sizeof exe_path);
-    return join_path(buffer, exe_path, filename);
-}
-
-char *read_line(FILE *fp, char *buffer)
-{
-    char *s;
-    do {
-        s = buffer;
-        if (NULL==fgets(s, MAX_PATH, fp))
-            return NULL;
-
-        while (*s) { if (IS_SPC(*s)) *s = ' '; ++s; }
-        while (s > buffer && IS_SPC(s[-1])) s--;
-        *s=0;
-        s = buffer;
-        while (*s && IS_SPC(*s)) ++s;
-    } while ('#' == *s || '!' == *s || 0 == *s);
-    return strcpy(buffer, s);
-}
-
-//===========================================================================
-int load_bmp(const char *filename, HIMG *pImg, string_node *searchpaths, const char *search_base)
-{
-    char path[MAX_PATH];
-    char temp[MAX_PATH];
-    const char *p;
-    int state;
-
-    for (state = 0;;++state) {
-        switch (state) {
-        case 0: // try original name
-            p = filename;
-            goto try_it;
-        case 1: // try from exe-path
-            p = filename;
-            break;
-        case 2: // try searchpaths listed in "bsetroot.rc"
-            if (NULL == searchpaths)
-                continue;
-            -- state; // might have still more lines
-            p = join_path(path, searchpaths->str, file_basename(filename));
-            searchpaths = searchpaths->next;
-            break;
-        case 3:  // try backgrounds/path
-            p = join_path(path, "backgrounds", filename);
-            break;
-        case 4:  // try backgrounds/file
-            p = join_path(path, "backgrounds", file_basename(filename));
-            break;
-        default: // give up
-            return 1;
-        }
-
-        if (!is_absolute_path(p))
-            p = make_full_path(path, strcpy(temp, p), search_base);
-try_it:
-        if (FileExists(p)) {
-            *pImg = image_create_fromfile(p);
-            return *pImg ? 0 : 2;
-        }
-    }
-}
-
-//===========================================================================
-
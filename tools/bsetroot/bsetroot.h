@@ -0,0 +1,177 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+#ifndef _BSETROOT_H_
+#define _BSETROOT_H_
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Image interface (image_cx.cpp / image_fr.cpp)
+
+typedef void *HIMG;
+const char *image_getversion(void);
+const char *image_getlasterror(void);
+
+// decoder hints for image_load
+struct imgload
+{
+    // in: the jpeg decoder may scale down by up to 1/max_denom
+    // (1,2,4,8) as long as the image stays at least min_width x
+    // min_height
+    int max_denom;
+    int min_width;
+    int min_height;
+    // in: bytes the jpeg decoder may use before it goes to a temp
+    // file, 0 = no limit
+    long max_memory;
+    // out: the scale actually used, and the error, if any
+    int denom;
+    char error[200];
+};
+
+HIMG image_create_fromfile(const char *path);
+HIMG image_load(const char *path, struct imgload *l);
+HIMG image_create_fromraw(int w, int h, void *pixels);
+
+// decode straight to 32 bit BGRX pixels, into the buffer that 'target'
+// returns once the size is known: the top row, with the stride set to
+// the distance of rows in bytes (negative for bottom-up buffers)
+typedef BYTE *(*image_target)(void *param, int w, int h, int *stride);
+int image_load_into(const char *path, struct imgload *l, image_target target, void *param);
+
+// encoder options for image_save
+struct imgsave
+{
+    // png: zlib level 0..9 (-1 = default), and the threads to deflate
+    // on (0 = one per cpu, 1 = the plain libpng encoder)
+    int png_level;
+    int png_threads;
+};
+
+int image_save(HIMG img, const char *path, struct imgsave *s);
+void image_destroy(HIMG Img);
+
+int image_getwidth(HIMG img);
+int image_getheight(HIMG img);
+
+RGBQUAD image_getpixel(HIMG img, int x, int y);
+int image_setpixel(HIMG img, int x, int y, RGBQUAD c);
+int image_resample(HIMG *img, int w, int h);
+HIMG image_create_resampled(HIMG img, int w, int h);
+void image_blit(HIMG dst, HIMG src, int x, int y);
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Streaming BMP writer (bmpfile.cpp)
+
+struct bmpfile
+{
+    FILE *fp;
+    BYTE *buf;
+    int len;
+    int width, height, rowbytes, rows;
+    char error;
+};
+
+int bmp_create(struct bmpfile *b, const char *path, int width, int height);
+void bmp_write_rows(struct bmpfile *b, const void *pixels, int rows);
+int bmp_close(struct bmpfile *b);
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// The rendering pipeline (rootimg.cpp)
+//
+// Everything from the parsed rootinfo to the final image, without
+// any calls to the windows API, such that it can be built also as
+// a headless tool (see makefile-posix).
+
+enum root_stage {
+    RS_LOAD, RS_SCALE, RS_GRADIENT, RS_COMPOSE, RS_SAVE,
+    RS_LAST
+};
+
+struct rootjob
+{
+    // in:
+    struct rootinfo *r;
+    int screen_width;
+    int screen_height;
+    COLORREF desk_color; // background when no color is given
+
+    // for previews: scale -center/-tile images by zoom/1000 (0 = none)
+    // and allow the jpeg decoder to scale down images on load
+    int zoom;
+    char preview;
+
+    // monitor rectangles in image coordinates, for '@n' in -layout
+    RECT *monitors;
+    int monitor_count;
+
+    // threads to compress .png output on (0 = one per cpu)
+    int save_threads;
+
+    // optional loader for images, for example from a cache. Images
+    // returned with *shared set are not modified nor destroyed.
+    HIMG (*load)(struct rootjob *j, const char *path, char *shared);
+    void *load_data;
+
+    // out:
+    HIMG Img;   // the loaded image
+    HIMG Back;  // the composed background, if any
+    char img_shared; // Img is owned by the loader
+    char stream; // gradient only, made by root_save as it writes
+    int stream_width, stream_height;
+    struct imgload ld;
+    char set_color; // caller should set r->color1 as system color
+    const char *error_msg;
+    char msgbuf[sizeof ((struct imgload*)0)->error + MAX_PATH + 40]; // loader error and a path
+
+    // microseconds spent per stage
+    unsigned usec[RS_LAST];
+};
+
+void root_setup(void);
+void root_init_job(struct rootjob *j, struct rootinfo *r, int w, int h);
+int root_render(struct rootjob *j);
+int root_save(struct rootjob *j, const char *path);
+HIMG root_result(struct rootjob *j);
+void root_free_job(struct rootjob *j);
+
+const char *root_stage_name(int stage);
+unsigned root_usec(void);
+
+/* bimage utils */
+HIMG DesktopGradient(struct rootinfo *r, int width, int height);
+void Modula(HIMG Img, int x, int y, COLORREF fg);
+void copy_img(HIMG Img1, HIMG Img2, int x0, int y0, int xs, int ys, int hueIntensity, int saturationValue);
+int load_bmp(struct rootjob *j, const char *filename, HIMG *pImg);
+
+/* per monitor layouts (rootlayout.cpp) */
+int root_render_layout(struct rootjob *j);
+
+/* batch mode (rootbatch.cpp, with pthreads) */
+int root_batch(const char *listfile, const char *rcfile,
+    int screen_width, int screen_height, int threads, int timing);
+
+/* parsing */
+char *make_full_path(char *buffer, const char *filename, const char *search_base);
+char *read_line(FILE *fp, char *buffer);
+int read_rcfile(struct rootinfo *r, const char *path, char *errbuf);
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#endif //ndef _BSETROOT_H_
@@ -4,26 +4,88 @@
 #include <stdio.h>
 #include <string.h>
 #include <malloc.h>
-#include "CxImage/CxImage/ximage.h"
+#include "CXIMAGE/CxImage/ximage.h"
+
+#ifndef _WIN32
+#include <strings.h>
+#define stricmp strcasecmp
+#endif
 
 extern "C" void dbg_printf (const char *fmt, ...);
 
+#include "bsetroot.h"
+
 char m_error[200];
-typedef void *HIMG;
 
 static void set_pixels(CxImage *Img, void *pixels);
 
 HIMG image_create_fromfile(const char *path)
+{
+    struct imgload l;
+    HIMG Img;
+    memset(&l, 0, sizeof l);
+    Img = image_load(path, &l);
+    strcpy(m_error, l.error);
+    return Img;
+}
+
+// with hints, and thread safe as to the error message
+HIMG image_load(const char *path, struct imgload *l)
 {
     CxImage *Img = new CxImage;
-    m_error[0] = 0;
-    if (Img->Load(path))
+    l->error[0] = 0;
+    l->denom = 1;
+    if (l->max_denom > 1)
+        Img->SetJpegScale(l->max_denom, l->min_width, l->min_height);
+    Img->SetJpegMaxMemory(l->max_memory);
+    if (Img->Load(path)) {
+        if (l->max_denom > 1 && Img->GetType() == CXIMAGE_FORMAT_JPG)
+            l->denom = Img->GetJpegScale();
         return (HIMG)Img;
-    strcpy(m_error, Img->GetLastError());
+    }
+    strncpy(l->error, Img->GetLastError(), sizeof l->error - 1);
+    l->error[sizeof l->error - 1] = 0;
     delete Img;
     return NULL;
 }
 
+struct target_args
+{
+    image_target target;
+    void *param;
+};
+
+static BYTE *cx_target(void *param, long w, long h, long *stride)
+{
+    struct target_args *a = (struct target_args*)param;
+    int s = 0;
+    BYTE *p = a->target(a->param, w, h, &s);
+    *stride = s;
+    return p;
+}
+
+// no CxImage in between, the decoders write the rows into the target
+int image_load_into(const char *path, struct imgload *l, image_target target, void *param)
+{
+    CxImage Img;
+    struct target_args a;
+    a.target = target;
+    a.param = param;
+    l->error[0] = 0;
+    l->denom = 1;
+    if (l->max_denom > 1)
+        Img.SetJpegScale(l->max_denom, l->min_width, l->min_height);
+    Img.SetJpegMaxMemory(l->max_memory);
+    if (Img.LoadInto(path, 0, cx_target, &a)) {
+        if (l->max_denom > 1 && Img.GetType() == CXIMAGE_FORMAT_JPG)
+            l->denom = Img.GetJpegScale();
+        return 1;
+    }
+    strncpy(l->error, Img.GetLastError(), sizeof l->error - 1);
+    l->error[sizeof l->error - 1] = 0;
+    return 0;
+}
+
 HIMG image_create_fromraw(int width, int height, void *pixels)
 {
     CxImage *Img = new CxImage(width, height, 24);
@@ -68,9 +130,18 @@ RGBQUAD image_getpixel(HIMG Img, int x, int y)
     return ((CxImage*)Img)->GetPixelColor(x, y);
 }
 
-int image_save(HIMG Img, const char *path)
+int image_save(HIMG Img, const char *path, struct imgsave *s)
 {
-    return ((CxImage*)Img)->Save(path, CXIMAGE_FORMAT_BMP);
+    // save as .bmp, unless another supported type is asked for
+    int type = CXIMAGE_FORMAT_BMP;
+    const char *e = strrchr(path, '.');
+    if (e && 0 == stricmp(e, ".png")) {
+        type = CXIMAGE_FORMAT_PNG;
+        if (s)
+            ((CxImage*)Img)->SetPngCompression(s->png_level, s->png_threads);
+    } else if (e && (0 == stricmp(e, ".jpg") || 0 == stricmp(e, ".jpeg")))
+        type = CXIMAGE_FORMAT_JPG;
+    return ((CxImage*)Img)->Save(path, type);
 }
 
 int image_resample(HIMG *Img, int w, int h)
@@ -78,18 +149,51 @@ int image_resample(HIMG *Img, int w, int h)
     return ((CxImage*)*Img)->Resample(w, h, 0);
 }
 
+// leaves the original alone, which may be in use by other threads
+HIMG image_create_resampled(HIMG Img, int w, int h)
+{
+    CxImage *New = new CxImage(*(CxImage*)Img);
+    New->Resample(w, h, 0);
+    return (HIMG)New;
+}
+
+// copy src into dst with its top-left corner at x0/y0
+void image_blit(HIMG dst, HIMG src, int x0, int y0)
+{
+    CxImage *d = (CxImage*)dst;
+    CxImage *s = (CxImage*)src;
+    int dw = d->GetWidth(), dh = d->GetHeight();
+    int sw = s->GetWidth(), sh = s->GetHeight();
+    int x1 = max(0, x0), x2 = min(dw, x0 + sw);
+    int y1 = max(0, y0), y2 = min(dh, y0 + sh);
+    int x, y;
+
+    for (y = y1; y < y2; ++y) {
+        // rows are bottom-up in CxImage
+        int dy = dh - 1 - y, sy = sh - 1 - (y - y0);
+        if (24 == d->GetBpp() && 24 == s->GetBpp())
+            memcpy(d->GetBits() + dy * d->GetEffWidth() + x1 * 3,
+                s->GetBits() + sy * s->GetEffWidth() + (x1 - x0) * 3,
+                (x2 - x1) * 3);
+        else
+            for (x = x1; x < x2; ++x)
+                d->SetPixelColor(x, dy, s->GetPixelColor(x - x0, sy));
+    }
+}
+
 //======================================================
 
 static void set_pixels(CxImage *Img, void *pixels)
 {
     int width = Img->GetWidth();
     int height = Img->GetHeight();
+    int stride = Img->GetEffWidth();
     BYTE *d = Img->GetBits();
     BYTE *s = (BYTE*)pixels;
     if (NULL == s || NULL == d)
         return;
     for (int y = 0; y < height; ++y) {
-        BYTE *p = d + y * width * 3;
+        BYTE *p = d + y * stride;
         for(int x = 0; x< width;++x){
             p[0] = s[0];
             p[1] = s[1];
@@ -6,8 +6,9 @@
 #include <malloc.h>
 #include "FreeImage.h"
 
+#include "bsetroot.h"
+
 int error;
-typedef void * HIMG;
 
 HIMG image_create(FIBITMAP *Img)
 {
@@ -31,6 +32,43 @@ HIMG image_create_fromfile(const char *path)
     return image_create(Img);
 }
 
+// no decoder hints with FreeImage
+HIMG image_load(const char *path, struct imgload *l)
+{
+    HIMG Img = image_create_fromfile(path);
+    l->denom = 1;
+    strcpy(l->error, Img ? "" : image_getlasterror());
+    return Img;
+}
+
+// FreeImage has no such thing, so convert after loading
+int image_load_into(const char *path, struct imgload *l, image_target target, void *param)
+{
+    FIBITMAP *Img, *Img32;
+    int w, h, y, stride;
+    BYTE *p;
+
+    Img = (FIBITMAP*)image_load(path, l);
+    if (NULL == Img)
+        return 0;
+    Img32 = FreeImage_ConvertTo32Bits(Img);
+    image_destroy(Img);
+    if (NULL == Img32) {
+        strcpy(l->error, "out of memory");
+        return 0;
+    }
+    w = FreeImage_GetWidth(Img32);
+    h = FreeImage_GetHeight(Img32);
+    p = target(param, w, h, &stride);
+    if (p) // FreeImage scanlines count from the bottom
+        for (y = 0; y < h; ++y)
+            memcpy(p + y * stride, FreeImage_GetScanLine(Img32, h - 1 - y), 4 * w);
+    else
+        strcpy(l->error, "no buffer for the pixels");
+    FreeImage_Unload(Img32);
+    return NULL != p;
+}
+
 HIMG image_create_fromraw(int width, int height, void *pixels)
 {
     FreeImage_Initialise(FALSE);
@@ -49,7 +87,7 @@ void image_destroy(HIMG hImg)
     }
 }
 
-int image_save(HIMG hImg, const char *path)
+int image_save(HIMG hImg, const char *path, struct imgsave *s)
 {
     FIBITMAP *Img = (FIBITMAP*)hImg;
     BOOL r = FreeImage_Save(FIF_BMP, Img, path, 0);
@@ -129,4 +167,42 @@ int image_resample(HIMG *hImg, int new_width, int new_height)
     return 0;
 }
 
+HIMG image_create_resampled(HIMG hImg, int new_width, int new_height)
+{
+    FIBITMAP *Img = FreeImage_Rescale(
+        (FIBITMAP*)hImg,
+        new_width,
+        new_height,
+        FILTER_BSPLINE);
+    return image_create(Img);
+}
+
+// copy src into dst with its top-left corner at x0/y0
+void image_blit(HIMG hDst, HIMG hSrc, int x0, int y0)
+{
+    FIBITMAP *dst = (FIBITMAP*)hDst;
+    FIBITMAP *src = (FIBITMAP*)hSrc;
+    FIBITMAP *conv = NULL, *part = NULL;
+    int dw = FreeImage_GetWidth(dst), dh = FreeImage_GetHeight(dst);
+    int sw = FreeImage_GetWidth(src), sh = FreeImage_GetHeight(src);
+    int x1 = x0 > 0 ? x0 : 0, x2 = x0 + sw < dw ? x0 + sw : dw;
+    int y1 = y0 > 0 ? y0 : 0, y2 = y0 + sh < dh ? y0 + sh : dh;
+
+    if (x1 >= x2 || y1 >= y2)
+        return;
+    // FreeImage_Paste wants the same format and no clipping
+    if (FreeImage_GetBPP(src) != FreeImage_GetBPP(dst))
+        src = conv = 32 == FreeImage_GetBPP(dst)
+            ? FreeImage_ConvertTo32Bits(src)
+            : FreeImage_ConvertTo24Bits(src);
+    if (src && (x1 != x0 || y1 != y0 || x2 != x0 + sw || y2 != y0 + sh))
+        src = part = FreeImage_Copy(src, x1 - x0, y1 - y0, x2 - x0, y2 - y0);
+    if (src)
+        FreeImage_Paste(dst, src, x1, y1, 256);
+    if (part)
+        FreeImage_Unload(part);
+    if (conv)
+        FreeImage_Unload(conv);
+}
+
 // -----------------------------------------------
@@ -0,0 +1,701 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// imgbench: speed of the image codecs that come with bsetroot.
+//
+// Decodes and encodes a corpus of images with CxImage and its bundled
+// libjpeg, libpng and zlib, and reports for each file and stage the
+// best of some runs as MB/s, ns/pixel, plus the peak memory. The
+// corpus is generated on the first run and then kept, so that later
+// runs, also of other builds, measure the very same files.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <sys/stat.h>
+#include <sys/resource.h>
+#include "CXIMAGE/CxImage/ximage.h"
+#include "CXIMAGE/CxImage/ximajpg.h"
+#include "CXIMAGE/CxImage/ximagif.h"
+extern "C" {
+#include "CXIMAGE/jpeg/jpegint.h"
+}
+#include "CXIMAGE/png/png.h"
+
+#include "bsetroot.h"
+
+#define ST static
+
+ST int imax(int a, int b) { return a > b ? a : b; }
+ST int iminmax(int a, int b, int c) { return a < b ? b : a > c ? c : a; }
+
+ST double usec_now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+enum { S_IO, S_DECODE, S_ENTROPY, S_TRANSFORM, S_COLOR, S_ENCODE, S_LAST };
+
+ST const char * const stage_names[S_LAST] = {
+    "io", "decode", "entropy", "transform", "color", "encode"
+};
+
+// the generated corpus. TGA and ICO are not compiled into this
+// CxImage, see ximage.h.
+struct item
+{
+    const char *name;
+    DWORD type;
+    int bpp;        // as generated
+    int progressive;
+};
+
+ST const struct item corpus[] = {
+    { "bmp24.bmp",      CXIMAGE_FORMAT_BMP, 24, 0 },
+    { "bmp32.bmp",      CXIMAGE_FORMAT_BMP, 32, 0 },
+    { "jpeg.jpg",       CXIMAGE_FORMAT_JPG, 24, 0 },
+    { "jpeg-prog.jpg",  CXIMAGE_FORMAT_JPG, 24, 1 },
+    { "png8.png",       CXIMAGE_FORMAT_PNG,  8, 0 },
+    { "png24.png",      CXIMAGE_FORMAT_PNG, 24, 0 },
+    { "png32.png",      CXIMAGE_FORMAT_PNG, 32, 0 },
+    { "gif.gif",        CXIMAGE_FORMAT_GIF,  8, 0 },
+};
+
+#define CORPUS_COUNT (int)(sizeof corpus / sizeof corpus[0])
+
+struct result
+{
+    const char *name;
+    long bytes;
+    int width, height, bpp;
+    double usec[S_LAST];    // best run, < 0 = not measured
+    long peak_kb;
+};
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// something like a photo: shading, texture, noise and hard edges,
+// such that none of the codecs has it too easy. BGR(A) order.
+
+ST unsigned rnd_state = 12345;
+
+ST unsigned rnd(void)
+{
+    rnd_state = rnd_state * 1103515245 + 12345;
+    return rnd_state >> 16;
+}
+
+ST void make_row(BYTE *p, int y, int w, int h, int bpp)
+{
+    int x, r, g, b, n;
+    double t = cos(y * 0.031);
+    for (x = 0; x < w; ++x) {
+        n = (int)(rnd() % 25) - 12;
+        r = x * 255 / w;
+        g = y * 255 / h;
+        b = 128 + (int)(70 * sin(x * 0.023) * t);
+        if (0 == (((x / 97) ^ (y / 61)) & 3))
+            r = 255 - r, b = 40;
+        if (8 == bpp) {
+            // indices into the standard palette, shaded like the rest
+            *p++ = (BYTE)((iminmax(r + n, 0, 255) >> 5 << 5)
+                | (iminmax(g + n, 0, 255) >> 5 << 2)
+                | (iminmax(b + n, 0, 255) >> 6));
+            continue;
+        }
+        *p++ = (BYTE)iminmax(b + n, 0, 255);
+        *p++ = (BYTE)iminmax(g + n, 0, 255);
+        *p++ = (BYTE)iminmax(r + n, 0, 255);
+        if (32 == bpp)
+            *p++ = (BYTE)(255 - x * 191 / w);
+    }
+}
+
+ST void put32(BYTE *p, unsigned v)
+{
+    p[0] = (BYTE)v, p[1] = (BYTE)(v >> 8), p[2] = (BYTE)(v >> 16), p[3] = (BYTE)(v >> 24);
+}
+
+// CxImage writes 24 bit only
+ST int write_bmp32(const char *path, int w, int h)
+{
+    BYTE hdr[54], *row;
+    FILE *fp;
+    int y, ok;
+
+    fp = fopen(path, "wb");
+    if (NULL == fp)
+        return 0;
+    memset(hdr, 0, sizeof hdr);
+    hdr[0] = 'B', hdr[1] = 'M';
+    put32(hdr + 2, 54 + w * 4 * h);
+    put32(hdr + 10, 54);
+    put32(hdr + 14, 40);
+    put32(hdr + 18, w);
+    put32(hdr + 22, h);
+    hdr[26] = 1, hdr[28] = 32;
+    ok = 1 == fwrite(hdr, sizeof hdr, 1, fp);
+    row = (BYTE*)malloc(w * 4);
+    for (y = 0; ok && y < h; ++y) {
+        make_row(row, h - 1 - y, w, h, 32);
+        ok = 1 == fwrite(row, w * 4, 1, fp);
+    }
+    free(row);
+    return 0 == fclose(fp) && ok;
+}
+
+// CxImage has no alpha in this build
+ST int write_png32(const char *path, int w, int h)
+{
+    png_structp png_ptr;
+    png_infop info_ptr;
+    BYTE *row;
+    FILE *fp;
+    int y;
+
+    fp = fopen(path, "wb");
+    if (NULL == fp)
+        return 0;
+    row = (BYTE*)malloc(w * 4);
+    png_ptr = png_create_write_struct(PNG_LIBPNG_VER_STRING, NULL, NULL, NULL);
+    info_ptr = png_create_info_struct(png_ptr);
+    if (setjmp(png_ptr->jmpbuf)) {
+        png_destroy_write_struct(&png_ptr, &info_ptr);
+        fclose(fp);
+        free(row);
+        return 0;
+    }
+    png_init_io(png_ptr, fp);
+    png_set_IHDR(png_ptr, info_ptr, w, h, 8, PNG_COLOR_TYPE_RGB_ALPHA,
+        PNG_INTERLACE_NONE, PNG_COMPRESSION_TYPE_BASE, PNG_FILTER_TYPE_BASE);
+    png_write_info(png_ptr, info_ptr);
+    png_set_bgr(png_ptr);
+    for (y = 0; y < h; ++y) {
+        make_row(row, y, w, h, 32);
+        png_write_row(png_ptr, row);
+    }
+    png_write_end(png_ptr, info_ptr);
+    png_destroy_write_struct(&png_ptr, &info_ptr);
+    free(row);
+    return 0 == fclose(fp);
+}
+
+struct bench_jpeg_error
+{
+    struct jpeg_error_mgr pub;
+    jmp_buf jb;
+};
+
+ST void bench_jpeg_exit(j_common_ptr cinfo)
+{
+    longjmp(((struct bench_jpeg_error*)cinfo->err)->jb, 1);
+}
+
+// CxImage writes baseline jpegs only
+ST int write_jpeg_progressive(const char *path, int w, int h)
+{
+    struct jpeg_compress_struct cinfo;
+    struct bench_jpeg_error jerr;
+    BYTE *row;
+    FILE *fp;
+    int x, y;
+
+    fp = fopen(path, "wb");
+    if (NULL == fp)
+        return 0;
+    row = (BYTE*)malloc(w * 3);
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = bench_jpeg_exit;
+    jpeg_create_compress(&cinfo);
+    if (setjmp(jerr.jb)) {
+        jpeg_destroy_compress(&cinfo);
+        fclose(fp);
+        free(row);
+        return 0;
+    }
+    jpeg_stdio_dest(&cinfo, fp);
+    cinfo.image_width = w;
+    cinfo.image_height = h;
+    cinfo.input_components = 3;
+    cinfo.in_color_space = JCS_RGB;
+    jpeg_set_defaults(&cinfo);
+    jpeg_set_quality(&cinfo, 90, TRUE);
+    jpeg_simple_progression(&cinfo);
+    jpeg_start_compress(&cinfo, TRUE);
+    for (y = 0; y < h; ++y) {
+        make_row(row, y, w, h, 24);
+        for (x = 0; x < w * 3; x += 3) {
+            BYTE t = row[x];
+            row[x] = row[x + 2], row[x + 2] = t;
+        }
+        jpeg_write_scanlines(&cinfo, &row, 1);
+    }
+    jpeg_finish_compress(&cinfo);
+    jpeg_destroy_compress(&cinfo);
+    free(row);
+    return 0 == fclose(fp);
+}
+
+ST int write_item(const struct item *t, const char *path, int w, int h)
+{
+    CxImageGIF img; // CxImage::Encode does not do gif in this build
+    FILE *fp;
+    int y, ok;
+
+    if (t->progressive)
+        return write_jpeg_progressive(path, w, h);
+    if (32 == t->bpp)
+        return CXIMAGE_FORMAT_BMP == t->type
+            ? write_bmp32(path, w, h) : write_png32(path, w, h);
+
+    if (!img.Create(w, h, t->bpp, t->type))
+        return 0;
+    if (8 == t->bpp)
+        img.SetStdPalette();
+    for (y = 0; y < h; ++y)
+        make_row(img.GetBits() + (h - 1 - y) * img.GetEffWidth(), y, w, h, t->bpp);
+    img.SetJpegQuality(90);
+    if (CXIMAGE_FORMAT_GIF != t->type)
+        return img.Save(path, t->type);
+    fp = fopen(path, "wb");
+    if (NULL == fp)
+        return 0;
+    ok = img.Encode(fp);
+    return 0 == fclose(fp) && ok;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// The stages within the decoders, as far as they can be told apart.
+//
+// libjpeg is made of modules with method pointers, which after
+// jpeg_start_decompress stay put for the output pass. Wrapped with
+// timers, they give 'entropy' (huffman decoding, for progressive
+// files all of it happens in jpeg_start_decompress), 'transform'
+// (dequantizing, idct, upsampling) and 'color' (YCbCr to BGR, as
+// CxImage asks for). The timers themselves add some to the times.
+//
+// For png, 'entropy' is the inflating of the IDAT data, measured on
+// its own, and 'transform' the rest of the decode (unfiltering, rows
+// to the dib).
+
+struct jpeg_hooks
+{
+    JMETHOD(boolean, decode_mcu, (j_decompress_ptr cinfo, JBLOCKROW *MCU_data));
+    JMETHOD(int, decompress_data, (j_decompress_ptr cinfo, JSAMPIMAGE output_buf));
+    JMETHOD(void, post_process_data, (j_decompress_ptr cinfo,
+        JSAMPIMAGE input_buf, JDIMENSION *in_row_group_ctr,
+        JDIMENSION in_row_groups_avail, JSAMPARRAY output_buf,
+        JDIMENSION *out_row_ctr, JDIMENSION out_rows_avail));
+    JMETHOD(void, color_convert, (j_decompress_ptr cinfo,
+        JSAMPIMAGE input_buf, JDIMENSION input_row,
+        JSAMPARRAY output_buf, int num_rows));
+    double entropy, coef, post, color; // usec
+};
+
+ST struct jpeg_hooks hooks;
+
+ST boolean hook_decode_mcu(j_decompress_ptr cinfo, JBLOCKROW *MCU_data)
+{
+    double t0 = usec_now();
+    boolean r = hooks.decode_mcu(cinfo, MCU_data);
+    hooks.entropy += usec_now() - t0;
+    return r;
+}
+
+ST int hook_decompress_data(j_decompress_ptr cinfo, JSAMPIMAGE output_buf)
+{
+    double t0 = usec_now();
+    int r = hooks.decompress_data(cinfo, output_buf);
+    hooks.coef += usec_now() - t0;
+    return r;
+}
+
+ST void hook_post_process_data(j_decompress_ptr cinfo,
+    JSAMPIMAGE input_buf, JDIMENSION *in_row_group_ctr,
+    JDIMENSION in_row_groups_avail, JSAMPARRAY output_buf,
+    JDIMENSION *out_row_ctr, JDIMENSION out_rows_avail)
+{
+    double t0 = usec_now();
+    hooks.post_process_data(cinfo, input_buf, in_row_group_ctr,
+        in_row_groups_avail, output_buf, out_row_ctr, out_rows_avail);
+    hooks.post += usec_now() - t0;
+}
+
+ST void hook_color_convert(j_decompress_ptr cinfo,
+    JSAMPIMAGE input_buf, JDIMENSION input_row,
+    JSAMPARRAY output_buf, int num_rows)
+{
+    double t0 = usec_now();
+    hooks.color_convert(cinfo, input_buf, input_row, output_buf, num_rows);
+    hooks.color += usec_now() - t0;
+}
+
+// decodes as CxImage does, but into one row, with the stage times
+// added to r (usec)
+ST int jpeg_stages(BYTE *data, DWORD size, double *r)
+{
+    struct jpeg_decompress_struct cinfo;
+    struct bench_jpeg_error jerr;
+    CxMemFile file(data, size);
+    CxImageJPG::CxFileJpg src(&file);
+    JSAMPARRAY row;
+    double t0;
+
+    cinfo.err = jpeg_std_error(&jerr.pub);
+    jerr.pub.error_exit = bench_jpeg_exit;
+    jpeg_create_decompress(&cinfo);
+    if (setjmp(jerr.jb)) {
+        jpeg_destroy_decompress(&cinfo);
+        return 0;
+    }
+    cinfo.src = &src;
+    jpeg_read_header(&cinfo, TRUE);
+    if (JCS_RGB == cinfo.out_color_space && 3 == cinfo.num_components)
+        cinfo.out_color_space = JCS_EXT_BGR;
+
+    memset(&hooks, 0, sizeof hooks);
+    t0 = usec_now();
+    jpeg_start_decompress(&cinfo);
+    t0 = usec_now() - t0;
+
+    hooks.decode_mcu = cinfo.entropy->decode_mcu;
+    cinfo.entropy->decode_mcu = hook_decode_mcu;
+    hooks.decompress_data = cinfo.coef->decompress_data;
+    cinfo.coef->decompress_data = hook_decompress_data;
+    hooks.post_process_data = cinfo.post->post_process_data;
+    cinfo.post->post_process_data = hook_post_process_data;
+    hooks.color_convert = cinfo.cconvert->color_convert;
+    cinfo.cconvert->color_convert = hook_color_convert;
+
+    row = (*cinfo.mem->alloc_sarray)((j_common_ptr)&cinfo, JPOOL_IMAGE,
+        cinfo.output_width * cinfo.output_components, 1);
+    while (cinfo.output_scanline < cinfo.output_height)
+        jpeg_read_scanlines(&cinfo, row, 1);
+    jpeg_finish_decompress(&cinfo);
+    jpeg_destroy_decompress(&cinfo);
+
+    // the coef and post controllers call the others
+    r[S_ENTROPY] = t0 + hooks.entropy;
+    r[S_TRANSFORM] = hooks.coef - hooks.entropy + hooks.post - hooks.color;
+    r[S_COLOR] = hooks.color;
+    return 1;
+}
+
+ST int png_inflate_stage(BYTE *data, DWORD size)
+{
+    BYTE out[65536];
+    z_stream z;
+    DWORD pos, len;
+    int err;
+
+    memset(&z, 0, sizeof z);
+    if (Z_OK != inflateInit(&z))
+        return 0;
+    err = Z_OK;
+    for (pos = 8; Z_OK == err && pos + 12 <= size; pos += len + 12) {
+        BYTE *p = data + pos;
+        len = (DWORD)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+        if (len > size - pos - 12)
+            break;
+        if (memcmp(p + 4, "IDAT", 4))
+            continue;
+        z.next_in = p + 8;
+        z.avail_in = len;
+        while (Z_OK == err && (z.avail_in || 0 == z.avail_out)) {
+            z.next_out = out;
+            z.avail_out = sizeof out;
+            err = inflate(&z, Z_NO_FLUSH);
+        }
+    }
+    inflateEnd(&z);
+    return Z_STREAM_END == err;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// the peak resident size since the last reset, where linux lets
+// reset it, otherwise of the whole run
+
+ST void reset_peak(void)
+{
+    FILE *fp = fopen("/proc/self/clear_refs", "w");
+    if (fp)
+        fputs("5", fp), fclose(fp);
+}
+
+ST long peak_kb(void)
+{
+    char line[200];
+    long kb = 0;
+    struct rusage ru;
+    FILE *fp = fopen("/proc/self/status", "r");
+    if (fp) {
+        while (fgets(line, sizeof line, fp))
+            if (0 == strncmp(line, "VmHWM:", 6))
+                kb = atol(line + 6);
+        fclose(fp);
+    }
+    if (0 == kb && 0 == getrusage(RUSAGE_SELF, &ru))
+        kb = ru.ru_maxrss;
+    return kb;
+}
+
+ST BYTE *read_file(const char *path, long *psize)
+{
+    BYTE *buf = NULL;
+    long size = 0;
+    FILE *fp = fopen(path, "rb");
+    if (fp) {
+        fseek(fp, 0, SEEK_END);
+        size = ftell(fp);
+        fseek(fp, 0, SEEK_SET);
+        buf = (BYTE*)malloc(size > 0 ? size : 1);
+        if (buf && size > 0 && 1 != fread(buf, size, 1, fp))
+            free(buf), buf = NULL;
+        fclose(fp);
+    }
+    *psize = size;
+    return buf;
+}
+
+#define TIME(r, s, expr) do { \
+    double t0_ = usec_now(); \
+    if (!(expr)) goto failed; \
+    best(r, s, usec_now() - t0_); \
+} while (0)
+
+ST void best(struct result *r, int s, double usec)
+{
+    if (usec < 0)
+        usec = 0;
+    if (r->usec[s] < 0 || usec < r->usec[s])
+        r->usec[s] = usec;
+}
+
+// runs all stages that apply to the file, 'runs' times each
+ST int bench_file(struct result *r, const char *path, const char *name, DWORD type, int runs)
+{
+    CxImage img;
+    BYTE *buf, *enc;
+    long size = 0, enc_size;
+    double t[S_LAST];
+    int i, s;
+
+    memset(r, 0, sizeof *r);
+    r->name = name;
+    for (s = 0; s < S_LAST; ++s)
+        r->usec[s] = -1;
+    reset_peak();
+
+    buf = NULL;
+    for (i = 0; i < runs; ++i) {
+        free(buf);
+        TIME(r, S_IO, NULL != (buf = read_file(path, &size)));
+    }
+    r->bytes = size;
+
+    for (i = 0; i < runs; ++i) {
+        img.Destroy();
+        TIME(r, S_DECODE, img.Decode(buf, size, type));
+    }
+    type = img.GetType();
+    r->width = img.GetWidth();
+    r->height = img.GetHeight();
+    r->bpp = img.GetBpp();
+
+    if (CXIMAGE_FORMAT_JPG == type) {
+        for (i = 0; i < runs; ++i) {
+            if (!jpeg_stages(buf, size, t))
+                goto failed;
+            for (s = S_ENTROPY; s <= S_COLOR; ++s)
+                best(r, s, t[s]);
+        }
+    }
+
+    if (CXIMAGE_FORMAT_PNG == type) {
+        for (i = 0; i < runs; ++i)
+            TIME(r, S_ENTROPY, png_inflate_stage(buf, size));
+        best(r, S_TRANSFORM, r->usec[S_DECODE] - r->usec[S_ENTROPY]);
+    }
+
+    // write it back as it was read (less any alpha, which this
+    // CxImage drops), where CxImage::Encode can
+    for (i = 0; CXIMAGE_FORMAT_GIF != type && i < runs; ++i) {
+        enc = NULL;
+        TIME(r, S_ENCODE, img.Encode(enc, enc_size, type));
+        free(enc);
+    }
+
+    free(buf);
+    r->peak_kb = peak_kb();
+    return 1;
+
+failed:
+    free(buf);
+    fprintf(stderr, "imgbench: %s: %s\n", path,
+        img.GetLastError()[0] ? img.GetLastError() : "failed");
+    return 0;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// MB/s are of the decoded pixels (at their bpp), for 'io' of the file
+
+ST double stage_mb_s(const struct result *r, int s)
+{
+    double bytes = S_IO == s ? r->bytes : (double)r->width * r->height * r->bpp / 8;
+    return r->usec[s] > 0 ? bytes / r->usec[s] : 0;
+}
+
+ST double stage_ns_px(const struct result *r, int s)
+{
+    return r->usec[s] * 1000.0 / ((double)r->width * r->height);
+}
+
+ST void print_table(const struct result *r, int n)
+{
+    int i, s;
+    printf("%-16s %10s %-10s %10s %10s %8s %10s\n",
+        "file", "bytes", "stage", "ms", "MB/s", "ns/px", "peak kB");
+    for (i = 0; i < n; ++i, ++r)
+        for (s = 0; s < S_LAST; ++s)
+            if (r->usec[s] >= 0)
+                printf("%-16s %10ld %-10s %10.3f %10.1f %8.2f %10ld\n",
+                    r->name, r->bytes, stage_names[s], r->usec[s] / 1000.0,
+                    stage_mb_s(r, s), stage_ns_px(r, s), r->peak_kb);
+}
+
+// one line per file, for diffing the outputs of two builds
+ST int write_json(const char *path, const char *tag, int runs, const struct result *r, int n)
+{
+    FILE *fp = strcmp(path, "-") ? fopen(path, "w") : stdout;
+    int i, s;
+    if (NULL == fp)
+        return 0;
+    fprintf(fp, "{\"tool\": \"imgbench\", \"tag\": \"%s\", \"codecs\": \"%s\", \"runs\": %d, \"results\": [\n",
+        tag, image_getversion(), runs);
+    for (i = 0; i < n; ++i, ++r) {
+        fprintf(fp, "  {\"file\": \"%s\", \"bytes\": %ld, \"width\": %d, \"height\": %d, \"bpp\": %d, \"peak_rss_kb\": %ld",
+            r->name, r->bytes, r->width, r->height, r->bpp, r->peak_kb);
+        for (s = 0; s < S_LAST; ++s)
+            if (r->usec[s] >= 0)
+                fprintf(fp, ", \"%s\": {\"ms\": %.3f, \"mb_s\": %.1f, \"ns_px\": %.2f}",
+                    stage_names[s], r->usec[s] / 1000.0, stage_mb_s(r, s), stage_ns_px(r, s));
+        fprintf(fp, "}%s\n", i < n - 1 ? "," : "");
+    }
+    fprintf(fp, "]}\n");
+    return fp == stdout || 0 == fclose(fp);
+}
+
+ST void show_help(void)
+{
+    printf(
+    "imgbench (uses %s)"
+    "\n"
+    "\nUsage: imgbench [options] [files...]"
+    "\n"
+    "\nOptions:"
+    "\n  -corpus <dir>       \twhere the generated images are (default imgbench-corpus)"
+    "\n  -size <w>x<h>       \tsize of generated images (default 2048x1536)"
+    "\n  -regen              \tgenerate the images even if they exist"
+    "\n  -n <runs>           \truns per stage, the best one counts (default 5)"
+    "\n  -json <file>        \twrite the results as json ('-' for stdout)"
+    "\n  -tag <text>         \tput into the json, for example the commit"
+    "\n"
+    "\nWith files given, these are measured instead of the corpus."
+    "\n"
+    ,image_getversion()
+    );
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+int main(int argc, char **argv)
+{
+    const char *dir = "imgbench-corpus";
+    const char *json = NULL;
+    const char *tag = "";
+    int width = 2048, height = 1536;
+    int runs = 5, regen = 0;
+    int files = 0, n = 0, failed = 0;
+    struct result results[64];
+    char path[MAX_PATH];
+    struct stat st;
+    int i;
+
+    for (i = 1; i < argc; ++i) {
+        const char *a = argv[i];
+        if (0 == strcmp(a, "-corpus") && i+1 < argc) {
+            dir = argv[++i];
+        } else if (0 == strcmp(a, "-size") && i+1 < argc) {
+            if (2 != sscanf(argv[++i], "%dx%d", &width, &height) || width < 1 || height < 1) {
+                fprintf(stderr, "imgbench: bad size: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (0 == strcmp(a, "-regen")) {
+            regen = 1;
+        } else if (0 == strcmp(a, "-n") && i+1 < argc) {
+            runs = imax(1, atoi(argv[++i]));
+        } else if (0 == strcmp(a, "-json") && i+1 < argc) {
+            json = argv[++i];
+        } else if (0 == strcmp(a, "-tag") && i+1 < argc) {
+            tag = argv[++i];
+        } else if ('-' == a[0]) {
+            show_help();
+            return 0 == strcmp(a, "-help") ? 0 : 1;
+        } else {
+            argv[++files] = argv[i];
+        }
+    }
+
+    if (files) {
+        for (i = 1; i <= files && n < 64; ++i)
+            if (bench_file(&results[n], argv[i], argv[i], CXIMAGE_FORMAT_UNKNOWN, runs))
+                ++n;
+            else
+                ++failed;
+    } else {
+        mkdir(dir, 0777);
+        for (i = 0; i < CORPUS_COUNT; ++i) {
+            const struct item *t = &corpus[i];
+            sprintf(path, "%.200s/%s", dir, t->name);
+            if ((regen || 0 != stat(path, &st)) && !write_item(t, path, width, height)) {
+                fprintf(stderr, "imgbench: could not write %s\n", path);
+                remove(path);
+                ++failed;
+                continue;
+            }
+            if (bench_file(&results[n], path, t->name, t->type, runs))
+                ++n;
+            else
+                ++failed;
+        }
+    }
+
+    print_table(results, n);
+    if (json && !write_json(json, tag, runs, results, n)) {
+        fprintf(stderr, "imgbench: could not write %s\n", json);
+        ++failed;
+    }
+    return 0 != failed;
+}
+
+//===========================================================================
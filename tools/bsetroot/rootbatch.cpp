@@ -0,0 +1,326 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// Batch mode for bsetroot-cli: renders a list of root commands, for
+// example the rootCommands of a directory of styles, on a pool of
+// worker threads in one process. Images used by several commands are
+// loaded only once (per decoder scale) and shared between the jobs.
+//
+// Line format of the list (empty lines and '#' comments are skipped):
+//
+//     <width>x<height> <output file> [bsetroot] <switches>
+
+#include "BBApi.h"
+#include "bbroot.h"
+#include "bsetroot.h"
+#include <pthread.h>
+#include <unistd.h>
+
+#define ST static
+
+struct cache_entry
+{
+    struct cache_entry *next;
+    char path[MAX_PATH];
+    int max_denom, min_width, min_height;
+    struct imgload ld;
+    HIMG img;
+    char loading;
+};
+
+struct batch_job
+{
+    struct rootinfo ri;
+    struct rootjob job;
+    int line;
+    char ok;
+    char error[sizeof ((struct rootjob*)0)->msgbuf]; // takes j->error_msg
+    unsigned usec; // render and save
+};
+
+struct batch
+{
+    struct batch_job *jobs;
+    int count, next;
+    struct cache_entry *cache;
+    int cache_hits, cache_loads;
+    pthread_mutex_t lock;
+    pthread_cond_t loaded;
+};
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// the shared image cache. Loading happens outside the lock, others
+// who want the same image meanwhile wait for it.
+
+ST HIMG load_cached(struct rootjob *j, const char *path, char *shared)
+{
+    struct batch *b = (struct batch *)j->load_data;
+    struct imgload *l = &j->ld;
+    struct cache_entry *e;
+
+    pthread_mutex_lock(&b->lock);
+    for (e = b->cache; e; e = e->next)
+        if (0 == strcmp(e->path, path)
+            && e->max_denom == l->max_denom
+            && e->min_width == l->min_width
+            && e->min_height == l->min_height)
+            break;
+
+    if (e) {
+        ++b->cache_hits;
+        while (e->loading)
+            pthread_cond_wait(&b->loaded, &b->lock);
+    } else {
+        ++b->cache_loads;
+        e = c_new(struct cache_entry);
+        strcpy(e->path, path);
+        e->max_denom = l->max_denom;
+        e->min_width = l->min_width;
+        e->min_height = l->min_height;
+        e->loading = 1;
+        e->next = b->cache, b->cache = e;
+        pthread_mutex_unlock(&b->lock);
+
+        e->ld = *l;
+        e->img = image_load(path, &e->ld);
+
+        pthread_mutex_lock(&b->lock);
+        e->loading = 0;
+        pthread_cond_broadcast(&b->loaded);
+    }
+    pthread_mutex_unlock(&b->lock);
+
+    l->denom = e->ld.denom;
+    strcpy(l->error, e->ld.error);
+    *shared = 1;
+    return e->img;
+}
+
+ST void free_cache(struct batch *b)
+{
+    struct cache_entry *e;
+    while (NULL != (e = b->cache)) {
+        b->cache = e->next;
+        image_destroy(e->img);
+        m_free(e);
+    }
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ST void *worker(void *arg)
+{
+    struct batch *b = (struct batch *)arg;
+    struct batch_job *bj;
+    struct rootjob *j;
+    unsigned t0;
+
+    for (;;) {
+        pthread_mutex_lock(&b->lock);
+        bj = b->next < b->count ? &b->jobs[b->next++] : NULL;
+        pthread_mutex_unlock(&b->lock);
+        if (NULL == bj)
+            break;
+
+        j = &bj->job;
+        t0 = root_usec();
+        if (root_render(j) && !root_save(j, bj->ri.bsetroot_bmp))
+            j->error_msg = "Error: Could not save image";
+        if (j->error_msg)
+            strcpy(bj->error, j->error_msg);
+        root_free_job(j);
+        bj->usec = root_usec() - t0;
+    }
+    return NULL;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// skip the program name, as with rootCommands from styles
+ST const char *skip_progname(const char *s)
+{
+    char temp[MAX_PATH];
+    const char *p = s;
+    NextToken(temp, &p, " ");
+    strlwr((char*)file_basename(temp));
+    if (0 == memcmp(file_basename(temp), "bsetroot", 8)
+     || 0 == memcmp(file_basename(temp), "bsetbg", 6))
+        return p;
+    return s;
+}
+
+ST int parse_line(struct batch_job *bj, const char *s, const char *rcfile,
+    int screen_width, int screen_height)
+{
+    struct rootinfo *r = &bj->ri;
+    char size[MAX_PATH], out[MAX_PATH], command[2*MAX_PATH+20];
+    const char *p;
+    int w, h;
+
+    init_root(r);
+    root_init_job(&bj->job, r, 0, 0);
+
+    // so that none of the tokens below can overflow
+    if (strlen(s) >= MAX_PATH) {
+        strcpy(bj->error, "Error: line too long");
+        return 0;
+    }
+    NextToken(size, &s, " ");
+    NextToken(out, &s, " ");
+    if (2 != sscanf(size, "%dx%d", &w, &h) || w < 1 || h < 1 || 0 == out[0]) {
+        strcpy(bj->error, "Error: expected <width>x<height> <file> <switches>");
+        return 0;
+    }
+
+    if (!read_rcfile(r, rcfile, bj->error))
+        return 0;
+
+    p = skip_progname(s);
+    sprintf(command, "%.*s -save \"%.*s\"", MAX_PATH-1, p, MAX_PATH-1, out);
+    if (!parse_root(r, command)) {
+        sprintf(bj->error, "Error: in commandstring:\n%.*s", MAX_PATH-1, s);
+        return 0;
+    }
+
+    bj->job.screen_width = w;
+    bj->job.screen_height = h;
+    bj->job.preview = 1;
+    // with the real screen size given, -center/-tile images shrink
+    // along with the preview
+    if (screen_width)
+        bj->job.zoom = imax(1, imin(w * 1000 / screen_width, h * 1000 / screen_height));
+    return 1;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Returns the number of failed jobs, or -1 if the list could not
+// be read.
+
+int root_batch(const char *listfile, const char *rcfile,
+    int screen_width, int screen_height, int threads, int timing)
+{
+    struct batch B, *b = &B;
+    struct batch_job *bj;
+    pthread_t *tid;
+    char *ok;
+    char line[MAX_PATH*2];
+    unsigned t0, usec, stage[RS_LAST];
+    int i, n, c, errors;
+    FILE *fp;
+
+    fp = fopen(listfile, "rb");
+    if (NULL == fp)
+        return -1;
+
+    memset(b, 0, sizeof *b);
+    for (n = 0; fgets(line, sizeof line, fp); ) {
+        const char *s = line;
+        ++n;
+        skip_spc(&s);
+        if (0 == *s || '#' == *s)
+            continue;
+        if (0 == (b->count & 15))
+            b->jobs = (struct batch_job *)m_realloc(b->jobs, (b->count + 16) * sizeof *b->jobs);
+        bj = &b->jobs[b->count++];
+        memset(bj, 0, sizeof *bj);
+        bj->line = n;
+        // the rest of a line too long for the buffer is dropped,
+        // parse_line rejects what was read of it
+        if (NULL == strchr(line, '\n'))
+            while (EOF != (c = getc(fp)) && '\n' != c)
+                ;
+        line[strcspn(line, "\r\n")] = 0;
+        bj->ok = parse_line(bj, s, rcfile, screen_width, screen_height);
+    }
+    fclose(fp);
+
+    // the jobs with errors are sorted out here already
+    for (i = n = 0; i < b->count; ++i) {
+        bj = &b->jobs[i];
+        if (bj->ok) {
+            if (n != i)
+                b->jobs[n] = *bj;
+            bj = &b->jobs[n++];
+            bj->job.r = &bj->ri;
+            bj->job.load = load_cached;
+            bj->job.load_data = b;
+        } else {
+            fprintf(stderr, "%s:%d: %s\n", listfile, bj->line, bj->error);
+            delete_root(&bj->ri);
+        }
+    }
+    errors = b->count - n;
+    b->count = n;
+
+    if (threads < 1)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    threads = imax(1, imin(threads, b->count));
+    // the images are saved in parallel already
+    if (threads > 1)
+        for (i = 0; i < b->count; ++i)
+            b->jobs[i].job.save_threads = 1;
+
+    root_setup();
+    pthread_mutex_init(&b->lock, NULL);
+    pthread_cond_init(&b->loaded, NULL);
+
+    t0 = root_usec();
+    tid = (pthread_t *)m_alloc(threads * (sizeof *tid + 1));
+    ok = (char *)(tid + threads);
+    for (i = 0; i < threads; ++i)
+        ok[i] = 0 == pthread_create(&tid[i], NULL, worker, b);
+    // where a thread could not start, the jobs left are done here
+    for (i = 0; i < threads; ++i)
+        if (ok[i])
+            pthread_join(tid[i], NULL);
+        else
+            worker(b);
+    m_free(tid);
+    t0 = root_usec() - t0;
+
+    memset(stage, 0, sizeof stage);
+    for (usec = i = 0; i < b->count; ++i) {
+        bj = &b->jobs[i];
+        if (bj->error[0]) {
+            if (0 == bj->ri.quiet)
+                fprintf(stderr, "%s:%d: %s\n", listfile, bj->line, bj->error);
+            ++errors;
+        }
+        for (n = 0; n < RS_LAST; ++n)
+            stage[n] += bj->job.usec[n];
+        usec += bj->usec;
+        delete_root(&bj->ri);
+    }
+
+    if (timing) {
+        for (n = 0; n < RS_LAST; ++n)
+            printf("%-10s %10.3f ms\n", root_stage_name(n), stage[n] / 1000.0);
+        printf("%-10s %10.3f ms\n", "jobs", usec / 1000.0);
+        printf("%-10s %10.3f ms (%d images, %d threads, %d loads, %d cache hits)\n",
+            "wall", t0 / 1000.0, b->count, threads, b->cache_loads, b->cache_hits);
+    }
+
+    free_cache(b);
+    pthread_cond_destroy(&b->loaded);
+    pthread_mutex_destroy(&b->lock);
+    m_free(b->jobs);
+    return errors;
+}
+
+//===========================================================================
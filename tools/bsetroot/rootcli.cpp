@@ -0,0 +1,224 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// bsetroot-cli: headless frontend to the bsetroot rendering pipeline.
+// Renders a root command to an image file with explicitly given
+// screen geometry, for example to make style previews in batch jobs.
+
+#include "BBApi.h"
+#include "bbroot.h"
+#include "bsetroot.h"
+
+const char *szAppName = "bsetroot-cli";
+
+#define ST static
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ST void show_help(void)
+{
+    printf(
+    "%s (uses %s)"
+    "\n"
+    "\nUsage: %s [options] <bsetroot switches> -save <file>"
+    "\n       %s [options] -batch <listfile>"
+    "\n"
+    "\nOptions:"
+    "\n  -screen <w>x<h>     \tscreen size (default 1024x768)"
+    "\n  -monitor <w>x<h>+<x>+<y>\tmonitor for '@n' in -layout files (repeatable)"
+    "\n  -rc <file>          \tread switches from file instead of bsetroot.rc"
+    "\n  -timing             \tprint time spent per stage"
+    "\n  -batch <file>       \trender all lines '<w>x<h> <file> <switches>'"
+    "\n  -j <n>              \tnumber of threads for -batch (default: all cpus)"
+    "\n"
+    "\nWith -batch, the -screen size if given is the size of the real screen,"
+    "\nwhich -center/-tile images are scaled to the previews relative to."
+    "\n"
+    "\nThe output type is taken from the extension (.bmp .png .jpg)."
+    "\n"
+    ,szAppName
+    ,image_getversion()
+    ,szAppName
+    ,szAppName
+    );
+}
+
+ST int read_geometry(const char *s, int *pw, int *ph)
+{
+    int w, h;
+    if (2 != sscanf(s, "%dx%d", &w, &h) || w < 1 || h < 1)
+        return 0;
+    *pw = w, *ph = h;
+    return 1;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+int main(int argc, char **argv)
+{
+    const char *error_msg = NULL;
+    const char *rcfile = NULL;
+    const char *listfile = NULL;
+
+    char temp[MAX_PATH];
+    char buffer[4096];
+
+    int screen_width = 1024;
+    int screen_height = 768;
+    int screen_given = 0;
+    int threads = 0;
+    RECT monitors[16];
+    int monitor_count = 0;
+    int timing = 0;
+    int i, l, n;
+    unsigned t0;
+
+    struct rootinfo RI;
+    struct rootinfo *r = &RI;
+    struct rootjob J;
+
+    init_root(r);
+    root_init_job(&J, r, 0, 0);
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    // our own options, everything else is put together as
+    // the bsetroot commandline
+
+    buffer[0] = 0;
+    for (i = 1, l = 0; i < argc; ++i) {
+        const char *a = argv[i];
+        if (0 == strcmp(a, "-screen") && i+1 < argc) {
+            if (!read_geometry(argv[++i], &screen_width, &screen_height)) {
+                fprintf(stderr, "%s: bad screen size: %s\n", szAppName, argv[i]);
+                return 1;
+            }
+            screen_given = 1;
+        } else if (0 == strcmp(a, "-monitor") && i+1 < argc) {
+            RECT *m = &monitors[monitor_count];
+            int w, h, x, y;
+            if (monitor_count == 16
+             || 4 != sscanf(argv[++i], "%dx%d%d%d", &w, &h, &x, &y)
+             || w < 1 || h < 1 || x < 0 || y < 0) {
+                fprintf(stderr, "%s: bad monitor: %s\n", szAppName, argv[i]);
+                return 1;
+            }
+            m->left = x, m->top = y, m->right = x + w, m->bottom = y + h;
+            ++monitor_count;
+        } else if (0 == strcmp(a, "-rc") && i+1 < argc) {
+            rcfile = argv[++i];
+        } else if (0 == strcmp(a, "-timing")) {
+            timing = 1;
+        } else if (0 == strcmp(a, "-batch") && i+1 < argc) {
+            listfile = argv[++i];
+        } else if (0 == strcmp(a, "-j") && i+1 < argc) {
+            threads = atoi(argv[++i]);
+        } else {
+            n = strlen(a);
+            if (l + n + 4 >= (int)sizeof buffer)
+                break;
+            if (l)
+                buffer[l++] = ' ';
+            if (strchr(a, ' '))
+                l += sprintf(buffer + l, "\"%s\"", a);
+            else
+                l += sprintf(buffer + l, "%s", a);
+        }
+    }
+
+    if (NULL == rcfile)
+        rcfile = make_full_path(temp, "bsetroot.rc", NULL);
+
+    if (listfile) {
+        n = root_batch(listfile, rcfile,
+            screen_given ? screen_width : 0,
+            screen_given ? screen_height : 0,
+            threads, timing);
+        if (n < 0) {
+            sprintf(buffer, "Error: Could not read: %s", listfile);
+            r->quiet = 0;
+            error_msg = buffer;
+        } else if (n > 0) {
+            sprintf(buffer, "%d of the images failed", n);
+            error_msg = buffer;
+        }
+        goto theend;
+    }
+
+    if (0 == buffer[0]) {
+        show_help();
+        goto theend;
+    }
+    if (!read_rcfile(r, rcfile, buffer)) {
+        error_msg = buffer;
+        goto theend;
+    }
+
+    if (!parse_root(r, buffer)) {
+        error_msg = "Error: in commandstring";
+        goto theend;
+    }
+
+    if (r->help) {
+        show_help();
+        goto theend;
+    }
+
+    if (0 == r->save) {
+        error_msg = "Error: no output file, use -save <file>";
+        goto theend;
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    // without -screen, the monitors make up the desktop
+    if (monitor_count && 0 == screen_given) {
+        screen_width = screen_height = 0;
+        for (i = 0; i < monitor_count; ++i) {
+            screen_width = imax(screen_width, monitors[i].right);
+            screen_height = imax(screen_height, monitors[i].bottom);
+        }
+    }
+
+    t0 = root_usec();
+    J.screen_width = screen_width;
+    J.screen_height = screen_height;
+    J.monitors = monitors;
+    J.monitor_count = monitor_count;
+    if (root_render(&J) && !root_save(&J, r->bsetroot_bmp))
+        J.error_msg = "Error: Could not save image";
+    error_msg = J.error_msg;
+
+    if (timing) {
+        for (i = 0; i < RS_LAST; ++i)
+            printf("%-10s %10.3f ms\n", root_stage_name(i), J.usec[i] / 1000.0);
+        printf("%-10s %10.3f ms\n", "total", (root_usec() - t0) / 1000.0);
+    }
+
+theend:
+    root_free_job(&J);
+    n = 0;
+    if (error_msg) {
+        if (0 == r->quiet)
+            fprintf(stderr, "%s: %s\n", szAppName, error_msg);
+        n = 1;
+    }
+    delete_root(r);
+    return n;
+}
+
+//===========================================================================
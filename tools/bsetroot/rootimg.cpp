@@ -0,0 +1,757 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// the bsetroot rendering pipeline, no windows API calls in here
+
+#include "BBApi.h"
+#include "BImage.h"
+#include "bbroot.h"
+#include "bsetroot.h"
+
+#ifndef _WIN32
+#include <time.h>
+#endif
+
+#define ST static
+
+ST void mix_pixel(BYTE *d, const BYTE *s, int hueIntensity, int saturationValue);
+ST const char *find_bmp(struct rootjob *j, const char *filename, char *path);
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+unsigned root_usec(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq;
+    LARGE_INTEGER t;
+    if (0 == freq.QuadPart)
+        QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&t);
+    return (unsigned)(t.QuadPart / freq.QuadPart * 1000000
+        + t.QuadPart % freq.QuadPart * 1000000 / freq.QuadPart);
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned)(ts.tv_sec * 1000000 + ts.tv_nsec / 1000);
+#endif
+}
+
+const char *root_stage_name(int stage)
+{
+    static const char * const names[RS_LAST] = {
+        "load", "scale", "gradient", "compose", "save"
+    };
+    return stage >= 0 && stage < RS_LAST ? names[stage] : "";
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// once per process, before any rendering
+void root_setup(void)
+{
+    static bool done;
+    if (false == done) {
+        bimage_init(true, true);
+        done = true;
+    }
+}
+
+void root_init_job(struct rootjob *j, struct rootinfo *r, int w, int h)
+{
+    memset(j, 0, sizeof *j);
+    j->r = r;
+    j->screen_width = w;
+    j->screen_height = h;
+    j->desk_color = RGB(0,0,0);
+}
+
+void root_free_job(struct rootjob *j)
+{
+    image_destroy(j->Back);
+    if (0 == j->img_shared)
+        image_destroy(j->Img);
+    j->Back = j->Img = NULL;
+    j->img_shared = 0;
+    j->stream = 0;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// the same as DesktopGradient with Modula, but written out in strips
+
+ST void modula_row(BYTE *p, int width, int y, int height, struct rootinfo *r)
+{
+    DWORD c = switch_rgb(r->modfg);
+    int x;
+    if (r->mody > 1 && 0 == (height - y) % r->mody)
+        for (x = 0; x < width; ++x)
+            ((DWORD*)p)[x] = c;
+    else if (r->modx > 1)
+        for (x = r->modx - 1; x < width; x += r->modx)
+            ((DWORD*)p)[x] = c;
+}
+
+ST int save_gradient(struct rootjob *j, const char *path)
+{
+    struct rootinfo *r = j->r;
+    int width = j->stream_width;
+    int height = j->stream_height;
+    struct bmpfile B;
+    struct bimage *b;
+    StyleItem si;
+    BYTE *p;
+    int y, n, i, rows;
+    unsigned t0, t1;
+
+    si.type = r->type,
+    si.Color = r->color1,
+    si.ColorTo = r->color2,
+    si.interlaced = !!r->interlaced,
+    si.bevelstyle = r->bevelstyle,
+    si.bevelposition = r->bevelposition;
+    si.parentRelative = false;
+
+    // strips of about 256 kB
+    rows = imax(1, 0x40000 / (width * 4));
+    root_setup();
+    b = bimage_create_strip(width, height, rows, &si);
+    if (NULL == b)
+        return 0;
+
+    if (!bmp_create(&B, path, width, height)) {
+        bimage_destroy(b);
+        return 0;
+    }
+
+    for (t1 = 0, y = 0; y < height; y += n) {
+        n = imin(rows, height - y);
+        t0 = root_usec();
+        p = bimage_getstrip(b, y, n);
+        if (r->mod)
+            for (i = 0; i < n; ++i)
+                modula_row(p + i * width * 4, width, y + i, height, r);
+        t1 += root_usec() - t0;
+        bmp_write_rows(&B, p, n);
+    }
+    bimage_destroy(b);
+    j->usec[RS_GRADIENT] += t1;
+    j->usec[RS_SAVE] -= t1;
+    return bmp_close(&B);
+}
+
+ST int is_bmp(const char *path)
+{
+    const char *e = strrchr(path, '.');
+    return e && 0 == stricmp(e, ".bmp");
+}
+
+// a row of the strip, and the bmp size, fit into 32 bits
+ST int can_stream(struct rootjob *j)
+{
+    int w = j->stream_width, h = j->stream_height;
+    return w > 0 && h > 0 && (double)w * h * 4 < 0x7FFFFFFF;
+}
+
+int root_save(struct rootjob *j, const char *path)
+{
+    HIMG Img;
+    struct imgsave s;
+    unsigned t0;
+    int ok = 1;
+
+    if (j->stream && is_bmp(path) && can_stream(j)) {
+        t0 = root_usec();
+        ok = save_gradient(j, path);
+        j->stream = 0;
+    } else {
+        Img = root_result(j);
+        t0 = root_usec();
+        s.png_level = j->r->pnglevel;
+        s.png_threads = j->save_threads;
+        if (Img && Img == j->Img && j->img_shared) {
+            // image_save sets the encoder options on the image, which
+            // may be in use by other threads
+            Img = image_create_resampled(Img, image_getwidth(Img), image_getheight(Img));
+            ok = image_save(Img, path, &s);
+            image_destroy(Img);
+        } else if (Img) {
+            ok = image_save(Img, path, &s);
+        }
+    }
+    j->usec[RS_SAVE] += root_usec() - t0;
+    return ok;
+}
+
+// the result as one image, made now if it was left for streaming
+HIMG root_result(struct rootjob *j)
+{
+    if (j->stream) {
+        unsigned t0 = root_usec();
+        j->Back = DesktopGradient(j->r, j->stream_width, j->stream_height);
+        if (j->r->mod)
+            Modula(j->Back, j->r->modx, j->r->mody, j->r->modfg);
+        j->usec[RS_GRADIENT] += root_usec() - t0;
+        j->stream = 0;
+    }
+    return j->Back ? j->Back : j->Img;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// size of -center/-tile images in percent of the original
+ST int img_scale(struct rootjob *j)
+{
+    int s = j->r->scale ? j->r->scale : 100;
+    if (j->zoom && (WP_TILE == j->r->wpstyle || WP_CENTER == j->r->wpstyle))
+        s = imax(1, s * j->zoom / 1000);
+    return s;
+}
+
+// For previews, let the jpeg decoder scale down already, as far as
+// the final image does not lose from it.
+ST void set_load_hints(struct rootjob *j)
+{
+    struct rootinfo *r = j->r;
+    struct imgload *l = &j->ld;
+    int s;
+
+    l->max_denom = l->denom = 1;
+    l->min_width = l->min_height = 0;
+    l->max_memory = (long)r->maxmem * 1048576L;
+    if (0 == j->preview || 0 == r->save || r->convert)
+        return;
+
+    s = img_scale(j);
+    if (WP_TILE == r->wpstyle || WP_CENTER == r->wpstyle) {
+        while (l->max_denom < 8 && s * l->max_denom * 2 <= 100)
+            l->max_denom *= 2;
+    } else {
+        l->max_denom = 8;
+        l->min_width = j->screen_width * 100 / s;
+        l->min_height = j->screen_height * 100 / s;
+    }
+}
+
+// resample, but leave shared images alone
+ST void scale_img(struct rootjob *j, HIMG *pImg, int w, int h)
+{
+    if (j->img_shared) {
+        *pImg = image_create_resampled(*pImg, w, h);
+        j->img_shared = 0;
+    } else {
+        image_resample(pImg, w, h);
+    }
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// -center/-tile images at their original size: the image is decoded
+// straight to BGRX and copied into the pixels of the gradient, with
+// no 24 bit copies of either and no copy_img pixel by pixel.
+
+struct rawimg
+{
+    BYTE *pixels; // bottom-up, as with bimage
+    int width, height;
+};
+
+ST BYTE *raw_target(void *param, int w, int h, int *stride)
+{
+    struct rawimg *ri = (struct rawimg *)param;
+    m_free(ri->pixels);
+    ri->width = w, ri->height = h;
+    ri->pixels = (BYTE*)m_alloc(w * h * 4);
+    *stride = -4 * w;
+    return ri->pixels ? ri->pixels + (h - 1) * w * 4 : NULL;
+}
+
+ST void compose_raw(BYTE *d, int w, int h, struct rawimg *ri,
+    int x0, int y0, int hue, int sat)
+{
+    int x1 = imax(0, x0), x2 = imin(w, x0 + ri->width);
+    int y1 = imax(0, y0), y2 = imin(h, y0 + ri->height);
+    int x, y;
+    BYTE *p, *q;
+
+    for (y = y1; y < y2; ++y) {
+        p = d + (y * w + x1) * 4;
+        q = ri->pixels + ((y - y0) * ri->width + x1 - x0) * 4;
+        if (sat >= 255 && hue <= 0)
+            memcpy(p, q, (x2 - x1) * 4);
+        else
+            for (x = x1; x < x2; ++x, p += 4, q += 4)
+                mix_pixel(p, q, hue, sat);
+    }
+}
+
+ST int has_texture(struct rootinfo *r)
+{
+    return r->gradient || r->mod || (r->solid && r->interlaced);
+}
+
+ST int raw_ok(struct rootjob *j)
+{
+    struct rootinfo *r = j->r;
+    return (WP_CENTER == r->wpstyle || WP_TILE == r->wpstyle)
+        && (has_texture(r) || r->save)
+        && 100 == img_scale(j)
+        && j->ld.max_denom <= 1
+        && NULL == j->load
+        && 0 == r->convert;
+}
+
+// Returns NULL if the image cannot be found or loaded, for root_render
+// to try again the usual way, which reports the error then.
+ST HIMG render_raw(struct rootjob *j)
+{
+    struct rootinfo *r = j->r;
+    int w = j->screen_width;
+    int h = j->screen_height;
+    char path[MAX_PATH];
+    const char *p;
+    struct rawimg ri;
+    struct bimage *b;
+    StyleItem si;
+    HIMG Back;
+    BYTE *d;
+    int x0, y0;
+    unsigned t0;
+
+    p = find_bmp(j, r->wpfile, path);
+    if (NULL == p)
+        return NULL;
+
+    t0 = root_usec();
+    memset(&ri, 0, sizeof ri);
+    if (!image_load_into(p, &j->ld, raw_target, &ri)) {
+        m_free(ri.pixels);
+        return NULL;
+    }
+    j->usec[RS_LOAD] += root_usec() - t0;
+
+    t0 = root_usec();
+    if (!has_texture(r) && false == r->solid)
+        r->color1 = j->desk_color;
+    si.type = r->type,
+    si.Color = r->color1,
+    si.ColorTo = r->color2,
+    si.interlaced = !!r->interlaced,
+    si.bevelstyle = r->bevelstyle,
+    si.bevelposition = r->bevelposition;
+    si.parentRelative = false;
+    root_setup();
+    b = bimage_create(w, h, &si);
+    d = bimage_getpixels(b);
+    if (r->mod)
+        for (y0 = 0; y0 < h; ++y0)
+            modula_row(d + y0 * w * 4, w, y0, h, r);
+    j->usec[RS_GRADIENT] += root_usec() - t0;
+
+    t0 = root_usec();
+    if (WP_TILE == r->wpstyle) {
+        for (x0 = 0; x0 < w; x0 += ri.width)
+        for (y0 = 0; y0 < h; y0 += ri.height)
+            compose_raw(d, w, h, &ri, x0, y0, r->hue, r->sat);
+    } else {
+        x0 = (w - ri.width) / 2;
+        y0 = (h - ri.height) / 2;
+        compose_raw(d, w, h, &ri, x0, y0, r->hue, r->sat);
+    }
+    m_free(ri.pixels);
+    Back = image_create_fromraw(w, h, d);
+    bimage_destroy(b);
+    j->usec[RS_COMPOSE] += root_usec() - t0;
+    return Back;
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+// Load the image, create the gradient and compose them as requested
+// by the switches in j->r. Returns 0 on fatal errors. Otherwise the
+// result in j->Back/j->Img is usable, even if j->error_msg was set
+// for a missing image. The caller needs to check r->save/r->wpstyle
+// for what to do with the result.
+
+int root_render(struct rootjob *j)
+{
+    struct rootinfo *r = j->r;
+    int screen_width = j->screen_width;
+    int screen_height = j->screen_height;
+    int bmp_width, bmp_height, n;
+    unsigned t0;
+
+    HIMG Img = NULL;
+    HIMG Back = NULL;
+
+    if (r->layout[0])
+        return root_render_layout(j);
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    // try to load the image
+
+    bmp_width = bmp_height = 0;
+
+    if (r->bmp) {
+        set_load_hints(j);
+        if (raw_ok(j)) {
+            Back = render_raw(j);
+            if (Back) {
+                r->wpstyle = WP_TILE;
+                goto done;
+            }
+        }
+        t0 = root_usec();
+        n = load_bmp(j, r->wpfile, &Img);
+        j->usec[RS_LOAD] += root_usec() - t0;
+
+        if (n == 1) {
+            sprintf(j->msgbuf, "Error: Could not find image:\n%s", r->wpfile);
+            j->error_msg = j->msgbuf;
+
+        } else if (n == 2) {
+            sprintf(j->msgbuf, "Error: Could not load image - %s:\n%s", j->ld.error, r->wpfile);
+            j->error_msg = j->msgbuf;
+        }
+
+        if (Img) {
+            bmp_width  = image_getwidth(Img);
+            bmp_height = image_getheight(Img);
+
+            // scale as requested, relative to the original size.
+            // -full images are resampled to the screen anyway.
+            n = img_scale(j);
+            if (n != 100 || (j->ld.denom > 1
+                && (WP_TILE == r->wpstyle || WP_CENTER == r->wpstyle))) {
+                int w = imax(1, bmp_width * j->ld.denom * n / 100);
+                int h = imax(1, bmp_height * j->ld.denom * n / 100);
+                if (w != bmp_width || h != bmp_height) {
+                    t0 = root_usec();
+                    scale_img(j, &Img, w, h);
+                    j->usec[RS_SCALE] += root_usec() - t0;
+                    bmp_width  = image_getwidth(Img);
+                    bmp_height = image_getheight(Img);
+                }
+            }
+
+            if (r->convert) {
+                screen_width = bmp_width;
+                screen_height = bmp_height;
+            }
+
+            if (WP_NONE == r->wpstyle)
+                r->wpstyle = WP_FULL;
+
+        } else {
+            r->wpstyle = WP_NONE;
+        }
+    }
+
+    // ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+    // create background texture, if any
+
+    if (r->gradient
+        || r->mod
+        || (r->solid
+            && (r->interlaced || (r->save && NULL == Img)))) {
+
+        if (NULL == Img) {
+            // nothing to put on it, root_save will make it as it writes
+            j->stream = 1;
+            j->stream_width = screen_width;
+            j->stream_height = screen_height;
+        } else {
+            t0 = root_usec();
+            Back = DesktopGradient(r, screen_width, screen_height);
+            if (r->mod)
+                Modula(Back, r->modx, r->mody, r->modfg);
+            j->usec[RS_GRADIENT] += root_usec() - t0;
+        }
+
+    } else if (0 == r->save) {
+        // default bsetbg behaviour: use os wallpaper / SysColor
+        if (r->solid)
+            j->set_color = 1;
+
+        if (Img && (r->sat < 255 || r->hue > 0)) {
+            if (false == r->solid)
+                r->color1 = j->desk_color;
+
+            t0 = root_usec();
+            Back = DesktopGradient(r, bmp_width, bmp_height);
+            j->usec[RS_GRADIENT] += root_usec() - t0;
+
+            t0 = root_usec();
+            copy_img(Back, Img,
+                0, 0, bmp_width, bmp_height, r->hue, r->sat);
+            j->usec[RS_COMPOSE] += root_usec() - t0;
+        }
+
+        goto done;
+    }
+
+    if (Img)
+    {
+        if (WP_FULL == r->wpstyle
+            && (bmp_width != screen_width || bmp_height != screen_height)) {
+            t0 = root_usec();
+            scale_img(j, &Img, screen_width, screen_height);
+            j->usec[RS_SCALE] += root_usec() - t0;
+            bmp_width  = image_getwidth(Img);
+            bmp_height = image_getheight(Img);
+        }
+
+        if (NULL == Back) {
+            // do we need a background anyway?
+            if (r->sat < 255 || r->hue > 0
+                || bmp_width != screen_width
+                || bmp_height != screen_height
+               ) {
+                if (false == r->solid)
+                    r->color1 = j->desk_color;
+                t0 = root_usec();
+                Back = DesktopGradient(r, screen_width, screen_height);
+                j->usec[RS_GRADIENT] += root_usec() - t0;
+            }
+        }
+
+        t0 = root_usec();
+        if (Back) {
+            if (WP_TILE == r->wpstyle) {
+                int x0, y0;
+                for (x0 = 0; x0 < screen_width;  x0+=bmp_width)
+                for (y0 = 0; y0 < screen_height; y0+=bmp_height)
+                    copy_img(Back, Img,
+                        x0, y0, bmp_width, bmp_height, r->hue, r->sat);
+            } else {
+                int x0 = (screen_width  - bmp_width) / 2;
+                int y0 = (screen_height - bmp_height) / 2;
+                copy_img(Back, Img,
+                    x0, y0, bmp_width, bmp_height, r->hue, r->sat);
+            }
+        }
+        j->usec[RS_COMPOSE] += root_usec() - t0;
+    }
+    // since we have a fullscreen image now, set tile mode
+    r->wpstyle = WP_TILE;
+
+done:
+    j->Img = Img;
+    j->Back = Back;
+
+    if (0 == r->save && r->convert) {
+        j->error_msg = "Error: -convert needs -save";
+        return 0;
+    }
+    return 1;
+}
+
+//===========================================================================
+// one pixel of the image 's' onto 'd', with saturation and hue (BGR order)
+ST void mix_pixel(BYTE *d, const BYTE *s, int hueIntensity, int saturationValue)
+{
+    unsigned r = s[2];
+    unsigned g = s[1];
+    unsigned b = s[0];
+    // First we apply saturation...
+    if (saturationValue<255)
+    {
+        unsigned greyscale =
+            (79*r + 156*g + 21*b) * (255-saturationValue)/256 + 255;
+
+        r = (r*saturationValue + greyscale)>>8;
+        g = (g*saturationValue + greyscale)>>8;
+        b = (b*saturationValue + greyscale)>>8;
+    }
+    // ...and hue according to color and intensity...
+    if (hueIntensity>0)
+    {
+        unsigned ih = 255 - hueIntensity;
+        r = (ih*r + hueIntensity*d[2] + 255)>>8;
+        g = (ih*g + hueIntensity*d[1] + 255)>>8;
+        b = (ih*b + hueIntensity*d[0] + 255)>>8;
+    }
+    d[0] = b;
+    d[1] = g;
+    d[2] = r;
+}
+
+void copy_img(HIMG Img1, HIMG Img2,
+    int x0, int y0, int xs, int ys, int hueIntensity, int saturationValue)
+{
+    int x, y;
+    for (y = 0; y < ys; y++)
+    for (x = 0; x < xs; x++)
+    {
+        RGBQUAD pix1 = image_getpixel(Img2, x, y);
+        RGBQUAD pix2 = pix1;
+        if (hueIntensity>0)
+            pix2 = image_getpixel(Img1, x0+x, y0+y);
+        mix_pixel((BYTE*)&pix2, (BYTE*)&pix1, hueIntensity, saturationValue);
+        image_setpixel(Img1, x0+x, y0+y, pix2);
+    }
+}
+
+//===========================================================================
+HIMG DesktopGradient(struct rootinfo *r, int width, int height)
+{
+    struct bimage *b;
+    HIMG h;
+    StyleItem si;
+
+    si.type = r->type,
+    si.Color = r->color1,
+    si.ColorTo = r->color2,
+    si.interlaced = !!r->interlaced,
+    si.bevelstyle = r->bevelstyle,
+    si.bevelposition = r->bevelposition;
+    si.parentRelative = false;
+
+    root_setup();
+    b = bimage_create(width, height, &si);
+    h = image_create_fromraw(width, height, bimage_getpixels(b));
+    bimage_destroy(b);
+    return h;
+}
+
+//===========================================================================
+void Modula(HIMG Img, int mx, int my, COLORREF fg)
+{
+    RGBQUAD q; int x, y;
+    int width  = image_getwidth(Img);
+    int height = image_getheight(Img);
+    *(COLORREF*)&q = switch_rgb(fg);
+    if (my > 1)
+        for (y = height-my; y >= 0; y-=my)
+        for (x = 0; x < width; x++)
+            image_setpixel(Img, x, y, q);
+    if (mx > 1)
+        for (y = height; --y >= 0;)
+        for (x = mx-1; x < width; x+= mx)
+            image_setpixel(Img, x, y, q);
+}
+
+//===========================================================================
+bool FileExists(LPCSTR szFileName)
+{
+    DWORD a = GetFileAttributes(szFileName);
+    return (DWORD)-1 != a && 0 == (a & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+char *make_full_path(char *buffer, const char *filename, const char *search_base)
+{
+    char exe_path[MAX_PATH];
+    if (search_base && search_base[0]) {
+        join_path(buffer, search_base, filename);
+        if (FileExists(buffer))
+            return buffer;
+    }
+
+    get_exe_path(NULL, exe_path, sizeof exe_path);
+    return join_path(buffer, exe_path, filename);
+}
+
+char *read_line(FILE *fp, char *buffer)
+{
+    char *s;
+    do {
+        s = buffer;
+        if (NULL==fgets(s, MAX_PATH, fp))
+            return NULL;
+
+        while (*s) { if (IS_SPC(*s)) *s = ' '; ++s; }
+        while (s > buffer && IS_SPC(s[-1])) s--;
+        *s=0;
+        s = buffer;
+        while (*s && IS_SPC(*s)) ++s;
+    } while ('#' == *s || '!' == *s || 0 == *s);
+    return strcpy(buffer, s);
+}
+
+// Read switches from bsetroot.rc. Returns 0 and the offending line
+// in errbuf on parse errors, a missing file is not an error.
+int read_rcfile(struct rootinfo *r, const char *path, char *errbuf)
+{
+    char temp[MAX_PATH];
+    FILE *fp = fopen(path, "rb");
+    if (fp) {
+        while (read_line(fp, temp)) {
+            if ('-' == temp[0] && !parse_root(r, temp)) {
+                sprintf(errbuf, "Error: in bsetroot.rc:\n%s", temp);
+                fclose(fp);
+                return 0;
+            }
+        }
+        fclose(fp);
+    }
+    return 1;
+}
+
+//===========================================================================
+// look for the image where bsetroot looks for it, returns the path or NULL
+ST const char *find_bmp(struct rootjob *j, const char *filename, char *path)
+{
+    string_node *searchpaths = j->r->paths;
+    const char *search_base = j->r->search_base;
+    char temp[MAX_PATH];
+    const char *p;
+    int state;
+
+    for (state = 0;;++state) {
+        switch (state) {
+        case 0: // try original name
+            p = filename;
+            goto try_it;
+        case 1: // try from exe-path
+            p = filename;
+            break;
+        case 2: // try searchpaths listed in "bsetroot.rc"
+            if (NULL == searchpaths)
+                continue;
+            -- state; // might have still more lines
+            p = join_path(path, searchpaths->str, file_basename(filename));
+            searchpaths = searchpaths->next;
+            break;
+        case 3:  // try backgrounds/path
+            p = join_path(path, "backgrounds", filename);
+            break;
+        case 4:  // try backgrounds/file
+            p = join_path(path, "backgrounds", file_basename(filename));
+            break;
+        default: // give up
+            return NULL;
+        }
+
+        if (!is_absolute_path(p))
+            p = make_full_path(path, strcpy(temp, p), search_base);
+try_it:
+        if (FileExists(p))
+            return p;
+    }
+}
+
+int load_bmp(struct rootjob *j, const char *filename, HIMG *pImg)
+{
+    char path[MAX_PATH];
+    const char *p = find_bmp(j, filename, path);
+    if (NULL == p)
+        return 1;
+    if (j->load)
+        *pImg = j->load(j, p, &j->img_shared);
+    else
+        *pImg = image_load(p, &j->ld);
+    return *pImg ? 0 : 2;
+}
+
+//===========================================================================
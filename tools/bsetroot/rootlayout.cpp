@@ -0,0 +1,238 @@
+/* ==========================================================================
+
+  This file is part of the bbLean source code
+  Copyright  2001-2003 The Blackbox for Windows Development Team
+  Copyright  2004-2009 grischka
+
+  http://bb4win.sourceforge.net/bblean
+  http://developer.berlios.de/projects/bblean
+
+  bbLean is free software, released under the GNU General Public License
+  (GPL version 2). For details see:
+
+  http://www.fsf.org/licenses/gpl.html
+
+  This program is distributed in the hope that it will be useful, but
+  WITHOUT ANY WARRANTY; without even the implied warranty of MERCHANTABILITY
+  or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General Public License
+  for more details.
+
+  ========================================================================== */
+
+// Per monitor layouts: '-layout <file>' gives a list of rectangles,
+// each with its own image and/or gradient. The regions are rendered
+// in parallel and then put together into one image for the virtual
+// desktop, over the background from the other switches, if any.
+//
+// Line format (empty lines and '#' comments are skipped):
+//
+//     <width>x<height>+<x>+<y> <switches>
+//     @<n> <switches>          n-th monitor (1 = first)
+//     * <switches>             the whole desktop
+//
+// Coordinates are relative to the top-left of the desktop image.
+
+#include "BBApi.h"
+#include "bbroot.h"
+#include "bsetroot.h"
+
+#ifdef _WIN32
+#include <process.h>
+#else
+#include <pthread.h>
+#endif
+
+#define ST static
+#define MAX_REGIONS 32
+
+struct region
+{
+    struct rootinfo ri;
+    struct rootjob job;
+    int x, y;
+};
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+#ifdef _WIN32
+ST unsigned __stdcall region_thread(void *arg)
+#else
+ST void *region_thread(void *arg)
+#endif
+{
+    struct rootjob *j = &((struct region *)arg)->job;
+    root_render(j);
+    root_result(j);
+    return 0;
+}
+
+ST void render_parallel(struct region *rg, int count)
+{
+    int i;
+#ifdef _WIN32
+    HANDLE t[MAX_REGIONS];
+    for (i = 0; i < count; ++i)
+        t[i] = (HANDLE)_beginthreadex(NULL, 0, region_thread, &rg[i], 0, NULL);
+    for (i = 0; i < count; ++i)
+        if (t[i])
+            WaitForSingleObject(t[i], INFINITE), CloseHandle(t[i]);
+        else
+            region_thread(&rg[i]);
+#else
+    pthread_t t[MAX_REGIONS];
+    char ok[MAX_REGIONS];
+    for (i = 0; i < count; ++i)
+        ok[i] = 0 == pthread_create(&t[i], NULL, region_thread, &rg[i]);
+    for (i = 0; i < count; ++i)
+        if (ok[i])
+            pthread_join(t[i], NULL);
+        else
+            region_thread(&rg[i]);
+#endif
+}
+
+// ~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~~
+ST int read_region(struct rootjob *j, const char *s, RECT *rc)
+{
+    int w, h, x, y, n;
+    if ('*' == s[0] && 0 == s[1]) {
+        rc->left = rc->top = 0;
+        rc->right = j->screen_width;
+        rc->bottom = j->screen_height;
+        return 1;
+    }
+    if ('@' == s[0]) {
+        n = atoi(s + 1);
+        if (n < 1 || n > j->monitor_count)
+            return 0;
+        *rc = j->monitors[n-1];
+        return 1;
+    }
+    if (4 != sscanf(s, "%dx%d%d%d", &w, &h, &x, &y) || w < 1 || h < 1)
+        return 0;
+    rc->left = x, rc->top = y;
+    rc->right = x + w, rc->bottom = y + h;
+    return 1;
+}
+
+// a region that renders with the same settings as the parent job
+ST void init_region(struct region *g, struct rootjob *j, int x, int y, int w, int h)
+{
+    struct rootjob *rj = &g->job;
+    root_init_job(rj, &g->ri, w, h);
+    rj->desk_color = j->desk_color;
+    rj->zoom = j->zoom;
+    rj->preview = j->preview;
+    rj->load = j->load;
+    rj->load_data = j->load_data;
+    g->x = x, g->y = y;
+}
+
+int root_render_layout(struct rootjob *j)
+{
+    struct rootinfo *r = j->r;
+    struct region *rg, *g;
+    char line[MAX_PATH*2], geom[100];
+    const char *s;
+    int count, n, i, ok;
+    COLORREF color;
+    RECT rc;
+    FILE *fp;
+
+    fp = fopen(r->layout, "rb");
+    if (NULL == fp) {
+        sprintf(j->msgbuf, "Error: Could not open layout:\n%s", r->layout);
+        j->error_msg = j->msgbuf;
+        return 0;
+    }
+
+    rg = (struct region *)c_alloc(MAX_REGIONS * sizeof *rg);
+
+    root_setup();
+
+    // the background from the other switches, over the desktop color
+    // if none is given, such that it covers everything
+    g = &rg[0];
+    init_region(g, j, 0, 0, j->screen_width, j->screen_height);
+    g->ri = *r;
+    g->ri.layout[0] = 0;
+    g->ri.save = 1;
+    g->ri.convert = 0;
+    if (0 == (g->ri.solid | g->ri.gradient | g->ri.mod)) {
+        g->ri.solid = 1;
+        g->ri.type = B_SOLID;
+        g->ri.color1 = j->desk_color;
+    }
+    color = g->ri.color1;
+    count = 1;
+
+    for (n = 1, ok = 1; ok && fgets(line, sizeof line, fp); ++n) {
+        s = line;
+        line[strcspn(line, "\r\n")] = 0;
+        skip_spc(&s);
+        if (0 == *s || '#' == *s)
+            continue;
+        ok = 0;
+        if (count == MAX_REGIONS)
+            break;
+        NextToken(geom, &s, " ");
+        if (!read_region(j, geom, &rc))
+            break;
+
+        g = &rg[count];
+        init_root(&g->ri);
+        // -path/-prefix as with the main command, the list is shared
+        strcpy(g->ri.search_base, r->search_base);
+        g->ri.paths = r->paths;
+        if (!parse_root(&g->ri, s) || g->ri.layout[0]) {
+            g->ri.paths = NULL;
+            delete_root(&g->ri);
+            break;
+        }
+        init_region(g, j, rc.left, rc.top, rc.right - rc.left, rc.bottom - rc.top);
+        g->ri.save = 1;
+        g->ri.convert = 0;
+        g->job.desk_color = color;
+        ++count, ok = 1;
+    }
+    fclose(fp);
+
+    if (0 == ok) {
+        sprintf(j->msgbuf, "Error: in layout, line %d:\n%s", n, r->layout);
+        j->error_msg = j->msgbuf;
+    } else {
+        render_parallel(rg, count);
+
+        // put together, in the order as listed
+        j->Back = image_create_fromraw(j->screen_width, j->screen_height, NULL);
+        for (i = 0; i < count; ++i) {
+            g = &rg[i];
+            if (NULL == j->error_msg && g->job.error_msg) {
+                strcpy(j->msgbuf, g->job.error_msg);
+                j->error_msg = j->msgbuf;
+            }
+            for (n = 0; n < RS_LAST; ++n)
+                j->usec[n] += g->job.usec[n];
+            if (root_result(&g->job)) {
+                unsigned t0 = root_usec();
+                image_blit(j->Back, root_result(&g->job), g->x, g->y);
+                j->usec[RS_COMPOSE] += root_usec() - t0;
+            }
+        }
+    }
+
+    for (i = 0; i < count; ++i) {
+        g = &rg[i];
+        root_free_job(&g->job);
+        if (i) {
+            g->ri.paths = NULL;
+            delete_root(&g->ri);
+        }
+    }
+    m_free(rg);
+
+    // since we have a fullscreen image now, set tile mode
+    r->wpstyle = WP_TILE;
+    return ok;
+}
+
+//===========================================================================